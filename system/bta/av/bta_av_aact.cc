@@ -2135,7 +2135,7 @@ void bta_av_data_path(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
         size_t fragment_len = data_end - data_begin;
         if (fragment_len > p_scb->stream_mtu) fragment_len = p_scb->stream_mtu;
 
-        BT_HDR* p_buf2 = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+        BT_HDR* p_buf2 = (BT_HDR*)osi_buffer_malloc(BT_DEFAULT_BUFFER_SIZE);
         p_buf2->offset = p_buf->offset;
         p_buf2->len = 0;
         p_buf2->layer_specific = 0;
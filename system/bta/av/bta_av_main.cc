@@ -1076,7 +1076,7 @@ void bta_av_dup_audio_buf(tBTA_AV_SCB* p_scb, BT_HDR* p_buf) {
       continue; /* Audio is not connected */
 
     /* Enqueue the data */
-    BT_HDR* p_new = (BT_HDR*)osi_malloc(copy_size);
+    BT_HDR* p_new = (BT_HDR*)osi_buffer_malloc(copy_size);
     memcpy(p_new, p_buf, copy_size);
     list_append(p_scbi->a2dp_list, p_new);
 
@@ -21,12 +21,17 @@
 #include <base/logging.h>
 #include <base/strings/string_number_conversions.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "bta/gatt/bta_gattc_int.h"
+#include "bta/gatt/database_cache.h"
 #include "osi/include/log.h"
 
 using gatt::StoredAttribute;
@@ -44,6 +49,10 @@ using std::vector;
 // Default expired time is 7 days
 #define GATT_HASH_EXPIRED_TIME 604800
 
+// Number of decoded databases kept in memory, shared by every server with the
+// same database hash
+#define GATT_DB_CACHE_MAX_SIZE 8
+
 static void bta_gattc_hash_remove_least_recently_used_if_possible();
 
 static void bta_gattc_generate_cache_file_name(char* buffer, size_t buffer_len,
@@ -61,11 +70,18 @@ static void bta_gattc_generate_hash_file_name(char* buffer, size_t buffer_len,
 
 static gatt::Database EMPTY_DB;
 
+// Reconnecting to any server whose hash is in here skips both the file read
+// and the decoding
+static gatt::DatabaseCache db_cache(GATT_DB_CACHE_MAX_SIZE);
+
 /*******************************************************************************
  *
  * Function         bta_gattc_load_db
  *
- * Description      Load GATT database from storage.
+ * Description      Load GATT database from storage. The file is mapped and all
+ *                  of its attributes are decoded straight from the mapping
+ *                  rather than read into a buffer first. The mapping does not
+ *                  outlive the call.
  *
  * Parameter        fname: input file name
  *
@@ -74,49 +90,52 @@ static gatt::Database EMPTY_DB;
  *
  ******************************************************************************/
 static gatt::Database bta_gattc_load_db(const char* fname) {
-  FILE* fd = fopen(fname, "rb");
-  if (!fd) {
+  int fd = open(fname, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
     LOG(ERROR) << __func__ << ": can't open GATT cache file " << fname
                << " for reading, error: " << strerror(errno);
     return EMPTY_DB;
   }
 
-  uint16_t cache_ver = 0;
-  uint16_t num_attr = 0;
-
-  if (fread(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__ << ": can't read GATT cache version from: " << fname;
-    goto done;
-  }
-
-  if (cache_ver != GATT_CACHE_VERSION) {
-    LOG(ERROR) << __func__ << ": wrong GATT cache version: " << fname;
-    goto done;
+  struct stat st;
+  if (fstat(fd, &st) == -1 || st.st_size < (off_t)(2 * sizeof(uint16_t))) {
+    LOG(ERROR) << __func__ << ": can't read GATT cache header from: " << fname;
+    close(fd);
+    return EMPTY_DB;
   }
 
-  if (fread(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__
-               << ": can't read number of GATT attributes: " << fname;
-    goto done;
+  size_t file_size = st.st_size;
+  void* map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    LOG(ERROR) << __func__ << ": can't map GATT cache file " << fname
+               << ", error: " << strerror(errno);
+    return EMPTY_DB;
   }
 
-  {
-    std::vector<StoredAttribute> attr(num_attr);
-
-    if (fread(attr.data(), sizeof(StoredAttribute), num_attr, fd) != num_attr) {
-      LOG(ERROR) << __func__ << ": can't read GATT attributes: " << fname;
-      goto done;
-    }
-    fclose(fd);
+  const uint8_t* data = static_cast<const uint8_t*>(map);
+  uint16_t cache_ver = 0;
+  uint16_t num_attr = 0;
+  memcpy(&cache_ver, data, sizeof(uint16_t));
+  memcpy(&num_attr, data + sizeof(uint16_t), sizeof(uint16_t));
 
+  gatt::Database result = EMPTY_DB;
+  if (cache_ver != GATT_CACHE_VERSION) {
+    LOG(ERROR) << __func__ << ": wrong GATT cache version: " << fname;
+  } else if (file_size <
+             2 * sizeof(uint16_t) + num_attr * sizeof(StoredAttribute)) {
+    LOG(ERROR) << __func__ << ": can't read GATT attributes: " << fname;
+  } else {
+    // The header is 4 bytes, which keeps the attributes suitably aligned
     bool success = false;
-    gatt::Database result = gatt::Database::Deserialize(attr, &success);
-    return success ? result : EMPTY_DB;
+    gatt::Database db = gatt::Database::Deserialize(
+        reinterpret_cast<const StoredAttribute*>(data + 2 * sizeof(uint16_t)),
+        num_attr, &success);
+    if (success) result = std::move(db);
   }
 
-done:
-  fclose(fd);
-  return EMPTY_DB;
+  munmap(map, file_size);
+  return result;
 }
 
 /*******************************************************************************
@@ -132,9 +151,18 @@ done:
  *
  ******************************************************************************/
 gatt::Database bta_gattc_cache_load(const RawAddress& server_bda) {
+  const gatt::Database* cached = db_cache.FindByServer(server_bda);
+  if (cached != nullptr) return *cached;
+
   char fname[255] = {0};
   bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
-  return bta_gattc_load_db(fname);
+  gatt::Database db = bta_gattc_load_db(fname);
+  if (!db.IsEmpty()) {
+    Octet16 hash = db.Hash();
+    db_cache.LinkServer(server_bda, hash);
+    db_cache.Put(hash, db);
+  }
+  return db;
 }
 
 /*******************************************************************************
@@ -150,9 +178,14 @@ gatt::Database bta_gattc_cache_load(const RawAddress& server_bda) {
  *
  ******************************************************************************/
 gatt::Database bta_gattc_hash_load(const Octet16& hash) {
+  const gatt::Database* cached = db_cache.Find(hash);
+  if (cached != nullptr) return *cached;
+
   char fname[255] = {0};
   bta_gattc_generate_hash_file_name(fname, sizeof(fname), hash);
-  return bta_gattc_load_db(fname);
+  gatt::Database db = bta_gattc_load_db(fname);
+  if (!db.IsEmpty()) db_cache.Put(hash, db);
+  return db;
 }
 
 /*******************************************************************************
@@ -249,9 +282,21 @@ void bta_gattc_cache_link(const RawAddress& server_bda, const Octet16& hash) {
   bta_gattc_generate_hash_file_name(hash_file, sizeof(hash_file), hash);
 
   unlink(addr_file);  // remove addr file first if the file exists
-  if (link(hash_file, addr_file) == -1) {
+  int result = link(hash_file, addr_file);
+  if (result == -1 && errno == ENOENT) {
+    // The hash file may have been evicted while its database is still held
+    // in memory; write it back so that the link can be made
+    const gatt::Database* db = db_cache.Find(hash);
+    if (db != nullptr && bta_gattc_store_db(hash_file, db->Serialize())) {
+      result = link(hash_file, addr_file);
+    }
+  }
+  if (result == -1) {
     LOG_ERROR("link %s to %s, errno=%d", addr_file, hash_file, errno);
+    db_cache.UnlinkServer(server_bda);
+    return;
   }
+  db_cache.LinkServer(server_bda, hash);
 }
 
 /*******************************************************************************
@@ -271,7 +316,9 @@ bool bta_gattc_hash_write(const Octet16& hash, const gatt::Database& database) {
   char fname[255] = {0};
   bta_gattc_generate_hash_file_name(fname, sizeof(fname), hash);
   bta_gattc_hash_remove_least_recently_used_if_possible();
-  return bta_gattc_store_db(fname, database.Serialize());
+  if (!bta_gattc_store_db(fname, database.Serialize())) return false;
+  db_cache.Put(hash, database);
+  return true;
 }
 
 /*******************************************************************************
@@ -291,6 +338,7 @@ void bta_gattc_cache_reset(const RawAddress& server_bda) {
   char fname[255] = {0};
   bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
   unlink(fname);
+  db_cache.UnlinkServer(server_bda);
 }
 
 /*******************************************************************************
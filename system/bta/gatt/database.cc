@@ -61,6 +61,81 @@ Service* FindService(std::list<Service>& services, uint16_t handle) {
   return nullptr;
 }
 
+void Database::BuildIndex() {
+  service_index.clear();
+  handle_index.clear();
+
+  size_t num_handles = 0;
+  for (const Service& service : services) {
+    for (const Characteristic& c : service.characteristics) {
+      num_handles += 1 + c.descriptors.size();
+    }
+  }
+  service_index.reserve(services.size());
+  handle_index.reserve(num_handles);
+
+  for (const Service& service : services) {
+    service_index.push_back({service.handle, service.end_handle, &service});
+    for (const Characteristic& c : service.characteristics) {
+      handle_index.push_back({c.value_handle, &c, nullptr});
+      for (const Descriptor& d : c.descriptors) {
+        handle_index.push_back({d.handle, &c, &d});
+      }
+    }
+  }
+
+  // Services and attributes are normally kept in handle order already, but
+  // do not rely on it. Stable, so the first of any duplicates still wins.
+  std::stable_sort(
+      service_index.begin(), service_index.end(),
+      [](const ServiceRange& a, const ServiceRange& b) {
+        return a.handle < b.handle;
+      });
+  std::stable_sort(handle_index.begin(), handle_index.end(),
+                   [](const HandleEntry& a, const HandleEntry& b) {
+                     return a.handle < b.handle;
+                   });
+}
+
+const Service* Database::FindService(uint16_t handle) const {
+  // Last service starting at or before |handle|
+  auto it = std::upper_bound(
+      service_index.begin(), service_index.end(), handle,
+      [](uint16_t h, const ServiceRange& range) { return h < range.handle; });
+  if (it == service_index.begin()) return nullptr;
+  --it;
+  if (handle > it->end_handle) return nullptr;
+  return it->service;
+}
+
+const Database::HandleEntry* Database::FindHandleEntry(uint16_t handle) const {
+  auto it = std::lower_bound(
+      handle_index.begin(), handle_index.end(), handle,
+      [](const HandleEntry& entry, uint16_t h) { return entry.handle < h; });
+  if (it == handle_index.end() || it->handle != handle) return nullptr;
+  return &*it;
+}
+
+const Characteristic* Database::FindCharacteristic(
+    uint16_t value_handle) const {
+  const HandleEntry* entry = FindHandleEntry(value_handle);
+  if (!entry || entry->descriptor) return nullptr;
+  return entry->characteristic;
+}
+
+const Descriptor* Database::FindDescriptor(uint16_t handle) const {
+  const HandleEntry* entry = FindHandleEntry(handle);
+  if (!entry) return nullptr;
+  return entry->descriptor;
+}
+
+const Characteristic* Database::FindOwningCharacteristic(
+    uint16_t handle) const {
+  const HandleEntry* entry = FindHandleEntry(handle);
+  if (!entry || !entry->descriptor) return nullptr;
+  return entry->characteristic;
+}
+
 std::string Database::ToString() const {
   std::stringstream tmp;
 
@@ -139,11 +214,17 @@ std::vector<StoredAttribute> Database::Serialize() const {
 
 Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
                                bool* success) {
+  return Deserialize(nv_attr.data(), nv_attr.size(), success);
+}
+
+Database Database::Deserialize(const StoredAttribute* nv_attr, size_t count,
+                               bool* success) {
   // clear reallocating
   Database result;
-  auto it = nv_attr.cbegin();
+  const StoredAttribute* it = nv_attr;
+  const StoredAttribute* end = nv_attr + count;
 
-  for (; it != nv_attr.cend(); ++it) {
+  for (; it != end; ++it) {
     const auto& attr = *it;
     if (attr.type != PRIMARY_SERVICE && attr.type != SECONDARY_SERVICE) break;
     result.services.emplace_back(Service{
@@ -155,7 +236,7 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
   }
 
   auto current_service_it = result.services.begin();
-  for (; it != nv_attr.cend(); it++) {
+  for (; it != end; it++) {
     const auto& attr = *it;
 
     // go to the service this attribute belongs to; attributes are stored in
@@ -170,15 +251,17 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
       LOG(ERROR) << "Can't find service for attribute with handle: "
                  << loghex(attr.handle);
       *success = false;
+      result.BuildIndex();
       return result;
     }
 
     if (attr.type == INCLUDE) {
-      Service* included_service =
-          FindService(result.services, attr.value.included_service.handle);
+      Service* included_service = gatt::FindService(
+          result.services, attr.value.included_service.handle);
       if (!included_service) {
         LOG(ERROR) << __func__ << ": Non-existing included service!";
         *success = false;
+        result.BuildIndex();
         return result;
       }
       current_service_it->included_services.push_back(IncludedService{
@@ -210,6 +293,7 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
     }
   }
   *success = true;
+  result.BuildIndex();
   return result;
 }
 
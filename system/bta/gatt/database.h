@@ -102,12 +102,44 @@ class DatabaseBuilder;
 
 class Database {
  public:
+  Database() = default;
+  /* The handle index points into |services|, so copies rebuild their own */
+  Database(const Database& other) : services(other.services) { BuildIndex(); }
+  Database& operator=(const Database& other) {
+    if (this != &other) {
+      services = other.services;
+      BuildIndex();
+    }
+    return *this;
+  }
+  Database(Database&&) = default;
+  Database& operator=(Database&&) = default;
+
   /* Return true if there are no services in this database. */
   bool IsEmpty() const { return services.empty(); }
 
   /* Clear the GATT database. This method forces relocation to ensure no extra
    * space is used unnecesarly */
-  void Clear() { std::list<Service>().swap(services); }
+  void Clear() {
+    std::list<Service>().swap(services);
+    std::vector<ServiceRange>().swap(service_index);
+    std::vector<HandleEntry>().swap(handle_index);
+  }
+
+  /* Handle lookups, each a binary search over a flat array sorted by handle.
+   * Return nullptr when nothing matches. */
+
+  /* Service whose handle range contains |handle| */
+  const Service* FindService(uint16_t handle) const;
+
+  /* Characteristic with the given value handle */
+  const Characteristic* FindCharacteristic(uint16_t value_handle) const;
+
+  /* Descriptor with the given handle */
+  const Descriptor* FindDescriptor(uint16_t handle) const;
+
+  /* Characteristic that the descriptor with the given handle belongs to */
+  const Characteristic* FindOwningCharacteristic(uint16_t handle) const;
 
   /* Return list of services available in this database */
   const std::list<Service>& Services() const { return services; }
@@ -119,13 +151,39 @@ class Database {
   static Database Deserialize(const std::vector<gatt::StoredAttribute>& nv_attr,
                               bool* success);
 
+  /* Same as above, for attributes that are not held in a vector, i.e. read
+   * straight from a mapped cache file */
+  static Database Deserialize(const gatt::StoredAttribute* nv_attr,
+                              size_t count, bool* success);
+
   /* Return 128 bit unique identifier of this GATT database */
   Octet16 Hash() const;
 
   friend class DatabaseBuilder;
 
  private:
+  struct ServiceRange {
+    uint16_t handle;
+    uint16_t end_handle;
+    const Service* service;
+  };
+
+  /* One entry per characteristic value and per descriptor. |descriptor| is
+   * nullptr for characteristic values. */
+  struct HandleEntry {
+    uint16_t handle;
+    const Characteristic* characteristic;
+    const Descriptor* descriptor;
+  };
+
+  /* Must be called whenever |services| changes shape */
+  void BuildIndex();
+
+  const HandleEntry* FindHandleEntry(uint16_t handle) const;
+
   std::list<Service> services;
+  std::vector<ServiceRange> service_index;
+  std::vector<HandleEntry> handle_index;
 };
 
 /* Find a service that should contain handle. Helper method for internal use
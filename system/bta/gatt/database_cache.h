@@ -0,0 +1,89 @@
+/******************************************************************************
+ *
+ *  Copyright 2022 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <utility>
+
+#include "bta/gatt/database.h"
+#include "types/raw_address.h"
+
+namespace gatt {
+
+/* Decoded databases, keyed by database hash and shared by every server with
+ * that hash, along with the hash of each server whose database is known. Only
+ * the |max_size| most recently used databases are kept. */
+class DatabaseCache {
+ public:
+  explicit DatabaseCache(size_t max_size) : max_size(max_size) {}
+
+  /* Return the database with |hash| and mark it as the most recently used, or
+   * nullptr if it is not cached. */
+  const Database* Find(const Octet16& hash) {
+    for (auto it = databases.begin(); it != databases.end(); it++) {
+      if (it->first == hash) {
+        databases.splice(databases.begin(), databases, it);
+        return &databases.front().second;
+      }
+    }
+    return nullptr;
+  }
+
+  /* Return the cached database of |server_bda|, or nullptr if its hash is not
+   * known or its database is not cached. */
+  const Database* FindByServer(const RawAddress& server_bda) {
+    auto it = server_hashes.find(server_bda);
+    if (it == server_hashes.end()) return nullptr;
+    return Find(it->second);
+  }
+
+  /* Cache |database| as the most recently used, evicting the least recently
+   * used database if the cache is full. */
+  void Put(const Octet16& hash, const Database& database) {
+    if (Find(hash) != nullptr) {
+      databases.front().second = database;
+      return;
+    }
+    databases.emplace_front(hash, database);
+    if (databases.size() > max_size) {
+      databases.pop_back();
+    }
+  }
+
+  /* Record that the database of |server_bda| has |hash|. */
+  void LinkServer(const RawAddress& server_bda, const Octet16& hash) {
+    server_hashes[server_bda] = hash;
+  }
+
+  /* Forget the database hash of |server_bda|. */
+  void UnlinkServer(const RawAddress& server_bda) {
+    server_hashes.erase(server_bda);
+  }
+
+  size_t Size() const { return databases.size(); }
+
+ private:
+  size_t max_size;
+  /* Most recently used first */
+  std::list<std::pair<Octet16, Database>> databases;
+  std::map<RawAddress, Octet16> server_hashes;
+};
+
+}  // namespace gatt
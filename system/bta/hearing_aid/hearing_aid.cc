@@ -25,12 +25,22 @@
 #include <base/logging.h>
 #include <base/strings/string_number_conversions.h>  // HexEncode
 
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "bta/include/bta_gatt_api.h"
 #include "bta/include/bta_gatt_queue.h"
 #include "bta/include/bta_hearing_aid_api.h"
+#include "common/message_loop_thread.h"
 #include "device/include/controller.h"
 #include "embdrv/g722/g722_enc_dec.h"
 #include "osi/include/compat.h"
@@ -217,24 +227,156 @@ static void write_rpt_ctl_cfg_cb(uint16_t conn_id, tGATT_STATUS status,
   }
 }
 
-g722_encode_state_t* encoder_state_left = nullptr;
-g722_encode_state_t* encoder_state_right = nullptr;
+// G.722 encoder for one side. The PCM and encoded buffers only ever grow,
+// so once streaming they are reused on every audio tick.
+struct G722EncodeChannel {
+  g722_encode_state_t* state = nullptr;
+  std::vector<int16_t> pcm;
+  std::vector<uint8_t> encoded;
+  int encoded_size = 0;
+
+  void Reserve(int num_samples) {
+    if (pcm.size() < static_cast<size_t>(num_samples)) {
+      pcm.resize(num_samples);
+      // G.722 produces one byte for every two input samples
+      encoded.resize(num_samples / 2);
+    }
+  }
+
+  void Encode(int num_samples) {
+    encoded_size =
+        g722_encode_fast(state, encoded.data(), pcm.data(), num_samples);
+  }
+};
+
+// Encodes one side on its own message loop thread, so that with both hearing
+// aids streaming the two independent encoders run concurrently.
+class G722ChannelWorker {
+ public:
+  void Start() {
+    if (thread_.IsRunning()) return;
+    thread_.StartUp();
+    if (!thread_.IsRunning()) {
+      LOG(ERROR) << __func__ << ": unable to start the encoder thread";
+    }
+  }
+
+  void Stop() { thread_.ShutDown(); }
+
+  bool IsRunning() { return thread_.IsRunning(); }
+
+  // |channel| must not be touched by the caller until Wait() returns
+  void Post(G722EncodeChannel* channel, int num_samples) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_ = true;
+    }
+    if (!thread_.DoInThread(
+            FROM_HERE, base::BindOnce(&G722ChannelWorker::Encode,
+                                      base::Unretained(this), channel,
+                                      num_samples))) {
+      Encode(channel, num_samples);
+    }
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !pending_; });
+  }
+
+ private:
+  void Encode(G722EncodeChannel* channel, int num_samples) {
+    channel->Encode(num_samples);
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_ = false;
+    cv_.notify_all();
+  }
+
+  bluetooth::common::MessageLoopThread thread_{"bt_hearing_aid_encoder"};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool pending_ = false;
+};
+
+G722EncodeChannel encoder_left;
+G722EncodeChannel encoder_right;
+G722ChannelWorker encoder_right_worker;
 
 inline void encoder_state_init() {
-  if (encoder_state_left != nullptr) {
+  if (encoder_left.state != nullptr) {
     LOG(WARNING) << __func__ << ": encoder already initialized";
     return;
   }
-  encoder_state_left = g722_encode_init(nullptr, 64000, G722_PACKED);
-  encoder_state_right = g722_encode_init(nullptr, 64000, G722_PACKED);
+  encoder_left.state = g722_encode_init(nullptr, 64000, G722_PACKED);
+  encoder_right.state = g722_encode_init(nullptr, 64000, G722_PACKED);
+  // With a single core the hand-off would only add latency
+  if (std::thread::hardware_concurrency() > 1) {
+    encoder_right_worker.Start();
+  }
 }
 
 inline void encoder_state_release() {
-  if (encoder_state_left != nullptr) {
-    g722_encode_release(encoder_state_left);
-    encoder_state_left = nullptr;
-    g722_encode_release(encoder_state_right);
-    encoder_state_right = nullptr;
+  if (encoder_left.state != nullptr) {
+    encoder_right_worker.Stop();
+    g722_encode_release(encoder_left.state);
+    encoder_left.state = nullptr;
+    g722_encode_release(encoder_right.state);
+    encoder_right.state = nullptr;
+  }
+}
+
+// Split 16 bit little endian stereo PCM into the two encoder inputs, scaled
+// down by one bit as the encoder expects. With |downmix| both outputs get
+// the average of the two channels.
+void deinterleave_pcm(const uint8_t* data, int num_samples, int16_t* left,
+                      int16_t* right, bool downmix) {
+  int i = 0;
+#if defined(__ARM_NEON)
+  const int16_t* pcm = reinterpret_cast<const int16_t*>(data);
+  for (; i + 8 <= num_samples; i += 8) {
+    int16x8x2_t frames = vld2q_s16(pcm + 2 * i);
+    int16x8_t l = vshrq_n_s16(frames.val[0], 1);
+    int16x8_t r = vshrq_n_s16(frames.val[1], 1);
+    if (downmix) {
+      // Halving add, (l + r) >> 1 without overflow
+      l = vhaddq_s16(l, r);
+      r = l;
+    }
+    vst1q_s16(left + i, l);
+    vst1q_s16(right + i, r);
+  }
+#elif defined(__SSE2__)
+  for (; i + 8 <= num_samples; i += 8) {
+    __m128i lo =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 4 * i));
+    __m128i hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 4 * i + 16));
+    // Left is the low half of every 32 bit frame, right the high half. The
+    // arithmetic shift by 17 sign extends and applies the >> 1 in one go.
+    __m128i l = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(lo, 16), 17),
+                                _mm_srai_epi32(_mm_slli_epi32(hi, 16), 17));
+    __m128i r =
+        _mm_packs_epi32(_mm_srai_epi32(lo, 17), _mm_srai_epi32(hi, 17));
+    if (downmix) {
+      // Both inputs are already halved, so the sum cannot overflow
+      l = _mm_srai_epi16(_mm_add_epi16(l, r), 1);
+      r = l;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(left + i), l);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(right + i), r);
+  }
+#endif
+  for (; i < num_samples; i++) {
+    const uint8_t* sample = data + i * 4;
+    int16_t l = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
+    sample += 2;
+    int16_t r = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
+    if (downmix) {
+      l = (int16_t)((l + r) >> 1);
+      r = l;
+    }
+    left[i] = l;
+    right[i] = r;
   }
 }
 
@@ -1019,7 +1161,7 @@ class HearingAidImpl : public HearingAid {
   void StartSendingAudio(const HearingDevice& hearingDevice) {
     VLOG(0) << __func__ << ": device=" << hearingDevice.address;
 
-    if (encoder_state_left == nullptr) {
+    if (encoder_left.state == nullptr) {
       encoder_state_init();
       seq_counter = 0;
 
@@ -1266,50 +1408,27 @@ class HearingAidImpl : public HearingAid {
       return;
     }
 
-    std::vector<uint16_t> chan_left;
-    std::vector<uint16_t> chan_right;
-    if (left == nullptr || right == nullptr) {
-      for (int i = 0; i < num_samples; i++) {
-        const uint8_t* sample = data.data() + i * 4;
-
-        int16_t left = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-
-        sample += 2;
-        int16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-
-        uint16_t mono_data = (int16_t)(((uint32_t)left + (uint32_t)right) >> 1);
-        chan_left.push_back(mono_data);
-        chan_right.push_back(mono_data);
-      }
-    } else {
-      for (int i = 0; i < num_samples; i++) {
-        const uint8_t* sample = data.data() + i * 4;
-
-        uint16_t left = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_left.push_back(left);
-
-        sample += 2;
-        uint16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_right.push_back(right);
-      }
-    }
+    encoder_left.Reserve(num_samples);
+    encoder_right.Reserve(num_samples);
+    deinterleave_pcm(data.data(), num_samples, encoder_left.pcm.data(),
+                     encoder_right.pcm.data(),
+                     left == nullptr || right == nullptr);
 
     // TODO: monural, binarual check
 
     // divide encoded data into packets, add header, send.
 
-    // TODO: make those buffers static and global to prevent constant
-    // reallocations
-    // TODO: this should basically fit the encoded data, tune the size later
-    std::vector<uint8_t> encoded_data_left;
+    // The two sides are independent, so the right one is encoded on the
+    // worker while this thread does the left one
+    bool right_on_worker = left && right && encoder_right_worker.IsRunning();
+    if (right_on_worker) {
+      encoder_right_worker.Post(&encoder_right, num_samples);
+    }
+
+    size_t encoded_data_size = 0;
     if (left) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_left.resize(4000);
-      int encoded_size =
-          g722_encode(encoder_state_left, encoded_data_left.data(),
-                      (const int16_t*)chan_left.data(), chan_left.size());
-      encoded_data_left.resize(encoded_size);
+      encoder_left.Encode(num_samples);
+      encoded_data_size = encoder_left.encoded_size;
 
       uint16_t cid = GAP_ConnGetL2CAPCid(left->gap_handle);
       uint16_t packets_in_chans = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
@@ -1333,15 +1452,14 @@ class HearingAidImpl : public HearingAid {
       check_and_do_rssi_read(left);
     }
 
-    std::vector<uint8_t> encoded_data_right;
     if (right) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_right.resize(4000);
-      int encoded_size =
-          g722_encode(encoder_state_right, encoded_data_right.data(),
-                      (const int16_t*)chan_right.data(), chan_right.size());
-      encoded_data_right.resize(encoded_size);
+      if (right_on_worker) {
+        encoder_right_worker.Wait();
+      } else {
+        encoder_right.Encode(num_samples);
+      }
+      encoded_data_size = std::max(
+          encoded_data_size, static_cast<size_t>(encoder_right.encoded_size));
 
       uint16_t cid = GAP_ConnGetL2CAPCid(right->gap_handle);
       uint16_t packets_in_chans = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
@@ -1365,9 +1483,6 @@ class HearingAidImpl : public HearingAid {
       check_and_do_rssi_read(right);
     }
 
-    size_t encoded_data_size =
-        std::max(encoded_data_left.size(), encoded_data_right.size());
-
     uint16_t packet_size =
         CalcCompressedAudioPacketSize(codec_in_use, default_data_interval_ms);
 
@@ -1384,11 +1499,11 @@ class HearingAidImpl : public HearingAid {
     for (size_t i = 0; i < encoded_data_size; i += packet_size) {
       if (left) {
         left->audio_stats.packet_send_count++;
-        SendAudio(encoded_data_left.data() + i, packet_size, left);
+        SendAudio(encoder_left.encoded.data() + i, packet_size, left);
       }
       if (right) {
         right->audio_stats.packet_send_count++;
-        SendAudio(encoded_data_right.data() + i, packet_size, right);
+        SendAudio(encoder_right.encoded.data() + i, packet_size, right);
       }
       seq_counter++;
     }
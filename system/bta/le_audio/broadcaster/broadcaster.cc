@@ -17,13 +17,16 @@
 
 #include <base/bind.h>
 
+#include <algorithm>
+#include <thread>
+
 #include "bta/include/bta_le_audio_api.h"
 #include "bta/include/bta_le_audio_broadcaster_api.h"
+#include "bta/le_audio/broadcaster/encode_pipeline.h"
 #include "bta/le_audio/broadcaster/state_machine.h"
 #include "bta/le_audio/le_audio_types.h"
 #include "bta/le_audio/le_audio_utils.h"
 #include "device/include/controller.h"
-#include "embdrv/lc3/include/lc3.h"
 #include "gd/common/strings.h"
 #include "internal_include/stack_config.h"
 #include "osi/include/log.h"
@@ -41,12 +44,12 @@ using bluetooth::le_audio::BroadcastId;
 using le_audio::CodecManager;
 using le_audio::broadcaster::BigConfig;
 using le_audio::broadcaster::BroadcastCodecWrapper;
+using le_audio::broadcaster::BroadcastEncodePipeline;
 using le_audio::broadcaster::BroadcastQosConfig;
 using le_audio::broadcaster::BroadcastStateMachine;
 using le_audio::broadcaster::BroadcastStateMachineConfig;
 using le_audio::broadcaster::IBroadcastStateMachineCallbacks;
 using le_audio::types::CodecLocation;
-using le_audio::types::kLeAudioCodingFormatLC3;
 using le_audio::types::LeAudioContextType;
 using le_audio::types::LeAudioLtvMap;
 using le_audio::utils::GetAllCcids;
@@ -119,6 +122,8 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
       leAudioClientAudioSource->Release(audio_instance_);
       audio_instance_ = nullptr;
     }
+
+    audio_receiver_.Reset();
   }
 
   void Stop() {
@@ -419,8 +424,10 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
     LOG_INFO("broadcast_id=%d", broadcast_id);
 
     if (broadcasts_.count(broadcast_id) != 0) {
-      LOG_INFO("Stopping LeAudioClientAudioSource");
-      leAudioClientAudioSource->Stop();
+      if (!IsAnyoneElseStreaming(broadcast_id)) {
+        LOG_INFO("Stopping LeAudioClientAudioSource");
+        leAudioClientAudioSource->Stop();
+      }
       broadcasts_[broadcast_id]->SetMuted(true);
       broadcasts_[broadcast_id]->ProcessMessage(
           BroadcastStateMachine::Message::SUSPEND, nullptr);
@@ -441,10 +448,25 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
     return (iter != instance->broadcasts_.cend());
   }
 
+  bool IsAnyoneElseStreaming(uint32_t broadcast_id) const {
+    return std::any_of(broadcasts_.cbegin(), broadcasts_.cend(),
+                       [broadcast_id](auto const& sm) {
+                         return sm.first != broadcast_id &&
+                                sm.second->GetState() ==
+                                    BroadcastStateMachine::State::STREAMING;
+                       });
+  }
+
   void StartAudioBroadcast(uint32_t broadcast_id) override {
     LOG_INFO("Starting broadcast_id=%d", broadcast_id);
 
-    if (IsAnyoneStreaming()) {
+    /* Broadcasts streaming at the same time share the audio source, each
+     * encoding it with its own codec configuration.
+     */
+    if (IsAnyoneStreaming() &&
+        (broadcasts_.count(broadcast_id) == 0 ||
+         !audio_receiver_.CanShareSource(
+             broadcasts_[broadcast_id]->GetCodecConfig()))) {
       LOG_ERROR("Stop the other broadcast first!");
       return;
     }
@@ -471,9 +493,11 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
       return;
     }
 
-    LOG_INFO("Stopping LeAudioClientAudioSource, broadcast_id=%d",
-             broadcast_id);
-    leAudioClientAudioSource->Stop();
+    if (!IsAnyoneElseStreaming(broadcast_id)) {
+      LOG_INFO("Stopping LeAudioClientAudioSource, broadcast_id=%d",
+               broadcast_id);
+      leAudioClientAudioSource->Stop();
+    }
     broadcasts_[broadcast_id]->SetMuted(true);
     broadcasts_[broadcast_id]->ProcessMessage(
         BroadcastStateMachine::Message::STOP, nullptr);
@@ -481,6 +505,7 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
 
   void DestroyAudioBroadcast(uint32_t broadcast_id) override {
     LOG_INFO("Destroying broadcast_id=%d", broadcast_id);
+    audio_receiver_.RemoveStream(broadcast_id);
     broadcasts_.erase(broadcast_id);
   }
 
@@ -600,8 +625,10 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
         CHECK(broadcasts_.count(broadcast_id) != 0);
         broadcasts_[broadcast_id]->HandleHciEvent(HCI_BLE_TERM_BIG_CPL_EVT,
                                                   evt);
-        leAudioClientAudioSource->Release(audio_instance_);
-        audio_instance_ = nullptr;
+        if (!IsAnyoneStreaming()) {
+          leAudioClientAudioSource->Release(audio_instance_);
+          audio_instance_ = nullptr;
+        }
       } break;
       default:
         LOG_ERROR("Invalid event=%d", event);
@@ -681,7 +708,7 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
         case BroadcastStateMachine::State::CONFIGURED:
           /* Pass through */
         case BroadcastStateMachine::State::STOPPING:
-          /* Nothing to do here? */
+          audio_receiver_.RemoveStream(broadcast_id);
           break;
         case BroadcastStateMachine::State::STREAMING:
           if (getStreamerCount() == 1) {
@@ -690,10 +717,12 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
             if (instance->broadcasts_.count(broadcast_id) != 0) {
               const auto& broadcast = instance->broadcasts_.at(broadcast_id);
 
-              // Reconfigure encoder instance for the new stream requirements
+              // Reconfigure the source and encoders for the stream
+              // requirements
               audio_receiver_.setCurrentCodecConfig(
                   broadcast->GetCodecConfig());
-              audio_receiver_.CheckAndReconfigureEncoders();
+              audio_receiver_.AddStream(broadcast_id,
+                                        broadcast->GetCodecConfig());
 
               broadcast->SetMuted(false);
               auto cfg = static_cast<const LeAudioCodecConfiguration*>(data);
@@ -707,6 +736,12 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
 
               instance->audio_data_path_state_ = AudioDataPathState::ACTIVE;
             }
+          } else if (instance->broadcasts_.count(broadcast_id) != 0) {
+            LOG_INFO("Joining the running LeAudioClientAudioSource");
+            const auto& broadcast = instance->broadcasts_.at(broadcast_id);
+            audio_receiver_.AddStream(broadcast_id,
+                                      broadcast->GetCodecConfig());
+            broadcast->SetMuted(false);
           }
           break;
       };
@@ -740,36 +775,30 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
                       le_audio::types::LeAudioContextType::UNSPECIFIED))
                   .first) {}
 
-    void CheckAndReconfigureEncoders() {
-      auto const& codec_id = codec_wrapper_.GetLeAudioCodecId();
-      if (codec_id.coding_format != kLeAudioCodingFormatLC3) {
-        LOG_ERROR("Invalid codec ID: [%d:%d:%d]", codec_id.coding_format,
-                  codec_id.vendor_company_id, codec_id.vendor_codec_id);
-        return;
-      }
+    /* Broadcasts can only share the audio source if they expect the same
+     * PCM frames out of it.
+     */
+    bool CanShareSource(BroadcastCodecWrapper const& config) const {
+      return config.GetSampleRate() == codec_wrapper_.GetSampleRate() &&
+             config.GetDataIntervalUs() == codec_wrapper_.GetDataIntervalUs() &&
+             config.GetBitsPerSample() == codec_wrapper_.GetBitsPerSample() &&
+             config.GetNumChannels() <= codec_wrapper_.GetNumChannels();
+    }
 
-      if (enc_audio_buffers_.size() != codec_wrapper_.GetNumChannels()) {
-        enc_audio_buffers_.resize(codec_wrapper_.GetNumChannels());
+    void AddStream(uint32_t broadcast_id, BroadcastCodecWrapper const& config) {
+      if (!encode_pipeline_) {
+        encode_pipeline_ =
+            std::make_unique<BroadcastEncodePipeline>(GetNumEncoderThreads());
       }
+      encode_pipeline_->ConfigureStream(broadcast_id, config);
+    }
 
-      const int dt_us = codec_wrapper_.GetDataIntervalUs();
-      const int sr_hz = codec_wrapper_.GetSampleRate();
-      const auto encoder_bytes = lc3_encoder_size(dt_us, sr_hz);
-      const auto channel_bytes = codec_wrapper_.GetMaxSduSizePerChannel();
-
-      /* TODO: We should act smart and reuse current configurations */
-      encoders_.clear();
-      encoders_mem_.clear();
-      while (encoders_.size() < codec_wrapper_.GetNumChannels()) {
-        auto& encoder_buf = enc_audio_buffers_.at(encoders_.size());
-        encoder_buf.resize(channel_bytes);
-
-        encoders_mem_.emplace_back(malloc(encoder_bytes), &std::free);
-        encoders_.emplace_back(
-            lc3_setup_encoder(dt_us, sr_hz, 0, encoders_mem_.back().get()));
-      }
+    void RemoveStream(uint32_t broadcast_id) {
+      if (encode_pipeline_) encode_pipeline_->RemoveStream(broadcast_id);
     }
 
+    void Reset() { encode_pipeline_.reset(); }
+
     const BroadcastCodecWrapper& getCurrentCodecConfig(void) const {
       return codec_wrapper_;
     }
@@ -778,23 +807,10 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
       codec_wrapper_ = config;
     }
 
-    void encodeLc3Channel(lc3_encoder_t encoder,
-                          std::vector<uint8_t>& out_buffer,
-                          const std::vector<uint8_t>& data,
-                          int initial_channel_offset, int pitch_samples,
-                          int num_channels) {
-      auto encoder_status =
-          lc3_encode(encoder, LC3_PCM_FORMAT_S16,
-                     (int16_t*)(data.data() + initial_channel_offset),
-                     pitch_samples, out_buffer.size(), out_buffer.data());
-      if (encoder_status != 0) {
-        LOG_ERROR("Encoding error=%d", encoder_status);
-      }
-    }
-
-    static void sendBroadcastData(
-        const std::unique_ptr<BroadcastStateMachine>& broadcast,
-        std::vector<std::vector<uint8_t>>& encoded_channels) {
+    /* Gives the SDU the encoded frame of channel |chan| goes into */
+    static uint8_t* acquireBroadcastSdu(
+        const std::unique_ptr<BroadcastStateMachine>& broadcast, uint8_t chan,
+        uint16_t len, std::vector<BT_HDR*>& sdus) {
       auto const& config = broadcast->GetBigConfig();
       if (config == std::nullopt) {
         LOG_ERROR(
@@ -802,48 +818,50 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
             "state=%s",
             broadcast->GetBroadcastId(),
             ToString(broadcast->GetState()).c_str());
-        return;
+        return nullptr;
       }
 
-      if (config->connection_handles.size() < encoded_channels.size()) {
+      if (config->connection_handles.size() <= chan) {
         LOG_ERROR("Not enough BIS'es to broadcast all channels!");
-        return;
+        return nullptr;
       }
 
-      for (uint8_t chan = 0; chan < encoded_channels.size(); ++chan) {
-        IsoManager::GetInstance()->SendIsoData(config->connection_handles[chan],
-                                               encoded_channels[chan].data(),
-                                               encoded_channels[chan].size());
-      }
+      BT_HDR* sdu = IsoManager::GetInstance()->AcquireIsoSdu(
+          config->connection_handles[chan], len);
+      if (sdu == nullptr) return nullptr;
+
+      sdus.push_back(sdu);
+      return IsoManager::GetIsoSduPayload(sdu);
     }
 
     virtual void OnAudioDataReady(const std::vector<uint8_t>& data) override {
-      if (!instance) return;
+      if (!instance || !encode_pipeline_) return;
 
       LOG_VERBOSE("Received %zu bytes.", data.size());
 
-      /* Constants for the channel data configuration */
-      const auto num_channels = codec_wrapper_.GetNumChannels();
-      const auto bytes_per_sample = (codec_wrapper_.GetBitsPerSample() / 8);
-
-      /* Prepare encoded data for all channels */
-      for (uint8_t chan = 0; chan < num_channels; ++chan) {
-        /* TODO: Use encoder agnostic wrapper */
-        encodeLc3Channel(encoders_[chan], enc_audio_buffers_[chan], data,
-                         chan * bytes_per_sample, num_channels, num_channels);
-      }
-
-      /* Currently there is no way to broadcast multiple distinct streams.
-       * We just receive all system sounds mixed into a one stream and each
-       * broadcast gets the same data.
+      /* Every streaming broadcast gets the source audio encoded with its own
+       * codec configuration, directly into the SDUs sent to its BISes.
        */
-      for (auto& broadcast_pair : instance->broadcasts_) {
-        auto& broadcast = broadcast_pair.second;
-        if ((broadcast->GetState() ==
-             BroadcastStateMachine::State::STREAMING) &&
-            !broadcast->IsMuted())
-          sendBroadcastData(broadcast, enc_audio_buffers_);
-      }
+      std::vector<BT_HDR*> sdus;
+      encode_pipeline_->Encode(
+          data, codec_wrapper_.GetNumChannels(),
+          [&sdus](uint32_t broadcast_id, uint8_t chan,
+                  uint16_t len) -> uint8_t* {
+            auto broadcast_it = instance->broadcasts_.find(broadcast_id);
+            if (broadcast_it == instance->broadcasts_.end()) return nullptr;
+
+            auto& broadcast = broadcast_it->second;
+            if ((broadcast->GetState() !=
+                 BroadcastStateMachine::State::STREAMING) ||
+                broadcast->IsMuted())
+              return nullptr;
+
+            return acquireBroadcastSdu(broadcast, chan, len, sdus);
+          });
+
+      /* The channels of all the broadcasts go down in a single batch */
+      if (!sdus.empty())
+        IsoManager::GetInstance()->SendIsoSdus(std::move(sdus));
       LOG_VERBOSE("All data sent.");
     }
 
@@ -893,10 +911,21 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
     }
 
    private:
+    static size_t GetNumEncoderThreads() {
+      /* Leave a core to the audio source thread */
+      const unsigned int cores = std::thread::hardware_concurrency();
+      const int32_t default_threads =
+          cores > 2 ? std::min(cores - 2, kMaxDefaultEncoderThreads) : 0;
+      const int32_t num_threads = osi_property_get_int32(
+          "bluetooth.leaudio.broadcast.encoder_threads", default_threads);
+      return num_threads > 0 ? num_threads : 0;
+    }
+
+    static constexpr unsigned int kMaxDefaultEncoderThreads = 3;
+
+    /* Configuration of the audio source, from the first streaming broadcast */
     BroadcastCodecWrapper codec_wrapper_;
-    std::vector<lc3_encoder_t> encoders_;
-    std::vector<std::unique_ptr<void, decltype(&std::free)>> encoders_mem_;
-    std::vector<std::vector<uint8_t>> enc_audio_buffers_;
+    std::unique_ptr<BroadcastEncodePipeline> encode_pipeline_;
   } audio_receiver_;
 
   bluetooth::le_audio::LeAudioBroadcasterCallbacks* callbacks_;
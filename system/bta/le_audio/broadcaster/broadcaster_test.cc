@@ -43,6 +43,7 @@ using testing::NotNull;
 using testing::Return;
 using testing::ReturnRef;
 using testing::SaveArg;
+using testing::SizeIs;
 using testing::Test;
 
 using namespace bluetooth::le_audio;
@@ -180,6 +181,19 @@ class BroadcasterTest : public Test {
     ASSERT_NE(iso_manager_, nullptr);
     iso_manager_->Start();
 
+    ON_CALL(*MockIsoManager::GetInstance(), AcquireIsoSdu)
+        .WillByDefault([](uint16_t iso_handle, uint16_t data_len) {
+          BT_HDR* sdu = (BT_HDR*)calloc(
+              1, sizeof(BT_HDR) +
+                     bluetooth::hci::iso_manager::kIsoSduHeaderLen + data_len);
+          sdu->len = bluetooth::hci::iso_manager::kIsoSduHeaderLen + data_len;
+          return sdu;
+        });
+    ON_CALL(*MockIsoManager::GetInstance(), SendIsoSdus)
+        .WillByDefault([](std::vector<BT_HDR*> sdus) {
+          for (BT_HDR* sdu : sdus) free(sdu);
+        });
+
     mock_audio_source_ = new MockLeAudioBroadcastClientAudioSource();
 
     ON_CALL(*mock_audio_source_, Start).WillByDefault(Return(true));
@@ -316,7 +330,8 @@ TEST_F(BroadcasterTest, StartAudioBroadcast) {
   MockBroadcastStateMachine::GetLastInstance()->SetExpectedBigConfig(big_cfg);
 
   // Inject the audio and verify call on the Iso manager side.
-  EXPECT_CALL(*MockIsoManager::GetInstance(), SendIsoData).Times(1);
+  EXPECT_CALL(*MockIsoManager::GetInstance(), AcquireIsoSdu).Times(1);
+  EXPECT_CALL(*MockIsoManager::GetInstance(), SendIsoSdus).Times(1);
   std::vector<uint8_t> sample_data(320, 0);
   audio_receiver->OnAudioDataReady(sample_data);
 }
@@ -348,11 +363,72 @@ TEST_F(BroadcasterTest, StartAudioBroadcastMedia) {
   MockBroadcastStateMachine::GetLastInstance()->SetExpectedBigConfig(big_cfg);
 
   // Inject the audio and verify call on the Iso manager side.
-  EXPECT_CALL(*MockIsoManager::GetInstance(), SendIsoData).Times(2);
+  EXPECT_CALL(*MockIsoManager::GetInstance(), AcquireIsoSdu).Times(2);
+  EXPECT_CALL(*MockIsoManager::GetInstance(), SendIsoSdus(SizeIs(2)))
+      .Times(1);
   std::vector<uint8_t> sample_data(1920, 0);
   audio_receiver->OnAudioDataReady(sample_data);
 }
 
+TEST_F(BroadcasterTest, StartTwoAudioBroadcastsSharingSource) {
+  auto broadcast_id = InstantiateBroadcast();
+  auto* broadcast = MockBroadcastStateMachine::GetLastInstance();
+  auto broadcast_id2 = InstantiateBroadcast();
+  auto* broadcast2 = MockBroadcastStateMachine::GetLastInstance();
+
+  EXPECT_CALL(mock_broadcaster_callbacks_,
+              OnBroadcastStateChanged(broadcast_id, BroadcastState::STREAMING))
+      .Times(1);
+  EXPECT_CALL(mock_broadcaster_callbacks_,
+              OnBroadcastStateChanged(broadcast_id2, BroadcastState::STREAMING))
+      .Times(1);
+
+  // The second broadcast joins the audio source started for the first one
+  LeAudioClientAudioSinkReceiver* audio_receiver;
+  EXPECT_CALL(*mock_audio_source_, Start)
+      .WillOnce(DoAll(SaveArg<1>(&audio_receiver), Return(true)));
+
+  LeAudioBroadcaster::Get()->StartAudioBroadcast(broadcast_id);
+  LeAudioBroadcaster::Get()->StartAudioBroadcast(broadcast_id2);
+  ASSERT_NE(audio_receiver, nullptr);
+
+  BigConfig big_cfg;
+  big_cfg.big_id = broadcast->GetAdvertisingSid();
+  big_cfg.connection_handles = {0x10};
+  big_cfg.max_pdu = 128;
+  broadcast->SetExpectedBigConfig(big_cfg);
+
+  BigConfig big_cfg2;
+  big_cfg2.big_id = broadcast2->GetAdvertisingSid();
+  big_cfg2.connection_handles = {0x20};
+  big_cfg2.max_pdu = 128;
+  broadcast2->SetExpectedBigConfig(big_cfg2);
+
+  // Each broadcast gets its own encoded frame, sent in the same batch
+  EXPECT_CALL(*MockIsoManager::GetInstance(), AcquireIsoSdu(0x10, _))
+      .Times(1);
+  EXPECT_CALL(*MockIsoManager::GetInstance(), AcquireIsoSdu(0x20, _))
+      .Times(1);
+  EXPECT_CALL(*MockIsoManager::GetInstance(), SendIsoSdus(SizeIs(2)))
+      .Times(1);
+  std::vector<uint8_t> sample_data(320, 0);
+  audio_receiver->OnAudioDataReady(sample_data);
+  Mock::VerifyAndClearExpectations(MockIsoManager::GetInstance());
+
+  // Stopping one of them keeps the audio source running for the other
+  EXPECT_CALL(*mock_audio_source_, Stop).Times(0);
+  LeAudioBroadcaster::Get()->StopAudioBroadcast(broadcast_id);
+  Mock::VerifyAndClearExpectations(mock_audio_source_);
+
+  EXPECT_CALL(*MockIsoManager::GetInstance(), AcquireIsoSdu(0x10, _))
+      .Times(0);
+  EXPECT_CALL(*MockIsoManager::GetInstance(), AcquireIsoSdu(0x20, _))
+      .Times(1);
+  EXPECT_CALL(*MockIsoManager::GetInstance(), SendIsoSdus(SizeIs(1)))
+      .Times(1);
+  audio_receiver->OnAudioDataReady(sample_data);
+}
+
 TEST_F(BroadcasterTest, StopAudioBroadcast) {
   auto broadcast_id = InstantiateBroadcast();
   LeAudioBroadcaster::Get()->StartAudioBroadcast(broadcast_id);
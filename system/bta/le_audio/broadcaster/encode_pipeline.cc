@@ -0,0 +1,169 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "encode_pipeline.h"
+
+#include <base/bind.h>
+
+#include <algorithm>
+#include <string>
+
+#include "osi/include/log.h"
+
+using bluetooth::common::MessageLoopThread;
+
+namespace le_audio {
+namespace broadcaster {
+
+BroadcastEncodePipeline::BroadcastEncodePipeline(size_t num_workers)
+    : pending_workers_(0) {
+  for (size_t i = 0; i < num_workers; ++i) {
+    auto worker = std::make_unique<MessageLoopThread>(
+        "bt_le_audio_broadcast_encoder_" + std::to_string(i));
+    worker->StartUp();
+    if (!worker->IsRunning()) {
+      LOG_ERROR("Unable to start encoder thread %zu", i);
+      break;
+    }
+    if (!worker->EnableRealTimeScheduling()) {
+      LOG_WARN("Failed to increase encoder thread %zu priority", i);
+    }
+    workers_.push_back(std::move(worker));
+  }
+  LOG_INFO("Using %zu encoder threads", workers_.size());
+}
+
+BroadcastEncodePipeline::~BroadcastEncodePipeline() {
+  for (auto& worker : workers_) worker->ShutDown();
+}
+
+void BroadcastEncodePipeline::ConfigureStream(
+    uint32_t broadcast_id, const BroadcastCodecWrapper& codec_config) {
+  auto const& codec_id = codec_config.GetLeAudioCodecId();
+  if (codec_id.coding_format != types::kLeAudioCodingFormatLC3) {
+    LOG_ERROR("Invalid codec ID: [%d:%d:%d]", codec_id.coding_format,
+              codec_id.vendor_company_id, codec_id.vendor_codec_id);
+    return;
+  }
+
+  const int dt_us = codec_config.GetDataIntervalUs();
+  const int sr_hz = codec_config.GetSampleRate();
+  const auto encoder_bytes = lc3_encoder_size(dt_us, sr_hz);
+
+  Stream stream;
+  stream.frame_samples = lc3_frame_samples(dt_us, sr_hz);
+  stream.frame_bytes = codec_config.GetMaxSduSizePerChannel();
+  for (uint8_t chan = 0; chan < codec_config.GetNumChannels(); ++chan) {
+    stream.encoders_mem.emplace_back(malloc(encoder_bytes), &std::free);
+    stream.encoders.emplace_back(
+        lc3_setup_encoder(dt_us, sr_hz, 0, stream.encoders_mem.back().get()));
+    stream.scratch.emplace_back(stream.frame_bytes);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  streams_.erase(broadcast_id);
+  streams_.emplace(broadcast_id, std::move(stream));
+}
+
+void BroadcastEncodePipeline::RemoveStream(uint32_t broadcast_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  streams_.erase(broadcast_id);
+}
+
+bool BroadcastEncodePipeline::HasStream(uint32_t broadcast_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return streams_.count(broadcast_id) != 0;
+}
+
+void BroadcastEncodePipeline::Encode(const std::vector<uint8_t>& data,
+                                     uint8_t num_channels,
+                                     const OutputBufferCallback& get_output) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (num_channels == 0) return;
+
+  const int16_t* pcm = reinterpret_cast<const int16_t*>(data.data());
+  const size_t source_samples = data.size() / sizeof(int16_t) / num_channels;
+
+  jobs_.clear();
+  for (auto& [broadcast_id, stream] : streams_) {
+    if (stream.encoders.size() > num_channels ||
+        source_samples < static_cast<size_t>(stream.frame_samples)) {
+      LOG_ERROR("Source audio does not fit broadcast_id=%d", broadcast_id);
+      continue;
+    }
+    for (uint8_t chan = 0; chan < stream.encoders.size(); ++chan) {
+      uint8_t* out = get_output(broadcast_id, chan, stream.frame_bytes);
+      /* Encode every frame to keep the encoder state continuous, even if
+       * there is nowhere to send it */
+      if (out == nullptr) out = stream.scratch[chan].data();
+      jobs_.push_back({.encoder = stream.encoders[chan],
+                       .pcm = pcm + chan,
+                       .pitch = num_channels,
+                       .out = out,
+                       .out_len = stream.frame_bytes});
+    }
+  }
+
+  /* The calling thread takes its share of the channels as well */
+  const size_t num_workers =
+      std::min(workers_.size(), jobs_.size() > 0 ? jobs_.size() - 1 : 0);
+  const size_t stride = num_workers + 1;
+
+  {
+    std::lock_guard<std::mutex> done_lock(done_mutex_);
+    pending_workers_ = num_workers;
+  }
+  for (size_t i = 0; i < num_workers; ++i) {
+    bool posted = workers_[i]->DoInThread(
+        FROM_HERE,
+        base::BindOnce(
+            [](BroadcastEncodePipeline* pipeline, size_t first, size_t stride) {
+              pipeline->RunJobs(first, stride);
+              pipeline->OnWorkerDone();
+            },
+            base::Unretained(this), i + 1, stride));
+    if (!posted) {
+      RunJobs(i + 1, stride);
+      OnWorkerDone();
+    }
+  }
+  RunJobs(0, stride);
+
+  {
+    std::unique_lock<std::mutex> done_lock(done_mutex_);
+    done_cv_.wait(done_lock, [this] { return pending_workers_ == 0; });
+  }
+}
+
+void BroadcastEncodePipeline::RunJobs(size_t first, size_t stride) {
+  for (size_t i = first; i < jobs_.size(); i += stride) {
+    auto& job = jobs_[i];
+    auto encoder_status =
+        lc3_encode(job.encoder, LC3_PCM_FORMAT_S16, job.pcm, job.pitch,
+                   job.out_len, job.out);
+    if (encoder_status != 0) {
+      LOG_ERROR("Encoding error=%d", encoder_status);
+    }
+  }
+}
+
+void BroadcastEncodePipeline::OnWorkerDone() {
+  std::lock_guard<std::mutex> done_lock(done_mutex_);
+  if (--pending_workers_ == 0) done_cv_.notify_one();
+}
+
+}  // namespace broadcaster
+}  // namespace le_audio
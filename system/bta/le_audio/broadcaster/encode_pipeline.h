@@ -0,0 +1,109 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "broadcaster_types.h"
+#include "common/message_loop_thread.h"
+#include "embdrv/lc3/include/lc3.h"
+
+namespace le_audio {
+namespace broadcaster {
+
+/* Encodes the source audio for every streaming broadcast.
+ *
+ * Each broadcast has its own set of LC3 encoders, configured from its own
+ * codec configuration, and gets one encoded frame per BIS out of every frame
+ * of source audio, written wherever the caller wants it, typically straight
+ * into the outgoing ISO SDUs. The channels of all the broadcasts are encoded
+ * in parallel on a set of worker threads and the calling thread.
+ *
+ * Streams may be configured and removed from any thread; Encode() excludes
+ * these changes while it runs.
+ */
+class BroadcastEncodePipeline {
+ public:
+  /* Returns where the |len| bytes of channel |chan| of |broadcast_id| are
+   * encoded to, or nullptr for the encoded frame to be discarded.
+   */
+  using OutputBufferCallback = std::function<uint8_t*(
+      uint32_t broadcast_id, uint8_t chan, uint16_t len)>;
+
+  /* With |num_workers| == 0 every channel is encoded on the calling thread */
+  explicit BroadcastEncodePipeline(size_t num_workers);
+  ~BroadcastEncodePipeline();
+
+  BroadcastEncodePipeline(const BroadcastEncodePipeline&) = delete;
+  BroadcastEncodePipeline& operator=(const BroadcastEncodePipeline&) = delete;
+
+  /* (Re)creates the encoders of |broadcast_id| for |codec_config| */
+  void ConfigureStream(uint32_t broadcast_id,
+                       const BroadcastCodecWrapper& codec_config);
+  void RemoveStream(uint32_t broadcast_id);
+  bool HasStream(uint32_t broadcast_id);
+
+  /* Encodes one frame of 16 bit interleaved PCM with |num_channels| channels.
+   * BIS channel N of each broadcast is encoded from source channel N, into
+   * the buffer |get_output| gives for it. |get_output| runs on the calling
+   * thread with the streams locked and must not configure or remove any.
+   * The encoded frames are all written once this returns.
+   */
+  void Encode(const std::vector<uint8_t>& data, uint8_t num_channels,
+              const OutputBufferCallback& get_output);
+
+  size_t GetNumWorkers() const { return workers_.size(); }
+
+ private:
+  struct Stream {
+    int frame_samples;
+    uint16_t frame_bytes;
+    std::vector<lc3_encoder_t> encoders;
+    std::vector<std::unique_ptr<void, decltype(&std::free)>> encoders_mem;
+    /* Per channel output, for frames that have no SDU to go to */
+    std::vector<std::vector<uint8_t>> scratch;
+  };
+
+  struct Job {
+    lc3_encoder_t encoder;
+    const int16_t* pcm;
+    int pitch;
+    uint8_t* out;
+    uint16_t out_len;
+  };
+
+  void RunJobs(size_t first, size_t stride);
+  void OnWorkerDone();
+
+  std::vector<std::unique_ptr<bluetooth::common::MessageLoopThread>> workers_;
+
+  std::mutex mutex_;
+  std::map<uint32_t, Stream> streams_;
+  std::vector<Job> jobs_;
+
+  std::mutex done_mutex_;
+  std::condition_variable done_cv_;
+  size_t pending_workers_;
+};
+
+}  // namespace broadcaster
+}  // namespace le_audio
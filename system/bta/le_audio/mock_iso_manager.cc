@@ -95,6 +95,21 @@ void IsoManager::SendIsoData(uint16_t iso_handle, const uint8_t* data,
   pimpl_->SendIsoData(iso_handle, data, data_len);
 }
 
+BT_HDR* IsoManager::AcquireIsoSdu(uint16_t iso_handle, uint16_t data_len) {
+  if (!pimpl_) return nullptr;
+  return pimpl_->AcquireIsoSdu(iso_handle, data_len);
+}
+
+void IsoManager::SendIsoSdus(std::vector<BT_HDR*> sdus) {
+  if (!pimpl_) return;
+  pimpl_->SendIsoSdus(std::move(sdus));
+}
+
+void IsoManager::ReleaseIsoSdu(BT_HDR* sdu) {
+  if (!pimpl_) return;
+  pimpl_->ReleaseIsoSdu(sdu);
+}
+
 void IsoManager::CreateBig(uint8_t big_id,
                            struct iso_manager::big_create_params big_params) {
   if (!pimpl_) return;
@@ -56,6 +56,10 @@ struct MockIsoManager {
               (uint16_t iso_handle, uint8_t data_path_dir));
   MOCK_METHOD((void), SendIsoData,
               (uint16_t iso_handle, const uint8_t* data, uint16_t data_len));
+  MOCK_METHOD((BT_HDR*), AcquireIsoSdu,
+              (uint16_t iso_handle, uint16_t data_len));
+  MOCK_METHOD((void), SendIsoSdus, (std::vector<BT_HDR*> sdus));
+  MOCK_METHOD((void), ReleaseIsoSdu, (BT_HDR * sdu));
   MOCK_METHOD((void), ReadIsoLinkQuality, (uint16_t iso_handle));
   MOCK_METHOD(
       (void), CreateBig,
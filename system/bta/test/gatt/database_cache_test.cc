@@ -0,0 +1,110 @@
+/******************************************************************************
+ *
+ *  Copyright 2022 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "gatt/database_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "gatt/database_builder.h"
+#include "types/bluetooth/uuid.h"
+#include "types/raw_address.h"
+
+using bluetooth::Uuid;
+
+namespace gatt {
+
+namespace {
+constexpr size_t kCacheSize = 2;
+
+const RawAddress kServer1 = {{0x01, 0x02, 0x03, 0x04, 0x05, 0x06}};
+const RawAddress kServer2 = {{0x11, 0x12, 0x13, 0x14, 0x15, 0x16}};
+
+Octet16 MakeHash(uint8_t value) {
+  Octet16 hash{};
+  hash[0] = value;
+  return hash;
+}
+
+/* Database with a single primary service of 16 bit |uuid| */
+Database MakeDatabase(uint16_t uuid) {
+  DatabaseBuilder builder;
+  builder.AddService(0x0001, 0x000f, Uuid::From16Bit(uuid), true);
+  return builder.Build();
+}
+
+Uuid FirstService(const Database* db) {
+  return db->Services().front().uuid;
+}
+}  // namespace
+
+TEST(GattDatabaseCacheTest, find_by_hash_test) {
+  DatabaseCache cache(kCacheSize);
+  cache.Put(MakeHash(1), MakeDatabase(0x1800));
+  cache.Put(MakeHash(2), MakeDatabase(0x1801));
+
+  ASSERT_NE(cache.Find(MakeHash(1)), nullptr);
+  EXPECT_EQ(FirstService(cache.Find(MakeHash(1))), Uuid::From16Bit(0x1800));
+  ASSERT_NE(cache.Find(MakeHash(2)), nullptr);
+  EXPECT_EQ(FirstService(cache.Find(MakeHash(2))), Uuid::From16Bit(0x1801));
+  EXPECT_EQ(cache.Find(MakeHash(3)), nullptr);
+
+  /* Putting a known hash again replaces its database */
+  cache.Put(MakeHash(1), MakeDatabase(0x180f));
+  EXPECT_EQ(cache.Size(), 2u);
+  EXPECT_EQ(FirstService(cache.Find(MakeHash(1))), Uuid::From16Bit(0x180f));
+}
+
+TEST(GattDatabaseCacheTest, evicts_least_recently_used_test) {
+  DatabaseCache cache(kCacheSize);
+  cache.Put(MakeHash(1), MakeDatabase(0x1800));
+  cache.Put(MakeHash(2), MakeDatabase(0x1801));
+
+  /* A hit makes hash 1 the most recently used, so hash 2 goes first */
+  ASSERT_NE(cache.Find(MakeHash(1)), nullptr);
+  cache.Put(MakeHash(3), MakeDatabase(0x180f));
+
+  EXPECT_EQ(cache.Size(), kCacheSize);
+  EXPECT_NE(cache.Find(MakeHash(1)), nullptr);
+  EXPECT_EQ(cache.Find(MakeHash(2)), nullptr);
+  EXPECT_NE(cache.Find(MakeHash(3)), nullptr);
+}
+
+TEST(GattDatabaseCacheTest, servers_share_database_by_hash_test) {
+  DatabaseCache cache(kCacheSize);
+  EXPECT_EQ(cache.FindByServer(kServer1), nullptr);
+
+  cache.Put(MakeHash(1), MakeDatabase(0x1800));
+  cache.LinkServer(kServer1, MakeHash(1));
+  cache.LinkServer(kServer2, MakeHash(1));
+  EXPECT_EQ(cache.Size(), 1u);
+  ASSERT_NE(cache.FindByServer(kServer1), nullptr);
+  EXPECT_EQ(cache.FindByServer(kServer1), cache.FindByServer(kServer2));
+
+  cache.UnlinkServer(kServer1);
+  EXPECT_EQ(cache.FindByServer(kServer1), nullptr);
+  EXPECT_NE(cache.FindByServer(kServer2), nullptr);
+
+  /* The hash of a server outlives the eviction of its database */
+  cache.Put(MakeHash(2), MakeDatabase(0x1801));
+  cache.Put(MakeHash(3), MakeDatabase(0x180f));
+  EXPECT_EQ(cache.FindByServer(kServer2), nullptr);
+  cache.Put(MakeHash(1), MakeDatabase(0x1800));
+  EXPECT_NE(cache.FindByServer(kServer2), nullptr);
+}
+
+}  // namespace gatt
@@ -97,6 +97,69 @@ TEST(GattDatabaseTest, serialize_deserialize_binary_test) {
   EXPECT_EQ(serialized[5].value.characteristic_extended_properties, 0x0001);
 }
 
+/* This test makes sure that attributes decoded straight from a raw buffer, as
+ * done for mapped cache files, give the same database as the vector path */
+TEST(GattDatabaseTest, deserialize_from_buffer_test) {
+  DatabaseBuilder builder;
+  builder.AddService(0x0001, 0x000f, SERVICE_1_UUID, true);
+  builder.AddService(0x0010, 0x001f, SERVICE_2_UUID, false);
+  builder.AddIncludedService(0x0002, SERVICE_2_UUID, 0x0010, 0x001f);
+  builder.AddCharacteristic(0x0003, 0x0004, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddDescriptor(0x0005, SERVICE_1_CHAR_1_DESC_1_UUID);
+  Database db = builder.Build();
+
+  std::vector<StoredAttribute> serialized = db.Serialize();
+  std::vector<uint8_t> buffer(serialized.size() * sizeof(StoredAttribute));
+  memcpy(buffer.data(), serialized.data(), buffer.size());
+
+  bool success = false;
+  Database result = Database::Deserialize(
+      reinterpret_cast<const StoredAttribute*>(buffer.data()),
+      serialized.size(), &success);
+  EXPECT_TRUE(success);
+  EXPECT_EQ(result.ToString(), db.ToString());
+  EXPECT_EQ(result.Hash(), db.Hash());
+}
+
+/* This test makes sure that the handle index finds every attribute, also in
+ * copies of the database, and nothing in the gaps between them */
+TEST(GattDatabaseTest, find_by_handle_test) {
+  DatabaseBuilder builder;
+  builder.AddService(0x0001, 0x000f, SERVICE_1_UUID, true);
+  builder.AddService(0x0020, 0x002f, SERVICE_2_UUID, true);
+  builder.AddCharacteristic(0x0003, 0x0004, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddDescriptor(0x0005, SERVICE_1_CHAR_1_DESC_1_UUID);
+  builder.AddCharacteristic(0x0021, 0x0022, SERVICE_1_CHAR_1_UUID, 0x10);
+  Database built = builder.Build();
+  Database db = built;
+
+  const Service* service = db.FindService(0x0005);
+  ASSERT_NE(service, nullptr);
+  EXPECT_EQ(service->handle, 0x0001);
+  EXPECT_EQ(db.FindService(0x0010), nullptr);
+  EXPECT_EQ(db.FindService(0x0025)->handle, 0x0020);
+  EXPECT_EQ(db.FindService(0x0030), nullptr);
+
+  const Characteristic* charac = db.FindCharacteristic(0x0004);
+  ASSERT_NE(charac, nullptr);
+  EXPECT_EQ(charac, &db.Services().front().characteristics[0]);
+  EXPECT_EQ(db.FindCharacteristic(0x0022)->properties, 0x10);
+  EXPECT_EQ(db.FindCharacteristic(0x0003), nullptr);
+  EXPECT_EQ(db.FindCharacteristic(0x0005), nullptr);
+
+  const Descriptor* desc = db.FindDescriptor(0x0005);
+  ASSERT_NE(desc, nullptr);
+  EXPECT_EQ(desc->uuid, SERVICE_1_CHAR_1_DESC_1_UUID);
+  EXPECT_EQ(db.FindDescriptor(0x0004), nullptr);
+  EXPECT_EQ(db.FindOwningCharacteristic(0x0005), charac);
+  EXPECT_EQ(db.FindOwningCharacteristic(0x0004), nullptr);
+
+  db.Clear();
+  EXPECT_EQ(db.FindService(0x0001), nullptr);
+  EXPECT_EQ(db.FindCharacteristic(0x0004), nullptr);
+  EXPECT_NE(built.FindCharacteristic(0x0004), nullptr);
+}
+
 /* This test makes sure that Service represented in StoredAttribute have proper
  * binary format. */
 TEST(GattCacheTest, stored_attribute_to_binary_service_test) {
@@ -23,13 +23,20 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/uhid.h>
-#include <poll.h>
 #include <pthread.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+
 #include "bta_api.h"
 #include "bta_hh_api.h"
 #include "btif_hh.h"
@@ -63,23 +70,46 @@ void uhid_set_non_blocking(int fd) {
 }
 
 /*Internal function to perform UHID write and error checking*/
-static int uhid_write(int fd, const struct uhid_event* ev) {
+static int uhid_write(int fd, const struct uhid_event* ev, size_t len) {
   ssize_t ret;
-  OSI_NO_INTR(ret = write(fd, ev, sizeof(*ev)));
+  OSI_NO_INTR(ret = write(fd, ev, len));
 
   if (ret < 0) {
     int rtn = -errno;
     APPL_TRACE_ERROR("%s: Cannot write to uhid:%s", __func__, strerror(errno));
     return rtn;
-  } else if (ret != (ssize_t)sizeof(*ev)) {
+  } else if (ret != (ssize_t)len) {
     APPL_TRACE_ERROR("%s: Wrong size written to uhid: %zd != %zu", __func__,
-                     ret, sizeof(*ev));
+                     ret, len);
     return -EFAULT;
   }
 
   return 0;
 }
 
+static int uhid_write(int fd, const struct uhid_event* ev) {
+  return uhid_write(fd, ev, sizeof(*ev));
+}
+
+/* All uhid devices share one event thread. It sleeps in epoll_wait until one
+ * of them has an event, instead of one thread per device waking up every
+ * 50 ms. The thread only exists while at least one device is registered. */
+static std::mutex uhid_control_mutex;   // serializes add/remove, held on join
+static std::mutex uhid_dispatch_mutex;  // held while an event is handled
+static std::condition_variable uhid_ready_cv;
+static std::set<int> uhid_registered_fds;
+static int uhid_epoll_fd = -1;
+static int uhid_wakeup_fd = -1;
+static pthread_t uhid_event_thread_id = -1;
+
+/* epoll data carries both the device slot and its fd, so that an event
+ * reported for a slot that has since been reused is not misdelivered */
+static constexpr uint32_t kUhidWakeupIndex = UINT32_MAX;
+
+static inline uint64_t uhid_epoll_data(uint32_t index, int fd) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 32) | index;
+}
+
 /* Internal function to parse the events received from UHID driver*/
 static int uhid_read_event(btif_hh_device_t* p_dev) {
   CHECK(p_dev);
@@ -90,7 +120,9 @@ static int uhid_read_event(btif_hh_device_t* p_dev) {
   ssize_t ret;
   OSI_NO_INTR(ret = read(p_dev->fd, &ev, sizeof(ev)));
 
-  if (ret == 0) {
+  if (ret < 0 && errno == EAGAIN) {
+    return 0;
+  } else if (ret == 0) {
     APPL_TRACE_ERROR("%s: Read HUP on uhid-cdev %s", __func__, strerror(errno));
     return -EFAULT;
   } else if (ret < 0) {
@@ -103,6 +135,7 @@ static int uhid_read_event(btif_hh_device_t* p_dev) {
     case UHID_START:
       APPL_TRACE_DEBUG("UHID_START from uhid-dev\n");
       p_dev->ready_for_data = true;
+      uhid_ready_cv.notify_all();
       break;
     case UHID_STOP:
       APPL_TRACE_DEBUG("UHID_STOP from uhid-dev\n");
@@ -111,6 +144,7 @@ static int uhid_read_event(btif_hh_device_t* p_dev) {
     case UHID_OPEN:
       APPL_TRACE_DEBUG("UHID_OPEN from uhid-dev\n");
       p_dev->ready_for_data = true;
+      uhid_ready_cv.notify_all();
       break;
     case UHID_CLOSE:
       APPL_TRACE_DEBUG("UHID_CLOSE from uhid-dev\n");
@@ -220,92 +254,178 @@ static int uhid_read_event(btif_hh_device_t* p_dev) {
 
 /*******************************************************************************
  *
- * Function create_thread
+ * Function btif_hh_uhid_event_thread
  *
- * Description creat a select loop
- *
- * Returns pthread_t
- *
- ******************************************************************************/
-static inline pthread_t create_thread(void* (*start_routine)(void*),
-                                      void* arg) {
-  APPL_TRACE_DEBUG("create_thread: entered");
-  pthread_attr_t thread_attr;
-
-  pthread_attr_init(&thread_attr);
-  pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
-  pthread_t thread_id = -1;
-  if (pthread_create(&thread_id, &thread_attr, start_routine, arg) != 0) {
-    APPL_TRACE_ERROR("pthread_create : %s", strerror(errno));
-    return -1;
-  }
-  APPL_TRACE_DEBUG("create_thread: thread created successfully");
-  return thread_id;
-}
-
-/*******************************************************************************
- *
- * Function btif_hh_poll_event_thread
- *
- * Description the polling thread which polls for event from UHID driver
+ * Description the thread which waits for events from the UHID driver of all
+ *             connected devices
  *
  * Returns void
  *
  ******************************************************************************/
-static void* btif_hh_poll_event_thread(void* arg) {
-  btif_hh_device_t* p_dev = (btif_hh_device_t*)arg;
-  struct pollfd pfds[1];
-
+static void* btif_hh_uhid_event_thread(void* arg) {
   // This thread is created by bt_main_thread with RT priority. Lower the thread
   // priority here since the tasks in this thread is not timing critical.
   struct sched_param sched_params;
   sched_params.sched_priority = THREAD_NORMAL_PRIORITY;
   if (sched_setscheduler(gettid(), SCHED_OTHER, &sched_params)) {
     APPL_TRACE_ERROR("%s: Failed to set thread priority to normal", __func__);
-    p_dev->hh_poll_thread_id = -1;
-    return 0;
   }
-  p_dev->pid = gettid();
   pthread_setname_np(pthread_self(), BT_HH_THREAD);
-  LOG_DEBUG("Host hid polling thread created name:%s pid:%d fd:%d",
-            BT_HH_THREAD, p_dev->pid, p_dev->fd);
+  LOG_DEBUG("Host hid event thread created name:%s tid:%d", BT_HH_THREAD,
+            gettid());
+
+  struct epoll_event events[BTIF_HH_MAX_HID + 1];
+  bool keep_running = true;
+  while (keep_running) {
+    int count;
+    OSI_NO_INTR(count = epoll_wait(uhid_epoll_fd, events,
+                                   BTIF_HH_MAX_HID + 1, -1));
+    if (count < 0) {
+      APPL_TRACE_ERROR("%s: Cannot wait for uhid events: %s", __func__,
+                       strerror(errno));
+      break;
+    }
 
-  pfds[0].fd = p_dev->fd;
-  pfds[0].events = POLLIN;
+    std::lock_guard<std::mutex> lock(uhid_dispatch_mutex);
+    for (int i = 0; i < count; i++) {
+      uint32_t index = static_cast<uint32_t>(events[i].data.u64);
+      int fd = static_cast<int>(events[i].data.u64 >> 32);
+      if (index == kUhidWakeupIndex) {
+        keep_running = false;
+        continue;
+      }
 
-  // Set the uhid fd as non-blocking to ensure we never block the BTU thread
-  uhid_set_non_blocking(p_dev->fd);
+      btif_hh_device_t* p_dev = &btif_hh_cb.devices[index];
+      if (!p_dev->hh_keep_polling || p_dev->fd != fd) {
+        // Removed after epoll_wait returned
+        continue;
+      }
+      if (uhid_read_event(p_dev) != 0 ||
+          (events[i].events & (EPOLLHUP | EPOLLERR))) {
+        LOG_WARN("Stop listening to uhid fd:%d", fd);
+        epoll_ctl(uhid_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        p_dev->hh_keep_polling = 0;
+      }
+    }
+  }
 
-  while (p_dev->hh_keep_polling) {
-    int ret;
-    OSI_NO_INTR(ret = poll(pfds, 1, 50));
-    if (ret < 0) {
-      APPL_TRACE_ERROR("%s: Cannot poll for fds: %s\n", __func__,
+  return 0;
+}
+
+/* Stop the event thread, with uhid_control_mutex held */
+static void btif_hh_uhid_event_loop_stop() {
+  uint64_t stop = 1;
+  ssize_t ret;
+  OSI_NO_INTR(ret = write(uhid_wakeup_fd, &stop, sizeof(stop)));
+  if (ret != sizeof(stop)) {
+    APPL_TRACE_ERROR("%s: Cannot wake up uhid event thread: %s", __func__,
+                     strerror(errno));
+  }
+  pthread_join(uhid_event_thread_id, NULL);
+  close(uhid_epoll_fd);
+  close(uhid_wakeup_fd);
+  uhid_epoll_fd = uhid_wakeup_fd = -1;
+  uhid_event_thread_id = -1;
+}
+
+/*******************************************************************************
+ *
+ * Function btif_hh_uhid_event_loop_add
+ *
+ * Description start listening to the uhid fd of |p_dev|, creating the event
+ *             thread for the first device
+ *
+ * Returns void
+ *
+ ******************************************************************************/
+static void btif_hh_uhid_event_loop_add(btif_hh_device_t* p_dev) {
+  std::lock_guard<std::mutex> control(uhid_control_mutex);
+
+  if (uhid_registered_fds.empty()) {
+    uhid_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    uhid_wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (uhid_epoll_fd < 0 || uhid_wakeup_fd < 0) {
+      APPL_TRACE_ERROR("%s: Cannot create uhid event loop: %s", __func__,
                        strerror(errno));
-      break;
+      if (uhid_epoll_fd >= 0) close(uhid_epoll_fd);
+      if (uhid_wakeup_fd >= 0) close(uhid_wakeup_fd);
+      uhid_epoll_fd = uhid_wakeup_fd = -1;
+      return;
     }
-    if (pfds[0].revents & POLLIN) {
-      APPL_TRACE_DEBUG("%s: POLLIN", __func__);
-      ret = uhid_read_event(p_dev);
-      if (ret != 0) break;
+    struct epoll_event wakeup = {};
+    wakeup.events = EPOLLIN;
+    wakeup.data.u64 = uhid_epoll_data(kUhidWakeupIndex, uhid_wakeup_fd);
+    epoll_ctl(uhid_epoll_fd, EPOLL_CTL_ADD, uhid_wakeup_fd, &wakeup);
+    if (pthread_create(&uhid_event_thread_id, nullptr,
+                       btif_hh_uhid_event_thread, nullptr) != 0) {
+      APPL_TRACE_ERROR("%s: pthread_create : %s", __func__, strerror(errno));
+      close(uhid_epoll_fd);
+      close(uhid_wakeup_fd);
+      uhid_epoll_fd = uhid_wakeup_fd = -1;
+      uhid_event_thread_id = -1;
+      return;
     }
   }
 
-  p_dev->hh_poll_thread_id = -1;
-  p_dev->pid = -1;
-  return 0;
+  // Set the uhid fd as non-blocking to ensure we never block the event thread
+  uhid_set_non_blocking(p_dev->fd);
+
+  {
+    std::lock_guard<std::mutex> lock(uhid_dispatch_mutex);
+    uint32_t index = static_cast<uint32_t>(p_dev - btif_hh_cb.devices);
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = uhid_epoll_data(index, p_dev->fd);
+    if (epoll_ctl(uhid_epoll_fd, EPOLL_CTL_ADD, p_dev->fd, &event) < 0 &&
+        errno != EEXIST) {
+      APPL_TRACE_ERROR("%s: Cannot listen to uhid fd:%d %s", __func__,
+                       p_dev->fd, strerror(errno));
+    } else {
+      uhid_registered_fds.insert(p_dev->fd);
+      p_dev->hh_keep_polling = 1;
+    }
+  }
+
+  if (uhid_registered_fds.empty()) {
+    btif_hh_uhid_event_loop_stop();
+  }
 }
 
-static inline void btif_hh_close_poll_thread(btif_hh_device_t* p_dev) {
-  APPL_TRACE_DEBUG("%s", __func__);
-  p_dev->hh_keep_polling = 0;
-  if (p_dev->hh_poll_thread_id > 0)
-    pthread_join(p_dev->hh_poll_thread_id, NULL);
+/*******************************************************************************
+ *
+ * Function btif_hh_uhid_event_loop_remove
+ *
+ * Description stop listening to |fd|, once no event is being handled for it.
+ *             The event thread exits with the last device.
+ *
+ * Returns void
+ *
+ ******************************************************************************/
+static void btif_hh_uhid_event_loop_remove(int fd) {
+  std::lock_guard<std::mutex> control(uhid_control_mutex);
+  if (uhid_registered_fds.erase(fd) == 0) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(uhid_dispatch_mutex);
+    epoll_ctl(uhid_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    for (uint32_t i = 0; i < BTIF_HH_MAX_HID; i++) {
+      btif_hh_device_t* p_dev = &btif_hh_cb.devices[i];
+      if (p_dev->fd == fd) {
+        p_dev->hh_keep_polling = 0;
+      }
+    }
+  }
 
-  return;
+  if (uhid_registered_fds.empty()) {
+    btif_hh_uhid_event_loop_stop();
+  }
 }
 
 void bta_hh_co_destroy(int fd) {
+  btif_hh_uhid_event_loop_remove(fd);
+
   struct uhid_event ev;
   memset(&ev, 0, sizeof(ev));
   ev.type = UHID_DESTROY;
@@ -317,17 +437,18 @@ void bta_hh_co_destroy(int fd) {
 int bta_hh_co_write(int fd, uint8_t* rpt, uint16_t len) {
   APPL_TRACE_VERBOSE("%s: UHID write %d", __func__, len);
 
+  // Only the header and the report are written, the kernel zero fills the rest
+  // of the event, so the 4 KB event is neither cleared nor copied here
   struct uhid_event ev;
-  memset(&ev, 0, sizeof(ev));
-  ev.type = UHID_INPUT;
-  ev.u.input.size = len;
-  if (len > sizeof(ev.u.input.data)) {
+  ev.type = UHID_INPUT2;
+  ev.u.input2.size = len;
+  if (len > sizeof(ev.u.input2.data)) {
     APPL_TRACE_WARNING("%s: Report size greater than allowed size", __func__);
     return -1;
   }
-  memcpy(ev.u.input.data, rpt, len);
+  memcpy(ev.u.input2.data, rpt, len);
 
-  return uhid_write(fd, &ev);
+  return uhid_write(fd, &ev, offsetof(struct uhid_event, u.input2.data) + len);
 }
 
 /*******************************************************************************
@@ -371,9 +492,7 @@ void bta_hh_co_open(uint8_t dev_handle, uint8_t sub_class,
           APPL_TRACE_DEBUG("%s: uhid fd = %d", __func__, p_dev->fd);
       }
 
-      p_dev->hh_keep_polling = 1;
-      p_dev->hh_poll_thread_id =
-          create_thread(btif_hh_poll_event_thread, p_dev);
+      btif_hh_uhid_event_loop_add(p_dev);
       break;
     }
     p_dev = NULL;
@@ -399,9 +518,7 @@ void bta_hh_co_open(uint8_t dev_handle, uint8_t sub_class,
           return;
         } else {
           APPL_TRACE_DEBUG("%s: uhid fd = %d", __func__, p_dev->fd);
-          p_dev->hh_keep_polling = 1;
-          p_dev->hh_poll_thread_id =
-              create_thread(btif_hh_poll_event_thread, p_dev);
+          btif_hh_uhid_event_loop_add(p_dev);
         }
 
         break;
@@ -465,7 +582,7 @@ void bta_hh_co_close(uint8_t dev_handle, uint8_t app_id) {
           "%s: Found an existing device with the same handle "
           "dev_status = %d, dev_handle =%d",
           __func__, p_dev->dev_status, p_dev->dev_handle);
-      btif_hh_close_poll_thread(p_dev);
+      btif_hh_uhid_event_loop_remove(p_dev->fd);
       break;
     }
   }
@@ -506,13 +623,14 @@ void bta_hh_co_data(uint8_t dev_handle, uint8_t* p_rpt, uint16_t len,
   }
 
   // Wait a maximum of MAX_POLLING_ATTEMPTS x POLLING_SLEEP_DURATION in case
-  // device creation is pending.
-  if (p_dev->fd >= 0) {
-    uint32_t polling_attempts = 0;
-    while (!p_dev->ready_for_data &&
-           polling_attempts++ < BTIF_HH_MAX_POLLING_ATTEMPTS) {
-      usleep(BTIF_HH_POLLING_SLEEP_DURATION_US);
-    }
+  // device creation is pending. The event thread wakes us up on UHID_START.
+  if (p_dev->fd >= 0 && !p_dev->ready_for_data) {
+    std::unique_lock<std::mutex> lock(uhid_dispatch_mutex);
+    uhid_ready_cv.wait_for(
+        lock,
+        std::chrono::microseconds(BTIF_HH_MAX_POLLING_ATTEMPTS *
+                                  BTIF_HH_POLLING_SLEEP_DURATION_US),
+        [p_dev] { return p_dev->ready_for_data; });
   }
 
   // Send the HID data to the kernel.
@@ -581,6 +699,7 @@ void bta_hh_co_send_hid_info(btif_hh_device_t* p_dev, const char* dev_name,
                        result);
 
     /* The HID report descriptor is corrupted. Close the driver. */
+    btif_hh_uhid_event_loop_remove(p_dev->fd);
     close(p_dev->fd);
     p_dev->fd = -1;
   }
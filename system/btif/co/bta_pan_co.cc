@@ -26,11 +26,14 @@
  ******************************************************************************/
 #include "bta_pan_co.h"
 
+#include <arpa/inet.h>
 #include <base/logging.h>
 #include <hardware/bluetooth.h>
 #include <hardware/bt_pan.h>
 #include <string.h>
 
+#include <vector>
+
 #include "bta_api.h"
 #include "bta_pan_api.h"
 #include "bta_pan_ci.h"
@@ -117,6 +120,7 @@ void bta_pan_co_tx_path(uint16_t handle, uint8_t app_id) {
   uint16_t protocol;
   bool ext;
   bool forward;
+  std::vector<btpan_frame_t> frames;
 
   BTIF_TRACE_API("%s, handle:%d, app_id:%d", __func__, handle, app_id);
 
@@ -134,22 +138,25 @@ void bta_pan_co_tx_path(uint16_t handle, uint8_t app_id) {
     /* read next data buffer from pan */
     p_buf = bta_pan_ci_readbuf(handle, src, dst, &protocol, &ext, &forward);
     if (p_buf) {
-      BTIF_TRACE_DEBUG(
-          "%s, calling btapp_tap_send, "
-          "p_buf->len:%d, offset:%d",
-          __func__, p_buf->len, p_buf->offset);
+      BTIF_TRACE_DEBUG("%s, queueing for tap, p_buf->len:%d, offset:%d",
+                       __func__, p_buf->len, p_buf->offset);
       if (is_empty_eth_addr(conn->eth_addr) && is_valid_bt_eth_addr(src)) {
         VLOG(1) << __func__ << " pan bt peer addr: " << conn->peer
                 << " update its ethernet addr: " << src;
         conn->eth_addr = src;
       }
-      btpan_tap_send(btpan_cb.tap_fd, src, dst, protocol,
-                     (char*)(p_buf + 1) + p_buf->offset, p_buf->len, ext,
-                     forward);
-      osi_free(p_buf);
+      btpan_frame_t frame;
+      frame.hdr.h_dest = dst;
+      frame.hdr.h_src = src;
+      frame.hdr.h_proto = htons(protocol);
+      frame.buf = p_buf;
+      frames.push_back(frame);
     }
 
   } while (p_buf != NULL);
+
+  /* The tap device is written on the PAN data thread */
+  btpan_tap_send_batch(btpan_cb.tap_fd, std::move(frames));
 }
 
 /*******************************************************************************
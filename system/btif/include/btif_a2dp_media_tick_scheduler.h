@@ -0,0 +1,113 @@
+/*
+ *  Copyright 2022 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef BTIF_A2DP_MEDIA_TICK_SCHEDULER_H
+#define BTIF_A2DP_MEDIA_TICK_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+
+// Number of consecutive media ticks without audio data before the tick
+// interval is stretched, and the longest interval in encoder intervals.
+static constexpr size_t kIdleTicksBeforeStretching = 10;
+static constexpr uint64_t kMaxIdleIntervalScale = 4;
+
+// Adapts the media tick to the link and to the audio source, for encoders
+// that size their output from the time elapsed since their previous call:
+// - A tick is deferred while the TX queue is more than half full, and the
+//   audio is left with the audio source instead of overflowing the queue,
+//   which would flush it. The next tick encodes both.
+// - The tick interval is doubled, up to kMaxIdleIntervalScale encoder
+//   intervals, while the audio source has no data, and goes back to the
+//   encoder interval as soon as data is read.
+// The media timer keeps the ticks aligned to their expected time, so that
+// the interval changes do not add drift.
+class MediaTickScheduler {
+ public:
+  MediaTickScheduler() { Reset(0, false); }
+  void Reset(uint64_t encoder_interval_us, bool adaptive) {
+    encoder_interval_us_ = encoder_interval_us;
+    adaptive_ = adaptive;
+    interval_us_ = encoder_interval_us;
+    next_tick_interval_us_ = encoder_interval_us;
+    idle_ticks_ = 0;
+    deferred_ = false;
+    tick_bytes_read_ = 0;
+  }
+
+  // Starts a tick. Returns the interval (in us) expected since the previous
+  // tick.
+  uint64_t StartTick() {
+    uint64_t expected_interval_us = next_tick_interval_us_;
+    // The media timer has already scheduled the next tick
+    next_tick_interval_us_ = interval_us_;
+    tick_bytes_read_ = 0;
+    return expected_interval_us;
+  }
+
+  // Returns false if the current tick should not encode, given the TX queue
+  // length and the length at which the queue overflows.
+  bool ShouldEncode(size_t tx_queue_length, size_t tx_queue_max_length) {
+    // Never defer twice in a row: the encoders limit how much they catch up
+    if (!adaptive_ || deferred_ || tx_queue_length * 2 <= tx_queue_max_length) {
+      deferred_ = false;
+      return true;
+    }
+    deferred_ = true;
+    return false;
+  }
+
+  // Records PCM data read from the audio source during the current tick.
+  void OnAudioRead(uint32_t bytes_read) { tick_bytes_read_ += bytes_read; }
+
+  // Ends a tick. Returns the new interval (in us) of the media timer, or 0 if
+  // it is unchanged.
+  uint64_t EndTick(size_t tx_queue_length) {
+    if (!adaptive_ || deferred_) return 0;
+
+    uint64_t interval_us = encoder_interval_us_;
+    if (tick_bytes_read_ == 0 && tx_queue_length == 0) {
+      idle_ticks_++;
+      if (idle_ticks_ >= kIdleTicksBeforeStretching) {
+        interval_us = std::min(interval_us_ * 2,
+                               encoder_interval_us_ * kMaxIdleIntervalScale);
+      }
+    } else {
+      idle_ticks_ = 0;
+    }
+    if (interval_us == interval_us_) return 0;
+    interval_us_ = interval_us;
+    return interval_us_;
+  }
+
+  // Whether the tick interval is currently stretched.
+  bool IsStretched() const { return interval_us_ > encoder_interval_us_; }
+
+ private:
+  uint64_t encoder_interval_us_;
+  bool adaptive_;
+  // The interval of the media timer
+  uint64_t interval_us_;
+  // The interval the next tick was scheduled with
+  uint64_t next_tick_interval_us_;
+  size_t idle_ticks_;
+  bool deferred_;
+  uint32_t tick_bytes_read_;
+};
+
+#endif  // BTIF_A2DP_MEDIA_TICK_SCHEDULER_H
@@ -89,8 +89,7 @@ typedef struct {
   uint8_t app_id;
   int fd;
   bool ready_for_data;
-  pthread_t hh_poll_thread_id;
-  pid_t pid{-1};
+  // Written by the uhid event loop with its dispatch lock held
   uint8_t hh_keep_polling;
   alarm_t* vup_timer;
   fixed_queue_t* get_rpt_id_queue;
@@ -27,7 +27,10 @@
 #ifndef BTIF_PAN_INTERNAL_H
 #define BTIF_PAN_INTERNAL_H
 
+#include <vector>
+
 #include "btif_pan.h"
+#include "stack/include/bt_hdr.h"
 #include "types/raw_address.h"
 
 /*******************************************************************************
@@ -73,10 +76,15 @@ typedef struct {
   int open_count;
   int flow;  // 1: outbound data flow on; 0: outbound data flow off
   btpan_conn_t conns[MAX_PAN_CONNS];
-  int congest_packet_size;
-  unsigned char congest_packet[1600];  // max ethernet packet size
 } btpan_cb_t;
 
+/* An Ethernet frame with its header split from the payload, which is the
+ * data of |buf| */
+typedef struct {
+  tETH_HDR hdr;
+  BT_HDR* buf;
+} btpan_frame_t;
+
 /*******************************************************************************
  *  Functions
  ******************************************************************************/
@@ -95,6 +103,7 @@ int btpan_tap_close(int tap_fd);
 int btpan_tap_send(int tap_fd, const RawAddress& src, const RawAddress& dst,
                    uint16_t protocol, const char* buff, uint16_t size, bool ext,
                    bool forward);
+void btpan_tap_send_batch(int tap_fd, std::vector<btpan_frame_t> frames);
 
 static inline int is_empty_eth_addr(const RawAddress& addr) {
   return addr == RawAddress::kEmpty;
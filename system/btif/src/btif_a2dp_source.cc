@@ -30,12 +30,14 @@
 #include <string.h>
 
 #include <algorithm>
+#include <string>
 
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
 #include "audio_hal_interface/a2dp_encoding.h"
 #include "bta_av_ci.h"
 #include "btif_a2dp.h"
 #include "btif_a2dp_control.h"
+#include "btif_a2dp_media_tick_scheduler.h"
 #include "btif_a2dp_source.h"
 #include "btif_av.h"
 #include "btif_av_co.h"
@@ -69,6 +71,14 @@ extern std::unique_ptr<tUIPC_STATE> a2dp_uipc;
  */
 #define MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ (MAX_PCM_FRAME_NUM_PER_TICK * 2)
 
+// Upper bounds (in us) of the scheduling jitter histogram buckets. The last
+// bucket counts all larger deviations.
+static constexpr uint64_t kSchedulingJitterBucketsUs[] = {500,  1000,  2000,
+                                                          5000, 10000, 20000};
+static constexpr size_t kSchedulingJitterBucketCount =
+    sizeof(kSchedulingJitterBucketsUs) / sizeof(kSchedulingJitterBucketsUs[0]) +
+    1;
+
 class SchedulingStats {
  public:
   SchedulingStats() { Reset(); }
@@ -83,6 +93,7 @@ class SchedulingStats {
     max_premature_scheduling_delta_us = 0;
     exact_scheduling_count = 0;
     total_scheduling_time_us = 0;
+    std::fill(std::begin(jitter_histogram), std::end(jitter_histogram), 0);
   }
 
   // Counter for total updates
@@ -114,6 +125,10 @@ class SchedulingStats {
 
   // Accumulated and counted scheduling time (in us)
   uint64_t total_scheduling_time_us;
+
+  // Counts of the deviations from the expected scheduling time, bucketed by
+  // kSchedulingJitterBucketsUs
+  size_t jitter_histogram[kSchedulingJitterBucketCount];
 };
 
 class BtifMediaStats {
@@ -136,6 +151,8 @@ class BtifMediaStats {
     tx_queue_max_dropped_messages = 0;
     tx_queue_dropouts = 0;
     tx_queue_last_dropouts_us = 0;
+    tx_queue_total_deferred_ticks = 0;
+    media_total_stretched_ticks = 0;
     media_read_total_underflow_bytes = 0;
     media_read_total_underflow_count = 0;
     media_read_last_underflow_us = 0;
@@ -164,6 +181,9 @@ class BtifMediaStats {
   size_t tx_queue_max_dropped_messages;
   size_t tx_queue_dropouts;
   uint64_t tx_queue_last_dropouts_us;
+  size_t tx_queue_total_deferred_ticks;
+
+  size_t media_total_stretched_ticks;
 
   size_t media_read_total_underflow_bytes;
   size_t media_read_total_underflow_count;
@@ -193,6 +213,7 @@ class BtifA2dpSource {
     tx_audio_queue = nullptr;
     tx_flush = false;
     media_alarm.CancelAndWait();
+    tick_scheduler.Reset(0, false);
     wakelock_release();
     encoder_interface = nullptr;
     encoder_interval_ms = 0;
@@ -220,6 +241,7 @@ class BtifA2dpSource {
   fixed_queue_t* tx_audio_queue;
   bool tx_flush; /* Discards any outgoing data when true */
   RepeatingTimer media_alarm;
+  MediaTickScheduler tick_scheduler;
   const tA2DP_ENCODER_INTERFACE* encoder_interface;
   uint64_t encoder_interval_ms; /* Local copy of the encoder interval */
   BtifMediaStats stats;
@@ -269,6 +291,8 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
 static void log_tstamps_us(const char* comment, uint64_t timestamp_us);
 static void update_scheduling_stats(SchedulingStats* stats, uint64_t now_us,
                                     uint64_t expected_delta);
+static void dump_jitter_histogram(int fd, const char* name,
+                                  const SchedulingStats* stats);
 // Update the A2DP Source related metrics.
 // This function should be called before collecting the metrics.
 static void btif_a2dp_source_update_metrics(void);
@@ -294,6 +318,9 @@ void btif_a2dp_source_accumulate_scheduling_stats(SchedulingStats* src,
                src->max_premature_scheduling_delta_us);
   dst->exact_scheduling_count += src->exact_scheduling_count;
   dst->total_scheduling_time_us += src->total_scheduling_time_us;
+  for (size_t i = 0; i < kSchedulingJitterBucketCount; i++) {
+    dst->jitter_histogram[i] += src->jitter_histogram[i];
+  }
 }
 
 void btif_a2dp_source_accumulate_stats(BtifMediaStats* src,
@@ -313,6 +340,8 @@ void btif_a2dp_source_accumulate_stats(BtifMediaStats* src,
       dst->tx_queue_max_dropped_messages, src->tx_queue_max_dropped_messages);
   dst->tx_queue_dropouts += src->tx_queue_dropouts;
   dst->tx_queue_last_dropouts_us = src->tx_queue_last_dropouts_us;
+  dst->tx_queue_total_deferred_ticks += src->tx_queue_total_deferred_ticks;
+  dst->media_total_stretched_ticks += src->media_total_stretched_ticks;
   dst->media_read_total_underflow_bytes +=
       src->media_read_total_underflow_bytes;
   dst->media_read_total_underflow_count +=
@@ -587,9 +616,15 @@ static void btif_a2dp_source_setup_codec_delayed(
     return;
   }
 
-  btif_a2dp_source_cb.encoder_interface->encoder_init(
-      &peer_params, a2dp_codec_config, btif_a2dp_source_read_callback,
-      btif_a2dp_source_enqueue_callback);
+  if (!btif_a2dp_source_cb.encoder_interface->encoder_init(
+          &peer_params, a2dp_codec_config, btif_a2dp_source_read_callback,
+          btif_a2dp_source_enqueue_callback)) {
+    LOG_ERROR("%s: Cannot stream audio: cannot initialize the %s encoder",
+              __func__, a2dp_codec_config->name().c_str());
+    btif_a2dp_source_cb.encoder_interface->encoder_cleanup();
+    btif_a2dp_source_cb.encoder_interface = nullptr;
+    return;
+  }
 
   // Save a local copy of the encoder_interval_ms
   btif_a2dp_source_cb.encoder_interval_ms =
@@ -795,8 +830,13 @@ static void btif_a2dp_source_audio_tx_start_event(void) {
 
   if (btif_av_is_a2dp_offload_running()) return;
 
+  if (btif_a2dp_source_cb.encoder_interface == nullptr) {
+    LOG_ERROR("%s: Cannot start streaming: the encoder is not initialized",
+              __func__);
+    return;
+  }
+
   /* Reset the media feeding state */
-  CHECK(btif_a2dp_source_cb.encoder_interface != nullptr);
   btif_a2dp_source_cb.encoder_interface->feeding_reset();
 
   APPL_TRACE_EVENT(
@@ -807,6 +847,9 @@ static void btif_a2dp_source_audio_tx_start_event(void) {
   btif_a2dp_source_cb.tx_flush = false;
 
   wakelock_acquire();
+  btif_a2dp_source_cb.tick_scheduler.Reset(
+      btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms() * 1000,
+      btif_a2dp_source_cb.encoder_interface->supports_variable_interval);
   btif_a2dp_source_cb.media_alarm.SchedulePeriodic(
       btif_a2dp_source_thread.GetWeakPtr(), FROM_HERE,
       base::Bind(&btif_a2dp_source_audio_handle_timer),
@@ -903,6 +946,8 @@ static void btif_a2dp_source_audio_handle_timer(void) {
     return;
   }
   CHECK(btif_a2dp_source_cb.encoder_interface != nullptr);
+  uint64_t expected_interval_us =
+      btif_a2dp_source_cb.tick_scheduler.StartTick();
   size_t transmit_queue_length =
       fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
 #ifndef OS_GENERIC
@@ -913,11 +958,33 @@ static void btif_a2dp_source_audio_handle_timer(void) {
     btif_a2dp_source_cb.encoder_interface->set_transmit_queue_length(
         transmit_queue_length);
   }
-  btif_a2dp_source_cb.encoder_interface->send_frames(timestamp_us);
+  if (btif_a2dp_source_cb.tick_scheduler.ShouldEncode(
+          transmit_queue_length, btif_a2dp_source_dynamic_audio_buffer_size)) {
+    btif_a2dp_source_cb.encoder_interface->send_frames(timestamp_us);
+  } else {
+    LOG_VERBOSE("%s: TX queue backed up (%zu), deferring encoding", __func__,
+                transmit_queue_length);
+    btif_a2dp_source_cb.stats.tx_queue_total_deferred_ticks++;
+  }
   bta_av_ci_src_data_ready(BTA_AV_CHNL_AUDIO);
   update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_enqueue_stats,
-                          timestamp_us,
-                          btif_a2dp_source_cb.encoder_interval_ms * 1000);
+                          timestamp_us, expected_interval_us);
+
+  uint64_t interval_us = btif_a2dp_source_cb.tick_scheduler.EndTick(
+      fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue));
+  if (interval_us != 0) {
+    LOG_VERBOSE("%s: media tick interval is now %" PRIu64 " us", __func__,
+                interval_us);
+    btif_a2dp_source_cb.media_alarm.UpdatePeriod(
+#if BASE_VER < 931007
+        base::TimeDelta::FromMicroseconds(interval_us));
+#else
+        base::Microseconds(interval_us));
+#endif
+  }
+  if (btif_a2dp_source_cb.tick_scheduler.IsStretched()) {
+    btif_a2dp_source_cb.stats.media_total_stretched_ticks++;
+  }
 }
 
 static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len) {
@@ -928,6 +995,7 @@ static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len) {
   } else if (a2dp_uipc != nullptr) {
     bytes_read = UIPC_Read(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, p_buf, len);
   }
+  btif_a2dp_source_cb.tick_scheduler.OnAudioRead(bytes_read);
 
   if (bytes_read < len) {
     LOG_WARN("%s: UNDERFLOW: ONLY READ %d BYTES OUT OF %d", __func__,
@@ -1095,6 +1163,14 @@ static void update_scheduling_stats(SchedulingStats* stats, uint64_t now_us,
   if (last_us == 0) return;  // First update: expected delta doesn't apply
 
   uint64_t deadline_us = last_us + expected_delta;
+  uint64_t jitter_us =
+      deadline_us > now_us ? deadline_us - now_us : now_us - deadline_us;
+  size_t bucket = 0;
+  while (bucket < kSchedulingJitterBucketCount - 1 &&
+         jitter_us >= kSchedulingJitterBucketsUs[bucket]) {
+    bucket++;
+  }
+  stats->jitter_histogram[bucket]++;
   if (deadline_us < now_us) {
     // Overdue scheduling
     uint64_t delta_us = now_us - deadline_us;
@@ -1124,6 +1200,27 @@ static void update_scheduling_stats(SchedulingStats* stats, uint64_t now_us,
   }
 }
 
+static void dump_jitter_histogram(int fd, const char* name,
+                                  const SchedulingStats* stats) {
+  std::string buckets;
+  std::string counts;
+  for (size_t i = 0; i < kSchedulingJitterBucketCount; i++) {
+    if (i > 0) {
+      buckets += "/";
+      counts += " / ";
+    }
+    if (i + 1 < kSchedulingJitterBucketCount) {
+      buckets += "<" + std::to_string(kSchedulingJitterBucketsUs[i]);
+    } else {
+      buckets += "more";
+    }
+    counts += std::to_string(stats->jitter_histogram[i]);
+  }
+  std::string title =
+      std::string("  ") + name + " jitter in us (" + buckets + ")";
+  dprintf(fd, "%-58s: %s\n", title.c_str(), counts.c_str());
+}
+
 void btif_a2dp_source_debug_dump(int fd) {
   btif_a2dp_source_accumulate_stats(&btif_a2dp_source_cb.stats,
                                     &btif_a2dp_source_cb.accumulated_stats);
@@ -1195,6 +1292,12 @@ void btif_a2dp_source_debug_dump(int fd) {
                 1000
           : 0);
 
+  dprintf(fd,
+          "  Counts (deferred/stretched ticks)                       : %zu / "
+          "%zu\n",
+          accumulated_stats->tx_queue_total_deferred_ticks,
+          accumulated_stats->media_total_stretched_ticks);
+
   dprintf(fd,
           "  Counts (underflow)                                      : %zu\n",
           accumulated_stats->media_read_total_underflow_count);
@@ -1250,6 +1353,8 @@ void btif_a2dp_source_debug_dump(int fd) {
           1000,
       (unsigned long long)ave_time_us / 1000);
 
+  dump_jitter_histogram(fd, "Enqueue", enqueue_stats);
+
   //
   // TxQueue dequeue stats
   //
@@ -1287,6 +1392,8 @@ void btif_a2dp_source_debug_dump(int fd) {
       (unsigned long long)dequeue_stats->max_premature_scheduling_delta_us /
           1000,
       (unsigned long long)ave_time_us / 1000);
+
+  dump_jitter_histogram(fd, "Dequeue", dequeue_stats);
 }
 
 static void btif_a2dp_source_update_metrics(void) {
@@ -49,6 +49,8 @@
 #include "btif/include/stack_manager.h"
 #include "common/message_loop_thread.h"
 #include "device/include/controller.h"
+#include "hci/le_host_batch_scan_storage.h"
+#include "hci/le_host_scan_filter.h"
 #include "osi/include/allocator.h"
 #include "osi/include/future.h"
 #include "osi/include/log.h"
@@ -583,13 +585,18 @@ void btif_get_adapter_property(bt_property_type_t type) {
     prop.len = sizeof(bt_local_le_features_t);
     if (cmn_vsc_cb.filter_support == 1)
       local_le_features.max_adv_filter_supported = cmn_vsc_cb.max_filter;
-    else
-      local_le_features.max_adv_filter_supported = 0;
+    else  // Scan results are filtered on the host instead
+      local_le_features.max_adv_filter_supported =
+          bluetooth::hci::LeHostScanFilter::kMaxFilters;
     local_le_features.max_adv_instance = cmn_vsc_cb.adv_inst_max;
     local_le_features.max_irk_list_size = cmn_vsc_cb.max_irk_list_sz;
     local_le_features.rpa_offload_supported = cmn_vsc_cb.rpa_offloading;
-    local_le_features.scan_result_storage_size =
-        cmn_vsc_cb.tot_scan_results_strg;
+    if (cmn_vsc_cb.tot_scan_results_strg > 0)
+      local_le_features.scan_result_storage_size =
+          cmn_vsc_cb.tot_scan_results_strg;
+    else  // Scan results are batched on the host instead
+      local_le_features.scan_result_storage_size =
+          bluetooth::hci::kHostBatchScanStorageSize;
     local_le_features.activity_energy_info_supported =
         cmn_vsc_cb.energy_support;
     local_le_features.version_supported = cmn_vsc_cb.version_supported;
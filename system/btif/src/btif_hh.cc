@@ -470,8 +470,7 @@ void btif_hh_remove_device(RawAddress bd_addr) {
     BTIF_TRACE_WARNING("%s: device_num = 0", __func__);
   }
 
-  p_dev->hh_keep_polling = 0;
-  p_dev->hh_poll_thread_id = -1;
+  // Destroying the uhid device stops polling it
   BTIF_TRACE_DEBUG("%s: uhid fd = %d", __func__, p_dev->fd);
   if (p_dev->fd >= 0) {
     bta_hh_co_destroy(p_dev->fd);
@@ -1732,8 +1731,6 @@ static void cleanup(void) {
         bta_hh_co_destroy(p_dev->fd);
         p_dev->fd = -1;
       }
-      p_dev->hh_keep_polling = 0;
-      p_dev->hh_poll_thread_id = -1;
     }
   }
 
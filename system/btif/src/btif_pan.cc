@@ -34,15 +34,19 @@
 #include <linux/if_ether.h>
 #include <linux/if_tun.h>
 #include <net/if.h>
-#include <poll.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <deque>
+#include <vector>
+
 #include "bt_target.h"  // Must be first to define build configuration
 #include "bta/include/bta_pan_api.h"
 #include "btif/include/btif_common.h"
 #include "btif/include/btif_pan_internal.h"
 #include "btif/include/btif_sock_thread.h"
+#include "common/message_loop_thread.h"
 #include "device/include/controller.h"
 #include "include/hardware/bt_pan.h"
 #include "osi/include/allocator.h"
@@ -66,10 +70,14 @@
                        __func__, #s, __LINE__)                           \
   } while (0)
 
-#define MIN(x, y) (((x) < (y)) ? (x) : (y))
-
 btpan_cb_t btpan_cb;
 
+// Reads and writes the tap device, off the main thread
+static bluetooth::common::MessageLoopThread pan_data_thread(
+    "bt_pan_data_thread");
+// Frames read from the tap device that BNEP did not take yet, oldest first
+static std::deque<btpan_frame_t> tap_backlog;
+
 static bool jni_initialized;
 static bool stack_initialized;
 
@@ -85,7 +93,10 @@ static void btpan_tap_fd_signaled(int fd, int type, int flags,
                                   uint32_t user_id);
 static void btpan_cleanup_conn(btpan_conn_t* conn);
 static void bta_pan_callback(tBTA_PAN_EVT event, tBTA_PAN* p_data);
-static void btu_exec_tap_fd_read(const int fd);
+static void pan_data_read_tap(int fd);
+static void btu_exec_tap_frames(int fd, std::vector<btpan_frame_t> frames);
+static void btpan_forward_backlog();
+static void btpan_clear_backlog();
 
 static btpan_interface_t pan_if = {
     sizeof(pan_if), btpan_jni_init,   nullptr,          btpan_get_local_role,
@@ -242,6 +253,11 @@ static bt_status_t btpan_disconnect(const RawAddress* bd_addr) {
 
 static int pan_pth = -1;
 void create_tap_read_thread(int tap_fd) {
+  if (!pan_data_thread.IsRunning()) {
+    pan_data_thread.StartUp();
+    if (!pan_data_thread.IsRunning())
+      LOG_ERROR("Unable to start the PAN data thread, using the main thread");
+  }
   if (pan_pth < 0) pan_pth = btsock_thread_create(btpan_tap_fd_signaled, NULL);
   if (pan_pth >= 0)
     btsock_thread_add_fd(pan_pth, tap_fd, 0, SOCK_THREAD_FD_RD, 0);
@@ -252,6 +268,10 @@ void destroy_tap_read_thread(void) {
     btsock_thread_exit(pan_pth);
     pan_pth = -1;
   }
+  // Done before the tap device is closed, so that nothing is still reading
+  // or writing it
+  pan_data_thread.ShutDown();
+  btpan_clear_backlog();
 }
 
 static int tap_if_up(const char* devname, const RawAddress* addr) {
@@ -343,9 +363,14 @@ void btpan_set_flow_control(bool enable) {
 
   btpan_cb.flow = enable;
   if (enable) {
+    // Frames left over from the last time the flow was off go first
+    btpan_forward_backlog();
+    if (!tap_backlog.empty()) return;
     btsock_thread_add_fd(pan_pth, btpan_cb.tap_fd, 0, SOCK_THREAD_FD_RD, 0);
-    do_in_main_thread(FROM_HERE,
-                      base::Bind(btu_exec_tap_fd_read, btpan_cb.tap_fd));
+    int fd = btpan_cb.tap_fd;
+    if (!pan_data_thread.DoInThread(FROM_HERE,
+                                    base::BindOnce(pan_data_read_tap, fd)))
+      pan_data_read_tap(fd);
   }
 }
 
@@ -384,6 +409,26 @@ int btpan_tap_open() {
   return INVALID_FD;
 }
 
+static int tap_write_frame(int tap_fd, const tETH_HDR& eth_hdr,
+                           const char* buf, uint16_t len) {
+  if (len > TAP_MAX_PKT_WRITE_LEN) {
+    LOG_ERROR("btpan_tap_send eth packet size:%d is exceeded limit!", len);
+    return -1;
+  }
+
+  /* Send data to network interface, the header and payload gathered by the
+   * kernel rather than copied together first */
+  struct iovec iov[2];
+  iov[0].iov_base = const_cast<tETH_HDR*>(&eth_hdr);
+  iov[0].iov_len = sizeof(tETH_HDR);
+  iov[1].iov_base = const_cast<char*>(buf);
+  iov[1].iov_len = len;
+  ssize_t ret;
+  OSI_NO_INTR(ret = writev(tap_fd, iov, 2));
+  BTIF_TRACE_DEBUG("ret:%d", ret);
+  return (int)ret;
+}
+
 int btpan_tap_send(int tap_fd, const RawAddress& src, const RawAddress& dst,
                    uint16_t proto, const char* buf, uint16_t len,
                    UNUSED_ATTR bool ext, UNUSED_ATTR bool forward) {
@@ -392,23 +437,48 @@ int btpan_tap_send(int tap_fd, const RawAddress& src, const RawAddress& dst,
     eth_hdr.h_dest = dst;
     eth_hdr.h_src = src;
     eth_hdr.h_proto = htons(proto);
-    char packet[TAP_MAX_PKT_WRITE_LEN + sizeof(tETH_HDR)];
-    memcpy(packet, &eth_hdr, sizeof(tETH_HDR));
-    if (len > TAP_MAX_PKT_WRITE_LEN) {
-      LOG_ERROR("btpan_tap_send eth packet size:%d is exceeded limit!", len);
-      return -1;
-    }
-    memcpy(packet + sizeof(tETH_HDR), buf, len);
-
-    /* Send data to network interface */
-    ssize_t ret;
-    OSI_NO_INTR(ret = write(tap_fd, packet, len + sizeof(tETH_HDR)));
-    BTIF_TRACE_DEBUG("ret:%d", ret);
-    return (int)ret;
+    return tap_write_frame(tap_fd, eth_hdr, buf, len);
   }
   return -1;
 }
 
+static void pan_data_write_tap(int tap_fd, std::vector<btpan_frame_t> frames) {
+  for (auto& frame : frames) {
+    tap_write_frame(tap_fd, frame.hdr,
+                    (const char*)(frame.buf + 1) + frame.buf->offset,
+                    frame.buf->len);
+    osi_free(frame.buf);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btpan_tap_send_batch
+ *
+ * Description      Writes |frames| to the tap device on the PAN data thread,
+ *                  in order, and frees their buffers. The |hdr| of each frame
+ *                  is in network byte order.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btpan_tap_send_batch(int tap_fd, std::vector<btpan_frame_t> frames) {
+  if (tap_fd == INVALID_FD) {
+    for (auto& frame : frames) osi_free(frame.buf);
+    return;
+  }
+  if (frames.empty()) return;
+
+  // The frames posted are all written and freed before ShutDown() returns, as
+  // it quits the thread once idle. The task and its copy of |frames| is
+  // dropped when posting fails, so the frames are written here instead.
+  if (!pan_data_thread.IsRunning() ||
+      !pan_data_thread.DoInThread(
+          FROM_HERE, base::BindOnce(pan_data_write_tap, tap_fd, frames))) {
+    pan_data_write_tap(tap_fd, std::move(frames));
+  }
+}
+
 int btpan_tap_close(int fd) {
   if (tap_if_down(TAP_IF_NAME) == 0) close(fd);
   if (pan_pth >= 0) btsock_thread_wakeup(pan_pth);
@@ -638,86 +708,98 @@ static void bta_pan_callback(tBTA_PAN_EVT event, tBTA_PAN* p_data) {
                         sizeof(tBTA_PAN), NULL);
 }
 
-#define IS_EXCEPTION(e) ((e) & (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL))
-static void btu_exec_tap_fd_read(int fd) {
-  struct pollfd ufd;
-
-  if (fd == INVALID_FD || fd != btpan_cb.tap_fd) return;
+/*******************************************************************************
+ *
+ * Function         pan_data_read_tap
+ *
+ * Description      Runs on the PAN data thread once the tap device is
+ *                  readable. Reads the frames queued in the driver, up to
+ *                  PAN_BUF_MAX, straight into the buffers later handed to
+ *                  BNEP, and passes them to the main thread in one batch.
+ *                  The Ethernet header is split off in place: BNEP builds its
+ *                  own header over it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void pan_data_read_tap(int fd) {
+  std::vector<btpan_frame_t> frames;
 
-  // Don't occupy BTU context too long, avoid buffer overruns and
+  // Don't occupy the main thread too long, avoid buffer overruns and
   // give other profiles a chance to run by limiting the amount of memory
   // PAN can use.
-  for (int i = 0; i < PAN_BUF_MAX && btif_is_enabled() && btpan_cb.flow; i++) {
-    BT_HDR* buffer = (BT_HDR*)osi_malloc(PAN_BUF_SIZE);
+  while (frames.size() < PAN_BUF_MAX) {
+    BT_HDR* buffer = (BT_HDR*)osi_buffer_malloc(PAN_BUF_SIZE);
     buffer->offset = PAN_MINIMUM_OFFSET;
-    buffer->len = PAN_BUF_SIZE - sizeof(BT_HDR) - buffer->offset;
-
-    uint8_t* packet = (uint8_t*)buffer + sizeof(BT_HDR) + buffer->offset;
-
-    // If we don't have an undelivered packet left over, pull one from the TAP
-    // driver.
-    // We save it in the congest_packet right away in case we can't deliver it
-    // in this
-    // attempt.
-    if (!btpan_cb.congest_packet_size) {
-      ssize_t ret;
-      OSI_NO_INTR(ret = read(fd, btpan_cb.congest_packet,
-                             sizeof(btpan_cb.congest_packet)));
-      switch (ret) {
-        case -1:
-          BTIF_TRACE_ERROR("%s unable to read from driver: %s", __func__,
-                           strerror(errno));
-          osi_free(buffer);
-          // add fd back to monitor thread to try it again later
-          btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
-          return;
-        case 0:
-          BTIF_TRACE_WARNING("%s end of file reached.", __func__);
-          osi_free(buffer);
-          // add fd back to monitor thread to process the exception
-          btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
-          return;
-        default:
-          btpan_cb.congest_packet_size = ret;
-          break;
-      }
+    uint8_t* packet = (uint8_t*)(buffer + 1) + buffer->offset;
+
+    ssize_t ret;
+    OSI_NO_INTR(ret = read(fd, packet,
+                           PAN_BUF_SIZE - sizeof(BT_HDR) - buffer->offset));
+    if (ret < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        BTIF_TRACE_ERROR("%s unable to read from driver: %s", __func__,
+                         strerror(errno));
+      osi_free(buffer);
+      break;
+    }
+    if (ret == 0) {
+      BTIF_TRACE_WARNING("%s end of file reached.", __func__);
+      osi_free(buffer);
+      break;
     }
 
-    memcpy(packet, btpan_cb.congest_packet,
-           MIN(btpan_cb.congest_packet_size, buffer->len));
-    buffer->len = MIN(btpan_cb.congest_packet_size, buffer->len);
-
-    if (buffer->len > sizeof(tETH_HDR) && should_forward((tETH_HDR*)packet)) {
-      // Extract the ethernet header from the buffer since the PAN_WriteBuf
-      // inside
-      // forward_bnep can't handle two pointers that point inside the same GKI
-      // buffer.
-      tETH_HDR hdr;
-      memcpy(&hdr, packet, sizeof(tETH_HDR));
-
-      // Skip the ethernet header.
-      buffer->len -= sizeof(tETH_HDR);
-      buffer->offset += sizeof(tETH_HDR);
-      if (forward_bnep(&hdr, buffer) != FORWARD_CONGEST)
-        btpan_cb.congest_packet_size = 0;
-    } else {
-      BTIF_TRACE_WARNING("%s dropping packet of length %d", __func__,
-                         buffer->len);
-      btpan_cb.congest_packet_size = 0;
+    if ((size_t)ret <= sizeof(tETH_HDR) || !should_forward((tETH_HDR*)packet)) {
+      BTIF_TRACE_WARNING("%s dropping packet of length %zd", __func__, ret);
       osi_free(buffer);
+      continue;
     }
 
-    // Bail out of the loop if reading from the TAP fd would block.
-    ufd.fd = fd;
-    ufd.events = POLLIN;
-    ufd.revents = 0;
+    // Extract the ethernet header from the buffer since the PAN_WriteBuf
+    // inside forward_bnep can't handle two pointers that point inside the
+    // same buffer.
+    btpan_frame_t frame;
+    memcpy(&frame.hdr, packet, sizeof(tETH_HDR));
+    buffer->offset += sizeof(tETH_HDR);
+    buffer->len = ret - sizeof(tETH_HDR);
+    frame.buf = buffer;
+    frames.push_back(frame);
+  }
 
-    int ret;
-    OSI_NO_INTR(ret = poll(&ufd, 1, 0));
-    if (ret <= 0 || IS_EXCEPTION(ufd.revents)) break;
+  // Also sent when empty, for the main thread to monitor the fd again
+  do_in_main_thread(FROM_HERE,
+                    base::BindOnce(btu_exec_tap_frames, fd, std::move(frames)));
+}
+
+static void btpan_clear_backlog() {
+  for (auto& frame : tap_backlog) osi_free(frame.buf);
+  tap_backlog.clear();
+}
+
+// Hands the frames read from the tap device to BNEP, oldest first, while the
+// data flow is on.
+static void btpan_forward_backlog() {
+  while (!tap_backlog.empty() && btif_is_enabled() && btpan_cb.flow) {
+    btpan_frame_t& frame = tap_backlog.front();
+    // BNEP leaves the frame to us when its queue is full, which happens once
+    // L2CAP is congested. The data flow is turned off along with that
+    // congestion and the frame is sent again when it is on.
+    if (forward_bnep(&frame.hdr, frame.buf) == FORWARD_CONGEST) break;
+    tap_backlog.pop_front();
+  }
+}
+
+static void btu_exec_tap_frames(int fd, std::vector<btpan_frame_t> frames) {
+  if (fd == INVALID_FD || fd != btpan_cb.tap_fd) {
+    for (auto& frame : frames) osi_free(frame.buf);
+    btpan_clear_backlog();
+    return;
   }
 
-  if (btpan_cb.flow) {
+  tap_backlog.insert(tap_backlog.end(), frames.begin(), frames.end());
+  btpan_forward_backlog();
+
+  if (btpan_cb.flow && tap_backlog.empty()) {
     // add fd back to monitor thread when the flow is on
     btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
   }
@@ -746,6 +828,8 @@ static void btpan_tap_fd_signaled(int fd, int type, int flags,
     btpan_tap_close(fd);
     btif_pan_close_all_conns();
   } else if (flags & SOCK_THREAD_FD_RD) {
-    do_in_main_thread(FROM_HERE, base::Bind(btu_exec_tap_fd_read, fd));
+    if (!pan_data_thread.DoInThread(FROM_HERE,
+                                    base::BindOnce(pan_data_read_tap, fd)))
+      do_in_main_thread(FROM_HERE, base::BindOnce(pan_data_read_tap, fd));
   }
 }
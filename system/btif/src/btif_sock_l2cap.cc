@@ -125,7 +125,7 @@ static char packet_get_head_l(l2cap_socket* sock, uint8_t** data,
 
 static struct packet* packet_alloc(const uint8_t* data, uint32_t len) {
   struct packet* p = (struct packet*)osi_calloc(sizeof(*p));
-  uint8_t* buf = (uint8_t*)osi_malloc(len);
+  uint8_t* buf = (uint8_t*)osi_buffer_malloc(len);
 
   p->data = buf;
   p->len = len;
@@ -836,8 +836,8 @@ static bool flush_incoming_que_on_wr_signal_l(l2cap_socket* sock) {
 
 inline BT_HDR* malloc_l2cap_buf(uint16_t len) {
   // We need FCS only for L2CAP_FCR_ERTM_MODE, but it's just 2 bytes so it's ok
-  BT_HDR* msg = (BT_HDR*)osi_malloc(BT_HDR_SIZE + L2CAP_MIN_OFFSET + len +
-                                    L2CAP_FCS_LENGTH);
+  BT_HDR* msg = (BT_HDR*)osi_buffer_malloc(BT_HDR_SIZE + L2CAP_MIN_OFFSET +
+                                           len + L2CAP_FCS_LENGTH);
   msg->offset = L2CAP_MIN_OFFSET;
   msg->len = len;
   return msg;
@@ -23,7 +23,9 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <cstdint>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 
 #include "bt_target.h"  // Must be first to define build configuration
 
@@ -36,6 +38,8 @@
 #include "btif/include/btif_sock_thread.h"
 #include "btif/include/btif_sock_util.h"
 #include "btif/include/btif_uid.h"
+#include "gd/common/init_flags.h"
+#include "gd/common/slab_pool.h"
 #include "include/hardware/bt_sock.h"
 #include "osi/include/allocator.h"
 #include "osi/include/compat.h"
@@ -54,6 +58,9 @@ using bluetooth::Uuid;
 // Maximum number of RFCOMM channels (1-30 inclusive).
 #define MAX_RFC_CHANNEL 30
 
+// Default number of RFCOMM sockets, see INIT_pool_capacity_rfc_slots
+#define RFC_SLOT_POOL_DEFAULT_CAPACITY MAX_RFC_CHANNEL
+
 // Maximum number of devices we can have an RFCOMM connection with.
 #define MAX_RFC_SESSION 7
 
@@ -91,9 +98,16 @@ typedef struct {
   int64_t tx_bytes;
   // Cumulative number of bytes received on this socket
   int64_t rx_bytes;
+  // Handle of this slot in rfc_slots
+  uint32_t pool_handle;
 } rfc_slot_t;
 
-static rfc_slot_t rfc_slots[MAX_RFC_CHANNEL];
+using RfcSlotPool = bluetooth::common::SlabPool<rfc_slot_t>;
+
+static std::unique_ptr<RfcSlotPool> rfc_slots;
+// In-use slots by id. Ids are swapped between slots on incoming connections,
+// so they are kept apart from the pool handles.
+static std::unordered_map<uint32_t, rfc_slot_t*> rfc_slots_by_id;
 static uint32_t rfc_slot_id;
 static volatile int pth = -1;  // poll thread handle
 static std::recursive_mutex slot_lock;
@@ -112,15 +126,10 @@ bt_status_t btsock_rfc_init(int poll_thread_handle, uid_set_t* set) {
   pth = poll_thread_handle;
   uid_set = set;
 
-  memset(rfc_slots, 0, sizeof(rfc_slots));
-  for (size_t i = 0; i < ARRAY_SIZE(rfc_slots); ++i) {
-    rfc_slots[i].scn = -1;
-    rfc_slots[i].sdp_handle = 0;
-    rfc_slots[i].fd = INVALID_FD;
-    rfc_slots[i].app_fd = INVALID_FD;
-    rfc_slots[i].incoming_queue = list_new(osi_free);
-    CHECK(rfc_slots[i].incoming_queue != NULL);
-  }
+  rfc_slots = std::make_unique<RfcSlotPool>(
+      bluetooth::common::InitFlags::GetPoolCapacity(
+          "rfc_slots", RFC_SLOT_POOL_DEFAULT_CAPACITY));
+  rfc_slots_by_id.clear();
 
   BTA_JvEnable(jv_dm_cback);
 
@@ -133,26 +142,40 @@ void btsock_rfc_cleanup(void) {
   BTA_JvDisable();
 
   std::unique_lock<std::recursive_mutex> lock(slot_lock);
-  for (size_t i = 0; i < ARRAY_SIZE(rfc_slots); ++i) {
-    if (rfc_slots[i].id) cleanup_rfc_slot(&rfc_slots[i]);
-    list_free(rfc_slots[i].incoming_queue);
-    rfc_slots[i].incoming_queue = NULL;
+  if (rfc_slots) {
+    rfc_slots->ForEach([](RfcSlotPool::Handle, rfc_slot_t& slot) {
+      cleanup_rfc_slot(&slot);
+    });
   }
 
   uid_set = NULL;
 }
 
 static rfc_slot_t* find_free_slot(void) {
-  for (size_t i = 0; i < ARRAY_SIZE(rfc_slots); ++i)
-    if (rfc_slots[i].fd == INVALID_FD) return &rfc_slots[i];
-  return NULL;
+  RfcSlotPool::Handle handle = rfc_slots->Allocate();
+  if (handle == RfcSlotPool::kInvalidHandle) return NULL;
+
+  rfc_slot_t* slot = rfc_slots->Get(handle);
+  slot->scn = -1;
+  slot->fd = INVALID_FD;
+  slot->app_fd = INVALID_FD;
+  slot->incoming_queue = list_new(osi_free);
+  CHECK(slot->incoming_queue != NULL);
+  slot->pool_handle = handle;
+  return slot;
+}
+
+static void free_slot(rfc_slot_t* slot) {
+  list_free(slot->incoming_queue);
+  slot->incoming_queue = NULL;
+  rfc_slots->Free(slot->pool_handle);
 }
 
 static rfc_slot_t* find_rfc_slot_by_id(uint32_t id) {
   CHECK(id != 0);
 
-  for (size_t i = 0; i < ARRAY_SIZE(rfc_slots); ++i)
-    if (rfc_slots[i].id == id) return &rfc_slots[i];
+  auto it = rfc_slots_by_id.find(id);
+  if (it != rfc_slots_by_id.end()) return it->second;
 
   LOG_ERROR("%s unable to find RFCOMM slot id: %u", __func__, id);
   return NULL;
@@ -160,21 +183,23 @@ static rfc_slot_t* find_rfc_slot_by_id(uint32_t id) {
 
 static rfc_slot_t* find_rfc_slot_by_pending_sdp(void) {
   uint32_t min_id = UINT32_MAX;
-  int slot = -1;
-  for (size_t i = 0; i < ARRAY_SIZE(rfc_slots); ++i)
-    if (rfc_slots[i].id && rfc_slots[i].f.pending_sdp_request &&
-        rfc_slots[i].id < min_id) {
-      min_id = rfc_slots[i].id;
-      slot = i;
+  rfc_slot_t* found = NULL;
+  rfc_slots->ForEach([&](RfcSlotPool::Handle, rfc_slot_t& slot) {
+    if (slot.id && slot.f.pending_sdp_request && slot.id < min_id) {
+      min_id = slot.id;
+      found = &slot;
     }
+  });
 
-  return (slot == -1) ? NULL : &rfc_slots[slot];
+  return found;
 }
 
 static bool is_requesting_sdp(void) {
-  for (size_t i = 0; i < ARRAY_SIZE(rfc_slots); ++i)
-    if (rfc_slots[i].id && rfc_slots[i].f.doing_sdp_request) return true;
-  return false;
+  bool requesting = false;
+  rfc_slots->ForEach([&](RfcSlotPool::Handle, rfc_slot_t& slot) {
+    if (slot.id && slot.f.doing_sdp_request) requesting = true;
+  });
+  return requesting;
 }
 
 static rfc_slot_t* alloc_rfc_slot(const RawAddress* addr, const char* name,
@@ -199,6 +224,7 @@ static rfc_slot_t* alloc_rfc_slot(const RawAddress* addr, const char* name,
   int fds[2] = {INVALID_FD, INVALID_FD};
   if (socketpair(AF_LOCAL, SOCK_STREAM, 0, fds) == -1) {
     LOG_ERROR("%s error creating socketpair: %s", __func__, strerror(errno));
+    free_slot(slot);
     return NULL;
   }
 
@@ -225,6 +251,7 @@ static rfc_slot_t* alloc_rfc_slot(const RawAddress* addr, const char* name,
     slot->addr = RawAddress::kEmpty;
   }
   slot->id = rfc_slot_id;
+  rfc_slots_by_id[slot->id] = slot;
   slot->f.server = server;
   slot->tx_bytes = 0;
   slot->rx_bytes = 0;
@@ -260,6 +287,8 @@ static rfc_slot_t* create_srv_accept_rfc_slot(rfc_slot_t* srv_rs,
   uint32_t new_listen_id = accept_rs->id;
   accept_rs->id = srv_rs->id;
   srv_rs->id = new_listen_id;
+  rfc_slots_by_id[accept_rs->id] = accept_rs;
+  rfc_slots_by_id[srv_rs->id] = srv_rs;
 
   return accept_rs;
 }
@@ -401,6 +430,9 @@ static void free_rfc_slot_scn(rfc_slot_t* slot) {
 }
 
 static void cleanup_rfc_slot(rfc_slot_t* slot) {
+  // Already released, the memory is still a slot but no longer ours
+  if (slot->id == 0) return;
+
   if (slot->fd != INVALID_FD) {
     shutdown(slot->fd, SHUT_RDWR);
     close(slot->fd);
@@ -433,10 +465,12 @@ static void cleanup_rfc_slot(rfc_slot_t* slot) {
 
   slot->rfc_port_handle = 0;
   memset(&slot->f, 0, sizeof(slot->f));
+  rfc_slots_by_id.erase(slot->id);
   slot->id = 0;
   slot->scn_notified = false;
   slot->tx_bytes = 0;
   slot->rx_bytes = 0;
+  free_slot(slot);
 }
 
 static bool send_app_scn(rfc_slot_t* slot) {
@@ -884,6 +918,8 @@ int bta_co_rfc_data_incoming(uint32_t id, BT_HDR* p_buf) {
 
   app_uid = slot->app_uid;
   bytes_rx = p_buf->len;
+  // Counted before sending, a failed send frees the slot
+  slot->rx_bytes += bytes_rx;
 
   if (list_is_empty(slot->incoming_queue)) {
     switch (send_data_to_app(slot->fd, p_buf)) {
@@ -908,7 +944,6 @@ int bta_co_rfc_data_incoming(uint32_t id, BT_HDR* p_buf) {
     list_append(slot->incoming_queue, p_buf);
   }
 
-  slot->rx_bytes += bytes_rx;
   uid_set_add_rx(uid_set, app_uid, bytes_rx);
 
   return ret;  // Return 0 to disable data flow.
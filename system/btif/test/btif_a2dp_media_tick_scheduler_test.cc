@@ -0,0 +1,135 @@
+/*
+ *  Copyright 2022 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "btif/include/btif_a2dp_media_tick_scheduler.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+constexpr uint64_t kEncoderIntervalUs = 20000;
+constexpr size_t kTxQueueMaxLength = 10;
+
+class MediaTickSchedulerTest : public ::testing::Test {
+ protected:
+  void SetUp() override { scheduler_.Reset(kEncoderIntervalUs, true); }
+
+  // Runs a tick that reads |bytes_read| from the audio source, and returns the
+  // new interval of the media timer
+  uint64_t Tick(uint32_t bytes_read) {
+    scheduler_.StartTick();
+    EXPECT_TRUE(scheduler_.ShouldEncode(0, kTxQueueMaxLength));
+    scheduler_.OnAudioRead(bytes_read);
+    return scheduler_.EndTick(0);
+  }
+
+  MediaTickScheduler scheduler_;
+};
+
+TEST_F(MediaTickSchedulerTest, defers_while_tx_queue_over_half_full) {
+  scheduler_.StartTick();
+  ASSERT_TRUE(
+      scheduler_.ShouldEncode(kTxQueueMaxLength / 2, kTxQueueMaxLength));
+  ASSERT_EQ(scheduler_.EndTick(kTxQueueMaxLength / 2), 0u);
+
+  scheduler_.StartTick();
+  ASSERT_FALSE(
+      scheduler_.ShouldEncode(kTxQueueMaxLength / 2 + 1, kTxQueueMaxLength));
+  // A deferred tick does not change the interval
+  ASSERT_EQ(scheduler_.EndTick(kTxQueueMaxLength / 2 + 1), 0u);
+  ASSERT_FALSE(scheduler_.IsStretched());
+}
+
+TEST_F(MediaTickSchedulerTest, never_defers_twice_in_a_row) {
+  for (int i = 0; i < 3; i++) {
+    scheduler_.StartTick();
+    ASSERT_FALSE(scheduler_.ShouldEncode(kTxQueueMaxLength, kTxQueueMaxLength));
+    scheduler_.EndTick(kTxQueueMaxLength);
+
+    scheduler_.StartTick();
+    ASSERT_TRUE(scheduler_.ShouldEncode(kTxQueueMaxLength, kTxQueueMaxLength));
+    scheduler_.EndTick(kTxQueueMaxLength);
+  }
+}
+
+TEST_F(MediaTickSchedulerTest, does_not_adapt_fixed_interval_encoders) {
+  scheduler_.Reset(kEncoderIntervalUs, false);
+  for (size_t i = 0; i < 2 * kIdleTicksBeforeStretching; i++) {
+    scheduler_.StartTick();
+    ASSERT_TRUE(scheduler_.ShouldEncode(kTxQueueMaxLength, kTxQueueMaxLength));
+    ASSERT_EQ(scheduler_.EndTick(0), 0u);
+  }
+  ASSERT_FALSE(scheduler_.IsStretched());
+}
+
+TEST_F(MediaTickSchedulerTest, stretches_when_idle_up_to_max_scale) {
+  for (size_t i = 1; i < kIdleTicksBeforeStretching; i++) {
+    ASSERT_EQ(Tick(0), 0u);
+  }
+  ASSERT_FALSE(scheduler_.IsStretched());
+
+  uint64_t interval_us = kEncoderIntervalUs;
+  while (interval_us < kEncoderIntervalUs * kMaxIdleIntervalScale) {
+    interval_us *= 2;
+    ASSERT_EQ(Tick(0), interval_us);
+    ASSERT_TRUE(scheduler_.IsStretched());
+  }
+  ASSERT_EQ(interval_us, kEncoderIntervalUs * kMaxIdleIntervalScale);
+
+  // Capped
+  ASSERT_EQ(Tick(0), 0u);
+  ASSERT_TRUE(scheduler_.IsStretched());
+}
+
+TEST_F(MediaTickSchedulerTest, does_not_stretch_with_queued_audio) {
+  for (size_t i = 0; i < 2 * kIdleTicksBeforeStretching; i++) {
+    scheduler_.StartTick();
+    ASSERT_TRUE(scheduler_.ShouldEncode(1, kTxQueueMaxLength));
+    ASSERT_EQ(scheduler_.EndTick(1), 0u);
+  }
+  ASSERT_FALSE(scheduler_.IsStretched());
+}
+
+TEST_F(MediaTickSchedulerTest, first_read_with_data_restores_interval) {
+  for (size_t i = 0; i < kIdleTicksBeforeStretching; i++) {
+    Tick(0);
+  }
+  ASSERT_TRUE(scheduler_.IsStretched());
+
+  ASSERT_EQ(Tick(512), kEncoderIntervalUs);
+  ASSERT_FALSE(scheduler_.IsStretched());
+
+  // The idle tick count starts over
+  ASSERT_EQ(Tick(0), 0u);
+  ASSERT_FALSE(scheduler_.IsStretched());
+}
+
+TEST_F(MediaTickSchedulerTest, expected_interval_follows_the_media_timer) {
+  for (size_t i = 1; i < kIdleTicksBeforeStretching; i++) {
+    Tick(0);
+  }
+  ASSERT_EQ(Tick(0), 2 * kEncoderIntervalUs);
+
+  // The tick after the change was already scheduled with the old interval
+  ASSERT_EQ(scheduler_.StartTick(), kEncoderIntervalUs);
+  scheduler_.OnAudioRead(512);
+  ASSERT_EQ(scheduler_.EndTick(0), kEncoderIntervalUs);
+
+  ASSERT_EQ(scheduler_.StartTick(), 2 * kEncoderIntervalUs);
+  ASSERT_EQ(scheduler_.StartTick(), kEncoderIntervalUs);
+}
+
+}  // namespace
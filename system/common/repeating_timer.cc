@@ -84,6 +84,27 @@ bool RepeatingTimer::SchedulePeriodic(
   return true;
 }
 
+// This runs on message loop thread
+bool RepeatingTimer::UpdatePeriod(base::TimeDelta period) {
+  if (period < kMinimumPeriod) {
+    LOG(ERROR) << __func__ << ": period must be at least " << kMinimumPeriod;
+    return false;
+  }
+
+  std::lock_guard<std::recursive_mutex> api_lock(api_mutex_);
+  if (message_loop_thread_ == nullptr || !message_loop_thread_->IsRunning()) {
+    LOG(ERROR) << __func__ << ": no periodic task is scheduled";
+    return false;
+  }
+  CHECK_EQ(message_loop_thread_->GetThreadId(),
+           base::PlatformThread::CurrentId())
+      << ": period must be updated on message loop thread";
+  // The next task time is already counted from the old period, so the
+  // following ones stay aligned to it without drift.
+  period_ = period;
+  return true;
+}
+
 // This runs on user thread
 void RepeatingTimer::Cancel() {
   std::promise<void> promise;
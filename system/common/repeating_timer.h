@@ -60,6 +60,16 @@ class RepeatingTimer final {
                         const base::Location& from_here,
                         base::RepeatingClosure task, base::TimeDelta period);
 
+  /**
+   * Change the period of the scheduled periodic task. The next task keeps its
+   * scheduled time, the new period applies from the task after it. Must be
+   * called on the message loop thread, e.g. from the task itself.
+   *
+   * @param period new period for the task to be executed
+   * @return true iff the period is updated
+   */
+  bool UpdatePeriod(base::TimeDelta period);
+
   /**
    * Post an event which cancels the current task asynchronously
    */
@@ -95,6 +95,23 @@ class RepeatingTimerTest : public ::testing::Test {
     timer_->CancelAndWait();
   }
 
+  void UpdatePeriodAfterTasks(int update_after_tasks, int new_period_ms,
+                              int scheduled_tasks,
+                              std::promise<void>* promise) {
+    counter_++;
+    if (counter_ == update_after_tasks) {
+#if BASE_VER < 931007
+      ASSERT_TRUE(timer_->UpdatePeriod(
+          base::TimeDelta::FromMilliseconds(new_period_ms)));
+#else
+      ASSERT_TRUE(timer_->UpdatePeriod(base::Milliseconds(new_period_ms)));
+#endif
+    }
+    if (counter_ == scheduled_tasks) {
+      promise->set_value();
+    }
+  }
+
   void CancelRepeatingTimerAndWait() { timer_->CancelAndWait(); }
 
  protected:
@@ -250,6 +267,41 @@ TEST_F(RepeatingTimerTest, schedule_multiple_delayed_slow_tasks) {
   VerifyMultipleDelayedTasks(10, 1, 2);
 }
 
+TEST_F(RepeatingTimerTest, update_period_without_scheduling) {
+#if BASE_VER < 931007
+  ASSERT_FALSE(timer_->UpdatePeriod(base::TimeDelta::FromMilliseconds(5)));
+#else
+  ASSERT_FALSE(timer_->UpdatePeriod(base::Milliseconds(5)));
+#endif
+}
+
+// Schedule a periodic task with interval 10 ms, and change the interval to
+// 200 ms from the 5th task; verify the later tasks follow the new interval
+TEST_F(RepeatingTimerTest, update_period_from_task) {
+  std::string name = "test_thread";
+  MessageLoopThread message_loop_thread(name);
+  message_loop_thread.StartUp();
+  auto future = promise_->get_future();
+  auto start_time = std::chrono::steady_clock::now();
+  int num_tasks = 7;
+
+  timer_->SchedulePeriodic(
+      message_loop_thread.GetWeakPtr(), FROM_HERE,
+      base::BindRepeating(&RepeatingTimerTest::UpdatePeriodAfterTasks,
+                          base::Unretained(this), 5, 200, num_tasks, promise_),
+#if BASE_VER < 931007
+      base::TimeDelta::FromMilliseconds(10));
+#else
+      base::Milliseconds(10));
+#endif
+  future.get();
+  auto actual_delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start_time);
+  timer_->CancelAndWait();
+  // The 6th task is still 10 ms after the 5th, the 7th comes 200 ms later
+  ASSERT_NEAR(260, actual_delay.count(), delay_error_ms);
+}
+
 TEST_F(RepeatingTimerTest,
        message_loop_thread_down_cancel_scheduled_periodic_task) {
   std::string name = "test_thread";
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "embdrv/g722/g722_enc_dec.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Enough audio for the encoder state to wander well away from its reset
+// values: 2 seconds at 16 kHz
+constexpr size_t kNumSamples = 32000;
+
+enum class Signal { RANDOM, SATURATED, TONE };
+
+std::vector<int16_t> GeneratePcm(Signal signal) {
+  std::vector<int16_t> pcm(kNumSamples);
+  std::mt19937 gen(0x722);
+  std::uniform_int_distribution<int> sample(INT16_MIN, INT16_MAX);
+  std::bernoulli_distribution sign;
+  for (size_t i = 0; i < pcm.size(); i++) {
+    switch (signal) {
+      case Signal::RANDOM:
+        pcm[i] = sample(gen);
+        break;
+      case Signal::SATURATED:
+        pcm[i] = sign(gen) ? INT16_MAX : INT16_MIN;
+        break;
+      case Signal::TONE:
+        pcm[i] = static_cast<int16_t>(12000 * std::sin(i * 0.0785) +
+                                      4000 * std::sin(i * 0.91));
+        break;
+    }
+  }
+  return pcm;
+}
+
+using EncodeFunction = int (*)(g722_encode_state_t*, uint8_t[], const int16_t[],
+                               int);
+
+// Encode |pcm| in |frame_size| sample frames, as the hearing aid source does
+std::vector<uint8_t> EncodeAll(EncodeFunction encode,
+                               g722_encode_state_t* state,
+                               const std::vector<int16_t>& pcm,
+                               size_t frame_size) {
+  std::vector<uint8_t> out(pcm.size());
+  size_t written = 0;
+  for (size_t i = 0; i + frame_size <= pcm.size(); i += frame_size) {
+    written += encode(state, out.data() + written, pcm.data() + i, frame_size);
+  }
+  out.resize(written);
+  return out;
+}
+
+// Compare both encoders over every test signal, including the state left
+// behind, so that a fast path which drifts after many frames is caught too
+bool IsBitExact(size_t frame_size) {
+  for (Signal signal : {Signal::RANDOM, Signal::SATURATED, Signal::TONE}) {
+    std::vector<int16_t> pcm = GeneratePcm(signal);
+    g722_encode_state_t* reference =
+        g722_encode_init(nullptr, 64000, G722_PACKED);
+    g722_encode_state_t* fast = g722_encode_init(nullptr, 64000, G722_PACKED);
+    bool same = EncodeAll(g722_encode, reference, pcm, frame_size) ==
+                    EncodeAll(g722_encode_fast, fast, pcm, frame_size) &&
+                memcmp(reference, fast, sizeof(*reference)) == 0;
+    g722_encode_release(reference);
+    g722_encode_release(fast);
+    if (!same) return false;
+  }
+  return true;
+}
+
+void RunEncoder(State& state, EncodeFunction encode) {
+  const size_t frame_size = state.range(0);
+  if (!IsBitExact(frame_size)) {
+    state.SkipWithError("g722_encode_fast output differs from g722_encode");
+    return;
+  }
+  std::vector<int16_t> pcm = GeneratePcm(Signal::TONE);
+  std::vector<uint8_t> out(frame_size);
+  g722_encode_state_t* encoder = g722_encode_init(nullptr, 64000, G722_PACKED);
+  size_t offset = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        encode(encoder, out.data(), pcm.data() + offset, frame_size));
+    offset = (offset + frame_size) % (pcm.size() - frame_size + 1);
+  }
+  g722_encode_release(encoder);
+  state.SetItemsProcessed(state.iterations() * frame_size);
+}
+
+}  // namespace
+
+// Frame sizes: 10 ms at 16 kHz, 20 ms at 16 kHz, 20 ms at 24 kHz
+static void BM_G722EncodeReference(State& state) {
+  RunEncoder(state, g722_encode);
+}
+BENCHMARK(BM_G722EncodeReference)->Arg(160)->Arg(320)->Arg(480);
+
+static void BM_G722EncodeFast(State& state) {
+  RunEncoder(state, g722_encode_fast);
+}
+BENCHMARK(BM_G722EncodeFast)->Arg(160)->Arg(320)->Arg(480);
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -136,6 +136,8 @@ extern "C" {
 g722_encode_state_t *g722_encode_init(g722_encode_state_t *s, unsigned int rate, int options);
 int g722_encode_release(g722_encode_state_t *s);
 int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[], int len);
+/* Bit exact with g722_encode(), but faster */
+int g722_encode_fast(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[], int len);
 
 g722_decode_state_t *g722_decode_init(g722_decode_state_t *s, unsigned int rate, int options);
 int g722_decode_release(g722_decode_state_t *s);
@@ -435,4 +435,189 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
     return g722_bytes;
 }
 /*- End of function --------------------------------------------------------*/
+
+/* Number of input samples the fast encoder runs through the QMF at once.
+   Bounds the stack used for the band split buffers. */
+#define G722_FAST_BLOCK 320
+
+/* One low band and one high band sample through the ADPCM stages of
+   g722_encode(), returning the 8 bit code */
+static __inline int encode_subbands(g722_encode_state_t *s, int xlow, int xhigh)
+{
+    int i;
+    int el;
+    int eh;
+    int wd;
+    int wd1;
+    int wd2;
+    int wd3;
+    int ril;
+    int il4;
+    int ih2;
+    int mih;
+    int nb;
+    int dlow;
+    int dhigh;
+    int ilow;
+    int ihigh;
+
+    /* Block 1L, SUBTRA */
+    el = saturate(xlow - s->band[0].s);
+
+    /* Block 1L, QUANTL */
+    wd = (el >= 0)  ?  el  :  -(el + 1);
+    for (i = 1;  i < 30;  i++)
+    {
+        wd1 = (q6[i]*s->band[0].det) >> 12;
+        if (wd < wd1)
+            break;
+    }
+    ilow = (el < 0)  ?  iln[i]  :  ilp[i];
+
+    /* Block 2L, INVQAL */
+    ril = ilow >> 2;
+    wd2 = qm4[ril];
+    dlow = (s->band[0].det*wd2) >> 15;
+
+    /* Block 3L, LOGSCL */
+    il4 = rl42[ril];
+    wd = (s->band[0].nb*127) >> 7;
+    nb = wd + wl[il4];
+    if (nb < 0)
+        nb = 0;
+    else if (nb > 18432)
+        nb = 18432;
+    s->band[0].nb = nb;
+
+    /* Block 3L, SCALEL */
+    wd1 = (nb >> 6) & 31;
+    wd2 = 8 - (nb >> 11);
+    wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
+    s->band[0].det = wd3 << 2;
+
+    block4(&s->band[0], dlow);
+
+    /* Block 1H, SUBTRA */
+    eh = saturate(xhigh - s->band[1].s);
+
+    /* Block 1H, QUANTH */
+    wd = (eh >= 0)  ?  eh  :  -(eh + 1);
+    wd1 = (564*s->band[1].det) >> 12;
+    mih = (wd >= wd1)  ?  2  :  1;
+    ihigh = (eh < 0)  ?  ihn[mih]  :  ihp[mih];
+
+    /* Block 2H, INVQAH */
+    wd2 = qm2[ihigh];
+    dhigh = (s->band[1].det*wd2) >> 15;
+
+    /* Block 3H, LOGSCH */
+    ih2 = rh2[ihigh];
+    wd = (s->band[1].nb*127) >> 7;
+    nb = wd + wh[ih2];
+    if (nb < 0)
+        nb = 0;
+    else if (nb > 22528)
+        nb = 22528;
+    s->band[1].nb = nb;
+
+    /* Block 3H, SCALEH */
+    wd1 = (nb >> 6) & 31;
+    wd2 = 10 - (nb >> 11);
+    wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
+    s->band[1].det = wd3 << 2;
+
+    block4(&s->band[1], dhigh);
+
+    return (ihigh << 6) | ilow;
+}
+/*- End of function --------------------------------------------------------*/
+
+/* Same output and state as g722_encode(), with the transmit QMF run over a
+ * block at a time: the history and the input are split once into even and
+ * odd sample rows, instead of shuffling s->x for every sample pair, so both
+ * 12 tap filters become contiguous multiply-accumulates which the compiler
+ * vectorises. The ADPCM stages are inherently serial and are unchanged.
+ * ITU test mode and odd lengths are handed to g722_encode(). */
+int g722_encode_fast(g722_encode_state_t *s, uint8_t g722_data[],
+                     const int16_t amp[], int len)
+{
+    int32_t even[G722_FAST_BLOCK/2 + 11];
+    int32_t odd[G722_FAST_BLOCK/2 + 11];
+    int32_t sumeven[G722_FAST_BLOCK/2];
+    int32_t sumodd[G722_FAST_BLOCK/2];
+    /* Low and high band PCM from the QMF */
+    int xlow;
+    int xhigh;
+    int g722_bytes;
+    int pairs;
+    int block;
+    int i;
+    int j;
+    int k;
+
+    if (s->itu_test_mode  ||  (len & 1))
+        return g722_encode(s, g722_data, amp, len);
+
+    g722_bytes = 0;
+    for (j = 0;  j < len;  j += block)
+    {
+        block = len - j;
+        if (block > G722_FAST_BLOCK)
+            block = G722_FAST_BLOCK;
+        pairs = block >> 1;
+
+        /* The last 22 samples of history, then this block, as even and odd
+           rows. Output pair k then sees x[2*i] == even[k + i] and
+           x[2*i + 1] == odd[k + i]. */
+        for (i = 0;  i < 11;  i++)
+        {
+            even[i] = s->x[2*i + 2];
+            odd[i] = s->x[2*i + 3];
+        }
+        for (k = 0;  k < pairs;  k++)
+        {
+            even[k + 11] = amp[j + 2*k];
+            odd[k + 11] = amp[j + 2*k + 1];
+        }
+
+        /* Apply the transmit QMF */
+        for (k = 0;  k < pairs;  k++)
+        {
+            sumodd[k] = 0;
+            sumeven[k] = 0;
+        }
+        for (i = 0;  i < 12;  i++)
+        {
+            const int32_t codd = qmf_coeffs[i];
+            const int32_t ceven = qmf_coeffs[11 - i];
+
+            for (k = 0;  k < pairs;  k++)
+            {
+                sumodd[k] += even[k + i]*codd;
+                sumeven[k] += odd[k + i]*ceven;
+            }
+        }
+
+        /* Keep the last 24 samples as history for the next call */
+        for (i = 0;  i < 12;  i++)
+        {
+            s->x[2*i] = even[pairs - 1 + i];
+            s->x[2*i + 1] = odd[pairs - 1 + i];
+        }
+
+        for (k = 0;  k < pairs;  k++)
+        {
+            /* See g722_encode() for the shift */
+            xlow = (sumeven[k] + sumodd[k]) >> 14;
+            xhigh = (sumeven[k] - sumodd[k]) >> 14;
+#ifdef RUN_LIKE_REFERENCE_G722
+            xlow = limitValues(xlow);
+            xhigh = limitValues(xhigh);
+#endif
+            g722_data[g722_bytes++] = (uint8_t) encode_subbands(s, xlow, xhigh);
+        }
+    }
+    return g722_bytes;
+}
+/*- End of function --------------------------------------------------------*/
 /*- End of file ------------------------------------------------------------*/
@@ -21,6 +21,7 @@
 #include <cstdlib>
 #include <string>
 
+#include "common/slab_pool.h"
 #include "common/strings.h"
 #include "os/log.h"
 
@@ -30,6 +31,11 @@ namespace common {
 bool InitFlags::logging_debug_enabled_for_all = false;
 int InitFlags::hci_adapter = 0;
 std::unordered_map<std::string, bool> InitFlags::logging_debug_explicit_tag_settings = {};
+std::unordered_map<std::string, int> InitFlags::pool_capacity_settings = {};
+
+constexpr char kPoolCapacityPrefix[] = "INIT_pool_capacity_";
+// Pools are backed by SlabPool, which refuses larger capacities
+constexpr size_t kMaxPoolCapacity = SlabPool<uint8_t>::kMaxCapacity;
 
 bool ParseBoolFlag(const std::vector<std::string>& flag_pair, const std::string& flag, bool* variable) {
   if (flag != flag_pair[0]) {
@@ -86,6 +92,17 @@ void InitFlags::Load(const char** flags) {
         logging_debug_explicit_tag_settings.insert_or_assign(tag, false);
       }
     }
+    if (flag_pair[0].rfind(kPoolCapacityPrefix, 0) == 0) {
+      int capacity = 0;
+      if (ParseIntFlag(flag_pair, flag_pair[0], &capacity) && capacity > 0) {
+        if (static_cast<size_t>(capacity) > kMaxPoolCapacity) {
+          LOG_WARN(
+              "%s=%d is above the maximum pool capacity, using %zu", flag_pair[0].c_str(), capacity, kMaxPoolCapacity);
+          capacity = static_cast<int>(kMaxPoolCapacity);
+        }
+        pool_capacity_settings.insert_or_assign(flag_pair[0].substr(sizeof(kPoolCapacityPrefix) - 1), capacity);
+      }
+    }
     flags++;
   }
 
@@ -111,6 +128,7 @@ void InitFlags::Load(const char** flags) {
 void InitFlags::SetAll(bool value) {
   logging_debug_enabled_for_all = value;
   logging_debug_explicit_tag_settings.clear();
+  pool_capacity_settings.clear();
 }
 
 void InitFlags::SetAllForTesting() {
@@ -45,6 +45,17 @@ class InitFlags final {
     return hci_adapter;
   }
 
+  // Number of control blocks the pool named |pool| may hold, as set with
+  // INIT_pool_capacity_<pool>=<count> and capped to SlabPool::kMaxCapacity, or
+  // |default_capacity|
+  inline static int GetPoolCapacity(const std::string& pool, int default_capacity) {
+    auto setting = pool_capacity_settings.find(pool);
+    if (setting != pool_capacity_settings.end()) {
+      return setting->second;
+    }
+    return default_capacity;
+  }
+
   static void SetAllForTesting();
 
  private:
@@ -53,6 +64,7 @@ class InitFlags final {
   static int hci_adapter;
   // save both log allow list and block list in the map to save hashing time
   static std::unordered_map<std::string, bool> logging_debug_explicit_tag_settings;
+  static std::unordered_map<std::string, int> pool_capacity_settings;
 };
 
 }  // namespace common
@@ -62,3 +62,21 @@ TEST(InitFlagsTest, test_debug_logging_multiple_flags) {
   ASSERT_FALSE(InitFlags::IsDebugLoggingEnabledForTag("Foo"));
   ASSERT_FALSE(InitFlags::IsDebugLoggingEnabledForAll());
 }
+
+TEST(InitFlagsTest, test_pool_capacity) {
+  const char* input[] = {"INIT_pool_capacity_rfc_slots=120",
+                         "INIT_pool_capacity_bad=-1",
+                         "INIT_pool_capacity_bad_too=many",
+                         "INIT_pool_capacity_huge=100000",
+                         nullptr};
+  InitFlags::Load(input);
+  ASSERT_EQ(120, InitFlags::GetPoolCapacity("rfc_slots", 30));
+  ASSERT_EQ(30, InitFlags::GetPoolCapacity("bad", 30));
+  ASSERT_EQ(30, InitFlags::GetPoolCapacity("bad_too", 30));
+  // Capped to what a SlabPool can hold
+  ASSERT_EQ(65536, InitFlags::GetPoolCapacity("huge", 30));
+  ASSERT_EQ(30, InitFlags::GetPoolCapacity("other", 30));
+
+  InitFlags::Load(nullptr);
+  ASSERT_EQ(30, InitFlags::GetPoolCapacity("rfc_slots", 30));
+}
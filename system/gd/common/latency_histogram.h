@@ -0,0 +1,138 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+namespace bluetooth {
+namespace common {
+
+// Lock-free latency histogram with log-linear buckets, in the spirit of HdrHistogram.
+//
+// Every power of two range is split into kSubBuckets linear buckets, so any recorded
+// value is reported with a relative error below 1 / kSubBuckets (12.5%) while the
+// whole int64 range fits in a few KB. Record() may be called from any thread; readers
+// see a consistent-enough view without stopping writers.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int64_t kSubBuckets = 1 << kSubBucketBits;
+  static constexpr size_t kBucketCount = (63 - kSubBucketBits + 1) * kSubBuckets;
+
+  LatencyHistogram() {
+    Reset();
+  }
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  // Negative values are recorded as 0
+  void Record(int64_t value) {
+    if (value < 0) {
+      value = 0;
+    }
+    counts_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    total_count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    int64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t GetCount() const {
+    return total_count_.load(std::memory_order_relaxed);
+  }
+
+  int64_t GetMax() const {
+    return max_.load(std::memory_order_relaxed);
+  }
+
+  int64_t GetMean() const {
+    uint64_t count = GetCount();
+    return count == 0 ? 0 : sum_.load(std::memory_order_relaxed) / static_cast<int64_t>(count);
+  }
+
+  uint64_t GetBucketCount(size_t index) const {
+    return counts_[index].load(std::memory_order_relaxed);
+  }
+
+  // Highest value that falls into the same bucket as the |percentile| [0, 100] sample, capped at GetMax()
+  int64_t GetValueAtPercentile(double percentile) const {
+    uint64_t count = GetCount();
+    if (count == 0) {
+      return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * count));
+    if (rank == 0) {
+      rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t index = 0; index < kBucketCount; index++) {
+      seen += GetBucketCount(index);
+      if (seen >= rank) {
+        int64_t upper = BucketUpperBound(index);
+        return upper < GetMax() ? upper : GetMax();
+      }
+    }
+    return GetMax();
+  }
+
+  void Reset() {
+    for (auto& count : counts_) {
+      count.store(0, std::memory_order_relaxed);
+    }
+    total_count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+  static size_t BucketIndex(int64_t value) {
+    if (value < kSubBuckets) {
+      return static_cast<size_t>(value);
+    }
+    int msb = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+    int shift = msb - kSubBucketBits;
+    return static_cast<size_t>((msb - kSubBucketBits + 1) * kSubBuckets + ((value >> shift) & (kSubBuckets - 1)));
+  }
+
+  static int64_t BucketLowerBound(size_t index) {
+    if (index < static_cast<size_t>(kSubBuckets)) {
+      return static_cast<int64_t>(index);
+    }
+    int shift = static_cast<int>(index / kSubBuckets) - 1;
+    return (kSubBuckets + static_cast<int64_t>(index % kSubBuckets)) << shift;
+  }
+
+  static int64_t BucketUpperBound(size_t index) {
+    if (index < static_cast<size_t>(kSubBuckets)) {
+      return static_cast<int64_t>(index);
+    }
+    int shift = static_cast<int>(index / kSubBuckets) - 1;
+    return BucketLowerBound(index) + ((int64_t{1} << shift) - 1);
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kBucketCount> counts_;
+  std::atomic<uint64_t> total_count_;
+  std::atomic<int64_t> sum_;
+  std::atomic<int64_t> max_;
+};
+
+}  // namespace common
+}  // namespace bluetooth
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/latency_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <thread>
+#include <vector>
+
+namespace testing {
+
+using bluetooth::common::LatencyHistogram;
+
+TEST(LatencyHistogramTest, empty) {
+  LatencyHistogram histogram;
+  ASSERT_EQ(histogram.GetCount(), 0u);
+  ASSERT_EQ(histogram.GetMean(), 0);
+  ASSERT_EQ(histogram.GetValueAtPercentile(50), 0);
+}
+
+TEST(LatencyHistogramTest, bucket_bounds_round_trip) {
+  for (size_t index = 0; index < LatencyHistogram::kBucketCount; index++) {
+    ASSERT_EQ(LatencyHistogram::BucketIndex(LatencyHistogram::BucketLowerBound(index)), index);
+    ASSERT_EQ(LatencyHistogram::BucketIndex(LatencyHistogram::BucketUpperBound(index)), index);
+  }
+  ASSERT_EQ(LatencyHistogram::BucketIndex(LLONG_MAX), LatencyHistogram::kBucketCount - 1);
+}
+
+TEST(LatencyHistogramTest, small_values_are_exact) {
+  LatencyHistogram histogram;
+  for (int64_t value = 0; value < LatencyHistogram::kSubBuckets; value++) {
+    histogram.Record(value);
+  }
+  ASSERT_EQ(histogram.GetCount(), static_cast<uint64_t>(LatencyHistogram::kSubBuckets));
+  ASSERT_EQ(histogram.GetValueAtPercentile(0), 0);
+  ASSERT_EQ(histogram.GetValueAtPercentile(100), LatencyHistogram::kSubBuckets - 1);
+}
+
+TEST(LatencyHistogramTest, percentiles_within_bucket_precision) {
+  LatencyHistogram histogram;
+  for (int64_t value = 1; value <= 10000; value++) {
+    histogram.Record(value);
+  }
+  ASSERT_EQ(histogram.GetMax(), 10000);
+  ASSERT_EQ(histogram.GetMean(), 5000);
+  for (double percentile : {50.0, 90.0, 99.0}) {
+    int64_t expected = static_cast<int64_t>(percentile * 100);
+    int64_t actual = histogram.GetValueAtPercentile(percentile);
+    ASSERT_GE(actual, expected);
+    ASSERT_LE(actual, expected + expected / LatencyHistogram::kSubBuckets);
+  }
+  ASSERT_EQ(histogram.GetValueAtPercentile(100), 10000);
+}
+
+TEST(LatencyHistogramTest, negative_recorded_as_zero) {
+  LatencyHistogram histogram;
+  histogram.Record(-5);
+  ASSERT_EQ(histogram.GetBucketCount(0), 1u);
+  ASSERT_EQ(histogram.GetMax(), 0);
+}
+
+TEST(LatencyHistogramTest, reset) {
+  LatencyHistogram histogram;
+  histogram.Record(100);
+  histogram.Reset();
+  ASSERT_EQ(histogram.GetCount(), 0u);
+  ASSERT_EQ(histogram.GetMax(), 0);
+}
+
+TEST(LatencyHistogramTest, record_from_multiple_threads) {
+  constexpr int kThreads = 4;
+  constexpr int kSamplesPerThread = 10000;
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&histogram, i]() {
+      for (int j = 0; j < kSamplesPerThread; j++) {
+        histogram.Record(i * 1000 + j % 100);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(histogram.GetCount(), static_cast<uint64_t>(kThreads * kSamplesPerThread));
+  ASSERT_EQ(histogram.GetMax(), (kThreads - 1) * 1000 + 99);
+}
+
+}  // namespace testing
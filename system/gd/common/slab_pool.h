@@ -0,0 +1,181 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "os/log.h"
+
+namespace bluetooth {
+namespace common {
+
+// A pool of control blocks allocated in fixed size slabs, meant to replace
+// the compile-time sized arrays of the legacy stack
+//
+// Usage:
+//   - Allocate() hands out a handle to a value-initialized T, Get() turns a
+//     handle back into a pointer
+//   - a handle carries the generation of its slot, bumped by Free(), so a
+//     handle kept past Free() is rejected by Get() instead of reaching the
+//     next user of the slot
+//   - objects never move: a pointer stays valid while its handle is live,
+//     and the memory stays a T until the pool is destroyed, like an array
+//     element would
+//   - slabs are only added once all existing slots are taken, so the memory
+//     used follows the peak number of objects, bounded by |capacity|
+//   - NOT THREAD SAFE
+//
+// Performance:
+//   - Allocate(), Get() and Free() are O(1)
+//   - ForEach() is O(allocated slabs)
+//
+// Template:
+//   - T control block type, default constructible and move assignable
+//   - kSlabSize number of T allocated at once
+template <typename T, size_t kSlabSize = 8>
+class SlabPool {
+ public:
+  using Handle = uint32_t;
+  static constexpr Handle kInvalidHandle = 0;
+  static constexpr size_t kMaxCapacity = UINT16_MAX + 1;
+
+  explicit SlabPool(size_t capacity) : capacity_(capacity) {
+    ASSERT_LOG(capacity_ != 0 && capacity_ <= kMaxCapacity, "Invalid pool capacity %zu", capacity_);
+  }
+
+  SlabPool(const SlabPool&) = delete;
+  SlabPool& operator=(const SlabPool&) = delete;
+
+  // Returns kInvalidHandle once |capacity| objects are allocated
+  Handle Allocate() {
+    if (free_.empty() && !grow()) {
+      return kInvalidHandle;
+    }
+    size_t index = free_.back();
+    free_.pop_back();
+
+    Slot& slot = slot_at(index);
+    slot.value = T();
+    slot.in_use = true;
+    size_++;
+    return make_handle(index, slot.generation);
+  }
+
+  // nullptr when |handle| was freed or never allocated
+  T* Get(Handle handle) {
+    Slot* slot = find(handle);
+    return slot == nullptr ? nullptr : &slot->value;
+  }
+
+  // Returns false when |handle| was already freed
+  bool Free(Handle handle) {
+    Slot* slot = find(handle);
+    if (slot == nullptr) {
+      return false;
+    }
+    slot->in_use = false;
+    if (++slot->generation == 0) {
+      slot->generation = 1;
+    }
+    free_.push_back(handle & kIndexMask);
+    size_--;
+    return true;
+  }
+
+  // Call |fn(handle, T&)| on every allocated object, in slot order. |fn| may
+  // free the object it is given.
+  template <typename F>
+  void ForEach(F fn) {
+    for (size_t index = 0; index < allocated_slots(); index++) {
+      Slot& slot = slot_at(index);
+      if (slot.in_use) {
+        fn(make_handle(index, slot.generation), slot.value);
+      }
+    }
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  // Slots backed by memory, allocated or not
+  size_t allocated_slots() const {
+    return std::min(slabs_.size() * kSlabSize, capacity_);
+  }
+
+ private:
+  static constexpr Handle kIndexMask = UINT16_MAX;
+  static constexpr int kGenerationShift = 16;
+
+  struct Slot {
+    T value{};
+    uint16_t generation{1};
+    bool in_use{false};
+  };
+  using Slab = std::array<Slot, kSlabSize>;
+
+  static Handle make_handle(size_t index, uint16_t generation) {
+    return (static_cast<Handle>(generation) << kGenerationShift) | static_cast<Handle>(index);
+  }
+
+  Slot& slot_at(size_t index) {
+    return (*slabs_[index / kSlabSize])[index % kSlabSize];
+  }
+
+  Slot* find(Handle handle) {
+    size_t index = handle & kIndexMask;
+    uint16_t generation = handle >> kGenerationShift;
+    if (generation == 0 || index >= allocated_slots()) {
+      return nullptr;
+    }
+    Slot& slot = slot_at(index);
+    if (!slot.in_use || slot.generation != generation) {
+      return nullptr;
+    }
+    return &slot;
+  }
+
+  bool grow() {
+    size_t first = allocated_slots();
+    if (first >= capacity_) {
+      return false;
+    }
+    slabs_.push_back(std::make_unique<Slab>());
+    // Hand out the lower indices first
+    for (size_t index = allocated_slots(); index > first; index--) {
+      free_.push_back(index - 1);
+    }
+    return true;
+  }
+
+  size_t capacity_;
+  size_t size_ = 0;
+  std::vector<std::unique_ptr<Slab>> slabs_;
+  std::vector<size_t> free_;
+};
+
+}  // namespace common
+}  // namespace bluetooth
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/slab_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+namespace testing {
+
+using bluetooth::common::SlabPool;
+
+struct ControlBlock {
+  int value;
+  bool flag;
+};
+
+TEST(SlabPoolTest, allocate_get_free_test) {
+  SlabPool<ControlBlock, 4> pool(10);
+  EXPECT_EQ(pool.size(), 0ul);
+  EXPECT_EQ(pool.allocated_slots(), 0ul);
+
+  auto handle = pool.Allocate();
+  ASSERT_NE(handle, SlabPool<ControlBlock>::kInvalidHandle);
+  ControlBlock* block = pool.Get(handle);
+  ASSERT_NE(block, nullptr);
+  EXPECT_EQ(block->value, 0);
+  EXPECT_FALSE(block->flag);
+  block->value = 42;
+  EXPECT_EQ(pool.Get(handle)->value, 42);
+  EXPECT_EQ(pool.size(), 1ul);
+  EXPECT_EQ(pool.allocated_slots(), 4ul);
+
+  EXPECT_TRUE(pool.Free(handle));
+  EXPECT_EQ(pool.Get(handle), nullptr);
+  EXPECT_FALSE(pool.Free(handle));
+  EXPECT_EQ(pool.size(), 0ul);
+  EXPECT_EQ(pool.Get(SlabPool<ControlBlock>::kInvalidHandle), nullptr);
+}
+
+TEST(SlabPoolTest, stale_handle_test) {
+  SlabPool<ControlBlock, 4> pool(1);
+  auto first = pool.Allocate();
+  ControlBlock* block = pool.Get(first);
+  block->value = 1;
+  pool.Free(first);
+
+  // Same slot, new generation, new value
+  auto second = pool.Allocate();
+  EXPECT_NE(first, second);
+  EXPECT_EQ(pool.Get(second), block);
+  EXPECT_EQ(block->value, 0);
+  EXPECT_EQ(pool.Get(first), nullptr);
+  EXPECT_FALSE(pool.Free(first));
+  EXPECT_EQ(pool.Get(second), block);
+}
+
+TEST(SlabPoolTest, grow_to_capacity_test) {
+  SlabPool<ControlBlock, 4> pool(10);
+  std::vector<SlabPool<ControlBlock>::Handle> handles;
+  std::set<ControlBlock*> blocks;
+  for (int i = 0; i < 10; i++) {
+    auto handle = pool.Allocate();
+    ASSERT_NE(handle, SlabPool<ControlBlock>::kInvalidHandle);
+    pool.Get(handle)->value = i;
+    handles.push_back(handle);
+    blocks.insert(pool.Get(handle));
+  }
+  EXPECT_EQ(blocks.size(), 10ul);
+  EXPECT_EQ(pool.size(), 10ul);
+  EXPECT_EQ(pool.allocated_slots(), 10ul);
+  EXPECT_EQ(pool.Allocate(), SlabPool<ControlBlock>::kInvalidHandle);
+
+  // Growing must not have moved the earlier objects
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(pool.Get(handles[i])->value, i);
+  }
+
+  pool.Free(handles[3]);
+  auto handle = pool.Allocate();
+  ASSERT_NE(handle, SlabPool<ControlBlock>::kInvalidHandle);
+  EXPECT_EQ(pool.allocated_slots(), 10ul);
+}
+
+TEST(SlabPoolTest, for_each_test) {
+  SlabPool<ControlBlock, 2> pool(8);
+  std::vector<SlabPool<ControlBlock>::Handle> handles;
+  for (int i = 0; i < 5; i++) {
+    handles.push_back(pool.Allocate());
+    pool.Get(handles.back())->value = i;
+  }
+  pool.Free(handles[1]);
+
+  std::vector<int> values;
+  pool.ForEach([&values](SlabPool<ControlBlock>::Handle, ControlBlock& block) { values.push_back(block.value); });
+  EXPECT_EQ(values, std::vector<int>({0, 2, 3, 4}));
+
+  // Freeing while iterating
+  pool.ForEach([&pool](SlabPool<ControlBlock>::Handle handle, ControlBlock& block) {
+    if (block.value % 2 == 0) {
+      pool.Free(handle);
+    }
+  });
+  EXPECT_EQ(pool.size(), 1ul);
+  EXPECT_EQ(pool.Get(handles[3])->value, 3);
+}
+
+}  // namespace testing
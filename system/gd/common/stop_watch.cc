@@ -92,12 +92,19 @@ StopWatch::StopWatch(std::string text)
       timestamp_(std::chrono::system_clock::now()),
       start_timestamp_(std::chrono::high_resolution_clock::now()) {}
 
+StopWatch::StopWatch(std::string text, TracePoint* trace_point) : StopWatch(std::move(text)) {
+  trace_point_ = trace_point;
+}
+
 StopWatch::~StopWatch() {
   StopWatchLog sw_log;
   sw_log.timestamp = timestamp_;
   sw_log.start_timestamp = start_timestamp_;
   sw_log.end_timestamp = std::chrono::high_resolution_clock::now();
   sw_log.message = std::move(text_);
+  if (trace_point_ != nullptr) {
+    trace_point_->Record(sw_log.end_timestamp - sw_log.start_timestamp);
+  }
 
   RecordLog(std::move(sw_log));
 }
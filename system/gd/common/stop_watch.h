@@ -19,6 +19,8 @@
 #include <chrono>
 #include <string>
 
+#include "common/trace_point.h"
+
 namespace bluetooth {
 namespace common {
 
@@ -33,12 +35,15 @@ class StopWatch {
  public:
   static void DumpStopWatchLog(void);
   StopWatch(std::string text);
+  // Also feed the elapsed time into |trace_point|'s histogram
+  StopWatch(std::string text, TracePoint* trace_point);
   ~StopWatch();
 
  private:
   std::string text_;
   std::chrono::system_clock::time_point timestamp_;
   std::chrono::high_resolution_clock::time_point start_timestamp_;
+  TracePoint* trace_point_ = nullptr;
   void RecordLog(StopWatchLog log);
 };
 
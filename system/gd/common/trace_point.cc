@@ -0,0 +1,116 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BtTracePoint"
+
+#include "common/trace_point.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+#include "os/log.h"
+
+namespace bluetooth {
+namespace common {
+
+namespace {
+
+constexpr const char* kTraceMarkerPaths[] = {
+    "/sys/kernel/tracing/trace_marker",
+    "/sys/kernel/debug/tracing/trace_marker",
+};
+
+// Heads a singly linked list of every TracePoint; only ever pushed to
+std::atomic<TracePoint*>& registered_trace_points() {
+  static std::atomic<TracePoint*> head{nullptr};
+  return head;
+}
+
+std::atomic_int trace_marker_fd{-1};
+std::atomic_bool trace_marker_enabled{false};
+
+}  // namespace
+
+TracePoint::TracePoint(const char* name) : name_(name) {
+  auto& head = registered_trace_points();
+  next_ = head.load(std::memory_order_relaxed);
+  while (!head.compare_exchange_weak(next_, this, std::memory_order_release, std::memory_order_relaxed)) {
+  }
+}
+
+void TracePoint::Record(std::chrono::nanoseconds latency) {
+  int64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+  histogram_.Record(latency_us);
+  if (trace_marker_enabled.load(std::memory_order_relaxed)) {
+    write_trace_marker(latency_us);
+  }
+}
+
+void TracePoint::write_trace_marker(int64_t latency_us) {
+  int fd = trace_marker_fd.load(std::memory_order_relaxed);
+  if (fd < 0) {
+    return;
+  }
+  static const int pid = getpid();
+  char buffer[128];
+  int length = snprintf(buffer, sizeof(buffer), "C|%d|bt:%s|%lld", pid, name_, static_cast<long long>(latency_us));
+  if (length > 0) {
+    // Best effort, a dropped sample is still in the histogram
+    (void)write(fd, buffer, std::min(static_cast<size_t>(length), sizeof(buffer) - 1));
+  }
+}
+
+void TracePoint::ForEach(const std::function<void(const TracePoint&)>& visitor) {
+  for (auto trace_point = registered_trace_points().load(std::memory_order_acquire); trace_point != nullptr;
+       trace_point = trace_point->next_) {
+    visitor(*trace_point);
+  }
+}
+
+bool TracePoint::EnableTraceMarker(bool enable) {
+  if (!enable) {
+    trace_marker_enabled = false;
+    return true;
+  }
+  // The descriptor is never closed, so writers racing with a disable can not end up in a reused fd
+  if (trace_marker_fd.load() < 0) {
+    for (auto path : kTraceMarkerPaths) {
+      int fd = open(path, O_WRONLY | O_CLOEXEC);
+      if (fd < 0) {
+        continue;
+      }
+      int expected = -1;
+      if (!trace_marker_fd.compare_exchange_strong(expected, fd)) {
+        close(fd);
+      }
+      LOG_INFO("Writing trace points to %s", path);
+      break;
+    }
+  }
+  if (trace_marker_fd.load() < 0) {
+    LOG_WARN("Unable to open trace_marker, trace points are only kept in histograms");
+    return false;
+  }
+  trace_marker_enabled = true;
+  return true;
+}
+
+}  // namespace common
+}  // namespace bluetooth
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+#include "common/latency_histogram.h"
+
+namespace bluetooth {
+namespace common {
+
+// A named latency measurement point on a hot path, e.g. the HCI command round trip.
+//
+// Trace points must have static storage duration; they register themselves in a
+// process wide list when constructed, so declare them with BT_TRACE_POINT at
+// namespace scope. Each one owns a LatencyHistogram in microseconds, exported
+// through dumpsys, and can mirror samples to ftrace so that they show up next to
+// the rest of the system in Perfetto.
+class TracePoint {
+ public:
+  explicit TracePoint(const char* name);
+  TracePoint(const TracePoint&) = delete;
+  TracePoint& operator=(const TracePoint&) = delete;
+
+  void Record(std::chrono::nanoseconds latency);
+
+  void RecordSince(std::chrono::steady_clock::time_point start) {
+    Record(std::chrono::steady_clock::now() - start);
+  }
+
+  const char* GetName() const {
+    return name_;
+  }
+
+  const LatencyHistogram& GetHistogram() const {
+    return histogram_;
+  }
+
+  void Reset() {
+    histogram_.Reset();
+  }
+
+  // Visit every trace point registered so far
+  static void ForEach(const std::function<void(const TracePoint&)>& visitor);
+
+  // Write each sample as an atrace counter ("C|pid|name|us") to the ftrace
+  // trace_marker file. Returns false if tracefs could not be opened.
+  static bool EnableTraceMarker(bool enable);
+
+ private:
+  void write_trace_marker(int64_t latency_us);
+
+  const char* name_;
+  LatencyHistogram histogram_;
+  TracePoint* next_ = nullptr;
+};
+
+// Records the time spent in the enclosing scope
+class ScopedTracePoint {
+ public:
+  explicit ScopedTracePoint(TracePoint* trace_point)
+      : trace_point_(trace_point), start_(std::chrono::steady_clock::now()) {}
+  ScopedTracePoint(const ScopedTracePoint&) = delete;
+  ScopedTracePoint& operator=(const ScopedTracePoint&) = delete;
+  ~ScopedTracePoint() {
+    trace_point_->RecordSince(start_);
+  }
+
+ private:
+  TracePoint* trace_point_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace common
+}  // namespace bluetooth
+
+#define BT_TRACE_POINT(variable, name) static ::bluetooth::common::TracePoint variable(name)
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/trace_point.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace testing {
+
+using bluetooth::common::ScopedTracePoint;
+using bluetooth::common::TracePoint;
+
+BT_TRACE_POINT(test_trace_point, "common.trace_point_test");
+
+TEST(TracePointTest, registered_at_static_init) {
+  int found = 0;
+  TracePoint::ForEach([&found](const TracePoint& trace_point) {
+    if (std::string(trace_point.GetName()) == "common.trace_point_test") {
+      found++;
+    }
+  });
+  ASSERT_EQ(found, 1);
+}
+
+TEST(TracePointTest, record_in_microseconds) {
+  test_trace_point.Reset();
+  test_trace_point.Record(std::chrono::milliseconds(3));
+  test_trace_point.Record(std::chrono::nanoseconds(500));
+  ASSERT_EQ(test_trace_point.GetHistogram().GetCount(), 2u);
+  ASSERT_EQ(test_trace_point.GetHistogram().GetMax(), 3000);
+  ASSERT_EQ(test_trace_point.GetHistogram().GetBucketCount(0), 1u);
+}
+
+TEST(TracePointTest, scoped_trace_point) {
+  test_trace_point.Reset();
+  {
+    ScopedTracePoint scoped(&test_trace_point);
+  }
+  ASSERT_EQ(test_trace_point.GetHistogram().GetCount(), 1u);
+}
+
+}  // namespace testing
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dumpsys/trace_points.h"
+
+#include <vector>
+
+#include "common/trace_point.h"
+#include "trace_point_generated.h"
+
+flatbuffers::Offset<bluetooth::common::TracePointsData> bluetooth::dumpsys::TracePoints::Dump(
+    flatbuffers::FlatBufferBuilder* fb_builder) {
+  std::vector<flatbuffers::Offset<common::TracePointData>> trace_points;
+  common::TracePoint::ForEach([fb_builder, &trace_points](const common::TracePoint& trace_point) {
+    const auto& histogram = trace_point.GetHistogram();
+    auto name = fb_builder->CreateString(trace_point.GetName());
+    common::TracePointDataBuilder builder(*fb_builder);
+    builder.add_name(name);
+    builder.add_count(histogram.GetCount());
+    builder.add_mean_us(histogram.GetMean());
+    builder.add_p50_us(histogram.GetValueAtPercentile(50));
+    builder.add_p90_us(histogram.GetValueAtPercentile(90));
+    builder.add_p99_us(histogram.GetValueAtPercentile(99));
+    builder.add_p999_us(histogram.GetValueAtPercentile(99.9));
+    builder.add_max_us(histogram.GetMax());
+    trace_points.push_back(builder.Finish());
+  });
+
+  auto title = fb_builder->CreateString("----- Trace Points -----");
+  auto trace_points_vector = fb_builder->CreateVector(trace_points);
+  common::TracePointsDataBuilder builder(*fb_builder);
+  builder.add_title(title);
+  builder.add_trace_points(trace_points_vector);
+  return builder.Finish();
+}
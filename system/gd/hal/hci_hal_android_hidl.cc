@@ -26,6 +26,7 @@
 #include "common/init_flags.h"
 #include "common/stop_watch.h"
 #include "common/strings.h"
+#include "common/trace_point.h"
 #include "hal/hci_hal.h"
 #include "hal/snoop_logger.h"
 #include "os/alarm.h"
@@ -55,6 +56,10 @@ class HciDeathRecipient : public ::android::hardware::hidl_death_recipient {
 
 android::sp<HciDeathRecipient> hci_death_recipient_ = new HciDeathRecipient();
 
+// Time spent in the HAL callback thread, including the hand off to HciLayer
+BT_TRACE_POINT(hal_event_received, "hal.event_received");
+BT_TRACE_POINT(hal_acl_data_received, "hal.acl_data_received");
+
 template <class VecType>
 std::string GetTimerText(const char* func_name, VecType vec) {
   return common::StringFormat(
@@ -92,7 +97,7 @@ class InternalHciCallbacks : public IBluetoothHciCallbacks {
   }
 
   Return<void> hciEventReceived(const hidl_vec<uint8_t>& event) override {
-    common::StopWatch stop_watch(GetTimerText(__func__, event));
+    common::StopWatch stop_watch(GetTimerText(__func__, event), &hal_event_received);
     std::vector<uint8_t> received_hci_packet(event.begin(), event.end());
     btsnoop_logger_->Capture(received_hci_packet, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::EVT);
     if (common::init_flags::btaa_hci_is_enabled()) {
@@ -105,7 +110,7 @@ class InternalHciCallbacks : public IBluetoothHciCallbacks {
   }
 
   Return<void> aclDataReceived(const hidl_vec<uint8_t>& data) override {
-    common::StopWatch stop_watch(GetTimerText(__func__, data));
+    common::StopWatch stop_watch(GetTimerText(__func__, data), &hal_acl_data_received);
     std::vector<uint8_t> received_hci_packet(data.begin(), data.end());
     btsnoop_logger_->Capture(received_hci_packet, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::ACL);
     if (common::init_flags::btaa_hci_is_enabled()) {
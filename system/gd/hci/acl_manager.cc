@@ -263,6 +263,16 @@ void AclManager::ClearResolvingList() {
   CallOn(pimpl_->le_impl_, &le_impl::clear_resolving_list);
 }
 
+void AclManager::AddDevicesToBackgroundAndResolvingLists(
+    std::vector<AddressWithType> background_connections,
+    std::vector<LeAddressManager::ResolvingListEntry> resolving_list_entries) {
+  CallOn(
+      pimpl_->le_impl_,
+      &le_impl::add_devices_to_background_and_resolving_lists,
+      std::move(background_connections),
+      std::move(resolving_list_entries));
+}
+
 void AclManager::CentralLinkKey(KeyFlag key_flag) {
   CallOn(pimpl_->classic_impl_, &classic_impl::central_link_key, key_flag);
 }
@@ -120,6 +120,12 @@ public:
  virtual void RemoveDeviceFromResolvingList(AddressWithType address_with_type);
  virtual void ClearResolvingList();
 
+ // Same as CreateLeConnection(address, false) and AddDeviceToResolvingList for each entry, but written to the
+ // controller as one batch, so that scanning and advertising are only paused once for the whole burst
+ virtual void AddDevicesToBackgroundAndResolvingLists(
+     std::vector<AddressWithType> background_connections,
+     std::vector<LeAddressManager::ResolvingListEntry> resolving_list_entries);
+
  virtual void CentralLinkKey(KeyFlag key_flag);
  virtual void SwitchRole(Address address, Role role);
  virtual uint16_t ReadDefaultLinkPolicySettings();
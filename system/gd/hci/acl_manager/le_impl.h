@@ -668,6 +668,61 @@ struct le_impl : public bluetooth::hci::LeAddressManagerCallback {
         address_with_type.ToPeerAddressType(), address_with_type.GetAddress());
   }
 
+  // Add a burst of background connections and resolving list entries, e.g. the bonded devices at startup, with a
+  // single sync of the controller lists instead of one pause window per device
+  void add_devices_to_background_and_resolving_lists(
+      std::vector<AddressWithType> background_connections,
+      std::vector<LeAddressManager::ResolvingListEntry> resolving_list_entries) {
+    // Resolving list entries need no client, only the background connections are dropped without one
+    if (le_client_callbacks_ == nullptr && !background_connections.empty()) {
+      LOG_ERROR("No callbacks to call, dropping %zu background connections", background_connections.size());
+      background_connections.clear();
+    }
+
+    // The batch only fills the room left in the controller filter accept list, the other devices are added one
+    // at a time as add_device_to_connect_list does
+    size_t accept_list_size = le_address_manager_->GetFilterAcceptListSize();
+    std::vector<AddressWithType> overflow;
+    bool connect_list_changed = false;
+    for (const auto& address_with_type : background_connections) {
+      if (connections.alreadyConnected(address_with_type)) {
+        continue;
+      }
+      background_connections_.insert(address_with_type);
+      if (connect_list.find(address_with_type) != connect_list.end()) {
+        continue;
+      }
+      if (connect_list.size() >= accept_list_size) {
+        overflow.push_back(address_with_type);
+        continue;
+      }
+      connect_list.insert(address_with_type);
+      connect_list_changed = true;
+    }
+
+    std::vector<LeAddressManager::FilterAcceptListEntry> filter_accept_list;
+    for (const auto& address_with_type : connect_list) {
+      filter_accept_list.push_back(
+          {address_with_type.ToFilterAcceptListAddressType(), address_with_type.GetAddress()});
+    }
+    register_with_address_manager();
+    le_address_manager_->SyncFilterAcceptAndResolvingLists(
+        std::move(filter_accept_list), std::move(resolving_list_entries));
+
+    if (!overflow.empty()) {
+      LOG_WARN("%zu devices do not fit in the filter accept list of %zu entries", overflow.size(), accept_list_size);
+      for (const auto& address_with_type : overflow) {
+        add_device_to_connect_list(address_with_type);
+      }
+      connect_list_changed = true;
+    }
+
+    // As for create_le_connection, arming waits until the filter accept list has been written
+    if (connect_list_changed) {
+      arm_on_resume_ = true;
+    }
+  }
+
   void on_extended_create_connection(CommandStatusView status) {
     ASSERT(status.IsValid());
     ASSERT(status.GetCommandOpCode() == OpCode::LE_EXTENDED_CREATE_CONNECTION);
@@ -369,6 +369,29 @@ TEST_F(LeImplTest, remove_device_from_connect_list) {
   ASSERT_EQ(0UL, le_impl_->connect_list.size());
 }
 
+TEST_F(LeImplTest, add_devices_to_background_and_resolving_lists_without_callbacks) {
+  std::promise<void> unregistered;
+  auto unregistered_future = unregistered.get_future();
+  le_impl_->handle_unregister_le_callbacks(&mock_le_connection_callbacks_, std::move(unregistered));
+  unregistered_future.wait();
+
+  AddressWithType background({0x01, 0x02, 0x03, 0x04, 0x05, 0x06}, AddressType::PUBLIC_DEVICE_ADDRESS);
+  Address bonded({0x11, 0x12, 0x13, 0x14, 0x15, 0x16});
+  crypto_toolbox::Octet16 irk{};
+  hci_layer_->SetCommandFuture();
+  le_impl_->add_devices_to_background_and_resolving_lists(
+      {background}, {{PeerAddressType::PUBLIC_DEVICE_OR_IDENTITY_ADDRESS, bonded, irk, irk}});
+
+  // Background connections need a client, resolving list entries do not
+  ASSERT_EQ(0UL, le_impl_->connect_list.size());
+  hci_layer_->GetCommand(OpCode::LE_SET_ADDRESS_RESOLUTION_ENABLE);
+  sync_handler();
+  auto packet = hci_layer_->GetCommand(OpCode::LE_ADD_DEVICE_TO_RESOLVING_LIST);
+  auto packet_view = LeAddDeviceToResolvingListView::Create(LeSecurityCommandView::Create(packet));
+  ASSERT_TRUE(packet_view.IsValid());
+  ASSERT_EQ(bonded, packet_view.GetPeerIdentityAddress());
+}
+
 TEST_F(LeImplTest, connection_complete_with_periperal_role) {
   // Create connection
   hci_layer_->SetCommandFuture();
@@ -17,10 +17,17 @@
 #include "hci/acl_manager/round_robin_scheduler.h"
 #include "hci/acl_manager/acl_fragmenter.h"
 
+#include "common/trace_point.h"
+
 namespace bluetooth {
 namespace hci {
 namespace acl_manager {
 
+// From a fragment being buffered by the scheduler until the HCI queue takes it
+BT_TRACE_POINT(scheduler_dwell, "hci.acl.scheduler_dwell");
+// From the controller buffer filling up until it returns credits
+BT_TRACE_POINT(credit_wait, "hci.acl.credit_wait");
+
 RoundRobinScheduler::RoundRobinScheduler(
     os::Handler* handler, Controller* controller, common::BidiQueueEnd<AclBuilder, AclView>* hci_queue_end)
     : handler_(handler), controller_(controller), hci_queue_end_(hci_queue_end) {
@@ -89,7 +96,7 @@ void RoundRobinScheduler::start_round_robin() {
     return;
   }
   if (!fragments_to_send_.empty()) {
-    auto connection_type = fragments_to_send_.front().first;
+    auto connection_type = fragments_to_send_.front().connection_type_;
     bool classic_buffer_full = acl_packet_credits_ == 0 && connection_type == ConnectionType::CLASSIC;
     bool le_buffer_full = le_acl_packet_credits_ == 0 && connection_type == ConnectionType::LE;
     if (classic_buffer_full || le_buffer_full) {
@@ -143,18 +150,20 @@ void RoundRobinScheduler::buffer_packet(std::map<uint16_t, acl_queue_handler>::i
                                                 : PacketBoundaryFlag::FIRST_NON_AUTOMATICALLY_FLUSHABLE;
 
   int acl_priority = acl_queue_handler->second.high_priority_ ? 1 : 0;
+  auto now = std::chrono::steady_clock::now();
   if (packet->size() <= mtu) {
     fragments_to_send_.push(
-        std::make_pair(
-            connection_type, AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(packet))),
+        fragment{
+            connection_type, AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(packet)), now},
         acl_priority);
   } else {
     auto fragments = AclFragmenter(mtu, std::move(packet)).GetFragments();
     for (size_t i = 0; i < fragments.size(); i++) {
       fragments_to_send_.push(
-          std::make_pair(
+          fragment{
               connection_type,
-              AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(fragments[i]))),
+              AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(fragments[i])),
+              now},
           acl_priority);
       packet_boundary_flag = PacketBoundaryFlag::CONTINUING_FRAGMENT;
     }
@@ -185,16 +194,24 @@ void RoundRobinScheduler::send_next_fragment() {
 
 // Invoked from some external Queue Reactable context 1
 std::unique_ptr<AclBuilder> RoundRobinScheduler::handle_enqueue_next_fragment() {
-  ConnectionType connection_type = fragments_to_send_.front().first;
+  ConnectionType connection_type = fragments_to_send_.front().connection_type_;
+  auto now = std::chrono::steady_clock::now();
   if (connection_type == ConnectionType::CLASSIC) {
     ASSERT(acl_packet_credits_ > 0);
     acl_packet_credits_ -= 1;
+    if (acl_packet_credits_ == 0) {
+      credits_exhausted_time_ = now;
+    }
   } else {
     ASSERT(le_acl_packet_credits_ > 0);
     le_acl_packet_credits_ -= 1;
+    if (le_acl_packet_credits_ == 0) {
+      le_credits_exhausted_time_ = now;
+    }
   }
 
-  auto raw_pointer = fragments_to_send_.front().second.release();
+  scheduler_dwell.Record(now - fragments_to_send_.front().buffered_time_);
+  auto raw_pointer = fragments_to_send_.front().packet_.release();
   fragments_to_send_.pop();
   if (fragments_to_send_.empty()) {
     if (enqueue_registered_.exchange(false)) {
@@ -202,7 +219,7 @@ std::unique_ptr<AclBuilder> RoundRobinScheduler::handle_enqueue_next_fragment()
     }
     handler_->Post(common::BindOnce(&RoundRobinScheduler::start_round_robin, common::Unretained(this)));
   } else {
-    ConnectionType next_connection_type = fragments_to_send_.front().first;
+    ConnectionType next_connection_type = fragments_to_send_.front().connection_type_;
     bool classic_buffer_full = next_connection_type == ConnectionType::CLASSIC && acl_packet_credits_ == 0;
     bool le_buffer_full = next_connection_type == ConnectionType::LE && le_acl_packet_credits_ == 0;
     if ((classic_buffer_full || le_buffer_full) && enqueue_registered_.exchange(false)) {
@@ -246,6 +263,9 @@ void RoundRobinScheduler::incoming_acl_credits(uint16_t handle, uint16_t credits
     }
   }
   if (credit_was_zero) {
+    credit_wait.RecordSince(
+        acl_queue_handler->second.connection_type_ == ConnectionType::CLASSIC ? credits_exhausted_time_
+                                                                              : le_credits_exhausted_time_);
     start_round_robin();
   }
 }
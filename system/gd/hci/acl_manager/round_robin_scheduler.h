@@ -18,6 +18,8 @@
 
 #include <stdint.h>
 
+#include <chrono>
+
 #include "common/bidi_queue.h"
 #include "common/multi_priority_queue.h"
 #include "hci/acl_manager.h"
@@ -60,14 +62,23 @@ class RoundRobinScheduler {
   std::unique_ptr<AclBuilder> handle_enqueue_next_fragment();
   void incoming_acl_credits(uint16_t handle, uint16_t credits);
 
+  struct fragment {
+    ConnectionType connection_type_;
+    std::unique_ptr<AclBuilder> packet_;
+    std::chrono::steady_clock::time_point buffered_time_;
+  };
+
   os::Handler* handler_ = nullptr;
   Controller* controller_ = nullptr;
   std::map<uint16_t, acl_queue_handler> acl_queue_handlers_;
-  common::MultiPriorityQueue<std::pair<ConnectionType, std::unique_ptr<AclBuilder>>, 2> fragments_to_send_;
+  common::MultiPriorityQueue<fragment, 2> fragments_to_send_;
   uint16_t max_acl_packet_credits_ = 0;
   uint16_t acl_packet_credits_ = 0;
   uint16_t le_max_acl_packet_credits_ = 0;
   uint16_t le_acl_packet_credits_ = 0;
+  // When the classic/LE controller buffers last ran out of credits
+  std::chrono::steady_clock::time_point credits_exhausted_time_;
+  std::chrono::steady_clock::time_point le_credits_exhausted_time_;
   size_t hci_mtu_{0};
   size_t le_hci_mtu_{0};
   std::atomic_bool enqueue_registered_ = false;
@@ -16,10 +16,16 @@
 
 #include "hci/hci_layer.h"
 
+#include <algorithm>
+#include <array>
+#include <mutex>
+
 #include "common/bind.h"
 #include "common/init_flags.h"
 #include "common/stop_watch.h"
+#include "common/trace_point.h"
 #include "hci/hci_metrics_logging.h"
+#include "hci_layer_generated.h"
 #include "os/alarm.h"
 #include "os/metrics.h"
 #include "os/queue.h"
@@ -47,6 +53,9 @@ using os::Handler;
 using std::move;
 using std::unique_ptr;
 
+// From sending a command to the HAL until its Command Complete or Command Status is handled
+BT_TRACE_POINT(command_round_trip, "hci.command_round_trip");
+
 static void fail_if_reset_complete_not_success(CommandCompleteView complete) {
   auto reset_complete = ResetCompleteView::Create(complete);
   ASSERT(reset_complete.IsValid());
@@ -69,7 +78,11 @@ class CommandQueueEntry {
       : command(move(command_packet)), waiting_for_status_(true), on_status(move(on_status_function)) {}
 
   unique_ptr<CommandBuilder> command;
+  // Serialized form, filled in before the command is sent
+  std::shared_ptr<std::vector<uint8_t>> bytes;
   unique_ptr<CommandView> command_view;
+  OpCode op_code{OpCode::NONE};
+  std::chrono::steady_clock::time_point sent_time;
 
   bool waiting_for_status_;
   ContextualOnceCallback<void(CommandStatusView)> on_status;
@@ -91,6 +104,36 @@ class CommandQueueEntry {
   }
 };
 
+// Round trip times of one opcode. Power of two buckets keep this small enough to track every opcode.
+struct CommandLatencyStats {
+  static constexpr size_t kBuckets = 32;
+
+  void Record(int64_t latency_us) {
+    count++;
+    total_us += latency_us;
+    max_us = std::max(max_us, latency_us);
+    size_t bucket = latency_us <= 1 ? 0 : 63 - __builtin_clzll(static_cast<uint64_t>(latency_us));
+    buckets[std::min(bucket, kBuckets - 1)]++;
+  }
+
+  int64_t GetPercentile(double percentile) const {
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(percentile / 100.0 * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+      seen += buckets[bucket];
+      if (seen >= rank) {
+        return std::min(max_us, (int64_t{2} << bucket) - 1);
+      }
+    }
+    return max_us;
+  }
+
+  uint64_t count = 0;
+  int64_t total_us = 0;
+  int64_t max_us = 0;
+  std::array<uint64_t, kBuckets> buckets{};
+};
+
 struct HciLayer::impl {
   impl(hal::HciHal* hal, HciLayer& module) : hal_(hal), module_(module) {
     hci_timeout_alarm_ = new Alarm(module.GetHandler());
@@ -107,6 +150,7 @@ struct HciLayer::impl {
       delete hci_abort_alarm_;
     }
     command_queue_.clear();
+    waiting_commands_.clear();
   }
 
   void drop(EventView event) {
@@ -174,18 +218,22 @@ struct HciLayer::impl {
     }
     bool is_status = logging_id == "status";
 
-    ASSERT_LOG(!command_queue_.empty(), "Unexpected %s event with OpCode 0x%02hx (%s)", logging_id.c_str(), op_code,
+    ASSERT_LOG(!waiting_commands_.empty(), "Unexpected %s event with OpCode 0x%02hx (%s)", logging_id.c_str(), op_code,
                OpCodeText(op_code).c_str());
-    if (waiting_command_ == OpCode::CONTROLLER_DEBUG_INFO && op_code != OpCode::CONTROLLER_DEBUG_INFO) {
+    if (is_waiting_for_debug_info() && op_code != OpCode::CONTROLLER_DEBUG_INFO) {
       LOG_ERROR("Discarding event that came after timeout 0x%02hx (%s)", op_code, OpCodeText(op_code).c_str());
       return;
     }
-    ASSERT_LOG(waiting_command_ == op_code, "Waiting for 0x%02hx (%s), got 0x%02hx (%s)", waiting_command_,
-               OpCodeText(waiting_command_).c_str(), op_code, OpCodeText(op_code).c_str());
+    auto waiting_command = find_waiting_command(op_code);
+    ASSERT_LOG(waiting_command != waiting_commands_.end(), "Waiting for 0x%02hx (%s), got 0x%02hx (%s)",
+               waiting_commands_.front().op_code, OpCodeText(waiting_commands_.front().op_code).c_str(), op_code,
+               OpCodeText(op_code).c_str());
+    command_round_trip.RecordSince(waiting_command->sent_time);
+    record_command_latency(op_code, waiting_command->sent_time);
 
     bool is_vendor_specific = static_cast<int>(op_code) & (0x3f << 10);
     CommandStatusView status_view = CommandStatusView::Create(event);
-    if (is_vendor_specific && (is_status && !command_queue_.front().waiting_for_status_) &&
+    if (is_vendor_specific && (is_status && !waiting_command->waiting_for_status_) &&
         (status_view.IsValid() && status_view.GetStatus() == ErrorCode::UNKNOWN_HCI_COMMAND)) {
       // If this is a command status of a vendor specific command, and command complete is expected, we can't treat
       // this as hard failure since we have no way of probing this lack of support at earlier time. Instead we let
@@ -193,36 +241,75 @@ struct HciLayer::impl {
       // response.
       CommandCompleteView command_complete_view = CommandCompleteView::Create(
           EventView::Create(PacketView<kLittleEndian>(std::make_shared<std::vector<uint8_t>>(std::vector<uint8_t>()))));
-      command_queue_.front().GetCallback<CommandCompleteView>()->Invoke(move(command_complete_view));
+      waiting_command->GetCallback<CommandCompleteView>()->Invoke(move(command_complete_view));
     } else {
       ASSERT_LOG(
-          command_queue_.front().waiting_for_status_ == is_status,
+          waiting_command->waiting_for_status_ == is_status,
           "0x%02hx (%s) was not expecting %s event",
           op_code,
           OpCodeText(op_code).c_str(),
           logging_id.c_str());
 
-      command_queue_.front().GetCallback<TResponse>()->Invoke(move(response_view));
+      waiting_command->GetCallback<TResponse>()->Invoke(move(response_view));
     }
 
-    command_queue_.pop_front();
-    waiting_command_ = OpCode::NONE;
+    bool was_oldest = waiting_command == waiting_commands_.begin();
+    waiting_commands_.erase(waiting_command);
     if (hci_timeout_alarm_ != nullptr) {
-      hci_timeout_alarm_->Cancel();
+      if (was_oldest) {
+        restart_hci_timeout();
+      }
       send_next_command();
     }
   }
 
+  // Responses to the same opcode come back in the order the commands were sent
+  std::list<CommandQueueEntry>::iterator find_waiting_command(OpCode op_code) {
+    return std::find_if(waiting_commands_.begin(), waiting_commands_.end(), [op_code](const CommandQueueEntry& entry) {
+      return entry.op_code == op_code;
+    });
+  }
+
+  bool is_waiting_for_debug_info() const {
+    return !waiting_commands_.empty() && waiting_commands_.front().op_code == OpCode::CONTROLLER_DEBUG_INFO;
+  }
+
+  // These change controller state in ways that make other outstanding commands meaningless, or have
+  // vendor defined flow control, so they are only sent when nothing else is outstanding
+  static bool must_be_sent_alone(OpCode op_code) {
+    bool is_vendor_specific = static_cast<int>(op_code) & (0x3f << 10);
+    return op_code == OpCode::RESET || op_code == OpCode::CONTROLLER_DEBUG_INFO || is_vendor_specific;
+  }
+
+  // The timeout always tracks the oldest outstanding command
+  void restart_hci_timeout() {
+    hci_timeout_alarm_->Cancel();
+    if (waiting_commands_.empty()) {
+      return;
+    }
+    const auto& oldest = waiting_commands_.front();
+    auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - oldest.sent_time);
+    auto remaining = std::max(kHciTimeoutMs - elapsed, std::chrono::milliseconds(1));
+    hci_timeout_alarm_->Schedule(BindOnce(&impl::on_hci_timeout, common::Unretained(this), oldest.op_code), remaining);
+  }
+
+  void record_command_latency(OpCode op_code, std::chrono::steady_clock::time_point sent_time) {
+    auto latency = std::chrono::steady_clock::now() - sent_time;
+    std::lock_guard<std::mutex> lock(dumpsys_mutex_);
+    command_latency_stats_[op_code].Record(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+  }
+
   void on_hci_timeout(OpCode op_code) {
     common::StopWatch::DumpStopWatchLog();
     LOG_ERROR("Timed out waiting for 0x%02hx (%s)", op_code, OpCodeText(op_code).c_str());
     // TODO: LogMetricHciTimeoutEvent(static_cast<uint32_t>(op_code));
 
-    LOG_ERROR("Flushing %zd waiting commands", command_queue_.size());
+    LOG_ERROR("Flushing %zd waiting commands", command_queue_.size() + waiting_commands_.size());
     // Clear any waiting commands (there is an abort coming anyway)
     command_queue_.clear();
+    waiting_commands_.clear();
     command_credits_ = 1;
-    waiting_command_ = OpCode::NONE;
     enqueue_command(
         ControllerDebugInfoBuilder::Create(), module_.GetHandler()->BindOnce(&fail_if_reset_complete_not_success));
     // Don't time out for this one;
@@ -240,32 +327,43 @@ struct HciLayer::impl {
   }
 
   void send_next_command() {
-    if (command_credits_ == 0) {
-      return;
-    }
-    if (waiting_command_ != OpCode::NONE) {
-      return;
-    }
-    if (command_queue_.size() == 0) {
-      return;
-    }
-    std::shared_ptr<std::vector<uint8_t>> bytes = std::make_shared<std::vector<uint8_t>>();
-    BitInserter bi(*bytes);
-    command_queue_.front().command->Serialize(bi);
-    hal_->sendHciCommand(*bytes);
-
-    auto cmd_view = CommandView::Create(PacketView<kLittleEndian>(bytes));
-    ASSERT(cmd_view.IsValid());
-    OpCode op_code = cmd_view.GetOpCode();
-    command_queue_.front().command_view = std::make_unique<CommandView>(std::move(cmd_view));
-    log_link_layer_connection_command(command_queue_.front().command_view);
-    log_classic_pairing_command_status(command_queue_.front().command_view, ErrorCode::STATUS_UNKNOWN);
-    waiting_command_ = op_code;
-    command_credits_ = 0;  // Only allow one outstanding command
-    if (hci_timeout_alarm_ != nullptr) {
-      hci_timeout_alarm_->Schedule(BindOnce(&impl::on_hci_timeout, common::Unretained(this), op_code), kHciTimeoutMs);
-    } else {
-      LOG_WARN("%s sent without an hci-timeout timer", OpCodeText(op_code).c_str());
+    while (command_credits_ > 0 && !command_queue_.empty()) {
+      auto& next = command_queue_.front();
+      if (next.command_view == nullptr) {
+        next.bytes = std::make_shared<std::vector<uint8_t>>();
+        BitInserter bi(*next.bytes);
+        next.command->Serialize(bi);
+        auto cmd_view = CommandView::Create(PacketView<kLittleEndian>(next.bytes));
+        ASSERT(cmd_view.IsValid());
+        next.op_code = cmd_view.GetOpCode();
+        next.command_view = std::make_unique<CommandView>(std::move(cmd_view));
+      }
+      if (!waiting_commands_.empty() && (!pipelining_enabled_ || must_be_sent_alone(next.op_code) ||
+                                         must_be_sent_alone(waiting_commands_.front().op_code))) {
+        return;
+      }
+
+      next.sent_time = std::chrono::steady_clock::now();
+      hal_->sendHciCommand(*next.bytes);
+      log_link_layer_connection_command(next.command_view);
+      log_classic_pairing_command_status(next.command_view, ErrorCode::STATUS_UNKNOWN);
+      command_credits_--;
+      OpCode op_code = next.op_code;
+      waiting_commands_.splice(waiting_commands_.end(), command_queue_, command_queue_.begin());
+      {
+        std::lock_guard<std::mutex> lock(dumpsys_mutex_);
+        max_outstanding_commands_ = std::max(max_outstanding_commands_, waiting_commands_.size());
+      }
+
+      if (waiting_commands_.size() > 1) {
+        // The timeout is already running for an older command
+        continue;
+      }
+      if (hci_timeout_alarm_ != nullptr) {
+        hci_timeout_alarm_->Schedule(BindOnce(&impl::on_hci_timeout, common::Unretained(this), op_code), kHciTimeoutMs);
+      } else {
+        LOG_WARN("%s sent without an hci-timeout timer", OpCodeText(op_code).c_str());
+      }
     }
   }
 
@@ -331,32 +429,33 @@ struct HciLayer::impl {
 
   void on_hci_event(EventView event) {
     ASSERT(event.IsValid());
-    if (command_queue_.empty()) {
-      auto event_code = event.GetEventCode();
-      // BT Core spec 5.2 (Volume 4, Part E section 4.4) allows anytime
-      // COMMAND_COMPLETE and COMMAND_STATUS with opcode 0x0 for flow control
-      if (event_code == EventCode::COMMAND_COMPLETE) {
-          auto view = CommandCompleteView::Create(event);
-          ASSERT(view.IsValid());
-          auto op_code = view.GetCommandOpCode();
-          ASSERT_LOG(op_code == OpCode::NONE,
-            "Received %s event with OpCode 0x%02hx (%s) without a waiting command"
-            "(is the HAL sending commands, but not handling the events?)",
-            EventCodeText(event_code).c_str(), op_code, OpCodeText(op_code).c_str());
-      }
-      if (event_code == EventCode::COMMAND_STATUS) {
-          auto view = CommandStatusView::Create(event);
-          ASSERT(view.IsValid());
-          auto op_code = view.GetCommandOpCode();
-          ASSERT_LOG(op_code == OpCode::NONE,
-            "Received %s event with OpCode 0x%02hx (%s) without a waiting command"
-            "(is the HAL sending commands, but not handling the events?)",
-            EventCodeText(event_code).c_str(), op_code, OpCodeText(op_code).c_str());
-      }
-      std::unique_ptr<CommandView> no_waiting_command{nullptr};
-      log_hci_event(no_waiting_command, event, module_.GetDependency<storage::StorageModule>());
+    OpCode op_code = OpCode::NONE;
+    if (event.GetEventCode() == EventCode::COMMAND_COMPLETE) {
+      auto view = CommandCompleteView::Create(event);
+      ASSERT(view.IsValid());
+      op_code = view.GetCommandOpCode();
+    } else if (event.GetEventCode() == EventCode::COMMAND_STATUS) {
+      auto view = CommandStatusView::Create(event);
+      ASSERT(view.IsValid());
+      op_code = view.GetCommandOpCode();
+    }
+    // BT Core spec 5.2 (Volume 4, Part E section 4.4) allows anytime
+    // COMMAND_COMPLETE and COMMAND_STATUS with opcode 0x0 for flow control
+    auto waiting_command = find_waiting_command(op_code);
+    if (op_code != OpCode::NONE && waiting_command != waiting_commands_.end()) {
+      log_hci_event(waiting_command->command_view, event, module_.GetDependency<storage::StorageModule>());
     } else {
-      log_hci_event(command_queue_.front().command_view, event, module_.GetDependency<storage::StorageModule>());
+      ASSERT_LOG(
+          op_code == OpCode::NONE || is_waiting_for_debug_info(),
+          "Received %s event with OpCode 0x%02hx (%s) without a waiting command"
+          "(is the HAL sending commands, but not handling the events?)",
+          EventCodeText(event.GetEventCode()).c_str(),
+          op_code,
+          OpCodeText(op_code).c_str());
+      if (op_code == OpCode::NONE) {
+        std::unique_ptr<CommandView> no_waiting_command{nullptr};
+        log_hci_event(no_waiting_command, event, module_.GetDependency<storage::StorageModule>());
+      }
     }
     EventCode event_code = event.GetEventCode();
     // Root Inflamation is a special case, since it aborts here
@@ -394,12 +493,16 @@ struct HciLayer::impl {
   HciLayer& module_;
 
   // Command Handling
+  // Commands not sent yet
   std::list<CommandQueueEntry> command_queue_;
+  // Commands sent to the controller and waiting for Command Complete or Command Status, oldest first
+  std::list<CommandQueueEntry> waiting_commands_;
 
   std::map<EventCode, ContextualCallback<void(EventView)>> event_handlers_;
   std::map<SubeventCode, ContextualCallback<void(LeMetaEventView)>> subevent_handlers_;
-  OpCode waiting_command_{OpCode::NONE};
-  uint8_t command_credits_{1};  // Send reset first
+  uint8_t command_credits_{1};  // Send reset first, then follow Num_HCI_Command_Packets
+  // Without INIT_hci_command_pipelining, one command at a time whatever the credits
+  const bool pipelining_enabled_{common::init_flags::hci_command_pipelining_is_enabled()};
   Alarm* hci_timeout_alarm_{nullptr};
   Alarm* hci_abort_alarm_{nullptr};
 
@@ -414,6 +517,34 @@ struct HciLayer::impl {
   // ISO packets
   BidiQueue<IsoView, IsoBuilder> iso_queue_{3 /* TODO: Set queue depth */};
   os::EnqueueBuffer<IsoView> incoming_iso_buffer_{iso_queue_.GetDownEnd()};
+
+  mutable std::mutex dumpsys_mutex_;
+  std::map<OpCode, CommandLatencyStats> command_latency_stats_;
+  size_t max_outstanding_commands_{0};
+
+  flatbuffers::Offset<HciLayerData> Dump(flatbuffers::FlatBufferBuilder* fb_builder) const {
+    std::lock_guard<std::mutex> lock(dumpsys_mutex_);
+    std::vector<flatbuffers::Offset<CommandLatencyData>> latencies;
+    for (const auto& [op_code, stats] : command_latency_stats_) {
+      auto op_code_text = fb_builder->CreateString(OpCodeText(op_code));
+      CommandLatencyDataBuilder builder(*fb_builder);
+      builder.add_op_code(op_code_text);
+      builder.add_count(stats.count);
+      builder.add_mean_us(stats.count == 0 ? 0 : stats.total_us / static_cast<int64_t>(stats.count));
+      builder.add_p50_us(stats.GetPercentile(50));
+      builder.add_p99_us(stats.GetPercentile(99));
+      builder.add_max_us(stats.max_us);
+      latencies.push_back(builder.Finish());
+    }
+    auto title = fb_builder->CreateString("----- Hci Layer Dumpsys -----");
+    auto latencies_vector = fb_builder->CreateVector(latencies);
+
+    HciLayerDataBuilder builder(*fb_builder);
+    builder.add_title(title);
+    builder.add_max_outstanding_commands(max_outstanding_commands_);
+    builder.add_command_latencies(latencies_vector);
+    return builder.Finish();
+  }
 };
 
 // All functions here are running on the HAL thread
@@ -654,6 +785,18 @@ void HciLayer::Start() {
   EnqueueCommand(ResetBuilder::Create(), handler->BindOnce(&fail_if_reset_complete_not_success));
 }
 
+DumpsysDataFinisher HciLayer::GetDumpsysData(flatbuffers::FlatBufferBuilder* fb_builder) const {
+  ASSERT(fb_builder != nullptr);
+  if (impl_ == nullptr) {
+    // Test doubles replace Start() and never create the impl
+    return Module::GetDumpsysData(fb_builder);
+  }
+  auto dumpsys_data = impl_->Dump(fb_builder);
+  return [dumpsys_data](DumpsysDataBuilder* dumpsys_builder) {
+    dumpsys_builder->add_hci_layer_dumpsys_data(dumpsys_data);
+  };
+}
+
 void HciLayer::Stop() {
   auto hal = GetDependency<hal::HciHal>();
   hal->unregisterIncomingPacketCallback();
@@ -20,6 +20,7 @@
 #include <list>
 #include <memory>
 
+#include "common/init_flags.h"
 #include "hal/hci_hal.h"
 #include "hci/hci_packets.h"
 #include "module.h"
@@ -621,6 +622,113 @@ TEST_F(HciTest, creditsTest) {
       ReadLocalSupportedFeaturesCompleteView::Create(CommandCompleteView::Create(EventView::Create(event))).IsValid());
 }
 
+class HciPipeliningTest : public HciTest {
+ public:
+  void SetUp() override {
+    const char* flags[] = {"INIT_hci_command_pipelining=true", nullptr};
+    bluetooth::common::InitFlags::Load(flags);
+    HciTest::SetUp();
+  }
+
+  void TearDown() override {
+    HciTest::TearDown();
+    bluetooth::common::InitFlags::Load(nullptr);
+  }
+};
+
+TEST_F(HciTest, oneCommandAtATimeTest) {
+  ASSERT_EQ(0, hal->GetNumSentCommands());
+
+  // Without pipelining, credits beyond one are not used
+  uint8_t num_packets = 3;
+  hal->callbacks->hciEventReceived(GetPacketBytes(NoCommandCompleteBuilder::Create(num_packets)));
+
+  auto command_future = hal->GetSentCommandFuture();
+  upper->SendHciCommandExpectingComplete(ReadLocalVersionInformationBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadLocalSupportedCommandsBuilder::Create());
+
+  auto command_sent_status = command_future.wait_for(kTimeout);
+  ASSERT_EQ(command_sent_status, std::future_status::ready);
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+  ASSERT_EQ(1, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalVersionInformationView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+
+  // The second one goes out once the first completes
+  auto event_future = upper->GetReceivedEventFuture();
+  command_future = hal->GetSentCommandFuture();
+  ErrorCode error_code = ErrorCode::SUCCESS;
+  LocalVersionInformation local_version_information;
+  local_version_information.hci_version_ = HciVersion::V_5_0;
+  local_version_information.lmp_version_ = LmpVersion::V_4_2;
+  hal->callbacks->hciEventReceived(GetPacketBytes(
+      ReadLocalVersionInformationCompleteBuilder::Create(num_packets, error_code, local_version_information)));
+  auto event_status = event_future.wait_for(kTimeout);
+  ASSERT_EQ(event_status, std::future_status::ready);
+  auto event = upper->GetReceivedEvent();
+  ASSERT_TRUE(
+      ReadLocalVersionInformationCompleteView::Create(CommandCompleteView::Create(EventView::Create(event))).IsValid());
+  command_sent_status = command_future.wait_for(kTimeout);
+  ASSERT_EQ(command_sent_status, std::future_status::ready);
+  ASSERT_EQ(1, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalSupportedCommandsView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+}
+
+TEST_F(HciPipeliningTest, pipelinedCommandsTest) {
+  ASSERT_EQ(0, hal->GetNumSentCommands());
+
+  // The controller can accept three commands at once
+  uint8_t num_packets = 3;
+  hal->callbacks->hciEventReceived(GetPacketBytes(NoCommandCompleteBuilder::Create(num_packets)));
+
+  auto command_future = hal->GetSentCommandFuture();
+  upper->SendHciCommandExpectingComplete(ReadLocalVersionInformationBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadLocalSupportedCommandsBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadLocalSupportedFeaturesBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadBdAddrBuilder::Create());
+
+  auto command_sent_status = command_future.wait_for(kTimeout);
+  ASSERT_EQ(command_sent_status, std::future_status::ready);
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+
+  // Verify that three were sent, in order, without waiting for responses
+  ASSERT_EQ(3, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalVersionInformationView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+  ASSERT_TRUE(ReadLocalSupportedCommandsView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+  ASSERT_TRUE(ReadLocalSupportedFeaturesView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+
+  // Respond to the second command first, it must be matched by opcode
+  auto event_future = upper->GetReceivedEventFuture();
+  command_future = hal->GetSentCommandFuture();
+  num_packets = 1;
+  ErrorCode error_code = ErrorCode::SUCCESS;
+  std::array<uint8_t, 64> supported_commands{};
+  hal->callbacks->hciEventReceived(
+      GetPacketBytes(ReadLocalSupportedCommandsCompleteBuilder::Create(num_packets, error_code, supported_commands)));
+  auto event_status = event_future.wait_for(kTimeout);
+  ASSERT_EQ(event_status, std::future_status::ready);
+  auto event = upper->GetReceivedEvent();
+  ASSERT_TRUE(
+      ReadLocalSupportedCommandsCompleteView::Create(CommandCompleteView::Create(EventView::Create(event))).IsValid());
+
+  // The returned credit lets the fourth command go out
+  command_sent_status = command_future.wait_for(kTimeout);
+  ASSERT_EQ(command_sent_status, std::future_status::ready);
+  ASSERT_EQ(1, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadBdAddrView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+
+  event_future = upper->GetReceivedEventFuture();
+  LocalVersionInformation local_version_information;
+  local_version_information.hci_version_ = HciVersion::V_5_0;
+  local_version_information.lmp_version_ = LmpVersion::V_4_2;
+  hal->callbacks->hciEventReceived(GetPacketBytes(
+      ReadLocalVersionInformationCompleteBuilder::Create(num_packets, error_code, local_version_information)));
+  event_status = event_future.wait_for(kTimeout);
+  ASSERT_EQ(event_status, std::future_status::ready);
+  event = upper->GetReceivedEvent();
+  ASSERT_TRUE(
+      ReadLocalVersionInformationCompleteView::Create(CommandCompleteView::Create(EventView::Create(event))).IsValid());
+}
+
 TEST_F(HciTest, leSecurityInterfaceTest) {
   // Send LeRand to the controller
   auto command_future = hal->GetSentCommandFuture();
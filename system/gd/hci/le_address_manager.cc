@@ -426,6 +426,11 @@ void LeAddressManager::handle_next_command() {
           rotate_random_address();
         } else if constexpr (std::is_same_v<T, HCICommand>) {
           enqueue_command_.Run(std::move(command.command));
+        } else if constexpr (std::is_same_v<T, HCICommandBatch>) {
+          outstanding_batch_commands_ = command.commands.size();
+          for (auto& builder : command.commands) {
+            enqueue_command_.Run(std::move(builder));
+          }
         } else {
           static_assert(!sizeof(T*), "non-exhaustive visitor!");
         }
@@ -435,6 +440,7 @@ void LeAddressManager::handle_next_command() {
 
 void LeAddressManager::AddDeviceToFilterAcceptList(
     FilterAcceptListAddressType connect_list_address_type, bluetooth::hci::Address address) {
+  filter_accept_list_.emplace(connect_list_address_type, address);
   auto packet_builder = hci::LeAddDeviceToFilterAcceptListBuilder::Create(connect_list_address_type, address);
   Command command = {CommandType::ADD_DEVICE_TO_CONNECT_LIST, HCICommand{std::move(packet_builder)}};
   handler_->BindOnceOn(this, &LeAddressManager::push_command, std::move(command)).Invoke();
@@ -445,6 +451,8 @@ void LeAddressManager::AddDeviceToResolvingList(
     Address peer_identity_address,
     const std::array<uint8_t, 16>& peer_irk,
     const std::array<uint8_t, 16>& local_irk) {
+  resolving_list_[{peer_identity_address_type, peer_identity_address}] = {peer_irk, local_irk};
+
   // Disable Address resolution
   auto disable_builder = hci::LeSetAddressResolutionEnableBuilder::Create(hci::Enable::DISABLED);
   Command disable = {CommandType::SET_ADDRESS_RESOLUTION_ENABLE, HCICommand{std::move(disable_builder)}};
@@ -476,6 +484,7 @@ void LeAddressManager::AddDeviceToResolvingList(
 
 void LeAddressManager::RemoveDeviceFromFilterAcceptList(
     FilterAcceptListAddressType connect_list_address_type, bluetooth::hci::Address address) {
+  filter_accept_list_.erase({connect_list_address_type, address});
   auto packet_builder = hci::LeRemoveDeviceFromFilterAcceptListBuilder::Create(connect_list_address_type, address);
   Command command = {CommandType::REMOVE_DEVICE_FROM_CONNECT_LIST, HCICommand{std::move(packet_builder)}};
   handler_->BindOnceOn(this, &LeAddressManager::push_command, std::move(command)).Invoke();
@@ -483,6 +492,8 @@ void LeAddressManager::RemoveDeviceFromFilterAcceptList(
 
 void LeAddressManager::RemoveDeviceFromResolvingList(
     PeerAddressType peer_identity_address_type, Address peer_identity_address) {
+  resolving_list_.erase({peer_identity_address_type, peer_identity_address});
+
   // Disable Address resolution
   auto disable_builder = hci::LeSetAddressResolutionEnableBuilder::Create(hci::Enable::DISABLED);
   Command disable = {CommandType::SET_ADDRESS_RESOLUTION_ENABLE, HCICommand{std::move(disable_builder)}};
@@ -506,12 +517,15 @@ void LeAddressManager::RemoveDeviceFromResolvingList(
 }
 
 void LeAddressManager::ClearFilterAcceptList() {
+  filter_accept_list_.clear();
   auto packet_builder = hci::LeClearFilterAcceptListBuilder::Create();
   Command command = {CommandType::CLEAR_CONNECT_LIST, HCICommand{std::move(packet_builder)}};
   handler_->BindOnceOn(this, &LeAddressManager::push_command, std::move(command)).Invoke();
 }
 
 void LeAddressManager::ClearResolvingList() {
+  resolving_list_.clear();
+
   // Disable Address resolution
   auto disable_builder = hci::LeSetAddressResolutionEnableBuilder::Create(hci::Enable::DISABLED);
   Command disable = {CommandType::SET_ADDRESS_RESOLUTION_ENABLE, HCICommand{std::move(disable_builder)}};
@@ -529,6 +543,89 @@ void LeAddressManager::ClearResolvingList() {
   handler_->BindOnceOn(this, &LeAddressManager::pause_registered_clients).Invoke();
 }
 
+void LeAddressManager::SyncFilterAcceptAndResolvingLists(
+    std::optional<std::vector<FilterAcceptListEntry>> filter_accept_list,
+    std::vector<ResolvingListEntry> resolving_list_entries) {
+  handler_
+      ->BindOnceOn(
+          this, &LeAddressManager::sync_address_lists, std::move(filter_accept_list), std::move(resolving_list_entries))
+      .Invoke();
+}
+
+void LeAddressManager::sync_address_lists(
+    std::optional<std::vector<FilterAcceptListEntry>> filter_accept_list,
+    std::vector<ResolvingListEntry> resolving_list_entries) {
+  std::vector<std::unique_ptr<CommandBuilder>> commands;
+
+  if (filter_accept_list.has_value()) {
+    std::set<FilterAcceptListKey> desired;
+    for (const auto& entry : *filter_accept_list) {
+      desired.emplace(entry.address_type, entry.address);
+    }
+    if (desired.size() > connect_list_size_) {
+      LOG_WARN("Filter accept list sync of %zu entries exceeds controller size %hhu", desired.size(), connect_list_size_);
+    }
+    // Removals first, so that additions do not overflow a full list
+    for (const auto& entry : filter_accept_list_) {
+      if (desired.find(entry) == desired.end()) {
+        commands.push_back(hci::LeRemoveDeviceFromFilterAcceptListBuilder::Create(entry.first, entry.second));
+      }
+    }
+    for (const auto& entry : desired) {
+      if (filter_accept_list_.find(entry) == filter_accept_list_.end()) {
+        commands.push_back(hci::LeAddDeviceToFilterAcceptListBuilder::Create(entry.first, entry.second));
+      }
+    }
+    filter_accept_list_ = std::move(desired);
+  }
+
+  // The resolving list is shared with periodic sync, so entries are only ever added here
+  std::vector<std::unique_ptr<CommandBuilder>> resolving_commands;
+  for (const auto& entry : resolving_list_entries) {
+    ResolvingListKey key = {entry.peer_identity_address_type, entry.peer_identity_address};
+    ResolvingListIrks irks = {entry.peer_irk, entry.local_irk};
+    auto it = resolving_list_.find(key);
+    if (it != resolving_list_.end()) {
+      if (it->second == irks) {
+        continue;
+      }
+      // Keys changed, the controller does not allow updating an entry in place
+      resolving_commands.push_back(hci::LeRemoveDeviceFromResolvingListBuilder::Create(key.first, key.second));
+    }
+    resolving_list_[key] = irks;
+    resolving_commands.push_back(
+        hci::LeAddDeviceToResolvingListBuilder::Create(key.first, key.second, irks.first, irks.second));
+    if (supports_ble_privacy_) {
+      resolving_commands.push_back(hci::LeSetPrivacyModeBuilder::Create(key.first, key.second, PrivacyMode::DEVICE));
+    }
+  }
+  if (resolving_list_.size() > resolving_list_size_) {
+    LOG_WARN("Resolving list of %zu entries exceeds controller size %hhu", resolving_list_.size(), resolving_list_size_);
+  }
+  // Address resolution is disabled once around the whole batch instead of around every entry
+  if (!resolving_commands.empty()) {
+    commands.push_back(hci::LeSetAddressResolutionEnableBuilder::Create(hci::Enable::DISABLED));
+    for (auto& command : resolving_commands) {
+      commands.push_back(std::move(command));
+    }
+    commands.push_back(hci::LeSetAddressResolutionEnableBuilder::Create(hci::Enable::ENABLED));
+  }
+
+  if (commands.empty()) {
+    LOG_DEBUG("Address lists already in sync");
+    return;
+  }
+  LOG_INFO("Syncing address lists with %zu commands", commands.size());
+  Command command = {CommandType::SYNC_ADDRESS_LISTS, HCICommandBatch{std::move(commands)}};
+  cached_commands_.push(std::move(command));
+
+  if (registered_clients_.empty()) {
+    handle_next_command();
+  } else {
+    pause_registered_clients();
+  }
+}
+
 template <class View>
 void LeAddressManager::on_command_complete(CommandCompleteView view) {
   auto op_code = view.GetCommandOpCode();
@@ -615,6 +712,14 @@ void LeAddressManager::OnCommandComplete(bluetooth::hci::CommandCompleteView vie
       break;
   }
 
+  // Keep the clients paused until the whole batch has completed
+  if (outstanding_batch_commands_ > 0 && op_code != OpCode::LE_SET_RANDOM_ADDRESS) {
+    outstanding_batch_commands_--;
+    if (outstanding_batch_commands_ > 0) {
+      return;
+    }
+  }
+
   handler_->BindOnceOn(this, &LeAddressManager::check_cached_commands).Invoke();
 }
 
@@ -17,8 +17,10 @@
 
 #include <map>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <variant>
+#include <vector>
 
 #include "common/callback.h"
 #include "hci/address_with_type.h"
@@ -56,6 +58,18 @@ class LeAddressManager {
     USE_RESOLVABLE_ADDRESS
   };
 
+  struct FilterAcceptListEntry {
+    FilterAcceptListAddressType address_type;
+    Address address;
+  };
+
+  struct ResolvingListEntry {
+    PeerAddressType peer_identity_address_type;
+    Address peer_identity_address;
+    std::array<uint8_t, 16> peer_irk;
+    std::array<uint8_t, 16> local_irk;
+  };
+
   // Aborts if called more than once
   void SetPrivacyPolicyForInitiatorAddress(
       AddressPolicy address_policy,
@@ -93,6 +107,12 @@ class LeAddressManager {
   void RemoveDeviceFromResolvingList(PeerAddressType peer_identity_address_type, Address peer_identity_address);
   void ClearFilterAcceptList();
   void ClearResolvingList();
+  // Bring the controller filter accept list to |filter_accept_list| (left untouched if std::nullopt) and make sure
+  // every entry of |resolving_list_entries| is in the resolving list. Only the difference with what was previously
+  // written is sent, as one batch of pipelined commands inside a single pause window.
+  void SyncFilterAcceptAndResolvingLists(
+      std::optional<std::vector<FilterAcceptListEntry>> filter_accept_list,
+      std::vector<ResolvingListEntry> resolving_list_entries);
   void OnCommandComplete(CommandCompleteView view);
   std::chrono::milliseconds GetNextPrivateAddressIntervalMs();
 
@@ -115,6 +135,7 @@ class LeAddressManager {
     SET_ADDRESS_RESOLUTION_ENABLE,
     LE_SET_PRIVACY_MODE,
     UPDATE_IRK,
+    SYNC_ADDRESS_LISTS,
   };
 
   struct RotateRandomAddressCommand {};
@@ -129,11 +150,20 @@ class LeAddressManager {
     std::unique_ptr<CommandBuilder> command;
   };
 
+  // Sent back to back; the next cached command runs once all of them have completed
+  struct HCICommandBatch {
+    std::vector<std::unique_ptr<CommandBuilder>> commands;
+  };
+
   struct Command {
     CommandType command_type;  // Note that this field is only intended for logging, not control flow
-    std::variant<RotateRandomAddressCommand, UpdateIRKCommand, HCICommand> contents;
+    std::variant<RotateRandomAddressCommand, UpdateIRKCommand, HCICommand, HCICommandBatch> contents;
   };
 
+  using FilterAcceptListKey = std::pair<FilterAcceptListAddressType, Address>;
+  using ResolvingListKey = std::pair<PeerAddressType, Address>;
+  using ResolvingListIrks = std::pair<std::array<uint8_t, 16>, std::array<uint8_t, 16>>;
+
   void pause_registered_clients();
   void push_command(Command command);
   void ack_pause(LeAddressManagerCallback* callback);
@@ -151,6 +181,9 @@ class LeAddressManager {
   hci::Address generate_nrpa();
   void handle_next_command();
   void check_cached_commands();
+  void sync_address_lists(
+      std::optional<std::vector<FilterAcceptListEntry>> filter_accept_list,
+      std::vector<ResolvingListEntry> resolving_list_entries);
   template <class View>
   void on_command_complete(CommandCompleteView view);
 
@@ -170,6 +203,10 @@ class LeAddressManager {
   uint8_t resolving_list_size_;
   std::queue<Command> cached_commands_;
   bool supports_ble_privacy_{false};
+  // Contents of the controller lists once every cached command has been sent, diffed against by a sync
+  std::set<FilterAcceptListKey> filter_accept_list_;
+  std::map<ResolvingListKey, ResolvingListIrks> resolving_list_;
+  size_t outstanding_batch_commands_ = 0;
 };
 
 }  // namespace hci
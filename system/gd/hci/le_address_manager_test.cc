@@ -439,6 +439,60 @@ TEST_F(LeAddressManagerWithSingleClientTest, clear_resolving_list) {
   clients[0].get()->WaitForResume();
 }
 
+TEST_F(LeAddressManagerWithSingleClientTest, sync_filter_accept_and_resolving_lists) {
+  Address kept, removed, added;
+  Address::FromString("01:02:03:04:05:06", kept);
+  Address::FromString("11:12:13:14:15:16", removed);
+  Address::FromString("21:22:23:24:25:26", added);
+  Octet16 peer_irk = {0xec, 0x02, 0x34, 0xa3, 0x57, 0xc8, 0xad, 0x05, 0x34, 0x10, 0x10, 0xa6, 0x0a, 0x39, 0x7d, 0x9b};
+  Octet16 local_irk = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10};
+  for (auto address : {kept, removed}) {
+    test_hci_layer_->SetCommandFuture();
+    le_address_manager_->AddDeviceToFilterAcceptList(FilterAcceptListAddressType::PUBLIC, address);
+    test_hci_layer_->GetCommand(OpCode::LE_ADD_DEVICE_TO_FILTER_ACCEPT_LIST);
+    test_hci_layer_->IncomingEvent(LeAddDeviceToFilterAcceptListCompleteBuilder::Create(0x01, ErrorCode::SUCCESS));
+  }
+  clients[0].get()->WaitForResume();
+
+  std::vector<LeAddressManager::FilterAcceptListEntry> filter_accept_list = {
+      {FilterAcceptListAddressType::PUBLIC, kept}, {FilterAcceptListAddressType::PUBLIC, added}};
+  std::vector<LeAddressManager::ResolvingListEntry> resolving_list = {
+      {PeerAddressType::PUBLIC_DEVICE_OR_IDENTITY_ADDRESS, added, peer_irk, local_irk}};
+  test_hci_layer_->SetCommandFuture();
+  le_address_manager_->SyncFilterAcceptAndResolvingLists(filter_accept_list, resolving_list);
+
+  // Only the difference is sent, without waiting for each command to complete
+  auto remove_packet = test_hci_layer_->GetCommand(OpCode::LE_REMOVE_DEVICE_FROM_FILTER_ACCEPT_LIST);
+  sync_handler(handler_);
+  auto remove_view = LeRemoveDeviceFromFilterAcceptListView::Create(
+      LeConnectionManagementCommandView::Create(AclCommandView::Create(remove_packet)));
+  ASSERT_TRUE(remove_view.IsValid());
+  ASSERT_EQ(removed, remove_view.GetAddress());
+  auto add_packet = test_hci_layer_->GetCommand(OpCode::LE_ADD_DEVICE_TO_FILTER_ACCEPT_LIST);
+  auto add_view = LeAddDeviceToFilterAcceptListView::Create(
+      LeConnectionManagementCommandView::Create(AclCommandView::Create(add_packet)));
+  ASSERT_TRUE(add_view.IsValid());
+  ASSERT_EQ(added, add_view.GetAddress());
+  test_hci_layer_->GetCommand(OpCode::LE_SET_ADDRESS_RESOLUTION_ENABLE);
+  auto resolving_packet = test_hci_layer_->GetCommand(OpCode::LE_ADD_DEVICE_TO_RESOLVING_LIST);
+  auto resolving_view = LeAddDeviceToResolvingListView::Create(LeSecurityCommandView::Create(resolving_packet));
+  ASSERT_TRUE(resolving_view.IsValid());
+  ASSERT_EQ(added, resolving_view.GetPeerIdentityAddress());
+  test_hci_layer_->GetCommand(OpCode::LE_SET_ADDRESS_RESOLUTION_ENABLE);
+
+  test_hci_layer_->IncomingEvent(LeRemoveDeviceFromFilterAcceptListCompleteBuilder::Create(0x01, ErrorCode::SUCCESS));
+  test_hci_layer_->IncomingEvent(LeAddDeviceToFilterAcceptListCompleteBuilder::Create(0x01, ErrorCode::SUCCESS));
+  test_hci_layer_->IncomingEvent(LeSetAddressResolutionEnableCompleteBuilder::Create(0x01, ErrorCode::SUCCESS));
+  test_hci_layer_->IncomingEvent(LeAddDeviceToResolvingListCompleteBuilder::Create(0x01, ErrorCode::SUCCESS));
+  test_hci_layer_->IncomingEvent(LeSetAddressResolutionEnableCompleteBuilder::Create(0x01, ErrorCode::SUCCESS));
+  clients[0].get()->WaitForResume();
+
+  // Lists already match, so nothing is sent
+  le_address_manager_->SyncFilterAcceptAndResolvingLists(filter_accept_list, resolving_list);
+  sync_handler(handler_);
+  ASSERT_FALSE(test_hci_layer_->GetLastCommand().IsValid());
+}
+
 TEST_F(LeAddressManagerWithSingleClientTest, register_during_command_complete) {
   Address address;
   Address::FromString("01:02:03:04:05:06", address);
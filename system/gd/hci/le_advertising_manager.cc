@@ -15,19 +15,25 @@
  */
 #include "hci/le_advertising_manager.h"
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <mutex>
+#include <optional>
 
 #include "common/init_flags.h"
+#include "common/strings.h"
 #include "hci/acl_manager.h"
 #include "hci/controller.h"
 #include "hci/hci_layer.h"
 #include "hci/hci_packets.h"
 #include "hci/le_advertising_interface.h"
 #include "module.h"
+#include "os/alarm.h"
 #include "os/handler.h"
 #include "os/log.h"
 #include "os/system_properties.h"
+#include "packet/bit_inserter.h"
 
 namespace bluetooth {
 namespace hci {
@@ -36,6 +42,13 @@ const ModuleFactory LeAdvertisingManager::Factory = ModuleFactory([]() { return
 constexpr int kIdLocal = 0xff;  // Id for advertiser not register from Java layer
 constexpr uint16_t kLenOfFlags = 0x03;
 
+// Number of advertising sets the host may add on top of the controller ones, by advertising them in turns on one
+// controller set. 0 disables multiplexing.
+constexpr char kMultiplexedSetsProperty[] = "bluetooth.core.le.advertising_multiplexed_sets";
+// Default time on air of a multiplexed set per turn
+constexpr char kMultiplexSlotProperty[] = "bluetooth.core.le.advertising_multiplex_slot_ms";
+constexpr std::chrono::milliseconds kDefaultMultiplexSlot = std::chrono::milliseconds(500);
+
 enum class AdvertisingApiType {
   LEGACY = 1,
   ANDROID_HCI = 2,
@@ -67,6 +80,24 @@ struct Advertiser {
   std::unique_ptr<os::Alarm> address_rotation_alarm;
 };
 
+// What a controller advertising set was last given, so that updates that would not change it are not sent again
+struct ControllerSetState {
+  std::vector<uint8_t> parameters;
+  std::optional<std::vector<uint8_t>> advertising_data;
+  std::optional<std::vector<uint8_t>> scan_response_data;
+};
+
+// A set that takes turns with the other multiplexed sets on the controller set kept for them. Only its host side
+// state is here, it is loaded into the controller set for each of its turns.
+struct MultiplexedSet {
+  int reg_id = kIdLocal;
+  ExtendedAdvertisingConfig config;
+  AddressWithType address;
+  std::chrono::steady_clock::time_point address_expiry;
+  bool enabled = false;
+  std::unique_ptr<os::Alarm> timeout_alarm;
+};
+
 ExtendedAdvertisingConfig::ExtendedAdvertisingConfig(const AdvertisingConfig& config) : AdvertisingConfig(config) {
   switch (config.advertising_type) {
     case AdvertisingType::ADV_IND:
@@ -138,9 +169,45 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
     for (size_t i = 0; i < enabled_sets_.size(); i++) {
       enabled_sets_[i].advertising_handle_ = kInvalidHandle;
     }
+    configure_multiplexing();
+  }
+
+  void configure_multiplexing() {
+    if (advertising_api_type_ != AdvertisingApiType::EXTENDED || num_instances_ < 2) {
+      return;
+    }
+    uint64_t max_sets = 0;
+    auto max_sets_prop = os::GetSystemProperty(kMultiplexedSetsProperty);
+    if (max_sets_prop) {
+      max_sets = common::Uint64FromString(max_sets_prop.value()).value_or(0);
+    }
+    // Multiplexed sets get the ids following the controller ones, which must stay below kInvalidId
+    max_sets = std::min<uint64_t>(max_sets, kInvalidId - num_instances_);
+    if (max_sets == 0) {
+      return;
+    }
+    auto slot_prop = os::GetSystemProperty(kMultiplexSlotProperty);
+    if (slot_prop) {
+      auto slot_ms = common::Uint64FromString(slot_prop.value());
+      if (slot_ms && slot_ms.value() > 0) {
+        multiplex_slot_ = std::chrono::milliseconds(slot_ms.value());
+      }
+    }
+    max_multiplexed_sets_ = max_sets;
+    multiplex_handle_ = num_instances_ - 1;
+    multiplex_alarm_ = std::make_unique<os::Alarm>(module_handler_);
+    LOG_INFO(
+        "Multiplexing up to %zu advertising sets on advertising set %d, slot %d ms",
+        max_multiplexed_sets_,
+        multiplex_handle_,
+        (int)multiplex_slot_.count());
   }
 
   size_t GetNumberOfAdvertisingInstances() const {
+    if (max_multiplexed_sets_ > 0) {
+      // One controller set is kept for the multiplexed ones
+      return num_instances_ - 1 + max_multiplexed_sets_;
+    }
     return num_instances_;
   }
 
@@ -229,7 +296,7 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
     AdvertiserId id = advertising_api_type_ == AdvertisingApiType::ANDROID_HCI ? 1 : 0;
     {
       std::unique_lock lock(id_mutex_);
-      while (id < num_instances_ && advertising_sets_.count(id) != 0) {
+      while (id < num_instances_ && (advertising_sets_.count(id) != 0 || id == multiplex_handle_)) {
         id++;
       }
       if (id == num_instances_) {
@@ -241,7 +308,35 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
     return id;
   }
 
+  AdvertiserId allocate_multiplexed_advertiser() {
+    std::unique_lock lock(id_mutex_);
+    for (size_t i = 0; i < max_multiplexed_sets_; i++) {
+      AdvertiserId id = num_instances_ + i;
+      if (multiplexed_sets_.count(id) == 0) {
+        multiplexed_sets_.try_emplace(id);
+        return id;
+      }
+    }
+    LOG_WARN("Number of max multiplexed sets %zu reached", max_multiplexed_sets_);
+    return kInvalidId;
+  }
+
+  // Only sets that do not need the controller to keep state across turns can be multiplexed
+  static bool is_multiplexable(const ExtendedAdvertisingConfig& config) {
+    return !config.connectable && !config.directed && config.periodic_data.empty() &&
+           (config.own_address_type == OwnAddressType::PUBLIC_DEVICE_ADDRESS ||
+            config.own_address_type == OwnAddressType::RANDOM_DEVICE_ADDRESS);
+  }
+
+  bool can_multiplex(const ExtendedAdvertisingConfig& config, uint8_t max_extended_advertising_events) const {
+    return max_multiplexed_sets_ > 0 && max_extended_advertising_events == 0 && is_multiplexable(config);
+  }
+
   void remove_advertiser(AdvertiserId advertiser_id) {
+    if (multiplexed_sets_.count(advertiser_id) != 0) {
+      remove_multiplexed_advertiser(advertiser_id);
+      return;
+    }
     stop_advertising(advertiser_id);
     std::unique_lock lock(id_mutex_);
     if (advertising_sets_.count(advertiser_id) == 0) {
@@ -258,7 +353,12 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
       }
     }
     advertising_sets_.erase(advertiser_id);
-    if (advertising_sets_.empty() && address_manager_registered) {
+    controller_sets_.erase(controller_set_key(advertiser_id));
+    unregister_address_manager_if_unused();
+  }
+
+  void unregister_address_manager_if_unused() {
+    if (advertising_sets_.empty() && multiplexed_sets_.empty() && address_manager_registered) {
       le_address_manager_->Unregister(this);
       address_manager_registered = false;
       paused = false;
@@ -368,6 +468,11 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
       uint16_t duration,
       uint8_t max_ext_adv_events,
       os::Handler* handler) {
+    if (multiplexed_sets_.count(id) != 0) {
+      create_multiplexed_advertiser(reg_id, id, config, duration);
+      return;
+    }
+
     id_map_[id] = reg_id;
 
     if (advertising_api_type_ != AdvertisingApiType::EXTENDED) {
@@ -548,6 +653,13 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
   }
 
   void get_own_address(AdvertiserId advertiser_id) {
+    auto multiplexed_set = multiplexed_sets_.find(advertiser_id);
+    if (multiplexed_set != multiplexed_sets_.end()) {
+      auto address = multiplexed_set->second.address;
+      advertising_callbacks_->OnOwnAddressRead(
+          advertiser_id, static_cast<uint8_t>(address.GetAddressType()), address.GetAddress());
+      return;
+    }
     if (advertising_sets_.find(advertiser_id) == advertising_sets_.end()) {
       LOG_INFO("Unknown advertising id %u", advertiser_id);
       return;
@@ -558,41 +670,56 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
   }
 
   void set_parameters(AdvertiserId advertiser_id, ExtendedAdvertisingConfig config) {
+    if (multiplexed_sets_.count(advertiser_id) != 0) {
+      set_multiplexed_parameters(advertiser_id, config);
+      return;
+    }
+
+    // The controller reports the power it selected, which stays current if the parameters are not sent
+    int8_t selected_tx_power = advertising_sets_[advertiser_id].tx_power;
     advertising_sets_[advertiser_id].connectable = config.connectable;
     advertising_sets_[advertiser_id].tx_power = config.tx_power;
     advertising_sets_[advertiser_id].directed = config.directed;
 
     switch (advertising_api_type_) {
       case (AdvertisingApiType::LEGACY): {
+        auto command = hci::LeSetAdvertisingParametersBuilder::Create(
+            config.interval_min,
+            config.interval_max,
+            config.advertising_type,
+            config.own_address_type,
+            config.peer_address_type,
+            config.peer_address,
+            config.channel_map,
+            config.filter_policy);
+        if (skip_unchanged_parameters(advertiser_id, *command, le_physical_channel_tx_power_)) {
+          return;
+        }
         le_advertising_interface_->EnqueueCommand(
-            hci::LeSetAdvertisingParametersBuilder::Create(
-                config.interval_min,
-                config.interval_max,
-                config.advertising_type,
-                config.own_address_type,
-                config.peer_address_type,
-                config.peer_address,
-                config.channel_map,
-                config.filter_policy),
+            std::move(command),
             module_handler_->BindOnceOn(
                 this, &impl::check_status_with_id<LeSetAdvertisingParametersCompleteView>, advertiser_id));
       } break;
       case (AdvertisingApiType::ANDROID_HCI): {
         auto own_address_type =
             static_cast<OwnAddressType>(advertising_sets_[advertiser_id].current_address.GetAddressType());
+        auto command = hci::LeMultiAdvtParamBuilder::Create(
+            config.interval_min,
+            config.interval_max,
+            config.advertising_type,
+            own_address_type,
+            advertising_sets_[advertiser_id].current_address.GetAddress(),
+            config.peer_address_type,
+            config.peer_address,
+            config.channel_map,
+            config.filter_policy,
+            advertiser_id,
+            config.tx_power);
+        if (skip_unchanged_parameters(advertiser_id, *command, le_physical_channel_tx_power_)) {
+          return;
+        }
         le_advertising_interface_->EnqueueCommand(
-            hci::LeMultiAdvtParamBuilder::Create(
-                config.interval_min,
-                config.interval_max,
-                config.advertising_type,
-                own_address_type,
-                advertising_sets_[advertiser_id].current_address.GetAddress(),
-                config.peer_address_type,
-                config.peer_address,
-                config.channel_map,
-                config.filter_policy,
-                advertiser_id,
-                config.tx_power),
+            std::move(command),
             module_handler_->BindOnceOn(this, &impl::check_status_with_id<LeMultiAdvtCompleteView>, advertiser_id));
       } break;
       case (AdvertisingApiType::EXTENDED): {
@@ -616,20 +743,25 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
             legacy_properties = LegacyAdvertisingEventProperties::ADV_NONCONN_IND;
           }
 
+          auto command = LeSetExtendedAdvertisingParametersLegacyBuilder::Create(
+              advertiser_id,
+              legacy_properties,
+              config.interval_min,
+              config.interval_max,
+              config.channel_map,
+              config.own_address_type,
+              config.peer_address_type,
+              config.peer_address,
+              config.filter_policy,
+              config.tx_power,
+              config.sid,
+              config.enable_scan_request_notifications);
+          if (skip_unchanged_parameters(advertiser_id, *command, selected_tx_power)) {
+            advertising_sets_[advertiser_id].tx_power = selected_tx_power;
+            return;
+          }
           le_advertising_interface_->EnqueueCommand(
-              LeSetExtendedAdvertisingParametersLegacyBuilder::Create(
-                  advertiser_id,
-                  legacy_properties,
-                  config.interval_min,
-                  config.interval_max,
-                  config.channel_map,
-                  config.own_address_type,
-                  config.peer_address_type,
-                  config.peer_address,
-                  config.filter_policy,
-                  config.tx_power,
-                  config.sid,
-                  config.enable_scan_request_notifications),
+              std::move(command),
               module_handler_->BindOnceOn(
                   this,
                   &impl::on_set_extended_advertising_parameters_complete<
@@ -645,23 +777,28 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
           extended_properties.anonymous_ = config.anonymous;
           extended_properties.tx_power_ = config.include_tx_power;
 
+          auto command = hci::LeSetExtendedAdvertisingParametersBuilder::Create(
+              advertiser_id,
+              extended_properties,
+              config.interval_min,
+              config.interval_max,
+              config.channel_map,
+              config.own_address_type,
+              config.peer_address_type,
+              config.peer_address,
+              config.filter_policy,
+              config.tx_power,
+              (config.use_le_coded_phy ? PrimaryPhyType::LE_CODED : PrimaryPhyType::LE_1M),
+              config.secondary_max_skip,
+              config.secondary_advertising_phy,
+              config.sid,
+              config.enable_scan_request_notifications);
+          if (skip_unchanged_parameters(advertiser_id, *command, selected_tx_power)) {
+            advertising_sets_[advertiser_id].tx_power = selected_tx_power;
+            return;
+          }
           le_advertising_interface_->EnqueueCommand(
-              hci::LeSetExtendedAdvertisingParametersBuilder::Create(
-                  advertiser_id,
-                  extended_properties,
-                  config.interval_min,
-                  config.interval_max,
-                  config.channel_map,
-                  config.own_address_type,
-                  config.peer_address_type,
-                  config.peer_address,
-                  config.filter_policy,
-                  config.tx_power,
-                  (config.use_le_coded_phy ? PrimaryPhyType::LE_CODED : PrimaryPhyType::LE_1M),
-                  config.secondary_max_skip,
-                  config.secondary_advertising_phy,
-                  config.sid,
-                  config.enable_scan_request_notifications),
+              std::move(command),
               module_handler_->BindOnceOn(
                   this,
                   &impl::on_set_extended_advertising_parameters_complete<
@@ -672,6 +809,58 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
     }
   }
 
+  // Controller sets are keyed by advertiser id, except with the legacy commands which all share the one set
+  uint8_t controller_set_key(AdvertiserId advertiser_id) const {
+    return advertising_api_type_ == AdvertisingApiType::LEGACY ? 0 : advertiser_id;
+  }
+
+  bool reports_to_callbacks(AdvertiserId advertiser_id) {
+    return advertising_callbacks_ != nullptr && advertising_sets_[advertiser_id].started &&
+           id_map_[advertiser_id] != kIdLocal;
+  }
+
+  // Returns true, after reporting the update as done, when the controller set already has these parameters
+  bool skip_unchanged_parameters(AdvertiserId advertiser_id, const CommandBuilder& command, int8_t tx_power) {
+    std::vector<uint8_t> bytes;
+    packet::BitInserter inserter(bytes);
+    command.Serialize(inserter);
+    auto& parameters = controller_sets_[controller_set_key(advertiser_id)].parameters;
+    if (parameters != bytes) {
+      parameters = std::move(bytes);
+      return false;
+    }
+    LOG_VERBOSE("Parameters of advertising set %d unchanged", advertiser_id);
+    if (reports_to_callbacks(advertiser_id)) {
+      advertising_callbacks_->OnAdvertisingParametersUpdated(
+          advertiser_id, tx_power, AdvertisingCallback::AdvertisingStatus::SUCCESS);
+    }
+    return true;
+  }
+
+  // Returns true, after reporting the update as done, when the controller set already has this data
+  bool skip_unchanged_data(AdvertiserId advertiser_id, bool set_scan_rsp, const std::vector<GapData>& data) {
+    std::vector<uint8_t> bytes;
+    packet::BitInserter inserter(bytes);
+    for (const auto& gap_data : data) {
+      gap_data.Serialize(inserter);
+    }
+    auto& state = controller_sets_[controller_set_key(advertiser_id)];
+    auto& current = set_scan_rsp ? state.scan_response_data : state.advertising_data;
+    if (current != bytes) {
+      current = std::move(bytes);
+      return false;
+    }
+    LOG_VERBOSE("%s of advertising set %d unchanged", set_scan_rsp ? "Scan response" : "Data", advertiser_id);
+    if (reports_to_callbacks(advertiser_id)) {
+      if (set_scan_rsp) {
+        advertising_callbacks_->OnScanResponseDataSet(advertiser_id, AdvertisingCallback::AdvertisingStatus::SUCCESS);
+      } else {
+        advertising_callbacks_->OnAdvertisingDataSet(advertiser_id, AdvertisingCallback::AdvertisingStatus::SUCCESS);
+      }
+    }
+    return true;
+  }
+
   bool data_has_flags(std::vector<GapData> data) {
     for (auto& gap_data : data) {
       if (gap_data.data_type_ == GapDataType::FLAGS) {
@@ -732,6 +921,11 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
   };
 
   void set_data(AdvertiserId advertiser_id, bool set_scan_rsp, std::vector<GapData> data) {
+    if (multiplexed_sets_.count(advertiser_id) != 0) {
+      set_multiplexed_data(advertiser_id, set_scan_rsp, data);
+      return;
+    }
+
     // The Flags data type shall be included when any of the Flag bits are non-zero and the advertising packet
     // is connectable.
     if (!set_scan_rsp && advertising_sets_[advertiser_id].connectable && !data_has_flags(data)) {
@@ -764,6 +958,11 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
       return;
     }
 
+    if (advertising_api_type_ != AdvertisingApiType::EXTENDED &&
+        skip_unchanged_data(advertiser_id, set_scan_rsp, data)) {
+      return;
+    }
+
     switch (advertising_api_type_) {
       case (AdvertisingApiType::LEGACY): {
         if (set_scan_rsp) {
@@ -825,6 +1024,10 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
           return;
         }
 
+        if (skip_unchanged_data(advertiser_id, set_scan_rsp, data)) {
+          return;
+        }
+
         if (data_len <= kLeMaximumFragmentLength) {
           send_data_fragment(advertiser_id, set_scan_rsp, data, Operation::COMPLETE_ADVERTISEMENT);
         } else {
@@ -878,6 +1081,11 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
 
   void enable_advertiser(
       AdvertiserId advertiser_id, bool enable, uint16_t duration, uint8_t max_extended_advertising_events) {
+    if (multiplexed_sets_.count(advertiser_id) != 0) {
+      enable_multiplexed_advertiser(advertiser_id, enable, duration, max_extended_advertising_events);
+      return;
+    }
+
     EnabledSet curr_set;
     curr_set.advertising_handle_ = advertiser_id;
     curr_set.duration_ = duration;
@@ -927,6 +1135,11 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
 
   void set_periodic_parameter(
       AdvertiserId advertiser_id, PeriodicAdvertisingParameters periodic_advertising_parameters) {
+    if (multiplexed_sets_.count(advertiser_id) != 0) {
+      advertising_callbacks_->OnPeriodicAdvertisingParametersUpdated(
+          advertiser_id, AdvertisingCallback::AdvertisingStatus::FEATURE_UNSUPPORTED);
+      return;
+    }
     uint8_t include_tx_power = periodic_advertising_parameters.properties >>
                                PeriodicAdvertisingParameters::AdvertisingProperty::INCLUDE_TX_POWER;
 
@@ -941,6 +1154,11 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
   }
 
   void set_periodic_data(AdvertiserId advertiser_id, std::vector<GapData> data) {
+    if (multiplexed_sets_.count(advertiser_id) != 0) {
+      advertising_callbacks_->OnPeriodicAdvertisingDataSet(
+          advertiser_id, AdvertisingCallback::AdvertisingStatus::FEATURE_UNSUPPORTED);
+      return;
+    }
     uint16_t data_len = 0;
     // check data size
     for (size_t i = 0; i < data.size(); i++) {
@@ -1001,6 +1219,11 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
   }
 
   void enable_periodic_advertising(AdvertiserId advertiser_id, bool enable) {
+    if (multiplexed_sets_.count(advertiser_id) != 0) {
+      advertising_callbacks_->OnPeriodicAdvertisingEnabled(
+          advertiser_id, enable, AdvertisingCallback::AdvertisingStatus::FEATURE_UNSUPPORTED);
+      return;
+    }
     Enable enable_value = enable ? Enable::ENABLED : Enable::DISABLED;
 
     le_advertising_interface_->EnqueueCommand(
@@ -1104,6 +1327,252 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
         rotate_advertiser_address(i);
       }
     }
+    // Multiplexed sets take a new address on their next turn
+    for (auto& [id, set] : multiplexed_sets_) {
+      if (set.config.own_address_type == OwnAddressType::RANDOM_DEVICE_ADDRESS) {
+        set.address_expiry = std::chrono::steady_clock::time_point::min();
+      }
+    }
+  }
+
+  void create_multiplexed_advertiser(
+      int reg_id, AdvertiserId id, const ExtendedAdvertisingConfig config, uint16_t duration) {
+    if (!check_extended_advertising_data(config.advertisement, false) ||
+        !check_extended_advertising_data(config.scan_response, false)) {
+      advertising_callbacks_->OnAdvertisingSetStarted(
+          reg_id, id, le_physical_channel_tx_power_, AdvertisingCallback::AdvertisingStatus::DATA_TOO_LARGE);
+      return;
+    }
+
+    if (!address_manager_registered) {
+      le_address_manager_->Register(this);
+      address_manager_registered = true;
+    }
+
+    auto& set = multiplexed_sets_[id];
+    set.reg_id = reg_id;
+    set.config = config;
+    refresh_multiplexed_address(set);
+    set.enabled = true;
+    schedule_multiplexed_timeout(id, duration);
+    advertising_callbacks_->OnAdvertisingSetStarted(
+        reg_id, id, config.tx_power, AdvertisingCallback::AdvertisingStatus::SUCCESS);
+    multiplex_update();
+  }
+
+  void remove_multiplexed_advertiser(AdvertiserId id) {
+    {
+      std::unique_lock lock(id_mutex_);
+      multiplexed_sets_.erase(id);
+    }
+    multiplex_update();
+    unregister_address_manager_if_unused();
+  }
+
+  void set_multiplexed_parameters(AdvertiserId id, ExtendedAdvertisingConfig config) {
+    auto& set = multiplexed_sets_[id];
+    if (!is_multiplexable(config)) {
+      LOG_WARN("Advertising set %d is multiplexed and can not use these parameters", id);
+      advertising_callbacks_->OnAdvertisingParametersUpdated(
+          id, set.config.tx_power, AdvertisingCallback::AdvertisingStatus::INTERNAL_ERROR);
+      return;
+    }
+
+    config.advertisement = set.config.advertisement;
+    config.scan_response = set.config.scan_response;
+    bool address_type_changed = config.own_address_type != set.config.own_address_type;
+    set.config = config;
+    if (address_type_changed) {
+      refresh_multiplexed_address(set);
+    }
+    if (multiplexed_on_air_ == id) {
+      load_multiplexed_set(id);
+    }
+    advertising_callbacks_->OnAdvertisingParametersUpdated(
+        id, config.tx_power, AdvertisingCallback::AdvertisingStatus::SUCCESS);
+  }
+
+  void set_multiplexed_data(AdvertiserId id, bool set_scan_rsp, std::vector<GapData> data) {
+    auto& set = multiplexed_sets_[id];
+    auto status = AdvertisingCallback::AdvertisingStatus::SUCCESS;
+    if (!check_extended_advertising_data(data, false)) {
+      status = AdvertisingCallback::AdvertisingStatus::DATA_TOO_LARGE;
+    } else {
+      if (set_scan_rsp) {
+        set.config.scan_response = data;
+      } else {
+        set.config.advertisement = data;
+      }
+      if (multiplexed_on_air_ == id) {
+        set_data(multiplex_handle_, set_scan_rsp, data);
+      }
+    }
+
+    if (set_scan_rsp) {
+      advertising_callbacks_->OnScanResponseDataSet(id, status);
+    } else {
+      advertising_callbacks_->OnAdvertisingDataSet(id, status);
+    }
+  }
+
+  void enable_multiplexed_advertiser(
+      AdvertiserId id, bool enable, uint16_t duration, uint8_t max_extended_advertising_events) {
+    if (enable && max_extended_advertising_events != 0) {
+      LOG_WARN("Advertising set %d is multiplexed and can not be limited in advertising events", id);
+      advertising_callbacks_->OnAdvertisingEnabled(id, enable, AdvertisingCallback::AdvertisingStatus::INTERNAL_ERROR);
+      return;
+    }
+    multiplexed_sets_[id].enabled = enable;
+    schedule_multiplexed_timeout(id, enable ? duration : 0);
+    advertising_callbacks_->OnAdvertisingEnabled(id, enable, AdvertisingCallback::AdvertisingStatus::SUCCESS);
+    multiplex_update();
+  }
+
+  // The controller set is shared, so the duration of a multiplexed set, in units of 10 ms, is kept by the host
+  void schedule_multiplexed_timeout(AdvertiserId id, uint16_t duration) {
+    auto& set = multiplexed_sets_[id];
+    if (set.timeout_alarm != nullptr) {
+      set.timeout_alarm->Cancel();
+    }
+    if (duration == 0) {
+      return;
+    }
+    if (set.timeout_alarm == nullptr) {
+      set.timeout_alarm = std::make_unique<os::Alarm>(module_handler_);
+    }
+    set.timeout_alarm->Schedule(
+        common::BindOnce(&impl::on_multiplexed_timeout, common::Unretained(this), id),
+        std::chrono::milliseconds(duration * 10));
+  }
+
+  void on_multiplexed_timeout(AdvertiserId id) {
+    auto set = multiplexed_sets_.find(id);
+    if (set == multiplexed_sets_.end() || !set->second.enabled) {
+      return;
+    }
+    set->second.enabled = false;
+    advertising_callbacks_->OnAdvertisingEnabled(id, false, static_cast<uint8_t>(ErrorCode::ADVERTISING_TIMEOUT));
+    multiplex_update();
+  }
+
+  void refresh_multiplexed_address(MultiplexedSet& set) {
+    set.address_expiry = std::chrono::steady_clock::time_point::max();
+    if (set.config.own_address_type == OwnAddressType::PUBLIC_DEVICE_ADDRESS) {
+      set.address = AddressWithType(controller_->GetMacAddress(), AddressType::PUBLIC_DEVICE_ADDRESS);
+      return;
+    }
+    auto address_policy = le_address_manager_->GetAddressPolicy();
+    if (address_policy == LeAddressManager::AddressPolicy::USE_NON_RESOLVABLE_ADDRESS ||
+        address_policy == LeAddressManager::AddressPolicy::USE_RESOLVABLE_ADDRESS) {
+      set.address = le_address_manager_->GetAnotherAddress();
+      set.address_expiry = std::chrono::steady_clock::now() + le_address_manager_->GetNextPrivateAddressIntervalMs();
+    } else {
+      set.address = le_address_manager_->GetCurrentAddress();
+    }
+  }
+
+  size_t num_enabled_multiplexed_sets() const {
+    return std::count_if(
+        multiplexed_sets_.begin(), multiplexed_sets_.end(), [](const auto& entry) { return entry.second.enabled; });
+  }
+
+  // Called whenever the multiplexed sets change, to keep the one on air and the turns consistent with them
+  void multiplex_update() {
+    auto on_air = multiplexed_sets_.find(multiplexed_on_air_);
+    if (on_air == multiplexed_sets_.end() || !on_air->second.enabled) {
+      multiplex_next_set();
+    } else {
+      schedule_multiplex_turn();
+    }
+  }
+
+  // Gives the controller set to the next enabled multiplexed set, round robin
+  void multiplex_next_set() {
+    auto is_enabled = [](const auto& entry) { return entry.second.enabled; };
+    auto next = std::find_if(multiplexed_sets_.upper_bound(multiplexed_on_air_), multiplexed_sets_.end(), is_enabled);
+    if (next == multiplexed_sets_.end()) {
+      next = std::find_if(multiplexed_sets_.begin(), multiplexed_sets_.end(), is_enabled);
+    }
+    if (next == multiplexed_sets_.end()) {
+      stop_multiplexing();
+      return;
+    }
+    if (next->first != multiplexed_on_air_ || std::chrono::steady_clock::now() >= next->second.address_expiry) {
+      load_multiplexed_set(next->first);
+    }
+    schedule_multiplex_turn();
+  }
+
+  void schedule_multiplex_turn() {
+    multiplex_alarm_->Cancel();
+    const auto& set = multiplexed_sets_[multiplexed_on_air_];
+    std::chrono::milliseconds delay =
+        set.config.multiplex_slot_ms != 0 ? std::chrono::milliseconds(set.config.multiplex_slot_ms) : multiplex_slot_;
+    if (num_enabled_multiplexed_sets() < 2) {
+      if (set.address_expiry == std::chrono::steady_clock::time_point::max()) {
+        return;
+      }
+      // Alone on air, the set only needs another turn to take a new address
+      delay = std::max(
+          delay,
+          std::chrono::duration_cast<std::chrono::milliseconds>(set.address_expiry - std::chrono::steady_clock::now()));
+    }
+    multiplex_alarm_->Schedule(common::BindOnce(&impl::multiplex_next_set, common::Unretained(this)), delay);
+  }
+
+  // Loads the parameters, address and data of a multiplexed set into the controller set kept for them. Whatever
+  // the controller set already has is not sent again.
+  void load_multiplexed_set(AdvertiserId id) {
+    const AdvertiserId handle = multiplex_handle_;
+    auto& set = multiplexed_sets_[id];
+    if (multiplexed_on_air_ == kInvalidId) {
+      std::unique_lock lock(id_mutex_);
+      advertising_sets_[handle].in_use = true;
+      id_map_[handle] = kIdLocal;
+    } else if (!paused) {
+      enable_advertiser(handle, false, 0, 0);
+    }
+    multiplexed_on_air_ = id;
+
+    set_parameters(handle, set.config);
+
+    if (std::chrono::steady_clock::now() >= set.address_expiry) {
+      refresh_multiplexed_address(set);
+    }
+    if (set.config.own_address_type == OwnAddressType::RANDOM_DEVICE_ADDRESS) {
+      if (advertising_sets_[handle].current_address != set.address) {
+        le_advertising_interface_->EnqueueCommand(
+            hci::LeSetAdvertisingSetRandomAddressBuilder::Create(handle, set.address.GetAddress()),
+            module_handler_->BindOnceOn(
+                this,
+                &impl::on_set_advertising_set_random_address_complete<LeSetAdvertisingSetRandomAddressCompleteView>,
+                handle,
+                set.address));
+      }
+    } else {
+      advertising_sets_[handle].current_address = set.address;
+    }
+
+    if (set.config.advertising_type == AdvertisingType::ADV_IND ||
+        set.config.advertising_type == AdvertisingType::ADV_NONCONN_IND) {
+      set_data(handle, true, set.config.scan_response);
+    }
+    set_data(handle, false, set.config.advertisement);
+
+    if (!paused) {
+      enable_advertiser(handle, true, 0, 0);
+    } else {
+      enabled_sets_[handle].advertising_handle_ = handle;
+    }
+  }
+
+  void stop_multiplexing() {
+    multiplex_alarm_->Cancel();
+    if (multiplexed_on_air_ == kInvalidId) {
+      return;
+    }
+    multiplexed_on_air_ = kInvalidId;
+    remove_advertiser(multiplex_handle_);
   }
 
   common::Callback<void(Address, AddressType)> scan_callback_;
@@ -1128,6 +1597,16 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
   std::vector<hci::EnabledSet> enabled_sets_;
   // map to mapping the id from java layer and advertier id
   std::map<uint8_t, int> id_map_;
+  // What each controller set was last given, see controller_set_key()
+  std::map<uint8_t, ControllerSetState> controller_sets_;
+
+  // Sets advertised in turns on the controller set multiplex_handle_, by id
+  std::map<AdvertiserId, MultiplexedSet> multiplexed_sets_;
+  size_t max_multiplexed_sets_ = 0;
+  AdvertiserId multiplex_handle_ = kInvalidId;
+  AdvertiserId multiplexed_on_air_ = kInvalidId;
+  std::chrono::milliseconds multiplex_slot_ = kDefaultMultiplexSlot;
+  std::unique_ptr<os::Alarm> multiplex_alarm_;
 
   AdvertisingApiType advertising_api_type_{0};
 
@@ -1237,6 +1716,7 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
     if (complete_view.GetStatus() != ErrorCode::SUCCESS) {
       LOG_INFO("Got a command complete with status %s", ErrorCodeText(complete_view.GetStatus()).c_str());
       advertising_status = AdvertisingCallback::AdvertisingStatus::INTERNAL_ERROR;
+      controller_sets_.erase(controller_set_key(id));
     }
     advertising_sets_[id].tx_power = complete_view.GetSelectedTxPower();
 
@@ -1295,6 +1775,8 @@ struct LeAdvertisingManager::impl : public bluetooth::hci::LeAddressManagerCallb
     if (status_view.GetStatus() != ErrorCode::SUCCESS) {
       LOG_INFO("Got a command complete with status %s", ErrorCodeText(status_view.GetStatus()).c_str());
       advertising_status = AdvertisingCallback::AdvertisingStatus::INTERNAL_ERROR;
+      // Not knowing what the controller set has, send the next update whatever it is
+      controller_sets_.erase(controller_set_key(id));
     }
 
     // Do not trigger callback if the advertiser not stated yet, or the advertiser is not register
@@ -1483,6 +1965,9 @@ AdvertiserId LeAdvertisingManager::ExtendedCreateAdvertiser(
     return kInvalidId;
   }
   AdvertiserId id = pimpl_->allocate_advertiser();
+  if (id == kInvalidId && pimpl_->can_multiplex(config, max_extended_advertising_events)) {
+    id = pimpl_->allocate_multiplexed_advertiser();
+  }
   if (id == kInvalidId) {
     LOG_WARN("Number of max instances reached");
     CallOn(
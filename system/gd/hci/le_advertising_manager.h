@@ -64,6 +64,8 @@ class ExtendedAdvertisingConfig : public AdvertisingConfig {
   Enable enable_scan_request_notifications = Enable::DISABLED;
   std::vector<GapData> periodic_data;
   PeriodicAdvertisingParameters periodic_advertising_parameters;
+  // Time on air per turn when the set shares a controller advertising set with others, 0 for the default
+  uint16_t multiplex_slot_ms = 0;
   ExtendedAdvertisingConfig() = default;
   ExtendedAdvertisingConfig(const AdvertisingConfig& config);
 };
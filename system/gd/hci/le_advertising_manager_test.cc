@@ -29,6 +29,7 @@
 #include "hci/address.h"
 #include "hci/controller.h"
 #include "hci/hci_layer.h"
+#include "os/system_properties.h"
 #include "os/thread.h"
 #include "packet/raw_builder.h"
 
@@ -119,6 +120,11 @@ class TestHciLayer : public HciLayer {
     }
   }
 
+  bool IsCommandQueueEmpty() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return command_queue_.empty();
+  }
+
   // Set command future for 'num_command' commands are expected
   void SetCommandFuture(uint16_t num_command) {
     ASSERT_TRUE(command_promise_ == nullptr) << "Promises, Promises, ... Only one at a time.";
@@ -587,6 +593,58 @@ class LeExtendedAdvertisingAPITest : public LeExtendedAdvertisingManagerTest {
   AdvertiserId advertiser_id_;
 };
 
+class LeExtendedAdvertisingMultiplexTest : public LeExtendedAdvertisingManagerTest {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(os::SetSystemProperty(kMultiplexedSetsProperty, "2"));
+    num_instances_ = 0x02;
+    LeExtendedAdvertisingManagerTest::SetUp();
+  }
+
+  void TearDown() override {
+    LeExtendedAdvertisingManagerTest::TearDown();
+    os::SetSystemProperty(kMultiplexedSetsProperty, "0");
+  }
+
+  ExtendedAdvertisingConfig beacon_config(uint8_t beacon) {
+    ExtendedAdvertisingConfig advertising_config{};
+    advertising_config.advertising_type = AdvertisingType::ADV_NONCONN_IND;
+    advertising_config.own_address_type = OwnAddressType::PUBLIC_DEVICE_ADDRESS;
+    GapData data_item{};
+    data_item.data_type_ = GapDataType::MANUFACTURER_SPECIFIC_DATA;
+    data_item.data_ = {0xe0, 0x00, beacon};
+    advertising_config.advertisement = {data_item};
+    advertising_config.channel_map = 1;
+    advertising_config.tx_power = 0x08;
+    advertising_config.multiplex_slot_ms = 50;
+    return advertising_config;
+  }
+
+  void complete_commands(std::vector<OpCode> opcodes) {
+    std::vector<uint8_t> success_vector{static_cast<uint8_t>(ErrorCode::SUCCESS)};
+    for (size_t i = 0; i < opcodes.size(); i++) {
+      auto command = test_hci_layer_->GetCommand();
+      ASSERT_EQ(opcodes[i], command.GetOpCode());
+      if (opcodes[i] == OpCode::LE_SET_EXTENDED_ADVERTISING_PARAMETERS) {
+        test_hci_layer_->IncomingEvent(
+            LeSetExtendedAdvertisingParametersCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS, 0x08));
+      } else {
+        if (opcodes[i] == OpCode::LE_SET_EXTENDED_ADVERTISING_ENABLE) {
+          auto enable_view = LeSetExtendedAdvertisingEnableView::Create(LeAdvertisingCommandView::Create(command));
+          ASSERT_TRUE(enable_view.IsValid());
+          ASSERT_EQ(multiplex_handle_, enable_view.GetEnabledSets()[0].advertising_handle_);
+        }
+        test_hci_layer_->IncomingEvent(
+            CommandCompleteBuilder::Create(uint8_t{1}, opcodes[i], std::make_unique<RawBuilder>(success_vector)));
+      }
+    }
+  }
+
+  static constexpr char kMultiplexedSetsProperty[] = "bluetooth.core.le.advertising_multiplexed_sets";
+  // The last controller set is kept for the multiplexed sets
+  const uint8_t multiplex_handle_ = 0x01;
+};
+
 TEST_F(LeAdvertisingManagerTest, startup_teardown) {}
 
 TEST_F(LeAndroidHciAdvertisingManagerTest, startup_teardown) {}
@@ -755,6 +813,8 @@ TEST_F(LeAdvertisingAPITest, set_parameter) {
   gap_data.push_back(data_item);
   advertising_config.advertisement = gap_data;
   advertising_config.channel_map = 1;
+  advertising_config.interval_min = 0x0800;
+  advertising_config.interval_max = 0x0800;
   test_hci_layer_->SetCommandFuture(1);
   le_advertising_manager_->SetParameters(advertiser_id_, advertising_config);
   ASSERT_EQ(OpCode::LE_SET_ADVERTISING_PARAMETERS, test_hci_layer_->GetCommand().GetOpCode());
@@ -775,6 +835,8 @@ TEST_F(LeAndroidHciAdvertisingAPITest, set_parameter) {
   gap_data.push_back(data_item);
   advertising_config.advertisement = gap_data;
   advertising_config.channel_map = 1;
+  advertising_config.interval_min = 0x0800;
+  advertising_config.interval_max = 0x0800;
   test_hci_layer_->SetCommandFuture(1);
   le_advertising_manager_->SetParameters(advertiser_id_, advertising_config);
   auto packet = test_hci_layer_->GetCommand();
@@ -810,6 +872,21 @@ TEST_F(LeExtendedAdvertisingAPITest, set_parameter) {
       LeSetExtendedAdvertisingParametersCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS, 0x08));
 }
 
+TEST_F(LeExtendedAdvertisingAPITest, set_unchanged_parameter) {
+  // Same parameters as the advertising set was started with
+  ExtendedAdvertisingConfig advertising_config{};
+  advertising_config.advertising_type = AdvertisingType::ADV_IND;
+  advertising_config.own_address_type = OwnAddressType::PUBLIC_DEVICE_ADDRESS;
+  advertising_config.channel_map = 1;
+  advertising_config.sid = 0x01;
+  EXPECT_CALL(
+      mock_advertising_callback_,
+      OnAdvertisingParametersUpdated(advertiser_id_, -23, AdvertisingCallback::AdvertisingStatus::SUCCESS));
+  le_advertising_manager_->SetParameters(advertiser_id_, advertising_config);
+  fake_registry_.SynchronizeModuleHandler(&LeAdvertisingManager::Factory, std::chrono::milliseconds(20));
+  ASSERT_TRUE(test_hci_layer_->IsCommandQueueEmpty());
+}
+
 TEST_F(LeAdvertisingAPITest, set_data_test) {
   // Set advertising data
   std::vector<GapData> advertising_data{};
@@ -870,6 +947,28 @@ TEST_F(LeExtendedAdvertisingAPITest, set_data_test) {
   test_hci_layer_->IncomingEvent(LeSetExtendedScanResponseDataCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
 }
 
+TEST_F(LeExtendedAdvertisingAPITest, set_unchanged_data_test) {
+  // Same data as the advertising set was started with
+  std::vector<GapData> gap_data{};
+  GapData data_item{};
+  data_item.data_type_ = GapDataType::FLAGS;
+  data_item.data_ = {0x34};
+  gap_data.push_back(data_item);
+  data_item.data_type_ = GapDataType::COMPLETE_LOCAL_NAME;
+  data_item.data_ = {'r', 'a', 'n', 'd', 'o', 'm', ' ', 'd', 'e', 'v', 'i', 'c', 'e'};
+  gap_data.push_back(data_item);
+  EXPECT_CALL(
+      mock_advertising_callback_,
+      OnAdvertisingDataSet(advertiser_id_, AdvertisingCallback::AdvertisingStatus::SUCCESS));
+  le_advertising_manager_->SetData(advertiser_id_, false, gap_data);
+  EXPECT_CALL(
+      mock_advertising_callback_,
+      OnScanResponseDataSet(advertiser_id_, AdvertisingCallback::AdvertisingStatus::SUCCESS));
+  le_advertising_manager_->SetData(advertiser_id_, true, gap_data);
+  fake_registry_.SynchronizeModuleHandler(&LeAdvertisingManager::Factory, std::chrono::milliseconds(20));
+  ASSERT_TRUE(test_hci_layer_->IsCommandQueueEmpty());
+}
+
 TEST_F(LeAndroidHciAdvertisingAPITest, set_data_test) {
   // Set advertising data
   std::vector<GapData> advertising_data{};
@@ -1196,6 +1295,58 @@ TEST_F(LeExtendedAdvertisingAPITest, set_perodic_data_with_invalid_length) {
   sync_client_handler();
 }
 
+TEST_F(LeExtendedAdvertisingMultiplexTest, multiplex_advertisers_test) {
+  // One controller set is left, the other is shared by two multiplexed sets
+  ASSERT_EQ(3u, le_advertising_manager_->GetNumberOfAdvertisingInstances());
+  le_advertising_manager_->RegisterAdvertiser(common::Bind([](uint8_t inst_id, uint8_t status) {
+    ASSERT_EQ(0x00, inst_id);
+    ASSERT_EQ(AdvertisingCallback::AdvertisingStatus::SUCCESS, status);
+  }));
+
+  // The first multiplexed set gets the controller set to itself
+  EXPECT_CALL(
+      mock_advertising_callback_,
+      OnAdvertisingSetStarted(0x01, 0x02, 0x08, AdvertisingCallback::AdvertisingStatus::SUCCESS));
+  test_hci_layer_->SetCommandFuture(4);
+  auto first_id = le_advertising_manager_->ExtendedCreateAdvertiser(
+      0x01, beacon_config(1), scan_callback, set_terminated_callback, 0, 0, client_handler_);
+  ASSERT_EQ(0x02, first_id);
+  complete_commands({
+      OpCode::LE_SET_EXTENDED_ADVERTISING_PARAMETERS,
+      OpCode::LE_SET_EXTENDED_SCAN_RESPONSE_DATA,
+      OpCode::LE_SET_EXTENDED_ADVERTISING_DATA,
+      OpCode::LE_SET_EXTENDED_ADVERTISING_ENABLE,
+  });
+  sync_client_handler();
+
+  // The second one takes its turn once the slot of the first one is over. Only its advertising data differs from
+  // what the controller set has.
+  EXPECT_CALL(
+      mock_advertising_callback_,
+      OnAdvertisingSetStarted(0x02, 0x03, 0x08, AdvertisingCallback::AdvertisingStatus::SUCCESS));
+  test_hci_layer_->SetCommandFuture(3);
+  auto second_id = le_advertising_manager_->ExtendedCreateAdvertiser(
+      0x02, beacon_config(2), scan_callback, set_terminated_callback, 0, 0, client_handler_);
+  ASSERT_EQ(0x03, second_id);
+  complete_commands({
+      OpCode::LE_SET_EXTENDED_ADVERTISING_ENABLE,
+      OpCode::LE_SET_EXTENDED_ADVERTISING_DATA,
+      OpCode::LE_SET_EXTENDED_ADVERTISING_ENABLE,
+  });
+  sync_client_handler();
+
+  // No set is left to multiplex with
+  EXPECT_CALL(
+      mock_advertising_callback_,
+      OnAdvertisingSetStarted(
+          0x03, LeAdvertisingManager::kInvalidId, 0, AdvertisingCallback::AdvertisingStatus::TOO_MANY_ADVERTISERS));
+  ASSERT_EQ(
+      LeAdvertisingManager::kInvalidId,
+      le_advertising_manager_->ExtendedCreateAdvertiser(
+          0x03, beacon_config(3), scan_callback, set_terminated_callback, 0, 0, client_handler_));
+  fake_registry_.SynchronizeModuleHandler(&LeAdvertisingManager::Factory, std::chrono::milliseconds(20));
+}
+
 TEST_F(LeExtendedAdvertisingAPITest, disable_enable_periodic_advertiser_test) {
   // disable advertiser
   test_hci_layer_->SetCommandFuture(1);
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "hci/le_host_batch_scan_storage.h"
+
+#include <algorithm>
+
+#include "os/log.h"
+
+namespace bluetooth {
+namespace hci {
+
+namespace {
+
+constexpr size_t kRssiOffset = 8;
+constexpr size_t kTimestampOffset = 9;
+constexpr uint64_t kTimestampUnitMs = 50;
+// The advertising data and scan response of a full record are each read as a signed length
+constexpr size_t kMaxPacketSize = 0x7F;
+
+}  // namespace
+
+LeHostBatchScanStorage::LeHostBatchScanStorage(size_t capacity) : capacity_(capacity) {}
+
+void LeHostBatchScanStorage::SetStorageParameters(
+    uint8_t full_max_percent, uint8_t truncated_max_percent, uint8_t notify_threshold_percent) {
+  full_max_percent = std::min<uint8_t>(full_max_percent, 100);
+  truncated_max_percent = std::min<uint8_t>(truncated_max_percent, 100 - full_max_percent);
+  full_.SetCapacity(capacity_ * full_max_percent / 100);
+  truncated_.SetCapacity(capacity_ * truncated_max_percent / 100);
+  notify_threshold_ = capacity_ * std::min<uint8_t>(notify_threshold_percent, 100) / 100;
+  threshold_crossed_ = notify_threshold_ != 0 && GetStoredBytes() >= notify_threshold_;
+}
+
+void LeHostBatchScanStorage::SetScanMode(BatchScanMode scan_mode, BatchScanDiscardRule discard_rule) {
+  scan_mode_ = scan_mode;
+  discard_rule_ = discard_rule;
+}
+
+bool LeHostBatchScanStorage::Add(
+    const Address& address,
+    uint8_t address_type,
+    int8_t tx_power,
+    int8_t rssi,
+    const std::vector<uint8_t>& advertising_data,
+    uint64_t now_ms) {
+  bool is_truncated = scan_mode_ == BatchScanMode::TRUNCATED || scan_mode_ == BatchScanMode::TRUNCATED_AND_FULL;
+  bool is_full = scan_mode_ == BatchScanMode::FULL || scan_mode_ == BatchScanMode::TRUNCATED_AND_FULL;
+  if (!is_truncated && !is_full) {
+    return false;
+  }
+
+  uint16_t tick = static_cast<uint16_t>(now_ms / kTimestampUnitMs);
+  std::vector<uint8_t> record(address.data(), address.data() + Address::kLength);
+  record.push_back(address_type);
+  record.push_back(static_cast<uint8_t>(tx_power));
+  record.push_back(static_cast<uint8_t>(rssi));
+  record.push_back(static_cast<uint8_t>(tick));
+  record.push_back(static_cast<uint8_t>(tick >> 8));
+
+  if (is_truncated) {
+    truncated_.Add(address, record, discard_rule_);
+  }
+  if (is_full) {
+    // Keep whole AD structures, split between the advertising data and scan response fields
+    size_t data_size = 0;
+    while (data_size < advertising_data.size()) {
+      size_t next = data_size + 1 + advertising_data[data_size];
+      if (next > advertising_data.size() || next > 2 * kMaxPacketSize) {
+        break;
+      }
+      data_size = next;
+    }
+    size_t advertising_size = std::min(data_size, kMaxPacketSize);
+    record.push_back(static_cast<uint8_t>(advertising_size));
+    record.insert(record.end(), advertising_data.begin(), advertising_data.begin() + advertising_size);
+    record.push_back(static_cast<uint8_t>(data_size - advertising_size));
+    record.insert(
+        record.end(), advertising_data.begin() + advertising_size, advertising_data.begin() + data_size);
+    full_.Add(address, std::move(record), discard_rule_);
+  }
+
+  if (!threshold_crossed_ && notify_threshold_ != 0 && GetStoredBytes() >= notify_threshold_) {
+    threshold_crossed_ = true;
+    return true;
+  }
+  return false;
+}
+
+uint16_t LeHostBatchScanStorage::Read(BatchScanMode format, uint64_t now_ms, std::vector<uint8_t>& data) {
+  uint16_t now_tick = static_cast<uint16_t>(now_ms / kTimestampUnitMs);
+  uint16_t num_records = 0;
+  if (format == BatchScanMode::TRUNCATED) {
+    num_records = truncated_.Read(now_tick, data);
+  } else if (format == BatchScanMode::FULL) {
+    num_records = full_.Read(now_tick, data);
+  } else {
+    LOG_WARN("Invalid report format %d", static_cast<uint8_t>(format));
+  }
+  threshold_crossed_ = notify_threshold_ != 0 && GetStoredBytes() >= notify_threshold_;
+  return num_records;
+}
+
+void LeHostBatchScanStorage::Clear() {
+  truncated_.Clear();
+  full_.Clear();
+  threshold_crossed_ = false;
+}
+
+void LeHostBatchScanStorage::Records::SetCapacity(size_t capacity) {
+  capacity_ = capacity;
+  if (data_.size() <= capacity_) {
+    return;
+  }
+  // Drop the oldest records in one go
+  size_t offset = 0;
+  while (data_.size() - offset > capacity_) {
+    offset += RecordSize(offset);
+    count_--;
+  }
+  data_.erase(data_.begin(), data_.begin() + offset);
+  Reindex();
+}
+
+void LeHostBatchScanStorage::Records::Add(
+    const Address& address, std::vector<uint8_t> record, BatchScanDiscardRule discard_rule) {
+  if (record.size() > capacity_) {
+    return;
+  }
+
+  auto latest = latest_.find(address);
+  if (latest != latest_.end() && IsSameRecord(latest->second, record)) {
+    // Only the address type, tx power, RSSI and timestamp may change
+    std::copy(record.begin(), record.end(), data_.begin() + latest->second);
+    return;
+  }
+
+  while (data_.size() + record.size() > capacity_) {
+    size_t offset = 0;
+    if (discard_rule == BatchScanDiscardRule::WEAKEST_RSSI) {
+      int8_t weakest_rssi = INT8_MAX;
+      for (size_t current = 0; current < data_.size(); current += RecordSize(current)) {
+        auto current_rssi = static_cast<int8_t>(data_[current + kRssiOffset]);
+        if (current_rssi < weakest_rssi) {
+          weakest_rssi = current_rssi;
+          offset = current;
+        }
+      }
+      if (static_cast<int8_t>(record[kRssiOffset]) < weakest_rssi) {
+        return;
+      }
+    }
+    Erase(offset);
+  }
+
+  latest_[address] = data_.size();
+  data_.insert(data_.end(), record.begin(), record.end());
+  count_++;
+}
+
+uint16_t LeHostBatchScanStorage::Records::Read(uint16_t now_tick, std::vector<uint8_t>& data) {
+  // Records carry the time they were last seen, readers expect how long ago that was
+  for (size_t offset = 0; offset < data_.size(); offset += RecordSize(offset)) {
+    uint16_t tick = data_[offset + kTimestampOffset] | (data_[offset + kTimestampOffset + 1] << 8);
+    uint16_t age = now_tick - tick;
+    data_[offset + kTimestampOffset] = static_cast<uint8_t>(age);
+    data_[offset + kTimestampOffset + 1] = static_cast<uint8_t>(age >> 8);
+  }
+  data.insert(data.end(), data_.begin(), data_.end());
+  uint16_t num_records = count_;
+  Clear();
+  return num_records;
+}
+
+void LeHostBatchScanStorage::Records::Clear() {
+  data_.clear();
+  latest_.clear();
+  count_ = 0;
+}
+
+size_t LeHostBatchScanStorage::Records::RecordSize(size_t offset) const {
+  if (!is_full_) {
+    return kTruncatedRecordSize;
+  }
+  size_t advertising_size = data_[offset + kTruncatedRecordSize];
+  size_t scan_response_size = data_[offset + kTruncatedRecordSize + 1 + advertising_size];
+  return kTruncatedRecordSize + 1 + advertising_size + 1 + scan_response_size;
+}
+
+bool LeHostBatchScanStorage::Records::IsSameRecord(size_t offset, const std::vector<uint8_t>& record) const {
+  if (!is_full_) {
+    return true;
+  }
+  return RecordSize(offset) == record.size() &&
+         std::equal(
+             record.begin() + kTruncatedRecordSize, record.end(), data_.begin() + offset + kTruncatedRecordSize);
+}
+
+void LeHostBatchScanStorage::Records::Erase(size_t offset) {
+  data_.erase(data_.begin() + offset, data_.begin() + offset + RecordSize(offset));
+  count_--;
+  Reindex();
+}
+
+void LeHostBatchScanStorage::Records::Reindex() {
+  latest_.clear();
+  for (size_t offset = 0; offset < data_.size(); offset += RecordSize(offset)) {
+    Address address;
+    std::copy(data_.begin() + offset, data_.begin() + offset + Address::kLength, address.data());
+    latest_[address] = offset;
+  }
+}
+
+}  // namespace hci
+}  // namespace bluetooth
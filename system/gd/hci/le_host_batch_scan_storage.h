@@ -0,0 +1,112 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "hci/address.h"
+#include "hci/hci_packets.h"
+#include "hci/le_scanning_manager.h"
+
+namespace bluetooth {
+namespace hci {
+
+// Batch scan storage kept on the host when the controller has none
+constexpr uint16_t kHostBatchScanStorageSize = 16 * 1024;
+
+// Batch scan storage kept on the host, for controllers without the vendor LE_BATCH_SCAN command.
+//
+// Records are stored back to back in the formats the controller returns them in, so reading them is a
+// copy. A truncated record is the address, address type, tx power, RSSI and timestamp, a full record
+// adds the advertising data and scan response. The storage is shared between the two formats with the
+// same percentages as the vendor command, and once a format is full its records are discarded by the
+// discard rule.
+//
+// Reports of an advertiser already stored update its truncated record, and its latest full record if
+// the data did not change, instead of taking more space.
+class LeHostBatchScanStorage {
+ public:
+  static constexpr size_t kTruncatedRecordSize = 11;
+
+  explicit LeHostBatchScanStorage(size_t capacity);
+
+  void SetStorageParameters(uint8_t full_max_percent, uint8_t truncated_max_percent, uint8_t notify_threshold_percent);
+  void SetScanMode(BatchScanMode scan_mode, BatchScanDiscardRule discard_rule);
+  BatchScanMode GetScanMode() const {
+    return scan_mode_;
+  }
+
+  // Stores the report in the formats of the scan mode. Returns true when the stored records cross the
+  // notify threshold for the first time since the last read.
+  bool Add(
+      const Address& address,
+      uint8_t address_type,
+      int8_t tx_power,
+      int8_t rssi,
+      const std::vector<uint8_t>& advertising_data,
+      uint64_t now_ms);
+
+  // Moves the records of |format|, TRUNCATED or FULL, to |data| and returns how many there were
+  uint16_t Read(BatchScanMode format, uint64_t now_ms, std::vector<uint8_t>& data);
+  void Clear();
+
+  size_t GetStoredBytes() const {
+    return truncated_.GetSize() + full_.GetSize();
+  }
+
+ private:
+  class Records {
+   public:
+    explicit Records(bool is_full) : is_full_(is_full) {}
+
+    void SetCapacity(size_t capacity);
+    size_t GetSize() const {
+      return data_.size();
+    }
+    uint16_t GetCount() const {
+      return count_;
+    }
+    void Add(const Address& address, std::vector<uint8_t> record, BatchScanDiscardRule discard_rule);
+    uint16_t Read(uint16_t now_tick, std::vector<uint8_t>& data);
+    void Clear();
+
+   private:
+    size_t RecordSize(size_t offset) const;
+    bool IsSameRecord(size_t offset, const std::vector<uint8_t>& record) const;
+    void Erase(size_t offset);
+    void Reindex();
+
+    bool is_full_;
+    size_t capacity_ = 0;
+    uint16_t count_ = 0;
+    std::vector<uint8_t> data_;
+    // Offset of the latest record of each address
+    std::unordered_map<Address, size_t> latest_;
+  };
+
+  size_t capacity_;
+  size_t notify_threshold_ = 0;
+  bool threshold_crossed_ = false;
+  BatchScanMode scan_mode_ = BatchScanMode::DISABLE;
+  BatchScanDiscardRule discard_rule_ = BatchScanDiscardRule::OLDEST;
+  Records truncated_{false};
+  Records full_{true};
+};
+
+}  // namespace hci
+}  // namespace bluetooth
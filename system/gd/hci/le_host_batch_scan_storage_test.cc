@@ -0,0 +1,150 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hci/le_host_batch_scan_storage.h"
+
+#include <gtest/gtest.h>
+
+namespace bluetooth {
+namespace hci {
+namespace {
+
+constexpr size_t kTruncatedSize = LeHostBatchScanStorage::kTruncatedRecordSize;
+
+const Address kAddress({0x01, 0x02, 0x03, 0x04, 0x05, 0x06});
+const Address kOtherAddress({0x06, 0x05, 0x04, 0x03, 0x02, 0x01});
+const std::vector<uint8_t> kAdvertisingData = {0x02, 0x01, 0x06, 0x03, 0x03, 0x0D, 0x18};
+
+TEST(LeHostBatchScanStorageTest, disabled_stores_nothing) {
+  LeHostBatchScanStorage storage(1024);
+  storage.SetStorageParameters(50, 50, 0);
+  ASSERT_FALSE(storage.Add(kAddress, 0, 0, -60, kAdvertisingData, 0));
+  ASSERT_EQ(storage.GetStoredBytes(), 0u);
+}
+
+TEST(LeHostBatchScanStorageTest, truncated_records) {
+  LeHostBatchScanStorage storage(1024);
+  storage.SetStorageParameters(0, 100, 0);
+  storage.SetScanMode(BatchScanMode::TRUNCATED, BatchScanDiscardRule::OLDEST);
+  storage.Add(kAddress, 1, 4, -60, kAdvertisingData, 1000);
+  storage.Add(kOtherAddress, 0, 4, -70, kAdvertisingData, 1000);
+  // The same advertiser again only refreshes its record
+  storage.Add(kAddress, 1, 4, -50, kAdvertisingData, 2000);
+  ASSERT_EQ(storage.GetStoredBytes(), 2 * kTruncatedSize);
+
+  std::vector<uint8_t> data;
+  ASSERT_EQ(storage.Read(BatchScanMode::TRUNCATED, 3000, data), 2);
+  ASSERT_EQ(data.size(), 2 * kTruncatedSize);
+  std::vector<uint8_t> expected = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x01, 0x04, static_cast<uint8_t>(-50), 20, 0};
+  ASSERT_EQ(std::vector<uint8_t>(data.begin(), data.begin() + kTruncatedSize), expected);
+  // 2 s ago, in 50 ms units
+  ASSERT_EQ(data[kTruncatedSize + 9], 40);
+  ASSERT_EQ(storage.GetStoredBytes(), 0u);
+
+  data.clear();
+  ASSERT_EQ(storage.Read(BatchScanMode::TRUNCATED, 3000, data), 0);
+  ASSERT_TRUE(data.empty());
+}
+
+TEST(LeHostBatchScanStorageTest, full_records) {
+  LeHostBatchScanStorage storage(1024);
+  storage.SetStorageParameters(100, 0, 0);
+  storage.SetScanMode(BatchScanMode::FULL, BatchScanDiscardRule::OLDEST);
+  storage.Add(kAddress, 0, 0, -60, kAdvertisingData, 0);
+  storage.Add(kAddress, 0, 0, -55, kAdvertisingData, 0);
+  std::vector<uint8_t> changed_data = {0x02, 0x01, 0x04};
+  storage.Add(kAddress, 0, 0, -55, changed_data, 0);
+
+  std::vector<uint8_t> data;
+  ASSERT_EQ(storage.Read(BatchScanMode::FULL, 0, data), 2);
+  size_t first_size = kTruncatedSize + 1 + kAdvertisingData.size() + 1;
+  ASSERT_EQ(data.size(), first_size + kTruncatedSize + 1 + changed_data.size() + 1);
+  ASSERT_EQ(static_cast<int8_t>(data[8]), -55);
+  ASSERT_EQ(data[kTruncatedSize], kAdvertisingData.size());
+  ASSERT_EQ(
+      std::vector<uint8_t>(data.begin() + kTruncatedSize + 1, data.begin() + first_size - 1), kAdvertisingData);
+  ASSERT_EQ(data[first_size - 1], 0);
+
+  // The truncated records were not kept
+  data.clear();
+  ASSERT_EQ(storage.Read(BatchScanMode::TRUNCATED, 0, data), 0);
+}
+
+TEST(LeHostBatchScanStorageTest, long_data_is_split) {
+  std::vector<uint8_t> long_data;
+  for (int i = 0; i < 6; i++) {
+    long_data.push_back(30);
+    long_data.push_back(0xFF);
+    long_data.insert(long_data.end(), 29, static_cast<uint8_t>(i));
+  }
+
+  LeHostBatchScanStorage storage(1024);
+  storage.SetStorageParameters(100, 0, 0);
+  storage.SetScanMode(BatchScanMode::FULL, BatchScanDiscardRule::OLDEST);
+  storage.Add(kAddress, 0, 0, -60, long_data, 0);
+
+  std::vector<uint8_t> data;
+  ASSERT_EQ(storage.Read(BatchScanMode::FULL, 0, data), 1);
+  uint8_t advertising_size = data[kTruncatedSize];
+  uint8_t scan_response_size = data[kTruncatedSize + 1 + advertising_size];
+  ASSERT_EQ(advertising_size, 0x7F);
+  ASSERT_EQ(advertising_size + scan_response_size, long_data.size());
+}
+
+TEST(LeHostBatchScanStorageTest, discard_rules) {
+  LeHostBatchScanStorage storage(3 * kTruncatedSize);
+  storage.SetStorageParameters(0, 100, 0);
+  storage.SetScanMode(BatchScanMode::TRUNCATED, BatchScanDiscardRule::OLDEST);
+  for (uint8_t i = 0; i < 4; i++) {
+    storage.Add(Address({i, 0, 0, 0, 0, 0}), 0, 0, -60 - i, {}, 0);
+  }
+  std::vector<uint8_t> data;
+  ASSERT_EQ(storage.Read(BatchScanMode::TRUNCATED, 0, data), 3);
+  ASSERT_EQ(data[0], 1);
+
+  storage.SetScanMode(BatchScanMode::TRUNCATED, BatchScanDiscardRule::WEAKEST_RSSI);
+  storage.Add(Address({0, 0, 0, 0, 0, 0}), 0, 0, -60, {}, 0);
+  storage.Add(Address({1, 0, 0, 0, 0, 0}), 0, 0, -80, {}, 0);
+  storage.Add(Address({2, 0, 0, 0, 0, 0}), 0, 0, -70, {}, 0);
+  // Weaker than everything stored: dropped
+  storage.Add(Address({3, 0, 0, 0, 0, 0}), 0, 0, -90, {}, 0);
+  // Replaces the weakest
+  storage.Add(Address({4, 0, 0, 0, 0, 0}), 0, 0, -50, {}, 0);
+  data.clear();
+  ASSERT_EQ(storage.Read(BatchScanMode::TRUNCATED, 0, data), 3);
+  ASSERT_EQ(data[0], 0);
+  ASSERT_EQ(data[kTruncatedSize], 2);
+  ASSERT_EQ(data[2 * kTruncatedSize], 4);
+}
+
+TEST(LeHostBatchScanStorageTest, notify_threshold) {
+  LeHostBatchScanStorage storage(10 * kTruncatedSize);
+  storage.SetStorageParameters(0, 100, 20);
+  storage.SetScanMode(BatchScanMode::TRUNCATED, BatchScanDiscardRule::OLDEST);
+  ASSERT_FALSE(storage.Add(kAddress, 0, 0, -60, {}, 0));
+  ASSERT_TRUE(storage.Add(kOtherAddress, 0, 0, -60, {}, 0));
+  // Only notified once until read
+  ASSERT_FALSE(storage.Add(Address({1, 1, 1, 1, 1, 1}), 0, 0, -60, {}, 0));
+
+  std::vector<uint8_t> data;
+  storage.Read(BatchScanMode::TRUNCATED, 0, data);
+  ASSERT_FALSE(storage.Add(kAddress, 0, 0, -60, {}, 0));
+  ASSERT_TRUE(storage.Add(kOtherAddress, 0, 0, -60, {}, 0));
+}
+
+}  // namespace
+}  // namespace hci
+}  // namespace bluetooth
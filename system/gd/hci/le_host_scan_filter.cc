@@ -0,0 +1,326 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "hci/le_host_scan_filter.h"
+
+#include <algorithm>
+
+#include "os/log.h"
+
+namespace bluetooth {
+namespace hci {
+
+namespace {
+
+constexpr uint16_t feature_bit(ApcfFilterType feature) {
+  return 1 << static_cast<uint8_t>(feature);
+}
+
+// SERVICE_DATA_CHANGE needs the previous data of every advertiser, it is not evaluated on the host
+constexpr uint16_t kSupportedFeatures =
+    feature_bit(ApcfFilterType::BROADCASTER_ADDRESS) | feature_bit(ApcfFilterType::SERVICE_UUID) |
+    feature_bit(ApcfFilterType::SERVICE_SOLICITATION_UUID) | feature_bit(ApcfFilterType::LOCAL_NAME) |
+    feature_bit(ApcfFilterType::MANUFACTURER_DATA) | feature_bit(ApcfFilterType::SERVICE_DATA) |
+    feature_bit(ApcfFilterType::AD_TYPE);
+
+bool is_full_mask(const Uuid& mask) {
+  if (mask.IsEmpty()) {
+    return true;
+  }
+  switch (mask.GetShortestRepresentationSize()) {
+    case Uuid::kNumBytes16:
+      return mask.As16Bit() == 0xFFFF;
+    case Uuid::kNumBytes32:
+      return mask.As32Bit() == 0xFFFFFFFF;
+    default:
+      for (auto byte : mask.To128BitBE()) {
+        if (byte != 0xFF) {
+          return false;
+        }
+      }
+      return true;
+  }
+}
+
+bool masked_equal(const Uuid& uuid, const Uuid& value, const Uuid& mask) {
+  auto const& uuid_bytes = uuid.To128BitBE();
+  auto const& value_bytes = value.To128BitBE();
+  auto const& mask_bytes = mask.To128BitBE();
+  for (size_t i = 0; i < Uuid::kNumBytes128; i++) {
+    if ((uuid_bytes[i] & mask_bytes[i]) != (value_bytes[i] & mask_bytes[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void LeHostScanFilter::Enable(bool enable) {
+  enabled_ = enable;
+}
+
+void LeHostScanFilter::SetParameters(uint8_t filter_index, const AdvertisingFilterParameter& parameters) {
+  if (parameters.feature_selection & ~kSupportedFeatures) {
+    LOG_WARN("Ignoring unsupported features 0x%x of filter %d", parameters.feature_selection, filter_index);
+  }
+  auto& filter = filters_[filter_index];
+  filter.has_parameters = true;
+  filter.features = parameters.feature_selection & kSupportedFeatures;
+  filter.and_list_features = parameters.list_logic_type;
+  filter.and_features = parameters.filter_logic_type != 0;
+  filter.rssi_threshold = static_cast<int8_t>(parameters.rssi_high_thresh);
+  compiled_ = false;
+}
+
+void LeHostScanFilter::Delete(uint8_t filter_index) {
+  filters_.erase(filter_index);
+  compiled_ = false;
+}
+
+void LeHostScanFilter::Clear() {
+  filters_.clear();
+  compiled_ = false;
+}
+
+void LeHostScanFilter::AddConditions(
+    uint8_t filter_index, const std::vector<AdvertisingPacketContentFilterCommand>& filters) {
+  auto& conditions = filters_[filter_index].conditions;
+  conditions.insert(conditions.end(), filters.begin(), filters.end());
+  compiled_ = false;
+}
+
+void LeHostScanFilter::AddPattern(uint8_t ad_type, Pattern pattern) {
+  patterns_[ad_type].push_back(std::move(pattern));
+}
+
+void LeHostScanFilter::Compile() {
+  addresses_.clear();
+  service_uuids_.clear();
+  solicitation_uuids_.clear();
+  masked_service_uuids_.clear();
+  masked_solicitation_uuids_.clear();
+  patterns_.clear();
+  condition_count_ = 0;
+
+  for (auto& entry : filters_) {
+    auto& filter = entry.second;
+    for (auto& conditions : filter.compiled_conditions) {
+      conditions.clear();
+    }
+    if (!filter.has_parameters) {
+      continue;
+    }
+    for (auto const& condition : filter.conditions) {
+      size_t id = condition_count_;
+      switch (condition.filter_type) {
+        case ApcfFilterType::BROADCASTER_ADDRESS:
+          addresses_[condition.address].push_back(id);
+          break;
+        case ApcfFilterType::SERVICE_UUID:
+        case ApcfFilterType::SERVICE_SOLICITATION_UUID: {
+          bool is_service = condition.filter_type == ApcfFilterType::SERVICE_UUID;
+          if (is_full_mask(condition.uuid_mask)) {
+            (is_service ? service_uuids_ : solicitation_uuids_)[condition.uuid].push_back(id);
+          } else {
+            (is_service ? masked_service_uuids_ : masked_solicitation_uuids_)
+                .push_back({condition.uuid, condition.uuid_mask, id});
+          }
+        } break;
+        case ApcfFilterType::LOCAL_NAME:
+          for (auto ad_type : {GapDataType::SHORTENED_LOCAL_NAME, GapDataType::COMPLETE_LOCAL_NAME}) {
+            AddPattern(static_cast<uint8_t>(ad_type), {id, condition.name, {}});
+          }
+          break;
+        case ApcfFilterType::MANUFACTURER_DATA: {
+          uint16_t company_mask = condition.company_mask != 0 ? condition.company_mask : 0xFFFF;
+          Pattern pattern{id, {}, {}};
+          pattern.value.push_back(static_cast<uint8_t>(condition.company));
+          pattern.value.push_back(static_cast<uint8_t>(condition.company >> 8));
+          pattern.value.insert(pattern.value.end(), condition.data.begin(), condition.data.end());
+          pattern.mask.push_back(static_cast<uint8_t>(company_mask));
+          pattern.mask.push_back(static_cast<uint8_t>(company_mask >> 8));
+          if (condition.data_mask.empty()) {
+            pattern.mask.insert(pattern.mask.end(), condition.data.size(), 0xFF);
+          } else {
+            pattern.mask.insert(pattern.mask.end(), condition.data_mask.begin(), condition.data_mask.end());
+          }
+          AddPattern(static_cast<uint8_t>(GapDataType::MANUFACTURER_SPECIFIC_DATA), std::move(pattern));
+        } break;
+        case ApcfFilterType::SERVICE_DATA:
+          // The data starts with the service UUID, as in the AD structure
+          for (auto ad_type :
+               {GapDataType::SERVICE_DATA_16_BIT_UUIDS,
+                GapDataType::SERVICE_DATA_32_BIT_UUIDS,
+                GapDataType::SERVICE_DATA_128_BIT_UUIDS}) {
+            AddPattern(static_cast<uint8_t>(ad_type), {id, condition.data, condition.data_mask});
+          }
+          break;
+        case ApcfFilterType::AD_TYPE:
+          AddPattern(condition.ad_type, {id, condition.data, condition.data_mask});
+          break;
+        default:
+          LOG_WARN("Filter type %d is not supported on the host", static_cast<uint8_t>(condition.filter_type));
+          continue;
+      }
+      filter.compiled_conditions[static_cast<uint8_t>(condition.filter_type)].push_back(id);
+      condition_count_++;
+    }
+  }
+  compiled_ = true;
+}
+
+void LeHostScanFilter::MatchUuid(ApcfFilterType feature, const Uuid& uuid) {
+  bool is_service = feature == ApcfFilterType::SERVICE_UUID;
+  auto const& uuids = is_service ? service_uuids_ : solicitation_uuids_;
+  auto entry = uuids.find(uuid);
+  if (entry != uuids.end()) {
+    for (auto condition : entry->second) {
+      matched_[condition] = true;
+    }
+  }
+  for (auto const& masked : is_service ? masked_service_uuids_ : masked_solicitation_uuids_) {
+    if (masked_equal(uuid, masked.uuid, masked.mask)) {
+      matched_[masked.condition] = true;
+    }
+  }
+}
+
+bool LeHostScanFilter::MatchesFeature(const Filter& filter, size_t feature) const {
+  auto const& conditions = filter.compiled_conditions[feature];
+  if (conditions.empty()) {
+    return false;
+  }
+  if (filter.and_list_features & (1 << feature)) {
+    return std::all_of(conditions.begin(), conditions.end(), [this](size_t c) { return matched_[c]; });
+  }
+  return std::any_of(conditions.begin(), conditions.end(), [this](size_t c) { return matched_[c]; });
+}
+
+bool LeHostScanFilter::Matches(const Address& address, int8_t rssi, const std::vector<uint8_t>& advertising_data) {
+  if (!enabled_) {
+    return true;
+  }
+  if (!compiled_) {
+    Compile();
+  }
+
+  matched_.assign(condition_count_, false);
+  auto address_entry = addresses_.find(address);
+  if (address_entry != addresses_.end()) {
+    for (auto condition : address_entry->second) {
+      matched_[condition] = true;
+    }
+  }
+
+  size_t offset = 0;
+  while (offset < advertising_data.size()) {
+    size_t length = advertising_data[offset];
+    if (length == 0 || offset + 1 + length > advertising_data.size()) {
+      break;
+    }
+    auto ad_type = static_cast<GapDataType>(advertising_data[offset + 1]);
+    const uint8_t* payload = advertising_data.data() + offset + 2;
+    size_t payload_size = length - 1;
+    offset += 1 + length;
+
+    ApcfFilterType uuid_feature = ApcfFilterType::SERVICE_UUID;
+    size_t uuid_size = 0;
+    switch (ad_type) {
+      case GapDataType::INCOMPLETE_LIST_16_BIT_UUIDS:
+      case GapDataType::COMPLETE_LIST_16_BIT_UUIDS:
+        uuid_size = Uuid::kNumBytes16;
+        break;
+      case GapDataType::INCOMPLETE_LIST_32_BIT_UUIDS:
+      case GapDataType::COMPLETE_LIST_32_BIT_UUIDS:
+        uuid_size = Uuid::kNumBytes32;
+        break;
+      case GapDataType::INCOMPLETE_LIST_128_BIT_UUIDS:
+      case GapDataType::COMPLETE_LIST_128_BIT_UUIDS:
+        uuid_size = Uuid::kNumBytes128;
+        break;
+      case GapDataType::LIST_16BIT_SERVICE_SOLICITATION_UUIDS:
+        uuid_feature = ApcfFilterType::SERVICE_SOLICITATION_UUID;
+        uuid_size = Uuid::kNumBytes16;
+        break;
+      case GapDataType::LIST_32BIT_SERVICE_SOLICITATION_UUIDS:
+        uuid_feature = ApcfFilterType::SERVICE_SOLICITATION_UUID;
+        uuid_size = Uuid::kNumBytes32;
+        break;
+      case GapDataType::LIST_128BIT_SERVICE_SOLICITATION_UUIDS:
+        uuid_feature = ApcfFilterType::SERVICE_SOLICITATION_UUID;
+        uuid_size = Uuid::kNumBytes128;
+        break;
+      default:
+        break;
+    }
+    for (size_t i = 0; uuid_size != 0 && i + uuid_size <= payload_size; i += uuid_size) {
+      const uint8_t* bytes = payload + i;
+      Uuid uuid;
+      if (uuid_size == Uuid::kNumBytes16) {
+        uuid = Uuid::From16Bit(bytes[0] | (bytes[1] << 8));
+      } else if (uuid_size == Uuid::kNumBytes32) {
+        uuid = Uuid::From32Bit(bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24));
+      } else {
+        uuid = Uuid::From128BitLE(bytes);
+      }
+      MatchUuid(uuid_feature, uuid);
+    }
+
+    auto patterns = patterns_.find(static_cast<uint8_t>(ad_type));
+    if (patterns == patterns_.end()) {
+      continue;
+    }
+    for (auto const& pattern : patterns->second) {
+      if (pattern.value.size() > payload_size) {
+        continue;
+      }
+      bool is_match = true;
+      for (size_t i = 0; i < pattern.value.size() && is_match; i++) {
+        uint8_t mask = i < pattern.mask.size() ? pattern.mask[i] : 0xFF;
+        is_match = (payload[i] & mask) == (pattern.value[i] & mask);
+      }
+      if (is_match) {
+        matched_[pattern.condition] = true;
+      }
+    }
+  }
+
+  for (auto const& entry : filters_) {
+    auto const& filter = entry.second;
+    if (!filter.has_parameters || rssi < filter.rssi_threshold) {
+      continue;
+    }
+    // A filter without any feature selected only checks the RSSI
+    bool is_match = filter.features == 0 || filter.and_features;
+    for (size_t feature = 0; feature < kNumFeatures; feature++) {
+      if (!(filter.features & (1 << feature))) {
+        continue;
+      }
+      if (filter.and_features) {
+        is_match &= MatchesFeature(filter, feature);
+      } else {
+        is_match |= MatchesFeature(filter, feature);
+      }
+    }
+    if (is_match) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace hci
+}  // namespace bluetooth
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "hci/address.h"
+#include "hci/le_scanning_callback.h"
+#include "hci/uuid.h"
+
+namespace bluetooth {
+namespace hci {
+
+// Advertising packet content filtering (APCF) done on the host, for controllers without the vendor
+// LE_ADV_FILTER command.
+//
+// Filters are configured the same way they are sent to the controller: content conditions are added per
+// filter index, and a filter index only takes part once its parameters are set. The conditions of all
+// the filter indexes are compiled into an address hash table, UUID hash tables and per AD type byte
+// patterns, so a report is matched with a single walk over its AD structures whatever the number of
+// filters.
+//
+// As in the vendor APCF specification, a selected feature matches when all of its conditions do if its
+// bit is set in list_logic_type, or when any of them does otherwise. A filter index matches when all of
+// its selected features match if filter_logic_type is AND, or when any of them does if it is OR. With
+// filtering enabled, a report is kept only when it matches a filter index.
+class LeHostScanFilter {
+ public:
+  // Number of filter indexes reported to the upper layers when filtering is done on the host
+  static constexpr uint8_t kMaxFilters = 32;
+
+  void Enable(bool enable);
+  bool IsEnabled() const {
+    return enabled_;
+  }
+
+  void SetParameters(uint8_t filter_index, const AdvertisingFilterParameter& parameters);
+  // Removes the parameters and the conditions of |filter_index|
+  void Delete(uint8_t filter_index);
+  void Clear();
+  void AddConditions(uint8_t filter_index, const std::vector<AdvertisingPacketContentFilterCommand>& filters);
+
+  // |advertising_data| is the complete advertising data of the report, scan response included
+  bool Matches(const Address& address, int8_t rssi, const std::vector<uint8_t>& advertising_data);
+
+ private:
+  static constexpr size_t kNumFeatures = 8;
+  // Indexes of compiled conditions, into the conditions matched by a report
+  using ConditionList = std::vector<size_t>;
+
+  struct Filter {
+    bool has_parameters = false;
+    uint16_t features = 0;
+    // Features whose conditions must all match, instead of any of them
+    uint16_t and_list_features = 0;
+    // Whether all the features must match, instead of any of them
+    bool and_features = false;
+    int8_t rssi_threshold = 0;
+    std::vector<AdvertisingPacketContentFilterCommand> conditions;
+    std::array<ConditionList, kNumFeatures> compiled_conditions;
+  };
+
+  struct MaskedUuid {
+    Uuid uuid;
+    Uuid mask;
+    size_t condition;
+  };
+
+  struct Pattern {
+    size_t condition;
+    std::vector<uint8_t> value;
+    // Bytes of |value| past the end of the mask have to match exactly
+    std::vector<uint8_t> mask;
+  };
+
+  void Compile();
+  void AddPattern(uint8_t ad_type, Pattern pattern);
+  void MatchUuid(ApcfFilterType feature, const Uuid& uuid);
+  bool MatchesFeature(const Filter& filter, size_t feature) const;
+
+  bool enabled_ = false;
+  bool compiled_ = false;
+  std::map<uint8_t, Filter> filters_;
+
+  size_t condition_count_ = 0;
+  std::unordered_map<Address, ConditionList> addresses_;
+  std::unordered_map<Uuid, ConditionList> service_uuids_;
+  std::unordered_map<Uuid, ConditionList> solicitation_uuids_;
+  std::vector<MaskedUuid> masked_service_uuids_;
+  std::vector<MaskedUuid> masked_solicitation_uuids_;
+  std::unordered_map<uint8_t, std::vector<Pattern>> patterns_;
+  // Conditions matched by the report being matched, kept to save an allocation per report
+  std::vector<bool> matched_;
+};
+
+}  // namespace hci
+}  // namespace bluetooth
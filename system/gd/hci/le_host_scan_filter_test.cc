@@ -0,0 +1,248 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hci/le_host_scan_filter.h"
+
+#include <gtest/gtest.h>
+
+namespace bluetooth {
+namespace hci {
+namespace {
+
+constexpr int8_t kRssi = -60;
+
+const Address kAddress({0x01, 0x02, 0x03, 0x04, 0x05, 0x06});
+const Address kOtherAddress({0x06, 0x05, 0x04, 0x03, 0x02, 0x01});
+
+// Flags, a complete list of 16 bit UUIDs with 0x180D and 0x180F, service data for 0xFEAA and manufacturer
+// data of company 0x00E0
+const std::vector<uint8_t> kAdvertisingData = {
+    0x02, 0x01, 0x06, 0x05, 0x03, 0x0D, 0x18, 0x0F, 0x18, 0x05, 0x16, 0xAA, 0xFE, 0x10, 0x20,
+    0x05, 0xFF, 0xE0, 0x00, 0x42, 0x43, 0x05, 0x09, 'T',  'e',  's',  't'};
+
+constexpr uint8_t kOr = 0x00;
+constexpr uint8_t kAnd = 0x01;
+
+// The logic types ScanManager sets on every filter
+constexpr uint16_t kScanManagerListLogicType = static_cast<uint16_t>(0x1111111);
+constexpr uint8_t kScanManagerFilterLogicType = kAnd;
+
+// By default, any condition of a feature matches it and all the features have to match
+AdvertisingFilterParameter parameters(
+    uint16_t feature_selection, uint16_t list_logic_type = 0, uint8_t filter_logic_type = kAnd) {
+  AdvertisingFilterParameter parameters{};
+  parameters.feature_selection = feature_selection;
+  parameters.list_logic_type = list_logic_type;
+  parameters.filter_logic_type = filter_logic_type;
+  parameters.rssi_high_thresh = static_cast<uint8_t>(-128);
+  parameters.delivery_mode = DeliveryMode::IMMEDIATE;
+  return parameters;
+}
+
+uint16_t bit(ApcfFilterType filter_type) {
+  return 1 << static_cast<uint8_t>(filter_type);
+}
+
+AdvertisingPacketContentFilterCommand address_filter(Address address) {
+  AdvertisingPacketContentFilterCommand filter{};
+  filter.filter_type = ApcfFilterType::BROADCASTER_ADDRESS;
+  filter.address = address;
+  return filter;
+}
+
+AdvertisingPacketContentFilterCommand uuid_filter(Uuid uuid, Uuid uuid_mask = Uuid::kEmpty) {
+  AdvertisingPacketContentFilterCommand filter{};
+  filter.filter_type = ApcfFilterType::SERVICE_UUID;
+  filter.uuid = uuid;
+  filter.uuid_mask = uuid_mask;
+  return filter;
+}
+
+AdvertisingPacketContentFilterCommand manufacturer_filter(
+    uint16_t company, std::vector<uint8_t> data, std::vector<uint8_t> data_mask) {
+  AdvertisingPacketContentFilterCommand filter{};
+  filter.filter_type = ApcfFilterType::MANUFACTURER_DATA;
+  filter.company = company;
+  filter.data = data;
+  filter.data_mask = data_mask;
+  return filter;
+}
+
+TEST(LeHostScanFilterTest, disabled_matches_everything) {
+  LeHostScanFilter filter;
+  filter.AddConditions(0, {address_filter(kOtherAddress)});
+  filter.SetParameters(0, parameters(bit(ApcfFilterType::BROADCASTER_ADDRESS)));
+  ASSERT_TRUE(filter.Matches(kAddress, kRssi, kAdvertisingData));
+
+  filter.Enable(true);
+  ASSERT_FALSE(filter.Matches(kAddress, kRssi, kAdvertisingData));
+  filter.Enable(false);
+  ASSERT_TRUE(filter.Matches(kAddress, kRssi, kAdvertisingData));
+}
+
+TEST(LeHostScanFilterTest, filter_without_parameters_is_ignored) {
+  LeHostScanFilter filter;
+  filter.Enable(true);
+  filter.AddConditions(0, {address_filter(kAddress)});
+  ASSERT_FALSE(filter.Matches(kAddress, kRssi, kAdvertisingData));
+
+  filter.SetParameters(0, parameters(bit(ApcfFilterType::BROADCASTER_ADDRESS)));
+  ASSERT_TRUE(filter.Matches(kAddress, kRssi, kAdvertisingData));
+  ASSERT_FALSE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+
+  filter.Delete(0);
+  ASSERT_FALSE(filter.Matches(kAddress, kRssi, kAdvertisingData));
+}
+
+TEST(LeHostScanFilterTest, allow_all_filter) {
+  LeHostScanFilter filter;
+  filter.Enable(true);
+  filter.SetParameters(0, parameters(0));
+  ASSERT_TRUE(filter.Matches(kOtherAddress, kRssi, {}));
+
+  auto rssi_parameters = parameters(0);
+  rssi_parameters.rssi_high_thresh = static_cast<uint8_t>(-50);
+  filter.SetParameters(0, rssi_parameters);
+  ASSERT_FALSE(filter.Matches(kOtherAddress, kRssi, {}));
+  ASSERT_TRUE(filter.Matches(kOtherAddress, -40, {}));
+}
+
+TEST(LeHostScanFilterTest, uuid_filter) {
+  LeHostScanFilter filter;
+  filter.Enable(true);
+  filter.AddConditions(0, {uuid_filter(Uuid::From16Bit(0x180A)), uuid_filter(Uuid::From16Bit(0x180F))});
+  filter.SetParameters(0, parameters(bit(ApcfFilterType::SERVICE_UUID)));
+  ASSERT_TRUE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+
+  filter.Clear();
+  filter.AddConditions(1, {uuid_filter(Uuid::From16Bit(0x180A))});
+  filter.SetParameters(1, parameters(bit(ApcfFilterType::SERVICE_UUID)));
+  ASSERT_FALSE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+
+  // Only the upper byte has to match
+  filter.AddConditions(1, {uuid_filter(Uuid::From16Bit(0x1800), Uuid::From16Bit(0xFF00))});
+  ASSERT_TRUE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+}
+
+TEST(LeHostScanFilterTest, masked_manufacturer_data) {
+  LeHostScanFilter filter;
+  filter.Enable(true);
+  filter.AddConditions(0, {manufacturer_filter(0x00E0, {0x42, 0x00}, {0xFF, 0x00})});
+  filter.SetParameters(0, parameters(bit(ApcfFilterType::MANUFACTURER_DATA)));
+  ASSERT_TRUE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+
+  filter.Clear();
+  filter.AddConditions(0, {manufacturer_filter(0x00E0, {0x42, 0x44}, {})});
+  filter.SetParameters(0, parameters(bit(ApcfFilterType::MANUFACTURER_DATA)));
+  ASSERT_FALSE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+}
+
+TEST(LeHostScanFilterTest, local_name_and_service_data) {
+  AdvertisingPacketContentFilterCommand name_filter{};
+  name_filter.filter_type = ApcfFilterType::LOCAL_NAME;
+  name_filter.name = {'T', 'e', 's', 't'};
+  AdvertisingPacketContentFilterCommand service_data_filter{};
+  service_data_filter.filter_type = ApcfFilterType::SERVICE_DATA;
+  service_data_filter.data = {0xAA, 0xFE, 0x10};
+  service_data_filter.data_mask = {0xFF, 0xFF, 0xF0};
+
+  LeHostScanFilter filter;
+  filter.Enable(true);
+  filter.AddConditions(0, {name_filter, service_data_filter});
+  filter.SetParameters(0, parameters(bit(ApcfFilterType::LOCAL_NAME) | bit(ApcfFilterType::SERVICE_DATA)));
+  ASSERT_TRUE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+
+  name_filter.name = {'N', 'o', 'p', 'e'};
+  filter.Clear();
+  filter.AddConditions(0, {name_filter, service_data_filter});
+  filter.SetParameters(0, parameters(bit(ApcfFilterType::LOCAL_NAME) | bit(ApcfFilterType::SERVICE_DATA)));
+  ASSERT_FALSE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+}
+
+TEST(LeHostScanFilterTest, filter_logic_type) {
+  LeHostScanFilter filter;
+  filter.Enable(true);
+  filter.AddConditions(0, {address_filter(kAddress), uuid_filter(Uuid::From16Bit(0x180D))});
+
+  // Address AND UUID
+  uint16_t features = bit(ApcfFilterType::BROADCASTER_ADDRESS) | bit(ApcfFilterType::SERVICE_UUID);
+  filter.SetParameters(0, parameters(features, 0, kAnd));
+  ASSERT_TRUE(filter.Matches(kAddress, kRssi, kAdvertisingData));
+  ASSERT_FALSE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+  ASSERT_FALSE(filter.Matches(kAddress, kRssi, {}));
+
+  // Address OR UUID
+  filter.SetParameters(0, parameters(features, 0, kOr));
+  ASSERT_TRUE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+  ASSERT_TRUE(filter.Matches(kAddress, kRssi, {}));
+  ASSERT_FALSE(filter.Matches(kOtherAddress, kRssi, {}));
+}
+
+TEST(LeHostScanFilterTest, list_logic_type) {
+  LeHostScanFilter filter;
+  filter.Enable(true);
+  filter.AddConditions(0, {uuid_filter(Uuid::From16Bit(0x180D)), uuid_filter(Uuid::From16Bit(0x180A))});
+
+  // 0x180D OR 0x180A
+  uint16_t features = bit(ApcfFilterType::SERVICE_UUID);
+  filter.SetParameters(0, parameters(features, 0));
+  ASSERT_TRUE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+
+  // 0x180D AND 0x180A
+  filter.SetParameters(0, parameters(features, features));
+  ASSERT_FALSE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+
+  // 0x180D AND 0x180F
+  filter.Clear();
+  filter.AddConditions(0, {uuid_filter(Uuid::From16Bit(0x180D)), uuid_filter(Uuid::From16Bit(0x180F))});
+  filter.SetParameters(0, parameters(features, features));
+  ASSERT_TRUE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+}
+
+TEST(LeHostScanFilterTest, scan_manager_logic_types) {
+  LeHostScanFilter filter;
+  filter.Enable(true);
+  uint16_t features = bit(ApcfFilterType::SERVICE_UUID) | bit(ApcfFilterType::MANUFACTURER_DATA);
+  auto scan_manager_parameters = parameters(features, kScanManagerListLogicType, kScanManagerFilterLogicType);
+
+  // A ScanFilter on a service UUID and manufacturer data needs both to match
+  filter.AddConditions(0, {uuid_filter(Uuid::From16Bit(0x180D)), manufacturer_filter(0x00E0, {0x42}, {})});
+  filter.SetParameters(0, scan_manager_parameters);
+  ASSERT_TRUE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+
+  filter.Clear();
+  filter.AddConditions(0, {uuid_filter(Uuid::From16Bit(0x180D)), manufacturer_filter(0x00E1, {0x42}, {})});
+  filter.SetParameters(0, scan_manager_parameters);
+  ASSERT_FALSE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+
+  filter.Clear();
+  filter.AddConditions(0, {uuid_filter(Uuid::From16Bit(0x180A)), manufacturer_filter(0x00E0, {0x42}, {})});
+  filter.SetParameters(0, scan_manager_parameters);
+  ASSERT_FALSE(filter.Matches(kOtherAddress, kRssi, kAdvertisingData));
+}
+
+TEST(LeHostScanFilterTest, truncated_data) {
+  LeHostScanFilter filter;
+  filter.Enable(true);
+  filter.AddConditions(0, {uuid_filter(Uuid::From16Bit(0x180D))});
+  filter.SetParameters(0, parameters(bit(ApcfFilterType::SERVICE_UUID)));
+  ASSERT_FALSE(filter.Matches(kAddress, kRssi, {0x05, 0x03, 0x0D, 0x18}));
+  ASSERT_TRUE(filter.Matches(kAddress, kRssi, {0x03, 0x03, 0x0D, 0x18, 0x09}));
+}
+
+}  // namespace
+}  // namespace hci
+}  // namespace bluetooth
@@ -15,6 +15,8 @@
  */
 #include "hci/le_scanning_manager.h"
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <unordered_map>
 
@@ -22,6 +24,8 @@
 #include "hci/controller.h"
 #include "hci/hci_layer.h"
 #include "hci/hci_packets.h"
+#include "hci/le_host_batch_scan_storage.h"
+#include "hci/le_host_scan_filter.h"
 #include "hci/le_periodic_sync_manager.h"
 #include "hci/le_scanning_interface.h"
 #include "hci/vendor_specific_event_manager.h"
@@ -291,6 +295,8 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
     }
     batch_scan_config_.current_state = BatchScanState::DISABLED_STATE;
     batch_scan_config_.ref_value = kInvalidScannerId;
+    host_batch_scanning_ = false;
+    host_batch_scan_storage_.Clear();
     scanning_callbacks_ = &null_scanning_callback_;
     periodic_sync_manager_.SetScanningCallback(scanning_callbacks_);
   }
@@ -466,6 +472,9 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
     }
 
     if (address_type == (uint8_t)DirectAdvertisingAddressType::NO_ADDRESS) {
+      if (!host_scan_filter_.Matches(address, rssi, significant_data)) {
+        return;
+      }
       scanning_callbacks_->OnScanResult(
           event_type,
           address_type,
@@ -505,6 +514,11 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
       return;
     }
 
+    if (!host_scan_filter_.Matches(address, rssi, adv_data)) {
+      advertising_cache_.Clear(address_with_type);
+      return;
+    }
+
     switch (address_type) {
       case (uint8_t)AddressType::PUBLIC_DEVICE_ADDRESS:
       case (uint8_t)AddressType::PUBLIC_IDENTITY_ADDRESS:
@@ -515,6 +529,18 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
         address_type = (uint8_t)AddressType::RANDOM_DEVICE_ADDRESS;
         break;
     }
+
+    if (host_batch_scanning_) {
+      if (host_batch_scan_storage_.Add(address, address_type, tx_power, rssi, adv_data, now_ms()) &&
+          batch_scan_config_.ref_value != kInvalidScannerId) {
+        scanning_callbacks_->OnBatchScanThresholdCrossed(static_cast<int>(batch_scan_config_.ref_value));
+      }
+      if (!scan_requested_) {
+        // Batched only, the scan results are read in bulk
+        advertising_cache_.Clear(address_with_type);
+        return;
+      }
+    }
     scanning_callbacks_->OnScanResult(
         event_type,
         address_type,
@@ -531,17 +557,20 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
   }
 
   void configure_scan() {
+    uint32_t interval = interval_ms_;
+    uint16_t window = window_ms_;
+    if (host_batch_scanning_ && !scan_requested_) {
+      interval = host_batch_scan_interval_;
+      window = host_batch_scan_window_;
+    }
     std::vector<PhyScanParameters> parameter_vector;
     PhyScanParameters phy_scan_parameters;
-    phy_scan_parameters.le_scan_window_ = window_ms_;
-    phy_scan_parameters.le_scan_interval_ = interval_ms_;
+    phy_scan_parameters.le_scan_window_ = window;
+    phy_scan_parameters.le_scan_interval_ = interval;
     phy_scan_parameters.le_scan_type_ = le_scan_type_;
     parameter_vector.push_back(phy_scan_parameters);
     uint8_t phys_in_use = 1;
 
-    // The Host shall not issue set scan parameter command when scanning is enabled
-    stop_scan();
-
     if (le_address_manager_->GetAddressPolicy() != LeAddressManager::USE_PUBLIC_ADDRESS) {
       own_address_type_ = OwnAddressType::RANDOM_DEVICE_ADDRESS;
     }
@@ -556,14 +585,14 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
       case ScanApiType::ANDROID_HCI:
         le_scanning_interface_->EnqueueCommand(
             hci::LeExtendedScanParamsBuilder::Create(
-                le_scan_type_, interval_ms_, window_ms_, own_address_type_, filter_policy_),
+                le_scan_type_, interval, window, own_address_type_, filter_policy_),
             module_handler_->BindOnceOn(this, &impl::on_set_scan_parameter_complete));
 
         break;
       case ScanApiType::LEGACY:
         le_scanning_interface_->EnqueueCommand(
             hci::LeSetScanParametersBuilder::Create(
-                le_scan_type_, interval_ms_, window_ms_, own_address_type_, filter_policy_),
+                le_scan_type_, interval, window, own_address_type_, filter_policy_),
             module_handler_->BindOnceOn(this, &impl::on_set_scan_parameter_complete));
         break;
     }
@@ -607,9 +636,14 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
   }
 
   void scan(bool start) {
+    scan_requested_ = start;
+    if (!start && host_batch_scanning_) {
+      // Keep scanning for the batch, with its own duty cycle
+      restart_scan();
+      return;
+    }
     if (start) {
-      configure_scan();
-      start_scan();
+      restart_scan();
     } else {
       if (address_manager_registered_) {
         le_address_manager_->Unregister(this);
@@ -620,6 +654,14 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
     }
   }
 
+  // Applies the current duty cycle. The Host shall not issue set scan parameter command when scanning is enabled,
+  // so a running scan is stopped first.
+  void restart_scan() {
+    stop_scan();
+    configure_scan();
+    start_scan();
+  }
+
   void start_scan() {
     // If we receive start_scan during paused, set scan_on_resume_ to true
     if (paused_) {
@@ -705,7 +747,7 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
 
   void scan_filter_enable(bool enable) {
     if (!is_filter_support_) {
-      LOG_WARN("Advertising filter is not supported");
+      host_scan_filter_.Enable(enable);
       return;
     }
 
@@ -728,14 +770,13 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
 
   void scan_filter_parameter_setup(
       ApcfAction action, uint8_t filter_index, AdvertisingFilterParameter advertising_filter_parameter) {
-    if (!is_filter_support_) {
-      LOG_WARN("Advertising filter is not supported");
-      return;
-    }
-
     auto entry = remove_me_later_map_.find(filter_index);
     switch (action) {
       case ApcfAction::ADD:
+        if (!is_filter_support_) {
+          host_scan_filter_.SetParameters(filter_index, advertising_filter_parameter);
+          break;
+        }
         le_scanning_interface_->EnqueueCommand(
             LeAdvFilterAddFilteringParametersBuilder::Create(
                 filter_index,
@@ -753,9 +794,13 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
         break;
       case ApcfAction::DELETE:
         tracker_id_map_.erase(filter_index);
-        le_scanning_interface_->EnqueueCommand(
-            LeAdvFilterDeleteFilteringParametersBuilder::Create(filter_index),
-            module_handler_->BindOnceOn(this, &impl::on_advertising_filter_complete));
+        if (is_filter_support_) {
+          le_scanning_interface_->EnqueueCommand(
+              LeAdvFilterDeleteFilteringParametersBuilder::Create(filter_index),
+              module_handler_->BindOnceOn(this, &impl::on_advertising_filter_complete));
+        } else {
+          host_scan_filter_.Delete(filter_index);
+        }
 
         // IRK Scanning
         if (entry != remove_me_later_map_.end()) {
@@ -769,9 +814,13 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
 
         break;
       case ApcfAction::CLEAR:
-        le_scanning_interface_->EnqueueCommand(
-            LeAdvFilterClearFilteringParametersBuilder::Create(),
-            module_handler_->BindOnceOn(this, &impl::on_advertising_filter_complete));
+        if (is_filter_support_) {
+          le_scanning_interface_->EnqueueCommand(
+              LeAdvFilterClearFilteringParametersBuilder::Create(),
+              module_handler_->BindOnceOn(this, &impl::on_advertising_filter_complete));
+        } else {
+          host_scan_filter_.Clear();
+        }
 
         // IRK Scanning
         if (entry != remove_me_later_map_.end()) {
@@ -791,11 +840,6 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
   }
 
   void scan_filter_add(uint8_t filter_index, std::vector<AdvertisingPacketContentFilterCommand> filters) {
-    if (!is_filter_support_) {
-      LOG_WARN("Advertising filter is not supported");
-      return;
-    }
-
     ApcfAction apcf_action = ApcfAction::ADD;
     for (auto filter : filters) {
       /* If data is passed, both mask and data have to be the same length */
@@ -804,6 +848,15 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
         continue;
       }
 
+      if (!is_filter_support_) {
+        // Matched in process_advertising_package_content, the controller still resolves the address
+        if (filter.filter_type == ApcfFilterType::BROADCASTER_ADDRESS && !is_empty_128bit(filter.irk)) {
+          add_to_resolving_list(filter_index, filter.address, filter.application_address_type, filter.irk);
+        }
+        host_scan_filter_.AddConditions(filter_index, {filter});
+        continue;
+      }
+
       switch (filter.filter_type) {
         case ApcfFilterType::BROADCASTER_ADDRESS: {
           update_address_filter(apcf_action, filter_index, filter.address, filter.application_address_type, filter.irk);
@@ -867,24 +920,7 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
               action, filter_index, address, ApcfApplicationAddressType::NOT_APPLICABLE),
           module_handler_->BindOnceOn(this, &impl::on_advertising_filter_complete));
       if (!is_empty_128bit(irk)) {
-        // If an entry exists for this filter index, replace data because the filter has been
-        // updated.
-        auto entry = remove_me_later_map_.find(filter_index);
-        // IRK Scanning
-        if (entry != remove_me_later_map_.end()) {
-          // Don't want to remove for a bonded device
-          if (!is_bonded(entry->second.GetAddress())) {
-            le_address_manager_->RemoveDeviceFromResolvingList(
-                static_cast<PeerAddressType>(entry->second.GetAddressType()), entry->second.GetAddress());
-          }
-          remove_me_later_map_.erase(filter_index);
-        }
-
-        // Now replace it with a new one
-        std::array<uint8_t, 16> empty_irk;
-        le_address_manager_->AddDeviceToResolvingList(
-            static_cast<PeerAddressType>(address_type), address, irk, empty_irk);
-        remove_me_later_map_.emplace(filter_index, AddressWithType(address, static_cast<AddressType>(address_type)));
+        add_to_resolving_list(filter_index, address, address_type, irk);
       }
     } else {
       le_scanning_interface_->EnqueueCommand(
@@ -899,6 +935,27 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
     }
   }
 
+  void add_to_resolving_list(
+      uint8_t filter_index, Address address, ApcfApplicationAddressType address_type, std::array<uint8_t, 16> irk) {
+    // If an entry exists for this filter index, replace data because the filter has been
+    // updated.
+    auto entry = remove_me_later_map_.find(filter_index);
+    // IRK Scanning
+    if (entry != remove_me_later_map_.end()) {
+      // Don't want to remove for a bonded device
+      if (!is_bonded(entry->second.GetAddress())) {
+        le_address_manager_->RemoveDeviceFromResolvingList(
+            static_cast<PeerAddressType>(entry->second.GetAddressType()), entry->second.GetAddress());
+      }
+      remove_me_later_map_.erase(filter_index);
+    }
+
+    // Now replace it with a new one
+    std::array<uint8_t, 16> empty_irk;
+    le_address_manager_->AddDeviceToResolvingList(static_cast<PeerAddressType>(address_type), address, irk, empty_irk);
+    remove_me_later_map_.emplace(filter_index, AddressWithType(address, static_cast<AddressType>(address_type)));
+  }
+
   bool is_empty_128bit(const std::array<uint8_t, 16> data) {
     for (int i = 0; i < 16; i++) {
       if (data[i] != (uint8_t)0) {
@@ -1051,12 +1108,13 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
       uint8_t batch_scan_truncated_max,
       uint8_t batch_scan_notify_threshold,
       ScannerId scanner_id) {
+    // scanner id for OnBatchScanThresholdCrossed
+    batch_scan_config_.ref_value = scanner_id;
     if (!is_batch_scan_support_) {
-      LOG_WARN("Batch scan is not supported");
+      host_batch_scan_storage_.SetStorageParameters(
+          batch_scan_full_max, batch_scan_truncated_max, batch_scan_notify_threshold);
       return;
     }
-    // scanner id for OnBatchScanThresholdCrossed
-    batch_scan_config_.ref_value = scanner_id;
 
     if (batch_scan_config_.current_state == BatchScanState::ERROR_STATE ||
         batch_scan_config_.current_state == BatchScanState::DISABLED_STATE ||
@@ -1079,7 +1137,8 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
       uint32_t duty_cycle_scan_interval_slots,
       BatchScanDiscardRule batch_scan_discard_rule) {
     if (!is_batch_scan_support_) {
-      LOG_WARN("Batch scan is not supported");
+      host_batch_scan_enable(
+          scan_mode, duty_cycle_scan_window_slots, duty_cycle_scan_interval_slots, batch_scan_discard_rule);
       return;
     }
 
@@ -1103,7 +1162,7 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
 
   void batch_scan_disable() {
     if (!is_batch_scan_support_) {
-      LOG_WARN("Batch scan is not supported");
+      host_batch_scan_disable();
       return;
     }
     batch_scan_config_.current_state = BatchScanState::DISABLE_CALLED;
@@ -1161,13 +1220,6 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
   }
 
   void batch_scan_read_results(ScannerId scanner_id, uint16_t total_num_of_records, BatchScanMode scan_mode) {
-    if (!is_batch_scan_support_) {
-      LOG_WARN("Batch scan is not supported");
-      int status = static_cast<int>(ErrorCode::UNSUPPORTED_FEATURE_OR_PARAMETER_VALUE);
-      scanning_callbacks_->OnBatchScanReports(scanner_id, status, 0, 0, {});
-      return;
-    }
-
     if (scan_mode != BatchScanMode::FULL && scan_mode != BatchScanMode::TRUNCATED) {
       LOG_WARN("Invalid scan mode %d", (uint16_t)scan_mode);
       int status = static_cast<int>(ErrorCode::INVALID_HCI_COMMAND_PARAMETERS);
@@ -1175,6 +1227,14 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
       return;
     }
 
+    if (!is_batch_scan_support_) {
+      std::vector<uint8_t> data;
+      uint16_t num_of_records = host_batch_scan_storage_.Read(scan_mode, now_ms(), data);
+      scanning_callbacks_->OnBatchScanReports(
+          scanner_id, 0x00, (int)scan_mode, total_num_of_records + num_of_records, std::move(data));
+      return;
+    }
+
     if (batch_scan_result_cache_.find(scanner_id) == batch_scan_result_cache_.end()) {
       std::vector<uint8_t> empty_data = {};
       batch_scan_result_cache_.emplace(scanner_id, empty_data);
@@ -1185,6 +1245,43 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
         module_handler_->BindOnceOn(this, &impl::on_batch_scan_read_result_complete, scanner_id, total_num_of_records));
   }
 
+  void host_batch_scan_enable(
+      BatchScanMode scan_mode,
+      uint32_t duty_cycle_scan_window_slots,
+      uint32_t duty_cycle_scan_interval_slots,
+      BatchScanDiscardRule batch_scan_discard_rule) {
+    if (scan_mode == BatchScanMode::DISABLE) {
+      host_batch_scan_disable();
+      return;
+    }
+    host_batch_scan_storage_.SetScanMode(scan_mode, batch_scan_discard_rule);
+    uint32_t max_scan_interval = api_type_ == ScanApiType::EXTENDED ? kLeExtendedScanIntervalMax : kLeScanIntervalMax;
+    host_batch_scan_interval_ =
+        std::clamp<uint32_t>(duty_cycle_scan_interval_slots, kLeScanIntervalMin, max_scan_interval);
+    host_batch_scan_window_ =
+        std::clamp<uint32_t>(duty_cycle_scan_window_slots, kLeScanWindowMin, host_batch_scan_interval_);
+    host_batch_scanning_ = true;
+    if (!scan_requested_) {
+      restart_scan();
+    }
+  }
+
+  void host_batch_scan_disable() {
+    host_batch_scan_storage_.SetScanMode(BatchScanMode::DISABLE, BatchScanDiscardRule::OLDEST);
+    if (!host_batch_scanning_) {
+      return;
+    }
+    host_batch_scanning_ = false;
+    if (!scan_requested_) {
+      scan(false);
+    }
+  }
+
+  static uint64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
   void start_sync(
       uint8_t sid, const AddressWithType& address_with_type, uint16_t skip, uint16_t timeout, int request_id) {
     if (!is_periodic_advertising_sync_transfer_sender_support_) {
@@ -1552,11 +1649,18 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
   PeriodicSyncManager periodic_sync_manager_{&null_scanning_callback_};
   std::vector<Scanner> scanners_;
   bool is_scanning_ = false;
+  // Scanning asked for by Scan(), as opposed to scanning for the host batch scan only
+  bool scan_requested_ = false;
   bool scan_on_resume_ = false;
   bool paused_ = false;
   AdvertisingCache advertising_cache_;
   bool is_filter_support_ = false;
+  LeHostScanFilter host_scan_filter_;
   bool is_batch_scan_support_ = false;
+  bool host_batch_scanning_ = false;
+  uint32_t host_batch_scan_interval_ = 0;
+  uint16_t host_batch_scan_window_ = 0;
+  LeHostBatchScanStorage host_batch_scan_storage_{kHostBatchScanStorageSize};
   bool is_periodic_advertising_sync_transfer_sender_support_ = false;
 
   LeScanType le_scan_type_ = LeScanType::ACTIVE;
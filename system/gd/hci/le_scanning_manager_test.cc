@@ -432,6 +432,81 @@ TEST_F(LeScanningManagerTest, start_scan_test) {
   test_hci_layer_->IncomingLeMetaEvent(LeAdvertisingReportBuilder::Create({report}));
 }
 
+TEST_F(LeScanningManagerTest, host_batch_scan_test) {
+  // Without the vendor command, batch scan configuration sends nothing to the controller
+  le_scanning_manager->BatchScanConifgStorage(100, 0, 95, 0x01);
+
+  // Enabling batch scan starts scanning with its duty cycle
+  test_hci_layer_->SetCommandFuture(2);
+  le_scanning_manager->BatchScanEnable(BatchScanMode::FULL, 2400, 2400, BatchScanDiscardRule::OLDEST);
+  ASSERT_EQ(param_opcode_, test_hci_layer_->GetCommand().GetOpCode());
+  test_hci_layer_->IncomingEvent(LeSetScanParametersCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+  ASSERT_EQ(enable_opcode_, test_hci_layer_->GetCommand().GetOpCode());
+  test_hci_layer_->IncomingEvent(LeSetScanEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+
+  LeAdvertisingResponse report{};
+  report.event_type_ = AdvertisingEventType::ADV_NONCONN_IND;
+  report.address_type_ = AddressType::PUBLIC_DEVICE_ADDRESS;
+  Address::FromString("12:34:56:78:9a:bc", report.address_);
+  std::vector<LengthAndData> adv_data{};
+  LengthAndData data_item{};
+  data_item.data_.push_back(static_cast<uint8_t>(GapDataType::FLAGS));
+  data_item.data_.push_back(0x34);
+  adv_data.push_back(data_item);
+  report.advertising_data_ = adv_data;
+
+  // Batched only, the report is not delivered as a scan result
+  EXPECT_CALL(mock_callbacks_, OnScanResult).Times(0);
+  test_hci_layer_->IncomingLeMetaEvent(LeAdvertisingReportBuilder::Create({report}));
+
+  EXPECT_CALL(
+      mock_callbacks_, OnBatchScanReports(0x01, 0x00, static_cast<int>(BatchScanMode::FULL), 1, testing::_));
+  le_scanning_manager->BatchScanReadReport(0x01, BatchScanMode::FULL);
+  fake_registry_.SynchronizeModuleHandler(&LeScanningManager::Factory, std::chrono::milliseconds(20));
+}
+
+TEST_F(LeScanningManagerTest, host_batch_scan_toggle_scan_test) {
+  test_hci_layer_->SetCommandFuture(2);
+  le_scanning_manager->BatchScanEnable(BatchScanMode::FULL, 24, 2400, BatchScanDiscardRule::OLDEST);
+  ASSERT_EQ(param_opcode_, test_hci_layer_->GetCommand().GetOpCode());
+  test_hci_layer_->IncomingEvent(LeSetScanParametersCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+  ASSERT_EQ(enable_opcode_, test_hci_layer_->GetCommand().GetOpCode());
+  test_hci_layer_->IncomingEvent(LeSetScanEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+
+  // Each duty cycle change stops the scan, sets the parameters and starts the scan again
+  auto expect_duty_cycle = [this](uint16_t interval, uint16_t window) {
+    auto disable_view = LeSetScanEnableView::Create(LeScanningCommandView::Create(test_hci_layer_->GetCommand()));
+    ASSERT_TRUE(disable_view.IsValid());
+    ASSERT_EQ(Enable::DISABLED, disable_view.GetLeScanEnable());
+    test_hci_layer_->IncomingEvent(LeSetScanEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+    auto param_view =
+        LeSetScanParametersView::Create(LeScanningCommandView::Create(test_hci_layer_->GetCommand()));
+    ASSERT_TRUE(param_view.IsValid());
+    ASSERT_EQ(interval, param_view.GetLeScanInterval());
+    ASSERT_EQ(window, param_view.GetLeScanWindow());
+    test_hci_layer_->IncomingEvent(LeSetScanParametersCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+    auto enable_view = LeSetScanEnableView::Create(LeScanningCommandView::Create(test_hci_layer_->GetCommand()));
+    ASSERT_TRUE(enable_view.IsValid());
+    ASSERT_EQ(Enable::ENABLED, enable_view.GetLeScanEnable());
+    test_hci_layer_->IncomingEvent(LeSetScanEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+  };
+
+  // The application duty cycle while it scans
+  test_hci_layer_->SetCommandFuture(3);
+  le_scanning_manager->Scan(true);
+  expect_duty_cycle(1000, 1000);
+
+  // Back to the batch duty cycle
+  test_hci_layer_->SetCommandFuture(3);
+  le_scanning_manager->Scan(false);
+  expect_duty_cycle(2400, 24);
+
+  // New batch parameters apply while batch scanning
+  test_hci_layer_->SetCommandFuture(3);
+  le_scanning_manager->BatchScanEnable(BatchScanMode::FULL, 48, 4800, BatchScanDiscardRule::OLDEST);
+  expect_duty_cycle(4800, 48);
+}
+
 TEST_F(LeAndroidHciScanningManagerTest, startup_teardown) {}
 
 TEST_F(LeAndroidHciScanningManagerTest, start_scan_test) {
@@ -17,7 +17,15 @@
 
 #include "metrics/counter_metrics.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <functional>
+
 #include "common/bind.h"
+#include "counter_metrics_generated.h"
 #include "os/log.h"
 #include "os/metrics.h"
 
@@ -28,6 +36,30 @@ const int COUNTER_METRICS_PERDIOD_MINUTES = 360; // Drain counters every 6 hours
 
 const ModuleFactory CounterMetrics::Factory = ModuleFactory([]() { return new CounterMetrics(); });
 
+namespace {
+
+size_t shard_count_for_this_device() {
+  long cpus = sysconf(_SC_NPROCESSORS_CONF);
+  if (cpus <= 0) {
+    return 1;
+  }
+  return std::min(static_cast<size_t>(cpus), CounterMetrics::kMaxShards);
+}
+
+int64_t saturating_add(int64_t total, int64_t count) {
+  return (LLONG_MAX - total < count) ? LLONG_MAX : total + count;
+}
+
+}  // namespace
+
+CounterMetrics::CounterMetrics()
+    : shard_count_(shard_count_for_this_device()), shards_(std::make_unique<Shard[]>(shard_count_)) {
+  for (size_t slot = 0; slot < kMaxKeys; slot++) {
+    keys_[slot].store(kUnusedKey, std::memory_order_relaxed);
+    near_overflow_[slot].store(false, std::memory_order_relaxed);
+  }
+}
+
 void CounterMetrics::ListDependencies(ModuleList* list) const {
 }
 
@@ -49,6 +81,31 @@ void CounterMetrics::Stop() {
   LOG_INFO("Counter metrics canceled");
 }
 
+size_t CounterMetrics::find_or_register_slot(int32_t key) {
+  size_t start = std::hash<int32_t>{}(key) % kMaxKeys;
+  for (size_t probe = 0; probe < kMaxKeys; probe++) {
+    auto& slot_key = keys_[(start + probe) % kMaxKeys];
+    int32_t current = slot_key.load(std::memory_order_acquire);
+    if (current == kUnusedKey) {
+      // Slots are never released, so losing the race only matters if the winner registered another key
+      if (slot_key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+        return (start + probe) % kMaxKeys;
+      }
+    }
+    if (current == key) {
+      return (start + probe) % kMaxKeys;
+    }
+  }
+  return kMaxKeys;
+}
+
+CounterMetrics::Shard& CounterMetrics::current_shard() {
+  // Threads are assigned a shard round robin the first time they count, and keep it
+  static std::atomic<size_t> next_thread_index{0};
+  thread_local size_t thread_index = next_thread_index.fetch_add(1, std::memory_order_relaxed);
+  return shards_[thread_index % shard_count_];
+}
+
 bool CounterMetrics::Count(int32_t key, int64_t count) {
   if (!IsInitialized()) {
     LOG_WARN("Counter metrics isn't initialized");
@@ -58,21 +115,70 @@ bool CounterMetrics::Count(int32_t key, int64_t count) {
     LOG_WARN("count is not larger than 0. count: %s, key: %d", std::to_string(count).c_str(), key);
     return false;
   }
-  int64_t total = 0;
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (counters_.find(key) != counters_.end()) {
-    total = counters_[key];
+  if (key == kUnusedKey) {
+    LOG_WARN("key %d is reserved", key);
+    return false;
   }
-  if (LLONG_MAX - total < count) {
+  size_t slot = find_or_register_slot(key);
+  if (slot == kMaxKeys) {
+    LOG_WARN("Too many counter metric keys, dropping key: %d", key);
+    return false;
+  }
+
+  // The merged total can only overflow once some shard holds a large value, so the cross-shard
+  // check is skipped until then and the common case touches a single cache line
+  auto& counter = current_shard().counts[slot];
+  if (count >= kNearOverflow || near_overflow_[slot].load(std::memory_order_relaxed)) {
+    int64_t total = sum_slot(slot);
+    if (LLONG_MAX - total < count) {
       LOG_WARN("Counter metric overflows. count %s current total: %s key: %d",
                std::to_string(count).c_str(), std::to_string(total).c_str(), key);
-      counters_[key] = LLONG_MAX;
+      counter.store(LLONG_MAX, std::memory_order_relaxed);
       return false;
+    }
+  }
+  int64_t total = counter.load(std::memory_order_relaxed);
+  while (!counter.compare_exchange_weak(
+      total, saturating_add(total, count), std::memory_order_relaxed, std::memory_order_relaxed)) {
+  }
+  if (saturating_add(total, count) >= kNearOverflow) {
+    near_overflow_[slot].store(true, std::memory_order_relaxed);
   }
-  counters_[key] = total + count;
   return true;
 }
 
+int64_t CounterMetrics::sum_slot(size_t slot) const {
+  int64_t total = 0;
+  for (size_t i = 0; i < shard_count_; i++) {
+    total = saturating_add(total, shards_[i].counts[slot].load(std::memory_order_relaxed));
+  }
+  return total;
+}
+
+int64_t CounterMetrics::take_slot(size_t slot) {
+  near_overflow_[slot].store(false, std::memory_order_relaxed);
+  int64_t total = 0;
+  for (size_t i = 0; i < shard_count_; i++) {
+    total = saturating_add(total, shards_[i].counts[slot].exchange(0, std::memory_order_relaxed));
+  }
+  return total;
+}
+
+std::unordered_map<int32_t, int64_t> CounterMetrics::GetSnapshot() const {
+  std::unordered_map<int32_t, int64_t> snapshot;
+  for (size_t slot = 0; slot < kMaxKeys; slot++) {
+    int32_t key = keys_[slot].load(std::memory_order_acquire);
+    if (key == kUnusedKey) {
+      continue;
+    }
+    int64_t total = sum_slot(slot);
+    if (total > 0) {
+      snapshot[key] = total;
+    }
+  }
+  return snapshot;
+}
+
 void CounterMetrics::WriteCounter(int32_t key, int64_t count) {
   os::LogMetricBluetoothCodePathCounterMetrics(key, count);
 }
@@ -82,12 +188,47 @@ void CounterMetrics::DrainBufferedCounters() {
     LOG_WARN("Counter metrics isn't initialized");
     return ;
   }
-  std::lock_guard<std::mutex> lock(mutex_);
   LOG_INFO("Draining buffered counters");
-  for (auto const& pair : counters_) {
-    WriteCounter(pair.first, pair.second);
+  for (size_t slot = 0; slot < kMaxKeys; slot++) {
+    int32_t key = keys_[slot].load(std::memory_order_acquire);
+    if (key == kUnusedKey) {
+      continue;
+    }
+    // Counts added between the per-shard exchanges land in the next drain instead of being lost
+    int64_t total = take_slot(slot);
+    if (total > 0) {
+      WriteCounter(key, total);
+    }
+  }
+}
+
+DumpsysDataFinisher CounterMetrics::GetDumpsysData(flatbuffers::FlatBufferBuilder* fb_builder) const {
+  ASSERT(fb_builder != nullptr);
+
+  size_t registered_keys = 0;
+  for (const auto& key : keys_) {
+    if (key.load(std::memory_order_relaxed) != kUnusedKey) {
+      registered_keys++;
+    }
+  }
+
+  std::vector<flatbuffers::Offset<CounterMetricsEntry>> entries;
+  for (const auto& pair : GetSnapshot()) {
+    entries.push_back(CreateCounterMetricsEntry(*fb_builder, pair.first, pair.second));
   }
-  counters_.clear();
+  auto entries_vector = fb_builder->CreateVector(entries);
+  auto title = fb_builder->CreateString(ToString());
+
+  CounterMetricsDataBuilder builder(*fb_builder);
+  builder.add_title(title);
+  builder.add_registered_key_count(registered_keys);
+  builder.add_shard_count(shard_count_);
+  builder.add_pending_counters(entries_vector);
+  auto dumpsys_data = builder.Finish();
+
+  return [dumpsys_data](DumpsysDataBuilder* dumpsys_builder) {
+    dumpsys_builder->add_counter_metrics_dumpsys_data(dumpsys_data);
+  };
 }
 
 }  // namespace metrics
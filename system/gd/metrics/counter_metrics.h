@@ -15,6 +15,10 @@
  */
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <climits>
+#include <memory>
 #include <unordered_map>
 
 #include "module.h"
@@ -23,10 +27,28 @@
 namespace bluetooth {
 namespace metrics {
 
+// Counts code path events and periodically drains them to the metrics backend.
+//
+// Count() is lock-free so it can be used on hot paths: keys are mapped to a
+// slot in a fixed size registry the first time they are seen, and each thread
+// increments the shard of slots it was assigned, one per CPU at most, with
+// relaxed atomics. Shards are only merged when draining or taking a snapshot.
 class CounterMetrics : public bluetooth::Module {
  public:
+  // Distinct keys that can be counted between restarts of the module
+  static constexpr size_t kMaxKeys = 256;
+  static constexpr size_t kMaxShards = 16;
+
+  CounterMetrics();
+  CounterMetrics(const CounterMetrics&) = delete;
+  CounterMetrics& operator=(const CounterMetrics&) = delete;
+
   bool Count(int32_t key, int64_t value);
   void Stop() override;
+
+  // Counts accumulated since the last drain, merged across shards. Does not reset them.
+  std::unordered_map<int32_t, int64_t> GetSnapshot() const;
+
   static const ModuleFactory Factory;
 
  protected:
@@ -35,6 +57,7 @@ class CounterMetrics : public bluetooth::Module {
   std::string ToString() const override {
     return std::string("BluetoothCounterMetrics");
   }
+  DumpsysDataFinisher GetDumpsysData(flatbuffers::FlatBufferBuilder* builder) const override;
   void DrainBufferedCounters();
   virtual void WriteCounter(int32_t key, int64_t count);
   virtual bool IsInitialized() {
@@ -42,11 +65,29 @@ class CounterMetrics : public bluetooth::Module {
   }
 
  private:
-  std::unordered_map<int32_t, int64_t> counters_;
-  mutable std::mutex mutex_;
+  static constexpr int32_t kUnusedKey = INT32_MIN;
+
+  struct alignas(64) Shard {
+    std::array<std::atomic<int64_t>, kMaxKeys> counts{};
+  };
+
+  // Returns the slot of |key|, registering it if needed, or kMaxKeys when the registry is full
+  size_t find_or_register_slot(int32_t key);
+  Shard& current_shard();
+  // Sum of |slot| over all shards, saturating at LLONG_MAX
+  int64_t sum_slot(size_t slot) const;
+  // Same as sum_slot(), resetting the slot in every shard
+  int64_t take_slot(size_t slot);
+
+  static constexpr int64_t kNearOverflow = LLONG_MAX / kMaxShards;
+
+  std::array<std::atomic<int32_t>, kMaxKeys> keys_;
+  std::array<std::atomic_bool, kMaxKeys> near_overflow_;
+  size_t shard_count_;
+  std::unique_ptr<Shard[]> shards_;
   std::unique_ptr<os::RepeatingAlarm> alarm_;
-  bool initialized_ {false};
+  std::atomic_bool initialized_{false};
 };
 
 }  // namespace metrics
-}  // namespace bluetooth
\ No newline at end of file
+}  // namespace bluetooth
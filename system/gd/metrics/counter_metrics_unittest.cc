@@ -16,7 +16,9 @@
 
 #include "metrics/counter_metrics.h"
 
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -86,6 +88,52 @@ TEST_F(CounterMetricsTest, non_positive) {
   ASSERT_EQ(testable_counter_metrics_.test_counters_[1], 5);
 }
 
+TEST_F(CounterMetricsTest, snapshot_does_not_drain) {
+  ASSERT_TRUE(testable_counter_metrics_.Count(1, 2));
+  ASSERT_TRUE(testable_counter_metrics_.Count(2, 4));
+  auto snapshot = testable_counter_metrics_.GetSnapshot();
+  ASSERT_EQ(snapshot.size(), 2u);
+  ASSERT_EQ(snapshot[1], 2);
+  ASSERT_EQ(snapshot[2], 4);
+  testable_counter_metrics_.DrainBuffer();
+  ASSERT_EQ(testable_counter_metrics_.test_counters_[1], 2);
+  ASSERT_EQ(testable_counter_metrics_.test_counters_[2], 4);
+  ASSERT_TRUE(testable_counter_metrics_.GetSnapshot().empty());
+}
+
+TEST_F(CounterMetricsTest, count_from_multiple_threads) {
+  constexpr int kThreads = 8;
+  constexpr int kCountsPerThread = 10000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([this]() {
+      for (int j = 0; j < kCountsPerThread; j++) {
+        testable_counter_metrics_.Count(1, 1);
+        testable_counter_metrics_.Count(j % 4 + 2, 2);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  testable_counter_metrics_.DrainBuffer();
+  ASSERT_EQ(testable_counter_metrics_.test_counters_[1], kThreads * kCountsPerThread);
+  for (int key = 2; key < 6; key++) {
+    ASSERT_EQ(testable_counter_metrics_.test_counters_[key], kThreads * kCountsPerThread / 2);
+  }
+}
+
+TEST_F(CounterMetricsTest, too_many_keys) {
+  for (int32_t key = 0; key < static_cast<int32_t>(CounterMetrics::kMaxKeys); key++) {
+    ASSERT_TRUE(testable_counter_metrics_.Count(key, 1));
+  }
+  ASSERT_FALSE(testable_counter_metrics_.Count(CounterMetrics::kMaxKeys, 1));
+  // Registered keys keep counting after a drain
+  testable_counter_metrics_.DrainBuffer();
+  ASSERT_TRUE(testable_counter_metrics_.Count(0, 1));
+  ASSERT_EQ(testable_counter_metrics_.GetSnapshot()[0], 1);
+}
+
 }  // namespace
 }  // namespace metrics
 }  // namespace bluetooth
@@ -18,6 +18,7 @@
 #include "module.h"
 #include "common/init_flags.h"
 #include "dumpsys/init_flags.h"
+#include "dumpsys/trace_points.h"
 #include "os/wakelock_manager.h"
 
 using ::bluetooth::os::Handler;
@@ -142,6 +143,7 @@ void ModuleDumper::DumpState(std::string* output) const {
 
   auto init_flags_offset = dumpsys::InitFlags::Dump(&builder);
   auto wakelock_offset = WakelockManager::Get().GetDumpsysData(&builder);
+  auto trace_points_offset = dumpsys::TracePoints::Dump(&builder);
 
   std::queue<DumpsysDataFinisher> queue;
   for (auto it = module_registry_.start_order_.rbegin(); it != module_registry_.start_order_.rend(); it++) {
@@ -154,6 +156,7 @@ void ModuleDumper::DumpState(std::string* output) const {
   data_builder.add_title(title);
   data_builder.add_init_flags(init_flags_offset);
   data_builder.add_wakelock_manager_data(wakelock_offset);
+  data_builder.add_trace_points(trace_points_offset);
 
   while (!queue.empty()) {
     queue.front()(&data_builder);
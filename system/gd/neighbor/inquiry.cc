@@ -57,6 +57,7 @@ struct InquiryModule::impl {
   void Stop();
 
   bool HasCallbacks() const;
+  bool IsInquiryActive() const;
 
   impl(InquiryModule& inquiry_module);
 
@@ -75,8 +76,6 @@ struct InquiryModule::impl {
   hci::InquiryScanType inquiry_scan_type_;
   int8_t inquiry_response_tx_power_;
 
-  bool IsInquiryActive() const;
-
   void EnqueueCommandComplete(std::unique_ptr<hci::CommandBuilder> command);
   void EnqueueCommandStatus(std::unique_ptr<hci::CommandBuilder> command);
   void OnCommandComplete(hci::CommandCompleteView view);
@@ -452,6 +451,10 @@ void neighbor::InquiryModule::StopPeriodicInquiry() {
       common::BindOnce(&neighbor::InquiryModule::impl::StopPeriodicInquiry, common::Unretained(pimpl_.get())));
 }
 
+bool neighbor::InquiryModule::IsInquiryActive() const {
+  return pimpl_->IsInquiryActive();
+}
+
 void neighbor::InquiryModule::SetScanActivity(ScanParameters params) {
   GetHandler()->Post(
       common::BindOnce(&neighbor::InquiryModule::impl::SetScanActivity, common::Unretained(pimpl_.get()), params));
@@ -55,6 +55,9 @@ class InquiryModule : public bluetooth::Module {
       InquiryLength inquiry_length, NumResponses num_responses, PeriodLength max_delay, PeriodLength min_delay);
   void StopPeriodicInquiry();
 
+  // Whether a one shot or periodic inquiry is in progress. Must be called from the module thread
+  virtual bool IsInquiryActive() const;
+
   void SetScanActivity(ScanParameters parms);
 
   void SetInterlacedScan();
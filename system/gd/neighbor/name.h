@@ -33,7 +33,7 @@ using CancelRemoteNameCallback = common::OnceCallback<void(hci::ErrorCode status
 
 class NameModule : public bluetooth::Module {
  public:
-  void ReadRemoteNameRequest(
+  virtual void ReadRemoteNameRequest(
       hci::Address address,
       hci::PageScanRepetitionMode page_scan_repetition_mode,
       uint16_t clock_offset,
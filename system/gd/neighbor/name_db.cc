@@ -17,28 +17,55 @@
 
 #include "neighbor/name_db.h"
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <list>
 #include <memory>
+#include <optional>
+#include <string>
 #include <unordered_map>
 #include <utility>
 
 #include "common/bind.h"
 #include "module.h"
+#include "neighbor/inquiry.h"
 #include "neighbor/name.h"
+#include "os/alarm.h"
 #include "os/handler.h"
 #include "os/log.h"
+#include "storage/storage_module.h"
 
 namespace bluetooth {
 namespace neighbor {
 
 namespace {
+// How long a background request waits before checking again whether the inquiry completed
+constexpr std::chrono::milliseconds kInquiryRetryDelay = std::chrono::milliseconds(500);
+
 struct PendingRemoteNameRead {
   ReadRemoteNameDbCallback callback_;
   os::Handler* handler_;
 };
+
+struct CachedRemoteName {
+  RemoteName name;
+  int64_t unix_timestamp;
+};
+
+int64_t NowUnixTimestamp() {
+  return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool IsFresh(int64_t unix_timestamp) {
+  auto age = NowUnixTimestamp() - unix_timestamp;
+  return age >= 0 && age < NameDbModule::kNameCacheTtl.count();
+}
 }  // namespace
 
 struct NameDbModule::impl {
-  void ReadRemoteNameRequest(hci::Address address, ReadRemoteNameDbCallback callback, os::Handler* handler);
+  void ReadRemoteNameRequest(
+      hci::Address address, bool user_visible, ReadRemoteNameDbCallback callback, os::Handler* handler);
 
   bool IsNameCached(hci::Address address) const;
   RemoteName ReadCachedRemoteName(hci::Address address) const;
@@ -50,11 +77,24 @@ struct NameDbModule::impl {
 
  private:
   std::unordered_map<hci::Address, std::list<PendingRemoteNameRead>> address_to_pending_read_map_;
-  std::unordered_map<hci::Address, RemoteName> address_to_name_map_;
-
+  std::unordered_map<hci::Address, CachedRemoteName> address_to_name_map_;
+
+  // Addresses waiting for their Remote Name Request, names shown to the user first
+  std::deque<hci::Address> user_visible_queue_;
+  std::deque<hci::Address> background_queue_;
+  hci::Address in_flight_address_ = hci::Address::kEmpty;
+  bool retry_scheduled_ = false;
+
+  std::optional<CachedRemoteName> GetCachedName(hci::Address address) const;
+  void StoreName(hci::Address address, const RemoteName& name);
+  void ScheduleNextRequest();
+  void OnRetry();
   void OnRemoteNameResponse(hci::ErrorCode status, hci::Address address, RemoteName name);
 
   neighbor::NameModule* name_module_;
+  neighbor::InquiryModule* inquiry_module_;
+  storage::StorageModule* storage_module_;
+  std::unique_ptr<os::Alarm> retry_alarm_;
 
   const NameDbModule& module_;
   os::Handler* handler_;
@@ -65,23 +105,63 @@ const ModuleFactory neighbor::NameDbModule::Factory = ModuleFactory([]() { retur
 neighbor::NameDbModule::impl::impl(const neighbor::NameDbModule& module) : module_(module) {}
 
 void neighbor::NameDbModule::impl::ReadRemoteNameRequest(
-    hci::Address address, ReadRemoteNameDbCallback callback, os::Handler* handler) {
-  if (address_to_pending_read_map_.find(address) != address_to_pending_read_map_.end()) {
-    LOG_WARN("Already have remote read db in progress; adding callback to callback list");
-    address_to_pending_read_map_[address].push_back({std::move(callback), handler});
+    hci::Address address, bool user_visible, ReadRemoteNameDbCallback callback, os::Handler* handler) {
+  if (IsNameCached(address)) {
+    handler->Call(std::move(callback), address, true);
+    return;
+  }
+
+  auto pending = address_to_pending_read_map_.find(address);
+  if (pending != address_to_pending_read_map_.end()) {
+    LOG_INFO("Already have remote read db in progress; adding callback to callback list");
+    pending->second.push_back({std::move(callback), handler});
+    auto queued = std::find(background_queue_.begin(), background_queue_.end(), address);
+    if (user_visible && queued != background_queue_.end()) {
+      background_queue_.erase(queued);
+      user_visible_queue_.push_back(address);
+    }
     return;
   }
 
-  std::list<PendingRemoteNameRead> tmp;
-  address_to_pending_read_map_[address] = std::move(tmp);
   address_to_pending_read_map_[address].push_back({std::move(callback), handler});
+  if (user_visible) {
+    user_visible_queue_.push_back(address);
+  } else {
+    background_queue_.push_back(address);
+  }
+  ScheduleNextRequest();
+}
+
+void neighbor::NameDbModule::impl::ScheduleNextRequest() {
+  if (!in_flight_address_.IsEmpty()) {
+    return;
+  }
+
+  if (!user_visible_queue_.empty()) {
+    in_flight_address_ = user_visible_queue_.front();
+    user_visible_queue_.pop_front();
+  } else if (!background_queue_.empty()) {
+    // Paging the remote device while inquiring slows both down, the background requests can wait
+    if (inquiry_module_->IsInquiryActive()) {
+      if (!retry_scheduled_) {
+        retry_scheduled_ = true;
+        retry_alarm_->Schedule(
+            common::BindOnce(&NameDbModule::impl::OnRetry, common::Unretained(this)), kInquiryRetryDelay);
+      }
+      return;
+    }
+    in_flight_address_ = background_queue_.front();
+    background_queue_.pop_front();
+  } else {
+    return;
+  }
 
   // TODO(cmanton) Use remote name request defaults for now
   hci::PageScanRepetitionMode page_scan_repetition_mode = hci::PageScanRepetitionMode::R1;
   uint16_t clock_offset = 0;
   hci::ClockOffsetValid clock_offset_valid = hci::ClockOffsetValid::INVALID;
   name_module_->ReadRemoteNameRequest(
-      address,
+      in_flight_address_,
       page_scan_repetition_mode,
       clock_offset,
       clock_offset_valid,
@@ -89,25 +169,70 @@ void neighbor::NameDbModule::impl::ReadRemoteNameRequest(
       handler_);
 }
 
+void neighbor::NameDbModule::impl::OnRetry() {
+  retry_scheduled_ = false;
+  ScheduleNextRequest();
+}
+
 void neighbor::NameDbModule::impl::OnRemoteNameResponse(hci::ErrorCode status, hci::Address address, RemoteName name) {
   ASSERT(address_to_pending_read_map_.find(address) != address_to_pending_read_map_.end());
+  if (address == in_flight_address_) {
+    in_flight_address_ = hci::Address::kEmpty;
+  }
   if (status == hci::ErrorCode::SUCCESS) {
-    address_to_name_map_[address] = name;
+    StoreName(address, name);
   }
   auto& callback_list = address_to_pending_read_map_.at(address);
   for (auto& it : callback_list) {
     it.handler_->Call(std::move(it.callback_), address, status == hci::ErrorCode::SUCCESS);
   }
   address_to_pending_read_map_.erase(address);
+  ScheduleNextRequest();
+}
+
+std::optional<CachedRemoteName> neighbor::NameDbModule::impl::GetCachedName(hci::Address address) const {
+  auto cached = address_to_name_map_.find(address);
+  if (cached != address_to_name_map_.end()) {
+    return cached->second;
+  }
+
+  auto device = storage_module_->GetDeviceByClassicMacAddress(address);
+  auto name = device.GetName();
+  auto unix_timestamp = device.GetNameUnixTimestamp();
+  if (!name || !unix_timestamp) {
+    return std::nullopt;
+  }
+  CachedRemoteName stored_name{.name = {}, .unix_timestamp = *unix_timestamp};
+  std::copy_n(name->begin(), std::min(name->size(), stored_name.name.size() - 1), stored_name.name.begin());
+  return stored_name;
+}
+
+void neighbor::NameDbModule::impl::StoreName(hci::Address address, const RemoteName& name) {
+  auto unix_timestamp = NowUnixTimestamp();
+  address_to_name_map_[address] = {.name = name, .unix_timestamp = unix_timestamp};
+
+  // The name is null terminated unless it takes the whole array
+  auto name_end = std::find(name.begin(), name.end(), '\0');
+  auto device = storage_module_->GetDeviceByClassicMacAddress(address);
+  auto mutation = storage_module_->Modify();
+  mutation.Add(device.SetName(std::string(name.begin(), name_end)));
+  mutation.Add(device.SetNameUnixTimestamp(unix_timestamp));
+  mutation.Commit();
 }
 
 bool neighbor::NameDbModule::impl::IsNameCached(hci::Address address) const {
-  return address_to_name_map_.count(address) == 1;
+  auto cached = GetCachedName(address);
+  return cached.has_value() && IsFresh(cached->unix_timestamp);
 }
 
 RemoteName neighbor::NameDbModule::impl::ReadCachedRemoteName(hci::Address address) const {
-  ASSERT(IsNameCached(address));
-  return address_to_name_map_.at(address);
+  // A name can expire between IsNameCached() and this call, it is still the best one known
+  auto cached = GetCachedName(address);
+  if (!cached.has_value()) {
+    LOG_WARN("No cached name for %s", address.ToString().c_str());
+    return {};
+  }
+  return cached->name;
 }
 
 /**
@@ -125,6 +250,18 @@ void neighbor::NameDbModule::ReadRemoteNameRequest(
       &NameDbModule::impl::ReadRemoteNameRequest,
       common::Unretained(pimpl_.get()),
       address,
+      true,
+      std::move(callback),
+      handler));
+}
+
+void neighbor::NameDbModule::ReadRemoteNameRequestInBackground(
+    hci::Address address, ReadRemoteNameDbCallback callback, os::Handler* handler) {
+  GetHandler()->Post(common::BindOnce(
+      &NameDbModule::impl::ReadRemoteNameRequest,
+      common::Unretained(pimpl_.get()),
+      address,
+      false,
       std::move(callback),
       handler));
 }
@@ -139,16 +276,24 @@ RemoteName neighbor::NameDbModule::ReadCachedRemoteName(hci::Address address) co
 
 void neighbor::NameDbModule::impl::Start() {
   name_module_ = module_.GetDependency<neighbor::NameModule>();
+  inquiry_module_ = module_.GetDependency<neighbor::InquiryModule>();
+  storage_module_ = module_.GetDependency<storage::StorageModule>();
   handler_ = module_.GetHandler();
+  retry_alarm_ = std::make_unique<os::Alarm>(handler_);
 }
 
-void neighbor::NameDbModule::impl::Stop() {}
+void neighbor::NameDbModule::impl::Stop() {
+  retry_alarm_->Cancel();
+  retry_alarm_.reset();
+}
 
 /**
  * Module methods here
  */
 void neighbor::NameDbModule::ListDependencies(ModuleList* list) const {
   list->add<neighbor::NameModule>();
+  list->add<neighbor::InquiryModule>();
+  list->add<storage::StorageModule>();
 }
 
 void neighbor::NameDbModule::Start() {
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <array>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 
@@ -30,11 +31,24 @@ namespace neighbor {
 
 using ReadRemoteNameDbCallback = common::OnceCallback<void(hci::Address address, bool success)>;
 
+// Remote names are cached in memory and stored with the device in StorageModule, and are read again once they are
+// older than kNameCacheTtl. Requests for an address already being read share the same Remote Name Request.
+//
+// StorageModule only writes bonded devices to disk, so the names of other devices are kept in its temporary device
+// cache and read again after a restart. Discovered devices are deliberately not persisted just for their names.
+//
+// Remote Name Requests page the remote device, so only one is issued at a time. Requests for names shown to the user
+// are issued first, and background requests are held while an inquiry is in progress.
 class NameDbModule : public bluetooth::Module {
  public:
+  static constexpr std::chrono::seconds kNameCacheTtl = std::chrono::hours(24 * 7);
+
   virtual void ReadRemoteNameRequest(hci::Address address, ReadRemoteNameDbCallback callback, os::Handler* handler);
+  // For names not yet shown to the user, e.g. prefetched during discovery
+  void ReadRemoteNameRequestInBackground(hci::Address address, ReadRemoteNameDbCallback callback, os::Handler* handler);
 
   bool IsNameCached(hci::Address address) const;
+  // The last name read, even if older than kNameCacheTtl, or an empty name when there is none
   RemoteName ReadCachedRemoteName(hci::Address address) const;
 
   static const ModuleFactory Factory;
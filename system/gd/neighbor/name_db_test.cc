@@ -0,0 +1,254 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "neighbor/name_db.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include "common/bind.h"
+#include "neighbor/inquiry.h"
+#include "neighbor/name.h"
+#include "storage/storage_module.h"
+
+namespace bluetooth {
+namespace neighbor {
+namespace {
+
+constexpr std::chrono::milliseconds kTimeout = std::chrono::milliseconds(100);
+
+const hci::Address kAddress({0x01, 0x02, 0x03, 0x04, 0x05, 0x06});
+const hci::Address kOtherAddress({0x06, 0x05, 0x04, 0x03, 0x02, 0x01});
+const hci::Address kThirdAddress({0x01, 0x01, 0x01, 0x01, 0x01, 0x01});
+const RemoteName kName = {'T', 'e', 's', 't'};
+
+class TestNameModule : public NameModule {
+ public:
+  void ReadRemoteNameRequest(
+      hci::Address address,
+      hci::PageScanRepetitionMode page_scan_repetition_mode,
+      uint16_t clock_offset,
+      hci::ClockOffsetValid clock_offset_valid,
+      ReadRemoteNameCallback on_read_name,
+      os::Handler* handler) override {
+    requests_.push_back(address);
+    pending_.push_back({address, std::move(on_read_name), handler});
+  }
+
+  void Complete(hci::ErrorCode status, RemoteName name) {
+    ASSERT_FALSE(pending_.empty());
+    auto pending = std::move(pending_.front());
+    pending_.pop_front();
+    pending.handler->Post(common::BindOnce(std::move(pending.callback), status, pending.address, name));
+  }
+
+  std::vector<hci::Address> requests_;
+
+ protected:
+  void ListDependencies(ModuleList* list) const override {}
+  void Start() override {}
+  void Stop() override {}
+
+ private:
+  struct PendingRead {
+    hci::Address address;
+    ReadRemoteNameCallback callback;
+    os::Handler* handler;
+  };
+  std::deque<PendingRead> pending_;
+};
+
+class TestInquiryModule : public InquiryModule {
+ public:
+  bool IsInquiryActive() const override {
+    return inquiry_active_;
+  }
+
+  std::atomic<bool> inquiry_active_{false};
+
+ protected:
+  void ListDependencies(ModuleList* list) const override {}
+  void Start() override {}
+  void Stop() override {}
+};
+
+class TestStorageModule : public storage::StorageModule {
+ public:
+  explicit TestStorageModule(std::string config_file_path)
+      : StorageModule(std::move(config_file_path), std::chrono::milliseconds(100), 100, false, false) {}
+};
+
+class NameDbTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    temp_config_ = std::filesystem::temp_directory_path() / "name_db_test_config.txt";
+    DeleteConfigFiles();
+
+    name_module_ = new TestNameModule();
+    inquiry_module_ = new TestInquiryModule();
+    storage_module_ = new TestStorageModule(temp_config_.string());
+    fake_registry_.InjectTestModule(&NameModule::Factory, name_module_);
+    fake_registry_.InjectTestModule(&InquiryModule::Factory, inquiry_module_);
+    fake_registry_.InjectTestModule(&storage::StorageModule::Factory, storage_module_);
+    client_handler_ = fake_registry_.GetTestModuleHandler(&NameModule::Factory);
+    fake_registry_.Start<NameDbModule>(&thread_);
+    name_db_ = fake_registry_.GetModuleUnderTest<NameDbModule>();
+  }
+
+  void TearDown() override {
+    fake_registry_.StopAll();
+    DeleteConfigFiles();
+  }
+
+  void DeleteConfigFiles() {
+    std::filesystem::remove(temp_config_);
+    std::filesystem::remove(temp_config_.string() + ".bak");
+  }
+
+  void Sync() {
+    for (int i = 0; i < 2; i++) {
+      ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&NameDbModule::Factory, kTimeout));
+      ASSERT_TRUE(fake_registry_.SynchronizeHandler(client_handler_, kTimeout));
+    }
+  }
+
+  void ReadName(hci::Address address) {
+    name_db_->ReadRemoteNameRequest(
+        address, common::BindOnce(&NameDbTest::OnNameRead, common::Unretained(this)), client_handler_);
+  }
+
+  void ReadNameInBackground(hci::Address address) {
+    name_db_->ReadRemoteNameRequestInBackground(
+        address, common::BindOnce(&NameDbTest::OnNameRead, common::Unretained(this)), client_handler_);
+  }
+
+  void OnNameRead(hci::Address address, bool success) {
+    results_.push_back({address, success});
+  }
+
+  void StoreName(hci::Address address, std::chrono::seconds age) {
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch());
+    auto device = storage_module_->GetDeviceByClassicMacAddress(address);
+    auto mutation = storage_module_->Modify();
+    mutation.Add(device.SetName("Stored"));
+    mutation.Add(device.SetNameUnixTimestamp((now - age).count()));
+    mutation.Commit();
+  }
+
+  TestModuleRegistry fake_registry_;
+  os::Thread& thread_ = fake_registry_.GetTestThread();
+  std::filesystem::path temp_config_;
+  TestNameModule* name_module_ = nullptr;
+  TestInquiryModule* inquiry_module_ = nullptr;
+  TestStorageModule* storage_module_ = nullptr;
+  os::Handler* client_handler_ = nullptr;
+  NameDbModule* name_db_ = nullptr;
+  std::vector<std::pair<hci::Address, bool>> results_;
+};
+
+TEST_F(NameDbTest, concurrent_requests_are_coalesced) {
+  ReadName(kAddress);
+  ReadNameInBackground(kAddress);
+  Sync();
+  ASSERT_EQ(name_module_->requests_, std::vector<hci::Address>({kAddress}));
+  ASSERT_FALSE(name_db_->IsNameCached(kAddress));
+
+  name_module_->Complete(hci::ErrorCode::SUCCESS, kName);
+  Sync();
+  ASSERT_EQ(results_.size(), 2u);
+  ASSERT_TRUE(results_[0].second);
+  ASSERT_TRUE(results_[1].second);
+  ASSERT_TRUE(name_db_->IsNameCached(kAddress));
+  ASSERT_EQ(name_db_->ReadCachedRemoteName(kAddress), kName);
+  ASSERT_EQ(storage_module_->GetDeviceByClassicMacAddress(kAddress).GetName(), "Test");
+
+  // Served from the cache
+  ReadName(kAddress);
+  Sync();
+  ASSERT_EQ(name_module_->requests_.size(), 1u);
+  ASSERT_EQ(results_.size(), 3u);
+}
+
+TEST_F(NameDbTest, failed_request_is_not_cached) {
+  ReadName(kAddress);
+  Sync();
+  name_module_->Complete(hci::ErrorCode::PAGE_TIMEOUT, {});
+  Sync();
+  ASSERT_EQ(results_.size(), 1u);
+  ASSERT_FALSE(results_[0].second);
+  ASSERT_FALSE(name_db_->IsNameCached(kAddress));
+}
+
+TEST_F(NameDbTest, stored_names_expire) {
+  StoreName(kAddress, std::chrono::hours(1));
+  StoreName(kOtherAddress, NameDbModule::kNameCacheTtl + std::chrono::hours(1));
+  ASSERT_TRUE(name_db_->IsNameCached(kAddress));
+  RemoteName stored_name = {'S', 't', 'o', 'r', 'e', 'd'};
+  ASSERT_EQ(name_db_->ReadCachedRemoteName(kAddress), stored_name);
+  ASSERT_FALSE(name_db_->IsNameCached(kOtherAddress));
+  // Expired names can still be read, unknown ones are empty
+  ASSERT_EQ(name_db_->ReadCachedRemoteName(kOtherAddress), stored_name);
+  ASSERT_EQ(name_db_->ReadCachedRemoteName(kThirdAddress), RemoteName{});
+
+  ReadName(kAddress);
+  ReadName(kOtherAddress);
+  Sync();
+  ASSERT_EQ(name_module_->requests_, std::vector<hci::Address>({kOtherAddress}));
+}
+
+TEST_F(NameDbTest, requests_are_serialized_by_priority) {
+  ReadNameInBackground(kAddress);
+  ReadNameInBackground(kOtherAddress);
+  ReadName(kThirdAddress);
+  Sync();
+  ASSERT_EQ(name_module_->requests_, std::vector<hci::Address>({kAddress}));
+
+  name_module_->Complete(hci::ErrorCode::SUCCESS, kName);
+  Sync();
+  name_module_->Complete(hci::ErrorCode::SUCCESS, kName);
+  Sync();
+  ASSERT_EQ(name_module_->requests_, std::vector<hci::Address>({kAddress, kThirdAddress, kOtherAddress}));
+}
+
+TEST_F(NameDbTest, background_requests_wait_for_inquiry) {
+  inquiry_module_->inquiry_active_ = true;
+  ReadNameInBackground(kAddress);
+  Sync();
+  ASSERT_TRUE(name_module_->requests_.empty());
+
+  // Shown to the user, not held
+  ReadName(kOtherAddress);
+  Sync();
+  ASSERT_EQ(name_module_->requests_, std::vector<hci::Address>({kOtherAddress}));
+  name_module_->Complete(hci::ErrorCode::SUCCESS, kName);
+  Sync();
+  ASSERT_EQ(name_module_->requests_.size(), 1u);
+
+  inquiry_module_->inquiry_active_ = false;
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  Sync();
+  ASSERT_EQ(name_module_->requests_, std::vector<hci::Address>({kOtherAddress, kAddress}));
+}
+
+}  // namespace
+}  // namespace neighbor
+}  // namespace bluetooth
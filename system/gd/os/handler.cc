@@ -20,6 +20,7 @@
 
 #include "common/bind.h"
 #include "common/callback.h"
+#include "common/trace_point.h"
 #include "os/log.h"
 #include "os/reactor.h"
 #include "os/utils.h"
@@ -28,7 +29,10 @@ namespace bluetooth {
 namespace os {
 using common::OnceClosure;
 
-Handler::Handler(Thread* thread) : tasks_(new std::queue<OnceClosure>()), thread_(thread) {
+// Time from Post() until the closure starts running, across all handlers
+BT_TRACE_POINT(handler_queue_delay, "os.handler.queue_delay");
+
+Handler::Handler(Thread* thread) : tasks_(new std::queue<PendingTask>()), thread_(thread) {
   event_ = thread_->GetReactor()->NewEvent();
   reactable_ = thread_->GetReactor()->Register(
       event_->Id(), common::Bind(&Handler::handle_next_event, common::Unretained(this)), common::Closure());
@@ -49,13 +53,13 @@ void Handler::Post(OnceClosure closure) {
       LOG_WARN("Posting to a handler which has been cleared");
       return;
     }
-    tasks_->emplace(std::move(closure));
+    tasks_->push(PendingTask{std::move(closure), std::chrono::steady_clock::now()});
   }
   event_->Notify();
 }
 
 void Handler::Clear() {
-  std::queue<OnceClosure>* tmp = nullptr;
+  std::queue<PendingTask>* tmp = nullptr;
   {
     std::lock_guard<std::mutex> lock(mutex_);
     ASSERT_LOG(!was_cleared(), "Handlers must only be cleared once");
@@ -76,6 +80,7 @@ void Handler::WaitUntilStopped(std::chrono::milliseconds timeout) {
 
 void Handler::handle_next_event() {
   common::OnceClosure closure;
+  std::chrono::steady_clock::time_point post_time;
   {
     std::lock_guard<std::mutex> lock(mutex_);
     bool has_data = event_->Read();
@@ -85,9 +90,11 @@ void Handler::handle_next_event() {
     }
     ASSERT_LOG(has_data, "Notified for work but no work available");
 
-    closure = std::move(tasks_->front());
+    closure = std::move(tasks_->front().closure);
+    post_time = tasks_->front().post_time;
     tasks_->pop();
   }
+  handler_queue_delay.RecordSince(post_time);
   std::move(closure).Run();
 }
 
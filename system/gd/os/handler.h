@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -98,10 +99,15 @@ class Handler : public common::IPostableContext {
   friend class RepeatingAlarm;
 
  private:
+  struct PendingTask {
+    common::OnceClosure closure;
+    std::chrono::steady_clock::time_point post_time;
+  };
+
   inline bool was_cleared() const {
     return tasks_ == nullptr;
   };
-  std::queue<common::OnceClosure>* tasks_;
+  std::queue<PendingTask>* tasks_;
   Thread* thread_;
   std::unique_ptr<Reactor::Event> event_;
   Reactor::Reactable* reactable_;
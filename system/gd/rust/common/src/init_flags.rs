@@ -83,7 +83,8 @@ init_flags!(
         gd_rust,
         gd_link_policy,
         irk_rotation,
-        pass_phy_update_callback
+        pass_phy_update_callback,
+        hci_command_pipelining
     },
     dependencies: {
         gd_core => gd_security
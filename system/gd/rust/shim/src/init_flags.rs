@@ -14,6 +14,7 @@ mod ffi {
         fn gd_link_policy_is_enabled() -> bool;
         fn irk_rotation_is_enabled() -> bool;
         fn pass_phy_update_callback_is_enabled() -> bool;
+        fn hci_command_pipelining_is_enabled() -> bool;
     }
 }
 
@@ -17,13 +17,22 @@
 
 #include "dumpsys/dumpsys.h"
 
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
 #include <future>
 #include <string>
 
+#include "common/bind.h"
+#include "common/strings.h"
 #include "dumpsys/filter.h"
 #include "module.h"
+#include "os/handler.h"
 #include "os/log.h"
 #include "os/system_properties.h"
+#include "os/thread.h"
 #include "shim/dumpsys.h"
 #include "shim/dumpsys_args.h"
 
@@ -35,6 +44,12 @@ static const std::string kReadOnlyDebuggableProperty = "ro.debuggable";
 namespace {
 constexpr char kModuleName[] = "shim::Dumpsys";
 constexpr char kDumpsysTitle[] = "----- Gd Dumpsys ------";
+
+// When true, only the module state is collected on the stack thread. Filtering, formatting and writing
+// it out happen on a dedicated lower priority thread.
+constexpr char kOffloadProperty[] = "bluetooth.core.dumpsys.offload";
+constexpr int kOffloadThreadNiceValue = 10;
+constexpr std::chrono::milliseconds kOffloadThreadStopTimeout = std::chrono::milliseconds(2000);
 }  // namespace
 
 struct Dumpsys::impl {
@@ -43,7 +58,7 @@ struct Dumpsys::impl {
   int GetNumberOfBundledSchemas() const;
 
   impl(const Dumpsys& dumpsys_module, const dumpsys::ReflectionSchema& reflection_schema);
-  ~impl() = default;
+  ~impl();
 
  protected:
   void FilterAsUser(std::string* dumpsys_data);
@@ -54,16 +69,47 @@ struct Dumpsys::impl {
 
  private:
   void DumpWithArgsAsync(int fd, const char** args);
+  void PrintSnapshot(int fd, std::string dumpsys_data, std::promise<void> promise);
 
   const Dumpsys& dumpsys_module_;
   const dumpsys::ReflectionSchema reflection_schema_;
+
+  std::unique_ptr<os::Thread> offload_thread_;
+  std::unique_ptr<os::Handler> offload_handler_;
 };
 
 const ModuleFactory Dumpsys::Factory =
     ModuleFactory([]() { return new Dumpsys(bluetooth::dumpsys::GetBundledSchemaData()); });
 
 Dumpsys::impl::impl(const Dumpsys& dumpsys_module, const dumpsys::ReflectionSchema& reflection_schema)
-    : dumpsys_module_(dumpsys_module), reflection_schema_(std::move(reflection_schema)) {}
+    : dumpsys_module_(dumpsys_module), reflection_schema_(std::move(reflection_schema)) {
+  auto offload = os::GetSystemProperty(kOffloadProperty);
+  if (!offload || !common::BoolFromString(*offload).value_or(false)) {
+    return;
+  }
+  offload_thread_ = std::make_unique<os::Thread>("bt_dumpsys", os::Thread::Priority::NORMAL);
+  offload_handler_ = std::make_unique<os::Handler>(offload_thread_.get());
+  offload_handler_->Post(common::BindOnce([]() {
+    if (setpriority(PRIO_PROCESS, gettid(), kOffloadThreadNiceValue) != 0) {
+      LOG_WARN("Unable to lower the priority of the dumpsys thread: %s", strerror(errno));
+    }
+  }));
+}
+
+Dumpsys::impl::~impl() {
+  if (offload_handler_ == nullptr) {
+    return;
+  }
+  // Let the dumps already collected complete, their callers are waiting on them
+  std::promise<void> flushed;
+  auto future = flushed.get_future();
+  offload_handler_->Post(common::BindOnce([](std::promise<void> promise) { promise.set_value(); }, std::move(flushed)));
+  future.wait();
+  offload_handler_->Clear();
+  offload_handler_->WaitUntilStopped(kOffloadThreadStopTimeout);
+  offload_handler_.reset();
+  offload_thread_.reset();
+}
 
 int Dumpsys::impl::GetNumberOfBundledSchemas() const {
   return reflection_schema_.GetNumberOfBundledSchemas();
@@ -129,11 +175,32 @@ void Dumpsys::impl::DumpWithArgsAsync(int fd, const char** args) {
   dprintf(fd, "%s", PrintAsJson(&dumpsys_data).c_str());
 }
 
-void Dumpsys::impl::DumpWithArgsSync(int fd, const char** args, std::promise<void> promise) {
-  DumpWithArgsAsync(fd, args);
+void Dumpsys::impl::PrintSnapshot(int fd, std::string dumpsys_data, std::promise<void> promise) {
+  dprintf(fd, " ----- Filtering as Developer -----\n");
+  FilterAsDeveloper(&dumpsys_data);
+
+  dprintf(fd, "%s", PrintAsJson(&dumpsys_data).c_str());
   promise.set_value();
 }
 
+void Dumpsys::impl::DumpWithArgsSync(int fd, const char** args, std::promise<void> promise) {
+  if (offload_handler_ == nullptr) {
+    DumpWithArgsAsync(fd, args);
+    promise.set_value();
+    return;
+  }
+
+  ParsedDumpsysArgs parsed_dumpsys_args(args);
+  const auto registry = dumpsys_module_.GetModuleRegistry();
+
+  ModuleDumper dumper(*registry, kDumpsysTitle);
+  std::string dumpsys_data;
+  dumper.DumpState(&dumpsys_data);
+
+  offload_handler_->Post(common::BindOnce(
+      &Dumpsys::impl::PrintSnapshot, common::Unretained(this), fd, std::move(dumpsys_data), std::move(promise)));
+}
+
 Dumpsys::Dumpsys(const std::string& pre_bundled_schema)
     : reflection_schema_(dumpsys::ReflectionSchema(pre_bundled_schema)) {}
 
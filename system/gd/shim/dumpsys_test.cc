@@ -21,6 +21,7 @@
 #include <future>
 
 #include "module.h"
+#include "os/system_properties.h"
 #include "os/thread.h"
 #include "shim/dumpsys.h"
 #include "shim/dumpsys_args.h"
@@ -134,4 +135,34 @@ TEST_F(DumpsysTest, dump_as_user) {
   ASSERT_TRUE(dumpsys_byte_cnt < socket_buffer_size);
 }
 
+class DumpsysOffloadTest : public DumpsysTest {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(os::SetSystemProperty("bluetooth.core.dumpsys.offload", "true"));
+    DumpsysTest::SetUp();
+  }
+
+  void TearDown() override {
+    DumpsysTest::TearDown();
+    os::SetSystemProperty("bluetooth.core.dumpsys.offload", "false");
+  }
+};
+
+TEST_F(DumpsysOffloadTest, dump_as_developer) {
+  const char* args[]{bluetooth::shim::kArgumentDeveloper, nullptr};
+
+  int sv[2];
+  ASSERT_EQ(0, socketpair(AF_LOCAL, SOCK_STREAM | SOCK_NONBLOCK, 0, sv));
+  int socket_buffer_size = GetSocketBufferSize(sv[0]);
+
+  std::promise<void> promise;
+  std::future future = promise.get_future();
+  dumpsys_module_->Dump(sv[0], args, std::move(promise));
+  future.wait();
+
+  int dumpsys_byte_cnt = 0;
+  ASSERT_TRUE(SimpleJsonValidator(sv[1], &dumpsys_byte_cnt));
+  ASSERT_TRUE(dumpsys_byte_cnt < socket_buffer_size);
+}
+
 }  // namespace testing
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack_benchmark/advertising_peer.h"
+
+#include "hal/serialize_packet.h"
+#include "stack_benchmark/rootcanal_environment.h"
+
+namespace bluetooth {
+namespace stack_benchmark {
+
+namespace {
+// 20 ms, the fastest interval allowed for connectable undirected advertising
+constexpr uint16_t kAdvertisingInterval = 0x0020;
+constexpr uint8_t kAllAdvertisingChannels = 0x07;
+}  // namespace
+
+std::shared_ptr<AdvertisingPeer> AdvertisingPeer::Create(RootcanalEnvironment* environment) {
+  auto peer = std::make_shared<AdvertisingPeer>();
+  auto device = environment->AddController(peer);
+  peer->address_ = device->GetAddress();
+  environment->RunSync([peer]() { peer->start_advertising(); });
+  return peer;
+}
+
+void AdvertisingPeer::RegisterCallbacks(
+    rootcanal::PacketCallback command_callback,
+    rootcanal::PacketCallback acl_callback,
+    rootcanal::PacketCallback sco_callback,
+    rootcanal::PacketCallback iso_callback,
+    rootcanal::CloseCallback close_callback) {
+  command_callback_ = std::move(command_callback);
+}
+
+void AdvertisingPeer::SendEvent(const std::vector<uint8_t>& packet) {
+  // Legacy advertising stops once connected; resume it so the next scenario iteration can reconnect
+  if (!packet.empty() && packet[0] == static_cast<uint8_t>(hci::EventCode::DISCONNECTION_COMPLETE)) {
+    send_command(hci::LeSetAdvertisingEnableBuilder::Create(hci::Enable::ENABLED));
+  }
+}
+
+void AdvertisingPeer::send_command(std::unique_ptr<hci::CommandBuilder> command) {
+  command_callback_(std::make_shared<std::vector<uint8_t>>(hal::SerializePacket(std::move(command))));
+}
+
+void AdvertisingPeer::start_advertising() {
+  send_command(hci::LeSetAdvertisingParametersBuilder::Create(
+      kAdvertisingInterval,
+      kAdvertisingInterval,
+      hci::AdvertisingType::ADV_IND,
+      hci::OwnAddressType::PUBLIC_DEVICE_ADDRESS,
+      hci::PeerAddressType::PUBLIC_DEVICE_OR_IDENTITY_ADDRESS,
+      hci::Address::kEmpty,
+      kAllAdvertisingChannels,
+      hci::AdvertisingFilterPolicy::ALL_DEVICES));
+  hci::GapData flags;
+  flags.data_type_ = hci::GapDataType::FLAGS;
+  flags.data_.push_back(0x06);  // LE General Discoverable, BR/EDR not supported
+  send_command(hci::LeSetAdvertisingDataBuilder::Create({flags}));
+  send_command(hci::LeSetAdvertisingEnableBuilder::Create(hci::Enable::ENABLED));
+}
+
+}  // namespace stack_benchmark
+}  // namespace bluetooth
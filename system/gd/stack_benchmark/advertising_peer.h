@@ -0,0 +1,69 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "hci/address.h"
+#include "hci/hci_packets.h"
+#include "model/hci/hci_transport.h"
+
+namespace bluetooth {
+namespace stack_benchmark {
+
+class RootcanalEnvironment;
+
+// Minimal host for a rootcanal controller which keeps connectable legacy
+// advertising enabled and otherwise ignores everything it receives.
+//
+// Much cheaper than a full StackUnderTest, used where a scenario needs many
+// remote devices that only have to accept a connection.
+class AdvertisingPeer : public rootcanal::HciTransport {
+ public:
+  // Create the controller and start advertising
+  static std::shared_ptr<AdvertisingPeer> Create(RootcanalEnvironment* environment);
+
+  hci::Address GetAddress() const {
+    return address_;
+  }
+
+  void SendEvent(const std::vector<uint8_t>& packet) override;
+  void SendAcl(const std::vector<uint8_t>& packet) override {}
+  void SendSco(const std::vector<uint8_t>& packet) override {}
+  void SendIso(const std::vector<uint8_t>& packet) override {}
+
+  void RegisterCallbacks(
+      rootcanal::PacketCallback command_callback,
+      rootcanal::PacketCallback acl_callback,
+      rootcanal::PacketCallback sco_callback,
+      rootcanal::PacketCallback iso_callback,
+      rootcanal::CloseCallback close_callback) override;
+
+  void TimerTick() override {}
+  void Close() override {}
+
+ private:
+  void send_command(std::unique_ptr<hci::CommandBuilder> command);
+  void start_advertising();
+
+  rootcanal::PacketCallback command_callback_;
+  hci::Address address_;
+};
+
+}  // namespace stack_benchmark
+}  // namespace bluetooth
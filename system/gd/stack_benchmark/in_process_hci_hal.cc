@@ -0,0 +1,194 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack_benchmark/in_process_hci_hal.h"
+
+#include "os/log.h"
+#include "stack_benchmark/rootcanal_environment.h"
+
+namespace bluetooth {
+namespace stack_benchmark {
+
+// Controller side of the in-process link. Owned by the rootcanal HciDevice, so
+// it may outlive the HAL; Detach() makes it drop everything afterwards.
+class InProcessHciHal::Transport : public rootcanal::HciTransport {
+ public:
+  explicit Transport(InProcessHciHal* hal) : hal_(hal) {}
+
+  void SendEvent(const std::vector<uint8_t>& packet) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (hal_ != nullptr) {
+      hal_->on_event(packet);
+    }
+  }
+
+  void SendAcl(const std::vector<uint8_t>& packet) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (hal_ != nullptr) {
+      hal_->on_acl(packet);
+    }
+  }
+
+  void SendSco(const std::vector<uint8_t>& packet) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (hal_ != nullptr) {
+      hal_->on_sco(packet);
+    }
+  }
+
+  void SendIso(const std::vector<uint8_t>& packet) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (hal_ != nullptr) {
+      hal_->on_iso(packet);
+    }
+  }
+
+  void RegisterCallbacks(
+      rootcanal::PacketCallback command_callback,
+      rootcanal::PacketCallback acl_callback,
+      rootcanal::PacketCallback sco_callback,
+      rootcanal::PacketCallback iso_callback,
+      rootcanal::CloseCallback close_callback) override {
+    command_callback_ = std::move(command_callback);
+    acl_callback_ = std::move(acl_callback);
+    sco_callback_ = std::move(sco_callback);
+    iso_callback_ = std::move(iso_callback);
+    close_callback_ = std::move(close_callback);
+  }
+
+  void TimerTick() override {}
+
+  void Close() override {
+    Detach();
+  }
+
+  void Detach() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hal_ = nullptr;
+  }
+
+  // Only called on the rootcanal thread
+  rootcanal::PacketCallback command_callback_;
+  rootcanal::PacketCallback acl_callback_;
+  rootcanal::PacketCallback sco_callback_;
+  rootcanal::PacketCallback iso_callback_;
+  rootcanal::CloseCallback close_callback_;
+
+ private:
+  std::mutex mutex_;
+  InProcessHciHal* hal_;
+};
+
+InProcessHciHal::InProcessHciHal(RootcanalEnvironment* environment) : environment_(environment) {
+  ASSERT(environment_ != nullptr);
+}
+
+InProcessHciHal::~InProcessHciHal() {
+  if (transport_ != nullptr) {
+    transport_->Detach();
+  }
+}
+
+void InProcessHciHal::Start() {
+  transport_ = std::make_shared<Transport>(this);
+  auto device = environment_->AddController(transport_);
+  controller_address_ = device->GetAddress();
+  LOG_INFO("Attached to in-process controller %s", controller_address_.ToString().c_str());
+}
+
+void InProcessHciHal::Stop() {
+  transport_->Detach();
+  transport_.reset();
+}
+
+void InProcessHciHal::registerIncomingPacketCallback(hal::HciHalCallbacks* callback) {
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  ASSERT(callbacks_ == nullptr && callback != nullptr);
+  callbacks_ = callback;
+}
+
+void InProcessHciHal::unregisterIncomingPacketCallback() {
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  callbacks_ = nullptr;
+}
+
+void InProcessHciHal::sendHciCommand(hal::HciPacket command) {
+  auto packet = std::make_shared<std::vector<uint8_t>>(std::move(command));
+  environment_->Post([transport = transport_, packet]() { transport->command_callback_(packet); });
+}
+
+void InProcessHciHal::sendAclData(hal::HciPacket data) {
+  auto packet = std::make_shared<std::vector<uint8_t>>(std::move(data));
+  environment_->Post([transport = transport_, packet]() { transport->acl_callback_(packet); });
+}
+
+void InProcessHciHal::sendScoData(hal::HciPacket data) {
+  auto packet = std::make_shared<std::vector<uint8_t>>(std::move(data));
+  environment_->Post([transport = transport_, packet]() { transport->sco_callback_(packet); });
+}
+
+void InProcessHciHal::sendIsoData(hal::HciPacket data) {
+  auto packet = std::make_shared<std::vector<uint8_t>>(std::move(data));
+  environment_->Post([transport = transport_, packet]() { transport->iso_callback_(packet); });
+}
+
+void InProcessHciHal::SetEventObserver(PacketObserver observer) {
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  event_observer_ = std::move(observer);
+}
+
+hci::Address InProcessHciHal::GetControllerAddress() const {
+  return controller_address_;
+}
+
+void InProcessHciHal::on_event(const std::vector<uint8_t>& packet) {
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  if (event_observer_) {
+    event_observer_(packet);
+  }
+  if (callbacks_ == nullptr) {
+    LOG_WARN("Dropping event, no callback registered");
+    return;
+  }
+  callbacks_->hciEventReceived(packet);
+}
+
+void InProcessHciHal::on_acl(const std::vector<uint8_t>& packet) {
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  if (callbacks_ == nullptr) {
+    return;
+  }
+  callbacks_->aclDataReceived(packet);
+}
+
+void InProcessHciHal::on_sco(const std::vector<uint8_t>& packet) {
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  if (callbacks_ == nullptr) {
+    return;
+  }
+  callbacks_->scoDataReceived(packet);
+}
+
+void InProcessHciHal::on_iso(const std::vector<uint8_t>& packet) {
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  if (callbacks_ == nullptr) {
+    return;
+  }
+  callbacks_->isoDataReceived(packet);
+}
+
+}  // namespace stack_benchmark
+}  // namespace bluetooth
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "hal/hci_hal.h"
+#include "model/hci/hci_transport.h"
+
+namespace bluetooth {
+namespace stack_benchmark {
+
+class RootcanalEnvironment;
+
+// HciHal which talks to a rootcanal controller living in the same process.
+//
+// Packets from the stack are handed to the controller on the rootcanal
+// AsyncManager thread, since the controller model is not thread safe.
+// Packets from the controller are delivered to the registered callbacks on
+// that same thread, mirroring how HciHalHost delivers them from its reactor.
+class InProcessHciHal : public hal::HciHal {
+ public:
+  using PacketObserver = std::function<void(const hal::HciPacket&)>;
+
+  explicit InProcessHciHal(RootcanalEnvironment* environment);
+  InProcessHciHal(const InProcessHciHal&) = delete;
+  InProcessHciHal& operator=(const InProcessHciHal&) = delete;
+  ~InProcessHciHal() override;
+
+  void registerIncomingPacketCallback(hal::HciHalCallbacks* callback) override;
+  void unregisterIncomingPacketCallback() override;
+
+  void sendHciCommand(hal::HciPacket command) override;
+  void sendAclData(hal::HciPacket data) override;
+  void sendScoData(hal::HciPacket data) override;
+  void sendIsoData(hal::HciPacket data) override;
+
+  // Invoked on the rootcanal thread for every event, before it is handed to the stack.
+  // Scenarios use it to timestamp controller egress.
+  void SetEventObserver(PacketObserver observer);
+
+  // Public address the controller was given when it joined the test model
+  hci::Address GetControllerAddress() const;
+
+  std::string ToString() const override {
+    return "InProcessHciHal";
+  }
+
+ protected:
+  void ListDependencies(ModuleList* list) const override {}
+  void Start() override;
+  void Stop() override;
+
+ private:
+  class Transport;
+
+  void on_event(const std::vector<uint8_t>& packet);
+  void on_acl(const std::vector<uint8_t>& packet);
+  void on_sco(const std::vector<uint8_t>& packet);
+  void on_iso(const std::vector<uint8_t>& packet);
+
+  RootcanalEnvironment* environment_;
+  std::shared_ptr<Transport> transport_;
+  hci::Address controller_address_;
+
+  std::mutex callbacks_mutex_;
+  hal::HciHalCallbacks* callbacks_ = nullptr;
+  PacketObserver event_observer_;
+};
+
+}  // namespace stack_benchmark
+}  // namespace bluetooth
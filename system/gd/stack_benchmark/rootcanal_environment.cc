@@ -0,0 +1,167 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack_benchmark/rootcanal_environment.h"
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include "model/devices/beacon_swarm.h"
+#include "os/log.h"
+
+namespace bluetooth {
+namespace stack_benchmark {
+
+namespace {
+
+constexpr uint8_t kManufacturerSpecificData = 0xff;
+// Reserved for testing by the Bluetooth SIG
+constexpr uint16_t kTestCompanyId = 0xffff;
+
+// Beacon swarm which stamps a sequence number in the manufacturer specific data of every advertisement,
+// so the scanner can match each scan result to the report the controller emitted for it
+class SequencedBeaconSwarm : public rootcanal::BeaconSwarm {
+ public:
+  SequencedBeaconSwarm(const std::vector<std::string>& args, uint32_t* next_sequence)
+      : rootcanal::BeaconSwarm(args), next_sequence_(next_sequence) {
+    // Keep the flags, the swarm name does not leave room for the sequence number
+    advertising_data_ = {
+        0x02 /* Length */,
+        0x01 /* TYPE_FLAG */,
+        0x4 /* BREDR_NOT_SUPPORTED */ | 0x2 /* GENERAL_DISCOVERABLE */,
+        0x07 /* Length */,
+        kManufacturerSpecificData,
+        kTestCompanyId & 0xff,
+        kTestCompanyId >> 8,
+    };
+  }
+
+  void TimerTick() override {
+    uint32_t sequence = (*next_sequence_)++;
+    for (size_t i = 0; i < sizeof(sequence); i++) {
+      advertising_data_[kSequenceOffset + i] = static_cast<uint8_t>(sequence >> (8 * i));
+    }
+    rootcanal::BeaconSwarm::TimerTick();
+  }
+
+  static constexpr size_t kSequenceOffset = 7;
+
+ private:
+  uint32_t* next_sequence_;
+};
+
+}  // namespace
+
+RootcanalEnvironment::RootcanalEnvironment()
+    : user_id_(async_manager_.GetNextUserId()),
+      test_model_(
+          [this]() { return async_manager_.GetNextUserId(); },
+          [this](rootcanal::AsyncUserId user_id, std::chrono::milliseconds delay, const rootcanal::TaskCallback& task) {
+            return async_manager_.ExecAsync(user_id, delay, task);
+          },
+          [this](
+              rootcanal::AsyncUserId user_id,
+              std::chrono::milliseconds delay,
+              std::chrono::milliseconds period,
+              const rootcanal::TaskCallback& task) {
+            return async_manager_.ExecAsyncPeriodically(user_id, delay, period, task);
+          },
+          [this](rootcanal::AsyncUserId user) { async_manager_.CancelAsyncTasksFromUser(user); },
+          [this](rootcanal::AsyncTaskId task) { async_manager_.CancelAsyncTask(task); },
+          [](const std::string& server, int port, rootcanal::Phy::Type phy_type) {
+            // Everything lives in this process, there is no remote link layer to connect to
+            return std::shared_ptr<rootcanal::Device>();
+          }) {
+  RunSync([this]() {
+    br_edr_phy_ = test_model_.AddPhy(rootcanal::Phy::Type::BR_EDR);
+    le_phy_ = test_model_.AddPhy(rootcanal::Phy::Type::LOW_ENERGY);
+    test_model_.SetTimerPeriod(kDefaultTimerPeriod);
+    test_model_.StartTimer();
+  });
+}
+
+RootcanalEnvironment::~RootcanalEnvironment() {
+  RunSync([this]() { test_model_.Reset(); });
+  // Flush the reset task scheduled by the test model
+  RunSync([]() {});
+  async_manager_.CancelAsyncTasksFromUser(user_id_);
+}
+
+std::shared_ptr<rootcanal::HciDevice> RootcanalEnvironment::AddController(
+    std::shared_ptr<rootcanal::HciTransport> transport) {
+  std::shared_ptr<rootcanal::HciDevice> device;
+  RunSync([this, &device, transport]() {
+    device = rootcanal::HciDevice::Create(transport, "");
+    test_model_.AddHciConnection(device);
+  });
+  return device;
+}
+
+void RootcanalEnvironment::AddBeaconSwarm(size_t count, std::chrono::milliseconds advertising_interval) {
+  RunSync([this, count, advertising_interval]() {
+    for (size_t i = 0; i < count; i++) {
+      // Give each swarm a distinct high byte so the rotating low byte never collides
+      std::vector<std::string> args = {
+          "beacon_swarm",
+          "be:ac:" + std::to_string(10 + (i % 90)) + ":00:00:00",
+          std::to_string(advertising_interval.count()),
+      };
+      auto index = test_model_.Add(std::make_shared<SequencedBeaconSwarm>(args, &next_beacon_sequence_));
+      test_model_.AddDeviceToPhy(index, le_phy_);
+    }
+  });
+}
+
+std::optional<uint32_t> RootcanalEnvironment::ParseBeaconSequence(const std::vector<uint8_t>& advertising_data) {
+  // AD type and company id
+  constexpr size_t kPrefixSize = 3;
+  size_t offset = 0;
+  while (offset + 1 < advertising_data.size() && advertising_data[offset] != 0) {
+    size_t length = advertising_data[offset];
+    if (offset + 1 + length > advertising_data.size()) {
+      break;
+    }
+    const uint8_t* field = &advertising_data[offset + 1];
+    if (length == kPrefixSize + sizeof(uint32_t) && field[0] == kManufacturerSpecificData &&
+        (field[1] | (field[2] << 8)) == kTestCompanyId) {
+      uint32_t sequence = 0;
+      for (size_t i = 0; i < sizeof(sequence); i++) {
+        sequence |= static_cast<uint32_t>(field[kPrefixSize + i]) << (8 * i);
+      }
+      return sequence;
+    }
+    offset += 1 + length;
+  }
+  return std::nullopt;
+}
+
+void RootcanalEnvironment::Post(std::function<void()> task) {
+  async_manager_.ExecAsync(user_id_, std::chrono::milliseconds(0), std::move(task));
+}
+
+void RootcanalEnvironment::RunSync(std::function<void()> task) {
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  Post([&task, &promise]() {
+    task();
+    promise.set_value();
+  });
+  future.wait();
+}
+
+}  // namespace stack_benchmark
+}  // namespace bluetooth
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "hci/address.h"
+#include "model/devices/hci_device.h"
+#include "model/hci/hci_transport.h"
+#include "model/setup/async_manager.h"
+#include "model/setup/test_model.h"
+
+namespace bluetooth {
+namespace stack_benchmark {
+
+// Owns a rootcanal test model with one BR/EDR and one LE phy, and the
+// AsyncManager thread every simulated device runs on.
+class RootcanalEnvironment {
+ public:
+  static constexpr std::chrono::milliseconds kDefaultTimerPeriod = std::chrono::milliseconds(5);
+
+  RootcanalEnvironment();
+  RootcanalEnvironment(const RootcanalEnvironment&) = delete;
+  RootcanalEnvironment& operator=(const RootcanalEnvironment&) = delete;
+  ~RootcanalEnvironment();
+
+  // Create a DualModeController attached to both phys and driven through |transport|.
+  // Must not be called from the rootcanal thread.
+  std::shared_ptr<rootcanal::HciDevice> AddController(std::shared_ptr<rootcanal::HciTransport> transport);
+
+  // Add |count| non-connectable beacons which rotate their address on every advertisement.
+  // Every advertisement carries a sequence number unique within the environment, see ParseBeaconSequence()
+  void AddBeaconSwarm(size_t count, std::chrono::milliseconds advertising_interval);
+
+  // Return the sequence number carried in |advertising_data| by a beacon added with AddBeaconSwarm()
+  static std::optional<uint32_t> ParseBeaconSequence(const std::vector<uint8_t>& advertising_data);
+
+  // Run |task| on the rootcanal thread
+  void Post(std::function<void()> task);
+
+  // Run |task| on the rootcanal thread and wait for it to complete
+  void RunSync(std::function<void()> task);
+
+ private:
+  rootcanal::AsyncManager async_manager_;
+  rootcanal::AsyncUserId user_id_;
+  rootcanal::TestModel test_model_;
+  size_t br_edr_phy_;
+  size_t le_phy_;
+  // Only accessed on the rootcanal thread
+  uint32_t next_beacon_sequence_ = 0;
+};
+
+}  // namespace stack_benchmark
+}  // namespace bluetooth
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace bluetooth {
+namespace stack_benchmark {
+
+inline int64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Every payload generated by a scenario carries its send time, so the
+// receiving side can compute one-way latency through both stacks.
+constexpr size_t kTimestampSize = sizeof(int64_t);
+
+inline void StampPayload(std::vector<uint8_t>* payload, size_t offset) {
+  int64_t now = NowNanos();
+  for (size_t i = 0; i < kTimestampSize && offset + i < payload->size(); i++) {
+    (*payload)[offset + i] = static_cast<uint8_t>(now >> (8 * i));
+  }
+}
+
+template <typename Iterator>
+int64_t ReadStamp(Iterator begin, Iterator end) {
+  int64_t stamp = 0;
+  size_t i = 0;
+  for (auto it = begin; it != end && i < kTimestampSize; ++it, i++) {
+    stamp |= static_cast<int64_t>(static_cast<uint8_t>(*it)) << (8 * i);
+  }
+  return stamp;
+}
+
+// Latency samples for one run. Record() may be called from any thread.
+class LatencyRecorder {
+ public:
+  void Reserve(size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_.reserve(count);
+  }
+
+  void Record(int64_t latency_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_.push_back(latency_ns);
+  }
+
+  size_t Count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samples_.size();
+  }
+
+  // |percentile| in [0, 100], result in microseconds; 0 when empty
+  double PercentileMicros(double percentile) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (samples_.empty()) {
+      return 0;
+    }
+    std::vector<int64_t> sorted = samples_;
+    size_t rank = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank] / 1000.0;
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_.clear();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<int64_t> samples_;
+};
+
+// Process CPU time (user + system) relative to wall time over one run.
+// Rootcanal runs in-process, so the controller model is included: compare
+// the figure across builds rather than reading it as stack-only CPU.
+class CpuMeter {
+ public:
+  void Start() {
+    start_wall_ns_ = NowNanos();
+    start_cpu_ns_ = cpu_nanos();
+  }
+
+  // Percentage of one core
+  double StopPercent() {
+    int64_t wall = NowNanos() - start_wall_ns_;
+    int64_t cpu = cpu_nanos() - start_cpu_ns_;
+    return wall > 0 ? 100.0 * cpu / wall : 0;
+  }
+
+ private:
+  static int64_t cpu_nanos() {
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    auto to_ns = [](const struct timeval& tv) { return int64_t(tv.tv_sec) * 1000000000 + int64_t(tv.tv_usec) * 1000; };
+    return to_ns(usage.ru_utime) + to_ns(usage.ru_stime);
+  }
+
+  int64_t start_wall_ns_ = 0;
+  int64_t start_cpu_ns_ = 0;
+};
+
+// Export the per-scenario results as benchmark counters, so that
+// --benchmark_format=json gives machine readable output
+inline void ReportScenario(
+    ::benchmark::State& state, LatencyRecorder* latency, double cpu_percent, uint64_t bytes, uint64_t items) {
+  state.counters["latency_p50_us"] = latency->PercentileMicros(50);
+  state.counters["latency_p99_us"] = latency->PercentileMicros(99);
+  state.counters["cpu_percent"] = cpu_percent;
+  if (bytes > 0) {
+    state.SetBytesProcessed(bytes);
+  }
+  if (items > 0) {
+    state.SetItemsProcessed(items);
+  }
+}
+
+}  // namespace stack_benchmark
+}  // namespace bluetooth
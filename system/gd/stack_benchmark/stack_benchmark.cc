@@ -0,0 +1,685 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// End-to-end benchmarks of the gd stack against in-process rootcanal controllers.
+//
+// Run with --benchmark_format=json to get machine readable results. Every
+// scenario reports bytes_per_second and/or items_per_second, along with the
+// latency_p50_us, latency_p99_us and cpu_percent counters.
+
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "common/bind.h"
+#include "hci/hci_packets.h"
+#include "hci/le_scanning_callback.h"
+#include "hci/le_scanning_manager.h"
+#include "l2cap/cid.h"
+#include "l2cap/classic/fixed_channel.h"
+#include "l2cap/classic/fixed_channel_manager.h"
+#include "l2cap/classic/fixed_channel_service.h"
+#include "l2cap/classic/l2cap_classic_module.h"
+#include "l2cap/le/dynamic_channel.h"
+#include "l2cap/le/dynamic_channel_manager.h"
+#include "l2cap/le/dynamic_channel_service.h"
+#include "l2cap/le/fixed_channel.h"
+#include "l2cap/le/fixed_channel_manager.h"
+#include "l2cap/le/fixed_channel_service.h"
+#include "l2cap/le/l2cap_le_module.h"
+#include "neighbor/connectability.h"
+#include "os/handler.h"
+#include "os/log.h"
+#include "os/parameter_provider.h"
+#include "os/repeating_alarm.h"
+#include "packet/raw_builder.h"
+#include "stack_benchmark/advertising_peer.h"
+#include "stack_benchmark/rootcanal_environment.h"
+#include "stack_benchmark/scenario_stats.h"
+#include "stack_benchmark/stack_under_test.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace stack_benchmark {
+
+namespace {
+
+constexpr auto kSetupTimeout = std::chrono::seconds(10);
+constexpr auto kScenarioTimeout = std::chrono::seconds(60);
+
+using ChannelQueueEnd = common::BidiQueueEnd<packet::BasePacketBuilder, packet::PacketView<packet::kLittleEndian>>;
+
+// Collects channels handed out by an L2CAP service, with the time each was opened
+template <typename Channel, typename Service, typename RegistrationResult>
+class ChannelCollector {
+ public:
+  void OnRegistrationComplete(RegistrationResult result, std::unique_ptr<Service> service) {
+    if (result != RegistrationResult::SUCCESS) {
+      LOG_ERROR("Service registration failed");
+      return;
+    }
+    service_ = std::move(service);
+  }
+
+  void OnConnectionOpen(std::unique_ptr<Channel> channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    opened_at_.push_back(NowNanos());
+    channels_.push_back(std::move(channel));
+    cv_.notify_all();
+  }
+
+  bool WaitForChannels(size_t count, std::chrono::seconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, timeout, [this, count] { return channels_.size() >= count; });
+  }
+
+  // Only valid after WaitForChannels()
+  std::vector<std::unique_ptr<Channel>>& GetChannels() {
+    return channels_;
+  }
+
+  const std::vector<int64_t>& GetOpenTimes() const {
+    return opened_at_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::unique_ptr<Service> service_;
+  std::vector<std::unique_ptr<Channel>> channels_;
+  std::vector<int64_t> opened_at_;
+};
+
+using LeDynamicChannelCollector = ChannelCollector<
+    l2cap::le::DynamicChannel,
+    l2cap::le::DynamicChannelService,
+    l2cap::le::DynamicChannelManager::RegistrationResult>;
+using LeFixedChannelCollector = ChannelCollector<
+    l2cap::le::FixedChannel,
+    l2cap::le::FixedChannelService,
+    l2cap::le::FixedChannelManager::RegistrationResult>;
+using ClassicFixedChannelCollector = ChannelCollector<
+    l2cap::classic::FixedChannel,
+    l2cap::classic::FixedChannelService,
+    l2cap::classic::FixedChannelManager::RegistrationResult>;
+
+// Receives timestamped payloads on a channel and records their one-way latency
+class TimestampedSink {
+ public:
+  TimestampedSink(ChannelQueueEnd* queue_end, os::Handler* handler, LatencyRecorder* latency, size_t stamp_offset)
+      : queue_end_(queue_end), latency_(latency), stamp_offset_(stamp_offset) {
+    queue_end_->RegisterDequeue(handler, common::Bind(&TimestampedSink::on_dequeue, common::Unretained(this)));
+  }
+
+  ~TimestampedSink() {
+    queue_end_->UnregisterDequeue();
+  }
+
+  // Resolves when |count| packets have been received since the last call
+  std::future<void> Expect(size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    expected_ = count;
+    received_ = 0;
+    promise_ = std::promise<void>();
+    return promise_.get_future();
+  }
+
+  uint64_t GetBytes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+  }
+
+ private:
+  void on_dequeue() {
+    auto packet = queue_end_->TryDequeue();
+    if (packet == nullptr) {
+      return;
+    }
+    if (packet->size() >= stamp_offset_ + kTimestampSize) {
+      latency_->Record(NowNanos() - ReadStamp(packet->begin() + stamp_offset_, packet->end()));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    bytes_ += packet->size();
+    if (++received_ == expected_) {
+      promise_.set_value();
+    }
+  }
+
+  ChannelQueueEnd* queue_end_;
+  LatencyRecorder* latency_;
+  size_t stamp_offset_;
+  std::mutex mutex_;
+  std::promise<void> promise_;
+  size_t expected_ = 0;
+  size_t received_ = 0;
+  uint64_t bytes_ = 0;
+};
+
+// Pushes timestamped payloads into a channel as fast as the channel accepts them
+class TimestampedSource {
+ public:
+  TimestampedSource(ChannelQueueEnd* queue_end, os::Handler* handler, std::vector<uint8_t> payload_template,
+                    size_t stamp_offset)
+      : queue_end_(queue_end),
+        handler_(handler),
+        payload_template_(std::move(payload_template)),
+        stamp_offset_(stamp_offset) {}
+
+  ~TimestampedSource() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (registered_) {
+      queue_end_->UnregisterEnqueue();
+    }
+  }
+
+  // Queue |count| more payloads. Safe to call from any thread.
+  void Send(size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_ += count;
+    if (!registered_ && pending_ > 0) {
+      registered_ = true;
+      queue_end_->RegisterEnqueue(
+          handler_, common::Bind(&TimestampedSource::on_enqueue_ready, common::Unretained(this)));
+    }
+  }
+
+ private:
+  std::unique_ptr<packet::BasePacketBuilder> on_enqueue_ready() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<uint8_t> payload = payload_template_;
+    StampPayload(&payload, stamp_offset_);
+    if (--pending_ == 0) {
+      registered_ = false;
+      queue_end_->UnregisterEnqueue();
+    }
+    return std::make_unique<packet::RawBuilder>(std::move(payload));
+  }
+
+  ChannelQueueEnd* queue_end_;
+  os::Handler* handler_;
+  std::vector<uint8_t> payload_template_;
+  size_t stamp_offset_;
+  std::mutex mutex_;
+  size_t pending_ = 0;
+  bool registered_ = false;
+};
+
+}  // namespace
+
+class BM_StackScenario : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    environment_ = std::make_unique<RootcanalEnvironment>();
+    dut_ = std::make_unique<StackUnderTest>(environment_.get(), "dut");
+  }
+
+  void TearDown(State& st) override {
+    peer_.reset();
+    dut_.reset();
+    environment_.reset();
+    latency_.Clear();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  // Start a second complete stack to play the remote device
+  StackUnderTest* AddPeer() {
+    peer_ = std::make_unique<StackUnderTest>(environment_.get(), "peer");
+    return peer_.get();
+  }
+
+  std::unique_ptr<RootcanalEnvironment> environment_;
+  std::unique_ptr<StackUnderTest> dut_;
+  std::unique_ptr<StackUnderTest> peer_;
+  LatencyRecorder latency_;
+  CpuMeter cpu_;
+};
+
+// L2CAP LE credit based channel, bulk transfer from the DUT to the peer
+BENCHMARK_DEFINE_F(BM_StackScenario, L2capCocBulkTransfer)(State& state) {
+  constexpr l2cap::Psm kPsm = 0x0080;
+  constexpr uint16_t kMtu = 512;
+  const size_t kSduCount = state.range(0);
+
+  auto peer = AddPeer();
+  LeDynamicChannelCollector peer_channels;
+  peer->Start<l2cap::le::L2capLeModule>()->GetDynamicChannelManager()->RegisterService(
+      kPsm,
+      {kMtu},
+      l2cap::le::SecurityPolicy::NO_SECURITY_WHATSOEVER_PLAINTEXT_TRANSPORT_OK,
+      common::BindOnce(&LeDynamicChannelCollector::OnRegistrationComplete, common::Unretained(&peer_channels)),
+      common::Bind(&LeDynamicChannelCollector::OnConnectionOpen, common::Unretained(&peer_channels)),
+      peer->GetClientHandler());
+  peer->StartConnectableAdvertising();
+
+  LeDynamicChannelCollector dut_channels;
+  auto dut_manager = dut_->Start<l2cap::le::L2capLeModule>()->GetDynamicChannelManager();
+  dut_manager->RegisterService(
+      kPsm,
+      {kMtu},
+      l2cap::le::SecurityPolicy::NO_SECURITY_WHATSOEVER_PLAINTEXT_TRANSPORT_OK,
+      common::BindOnce(&LeDynamicChannelCollector::OnRegistrationComplete, common::Unretained(&dut_channels)),
+      common::Bind(&LeDynamicChannelCollector::OnConnectionOpen, common::Unretained(&dut_channels)),
+      dut_->GetClientHandler());
+  dut_manager->ConnectChannel(
+      peer->GetAddressWithType(),
+      {kMtu},
+      kPsm,
+      common::Bind(&LeDynamicChannelCollector::OnConnectionOpen, common::Unretained(&dut_channels)),
+      common::BindOnce([](l2cap::le::DynamicChannelManager::ConnectionResult result) {
+        LOG_ERROR("CoC connection failed %d", static_cast<int>(result.connection_result_code));
+      }),
+      dut_->GetClientHandler());
+  if (!dut_channels.WaitForChannels(1, kSetupTimeout) || !peer_channels.WaitForChannels(1, kSetupTimeout)) {
+    state.SkipWithError("Unable to open the L2CAP CoC channel");
+    return;
+  }
+
+  TimestampedSink sink(
+      peer_channels.GetChannels()[0]->GetQueueUpEnd(), peer->GetClientHandler(), &latency_, /* stamp_offset */ 0);
+  TimestampedSource source(
+      dut_channels.GetChannels()[0]->GetQueueUpEnd(),
+      dut_->GetClientHandler(),
+      std::vector<uint8_t>(kMtu, 0xa5),
+      /* stamp_offset */ 0);
+  latency_.Reserve(kSduCount * state.max_iterations);
+
+  cpu_.Start();
+  for (auto _ : state) {
+    auto done = sink.Expect(kSduCount);
+    source.Send(kSduCount);
+    if (done.wait_for(kScenarioTimeout) != std::future_status::ready) {
+      state.SkipWithError("Timed out waiting for SDUs");
+      break;
+    }
+  }
+  ReportScenario(state, &latency_, cpu_.StopPercent(), sink.GetBytes(), kSduCount * state.iterations());
+}
+BENCHMARK_REGISTER_F(BM_StackScenario, L2capCocBulkTransfer)
+    ->Arg(1000)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Peer floods ATT Handle Value Notifications over the LE fixed channel
+BENCHMARK_DEFINE_F(BM_StackScenario, GattNotificationFlood)(State& state) {
+  constexpr uint8_t kHandleValueNotification = 0x1b;
+  constexpr uint16_t kAttributeHandle = 0x002a;
+  constexpr size_t kAttHeaderSize = 3;
+  // Default ATT_MTU of 23, the common case for notification heavy sensors
+  constexpr size_t kNotificationSize = 23;
+  const size_t kNotificationCount = state.range(0);
+
+  auto peer = AddPeer();
+  LeFixedChannelCollector peer_channels;
+  peer->Start<l2cap::le::L2capLeModule>()->GetFixedChannelManager()->RegisterService(
+      l2cap::kLeAttributeCid,
+      common::BindOnce(&LeFixedChannelCollector::OnRegistrationComplete, common::Unretained(&peer_channels)),
+      common::Bind(&LeFixedChannelCollector::OnConnectionOpen, common::Unretained(&peer_channels)),
+      peer->GetClientHandler());
+  peer->StartConnectableAdvertising();
+
+  LeFixedChannelCollector dut_channels;
+  auto dut_manager = dut_->Start<l2cap::le::L2capLeModule>()->GetFixedChannelManager();
+  dut_manager->RegisterService(
+      l2cap::kLeAttributeCid,
+      common::BindOnce(&LeFixedChannelCollector::OnRegistrationComplete, common::Unretained(&dut_channels)),
+      common::Bind(&LeFixedChannelCollector::OnConnectionOpen, common::Unretained(&dut_channels)),
+      dut_->GetClientHandler());
+  dut_manager->ConnectServices(
+      peer->GetAddressWithType(),
+      common::BindOnce([](l2cap::le::FixedChannelManager::ConnectionResult result) {
+        LOG_ERROR("ATT connection failed %d", static_cast<int>(result.connection_result_code));
+      }),
+      dut_->GetClientHandler());
+  if (!dut_channels.WaitForChannels(1, kSetupTimeout) || !peer_channels.WaitForChannels(1, kSetupTimeout)) {
+    state.SkipWithError("Unable to open the ATT channel");
+    return;
+  }
+  auto& dut_channel = dut_channels.GetChannels()[0];
+  auto& peer_channel = peer_channels.GetChannels()[0];
+  dut_channel->Acquire();
+  peer_channel->Acquire();
+
+  std::vector<uint8_t> notification(kNotificationSize, 0);
+  notification[0] = kHandleValueNotification;
+  notification[1] = kAttributeHandle & 0xff;
+  notification[2] = kAttributeHandle >> 8;
+  TimestampedSink sink(dut_channel->GetQueueUpEnd(), dut_->GetClientHandler(), &latency_, kAttHeaderSize);
+  TimestampedSource source(peer_channel->GetQueueUpEnd(), peer->GetClientHandler(), notification, kAttHeaderSize);
+  latency_.Reserve(kNotificationCount * state.max_iterations);
+
+  cpu_.Start();
+  for (auto _ : state) {
+    auto done = sink.Expect(kNotificationCount);
+    source.Send(kNotificationCount);
+    if (done.wait_for(kScenarioTimeout) != std::future_status::ready) {
+      state.SkipWithError("Timed out waiting for notifications");
+      break;
+    }
+  }
+  ReportScenario(state, &latency_, cpu_.StopPercent(), sink.GetBytes(), kNotificationCount * state.iterations());
+  dut_channel->Release();
+  peer_channel->Release();
+}
+BENCHMARK_REGISTER_F(BM_StackScenario, GattNotificationFlood)
+    ->Arg(5000)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+
+namespace {
+
+// Counts scan results, and matches them against the time the controller emitted the report carrying the same
+// beacon sequence number. Reports dropped or filtered on the way do not skew the latency of the others.
+class ScanResultCounter : public hci::ScanningCallback {
+ public:
+  explicit ScanResultCounter(LatencyRecorder* latency) : latency_(latency) {}
+
+  // Called on the rootcanal thread for every event sent to the DUT
+  void OnControllerEvent(const hal::HciPacket& packet) {
+    auto event = hci::EventView::Create(
+        packet::PacketView<packet::kLittleEndian>(std::make_shared<std::vector<uint8_t>>(packet)));
+    if (!event.IsValid() || event.GetEventCode() != hci::EventCode::LE_META_EVENT) {
+      return;
+    }
+    auto meta_event = hci::LeMetaEventView::Create(event);
+    if (!meta_event.IsValid()) {
+      return;
+    }
+    std::vector<std::vector<uint8_t>> reports;
+    if (meta_event.GetSubeventCode() == hci::SubeventCode::ADVERTISING_REPORT) {
+      auto report_view = hci::LeAdvertisingReportRawView::Create(meta_event);
+      if (!report_view.IsValid()) {
+        return;
+      }
+      for (const auto& response : report_view.GetResponses()) {
+        reports.push_back(response.advertising_data_);
+      }
+    } else if (meta_event.GetSubeventCode() == hci::SubeventCode::EXTENDED_ADVERTISING_REPORT) {
+      auto report_view = hci::LeExtendedAdvertisingReportRawView::Create(meta_event);
+      if (!report_view.IsValid()) {
+        return;
+      }
+      for (const auto& response : report_view.GetResponses()) {
+        reports.push_back(response.advertising_data_);
+      }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t now = NowNanos();
+    for (const auto& advertising_data : reports) {
+      auto sequence = RootcanalEnvironment::ParseBeaconSequence(advertising_data);
+      if (sequence.has_value()) {
+        emitted_at_.emplace(*sequence, now);
+      }
+    }
+  }
+
+  uint64_t GetResultCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return results_;
+  }
+
+  std::future<hci::ScannerId> GetScannerId() {
+    return scanner_promise_.get_future();
+  }
+
+  void OnScannerRegistered(const hci::Uuid app_uuid, hci::ScannerId scanner_id, ScanningStatus status) override {
+    scanner_promise_.set_value(scanner_id);
+  }
+  void OnSetScannerParameterComplete(hci::ScannerId scanner_id, ScanningStatus status) override {}
+  void OnScanResult(
+      uint16_t event_type,
+      uint8_t address_type,
+      hci::Address address,
+      uint8_t primary_phy,
+      uint8_t secondary_phy,
+      uint8_t advertising_sid,
+      int8_t tx_power,
+      int8_t rssi,
+      uint16_t periodic_advertising_interval,
+      std::vector<uint8_t> advertising_data) override {
+    auto sequence = RootcanalEnvironment::ParseBeaconSequence(advertising_data);
+    std::lock_guard<std::mutex> lock(mutex_);
+    results_++;
+    if (!sequence.has_value()) {
+      return;
+    }
+    auto emitted_at = emitted_at_.find(*sequence);
+    if (emitted_at != emitted_at_.end()) {
+      latency_->Record(NowNanos() - emitted_at->second);
+      emitted_at_.erase(emitted_at);
+    }
+  }
+  void OnTrackAdvFoundLost(hci::AdvertisingFilterOnFoundOnLostInfo on_found_on_lost_info) override {}
+  void OnBatchScanReports(
+      int client_if, int status, int report_format, int num_records, std::vector<uint8_t> data) override {}
+  void OnBatchScanThresholdCrossed(int client_if) override {}
+  void OnTimeout() override {}
+  void OnFilterEnable(hci::Enable enable, uint8_t status) override {}
+  void OnFilterParamSetup(uint8_t available_spaces, hci::ApcfAction action, uint8_t status) override {}
+  void OnFilterConfigCallback(
+      hci::ApcfFilterType filter_type, uint8_t available_spaces, hci::ApcfAction action, uint8_t status) override {}
+  void OnPeriodicSyncStarted(
+      int request_id,
+      uint8_t status,
+      uint16_t sync_handle,
+      uint8_t advertising_sid,
+      hci::AddressWithType address_with_type,
+      uint8_t phy,
+      uint16_t interval) override {}
+  void OnPeriodicSyncReport(
+      uint16_t sync_handle, int8_t tx_power, int8_t rssi, uint8_t status, std::vector<uint8_t> data) override {}
+  void OnPeriodicSyncLost(uint16_t sync_handle) override {}
+  void OnPeriodicSyncTransferred(int pa_source, uint8_t status, hci::Address address) override {}
+
+ private:
+  LatencyRecorder* latency_;
+  std::mutex mutex_;
+  // Emission time of the reports not matched to a scan result yet, by beacon sequence number
+  std::unordered_map<uint32_t, int64_t> emitted_at_;
+  uint64_t results_ = 0;
+  std::promise<hci::ScannerId> scanner_promise_;
+};
+
+}  // namespace
+
+// Many beacons advertising back to back while the DUT scans continuously
+BENCHMARK_DEFINE_F(BM_StackScenario, LeScanReportStorm)(State& state) {
+  constexpr auto kScanDuration = std::chrono::seconds(2);
+  constexpr uint16_t kScanInterval = 0x0010;
+  const size_t kSwarmCount = state.range(0);
+
+  ScanResultCounter counter(&latency_);
+  dut_->GetHal()->SetEventObserver(
+      [&counter](const hal::HciPacket& packet) { counter.OnControllerEvent(packet); });
+  auto scanning_manager = dut_->Start<hci::LeScanningManager>();
+  scanning_manager->RegisterScanningCallback(&counter);
+  scanning_manager->RegisterScanner(hci::Uuid::kEmpty);
+  auto scanner_id = counter.GetScannerId();
+  if (scanner_id.wait_for(kSetupTimeout) != std::future_status::ready) {
+    state.SkipWithError("Scanner registration timed out");
+    return;
+  }
+  // Scan window equal to the interval: the controller listens all the time
+  scanning_manager->SetScanParameters(scanner_id.get(), hci::LeScanType::PASSIVE, kScanInterval, kScanInterval);
+  environment_->AddBeaconSwarm(kSwarmCount, std::chrono::milliseconds(0));
+
+  cpu_.Start();
+  uint64_t results_before = counter.GetResultCount();
+  for (auto _ : state) {
+    scanning_manager->Scan(true);
+    std::this_thread::sleep_for(kScanDuration);
+    scanning_manager->Scan(false);
+  }
+  dut_->WaitForIdle(std::chrono::milliseconds(500));
+  ReportScenario(state, &latency_, cpu_.StopPercent(), 0, counter.GetResultCount() - results_before);
+  dut_->GetHal()->SetEventObserver(nullptr);
+  scanning_manager->RegisterScanningCallback(nullptr);
+}
+BENCHMARK_REGISTER_F(BM_StackScenario, LeScanReportStorm)
+    ->Arg(16)
+    ->Arg(64)
+    ->Iterations(1)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Paced media stream over a BR/EDR ACL link, shaped like A2DP SBC at 328 kbps:
+// every 20 ms tick carries a few 2-DH5 sized media packets. A fixed channel
+// stands in for the AVDTP media channel so no signalling or security is needed.
+BENCHMARK_DEFINE_F(BM_StackScenario, AclStreamingA2dpStyle)(State& state) {
+  constexpr l2cap::Cid kMediaCid = l2cap::kLastFixedChannel;
+  constexpr auto kTickPeriod = std::chrono::milliseconds(20);
+  constexpr size_t kPacketsPerTick = 3;
+  constexpr size_t kMediaPacketSize = 660;
+  const size_t kTicks = state.range(0);
+
+  auto peer = AddPeer();
+  ClassicFixedChannelCollector peer_channels;
+  peer->Start<l2cap::classic::L2capClassicModule>()->GetFixedChannelManager()->RegisterService(
+      kMediaCid,
+      common::BindOnce(&ClassicFixedChannelCollector::OnRegistrationComplete, common::Unretained(&peer_channels)),
+      common::Bind(&ClassicFixedChannelCollector::OnConnectionOpen, common::Unretained(&peer_channels)),
+      peer->GetClientHandler());
+  peer->Start<neighbor::ConnectabilityModule>()->StartConnectability();
+
+  ClassicFixedChannelCollector dut_channels;
+  auto dut_manager = dut_->Start<l2cap::classic::L2capClassicModule>()->GetFixedChannelManager();
+  dut_manager->RegisterService(
+      kMediaCid,
+      common::BindOnce(&ClassicFixedChannelCollector::OnRegistrationComplete, common::Unretained(&dut_channels)),
+      common::Bind(&ClassicFixedChannelCollector::OnConnectionOpen, common::Unretained(&dut_channels)),
+      dut_->GetClientHandler());
+  dut_->WaitForIdle(std::chrono::milliseconds(500));
+  peer->WaitForIdle(std::chrono::milliseconds(500));
+  dut_manager->ConnectServices(
+      peer->GetAddressWithType().GetAddress(),
+      common::BindOnce([](l2cap::classic::FixedChannelManager::ConnectionResult result) {
+        LOG_ERROR("ACL connection failed %d", static_cast<int>(result.connection_result_code));
+      }),
+      dut_->GetClientHandler());
+  if (!dut_channels.WaitForChannels(1, kSetupTimeout) || !peer_channels.WaitForChannels(1, kSetupTimeout)) {
+    state.SkipWithError("Unable to open the ACL link");
+    return;
+  }
+  auto& dut_channel = dut_channels.GetChannels()[0];
+  auto& peer_channel = peer_channels.GetChannels()[0];
+  dut_channel->Acquire();
+  peer_channel->Acquire();
+
+  TimestampedSink sink(peer_channel->GetQueueUpEnd(), peer->GetClientHandler(), &latency_, /* stamp_offset */ 0);
+  TimestampedSource source(
+      dut_channel->GetQueueUpEnd(),
+      dut_->GetClientHandler(),
+      std::vector<uint8_t>(kMediaPacketSize, 0x5a),
+      /* stamp_offset */ 0);
+  os::RepeatingAlarm media_tick(dut_->GetClientHandler());
+  latency_.Reserve(kTicks * kPacketsPerTick * state.max_iterations);
+
+  cpu_.Start();
+  for (auto _ : state) {
+    auto done = sink.Expect(kTicks * kPacketsPerTick);
+    media_tick.Schedule(
+        common::Bind(&TimestampedSource::Send, common::Unretained(&source), kPacketsPerTick), kTickPeriod);
+    auto status = done.wait_for(kTickPeriod * kTicks + kScenarioTimeout);
+    media_tick.Cancel();
+    if (status != std::future_status::ready) {
+      state.SkipWithError("Timed out waiting for media packets");
+      break;
+    }
+  }
+  ReportScenario(
+      state, &latency_, cpu_.StopPercent(), sink.GetBytes(), kTicks * kPacketsPerTick * state.iterations());
+  dut_channel->Release();
+  peer_channel->Release();
+}
+BENCHMARK_REGISTER_F(BM_StackScenario, AclStreamingA2dpStyle)
+    ->Arg(100)
+    ->Iterations(1)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Connect to many advertising peripherals at once; latency is the per-link
+// time from ConnectServices() to the ATT channel being usable
+BENCHMARK_DEFINE_F(BM_StackScenario, ManyConnectionSetup)(State& state) {
+  const size_t kPeerCount = state.range(0);
+
+  std::vector<std::shared_ptr<AdvertisingPeer>> peers;
+  for (size_t i = 0; i < kPeerCount; i++) {
+    peers.push_back(AdvertisingPeer::Create(environment_.get()));
+  }
+
+  LeFixedChannelCollector dut_channels;
+  auto dut_manager = dut_->Start<l2cap::le::L2capLeModule>()->GetFixedChannelManager();
+  dut_manager->RegisterService(
+      l2cap::kLeAttributeCid,
+      common::BindOnce(&LeFixedChannelCollector::OnRegistrationComplete, common::Unretained(&dut_channels)),
+      common::Bind(&LeFixedChannelCollector::OnConnectionOpen, common::Unretained(&dut_channels)),
+      dut_->GetClientHandler());
+  dut_->WaitForIdle(std::chrono::milliseconds(500));
+
+  std::map<hci::Address, int64_t> started_at;
+  cpu_.Start();
+  for (auto _ : state) {
+    for (auto& peer : peers) {
+      started_at[peer->GetAddress()] = NowNanos();
+      dut_manager->ConnectServices(
+          hci::AddressWithType(peer->GetAddress(), hci::AddressType::PUBLIC_DEVICE_ADDRESS),
+          common::BindOnce([](l2cap::le::FixedChannelManager::ConnectionResult result) {
+            LOG_ERROR("LE connection failed %d", static_cast<int>(result.connection_result_code));
+          }),
+          dut_->GetClientHandler());
+    }
+    if (!dut_channels.WaitForChannels(kPeerCount, kScenarioTimeout)) {
+      state.SkipWithError("Timed out waiting for connections");
+      break;
+    }
+  }
+  double cpu_percent = cpu_.StopPercent();
+  auto& channels = dut_channels.GetChannels();
+  auto& opened_at = dut_channels.GetOpenTimes();
+  for (size_t i = 0; i < channels.size(); i++) {
+    auto start = started_at.find(channels[i]->GetDevice().GetAddress());
+    if (start != started_at.end()) {
+      latency_.Record(opened_at[i] - start->second);
+    }
+  }
+  ReportScenario(state, &latency_, cpu_percent, 0, channels.size());
+}
+BENCHMARK_REGISTER_F(BM_StackScenario, ManyConnectionSetup)
+    ->Arg(8)
+    ->Arg(32)
+    ->Iterations(1)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace stack_benchmark
+}  // namespace bluetooth
+
+int main(int argc, char** argv) {
+  // Both stacks share one config file; keep it out of the working directory
+  bluetooth::os::ParameterProvider::OverrideConfigFilePath("/tmp/bluetooth_stack_benchmark_config.conf");
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
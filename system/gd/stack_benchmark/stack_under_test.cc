@@ -0,0 +1,79 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack_benchmark/stack_under_test.h"
+
+#include "hci/acl_manager.h"
+#include "hci/hci_layer.h"
+#include "hci/le_address_manager.h"
+#include "os/log.h"
+#include "stack_benchmark/rootcanal_environment.h"
+
+namespace bluetooth {
+namespace stack_benchmark {
+
+StackUnderTest::StackUnderTest(RootcanalEnvironment* environment, const std::string& name)
+    : hal_(new InProcessHciHal(environment)), client_thread_(name + "_client", os::Thread::Priority::NORMAL) {
+  client_handler_ = new os::Handler(&client_thread_);
+  registry_.InjectTestModule(&hal::HciHal::Factory, hal_);
+
+  // Scenarios address each other by controller public address, so keep the initiator on it as well
+  auto acl_manager = Start<hci::AclManager>();
+  acl_manager->SetPrivacyPolicyForInitiatorAddress(
+      hci::LeAddressManager::AddressPolicy::USE_PUBLIC_ADDRESS,
+      GetAddressWithType(),
+      std::chrono::milliseconds(7 * 60 * 1000),
+      std::chrono::milliseconds(15 * 60 * 1000));
+}
+
+StackUnderTest::~StackUnderTest() {
+  client_handler_->Clear();
+  client_handler_->WaitUntilStopped(std::chrono::milliseconds(2000));
+  delete client_handler_;
+  registry_.StopAll();
+}
+
+hci::AddressWithType StackUnderTest::GetAddressWithType() const {
+  return hci::AddressWithType(hal_->GetControllerAddress(), hci::AddressType::PUBLIC_DEVICE_ADDRESS);
+}
+
+void StackUnderTest::StartConnectableAdvertising() {
+  constexpr uint16_t kAdvertisingInterval = 0x0020;
+  constexpr uint8_t kAllAdvertisingChannels = 0x07;
+  auto hci_layer = Get<hci::HciLayer>();
+  hci_layer->EnqueueCommand(
+      hci::LeSetAdvertisingParametersBuilder::Create(
+          kAdvertisingInterval,
+          kAdvertisingInterval,
+          hci::AdvertisingType::ADV_IND,
+          hci::OwnAddressType::PUBLIC_DEVICE_ADDRESS,
+          hci::PeerAddressType::PUBLIC_DEVICE_OR_IDENTITY_ADDRESS,
+          hci::Address::kEmpty,
+          kAllAdvertisingChannels,
+          hci::AdvertisingFilterPolicy::ALL_DEVICES),
+      client_handler_->BindOnce([](hci::CommandCompleteView view) { ASSERT(view.IsValid()); }));
+  hci_layer->EnqueueCommand(
+      hci::LeSetAdvertisingEnableBuilder::Create(hci::Enable::ENABLED),
+      client_handler_->BindOnce([](hci::CommandCompleteView view) { ASSERT(view.IsValid()); }));
+}
+
+bool StackUnderTest::WaitForIdle(std::chrono::milliseconds timeout) {
+  return registry_.GetTestThread().GetReactor()->WaitForIdle(timeout) &&
+         client_thread_.GetReactor()->WaitForIdle(timeout);
+}
+
+}  // namespace stack_benchmark
+}  // namespace bluetooth
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "hci/address_with_type.h"
+#include "module.h"
+#include "os/handler.h"
+#include "os/thread.h"
+#include "stack_benchmark/in_process_hci_hal.h"
+
+namespace bluetooth {
+namespace stack_benchmark {
+
+class RootcanalEnvironment;
+
+// One complete gd stack bound to its own in-process controller.
+//
+// Modules run on the registry thread, exactly as under StackManager.
+// Scenario callbacks are delivered on a separate client thread, so that time
+// spent by the benchmark itself is not charged to the stack handlers.
+class StackUnderTest {
+ public:
+  StackUnderTest(RootcanalEnvironment* environment, const std::string& name);
+  StackUnderTest(const StackUnderTest&) = delete;
+  StackUnderTest& operator=(const StackUnderTest&) = delete;
+  ~StackUnderTest();
+
+  // Start |T| and its dependencies on the stack thread
+  template <class T>
+  T* Start() {
+    return registry_.Start<T>(&registry_.GetTestThread());
+  }
+
+  template <class T>
+  T* Get() const {
+    return registry_.GetModuleUnderTest<T>();
+  }
+
+  InProcessHciHal* GetHal() const {
+    return hal_;
+  }
+
+  // Handler on which scenario callbacks should be bound
+  os::Handler* GetClientHandler() const {
+    return client_handler_;
+  }
+
+  // Public address of the controller, also used as LE identity address
+  hci::AddressWithType GetAddressWithType() const;
+
+  // Enable connectable legacy advertising directly through HciLayer, so
+  // that peers do not need LeAdvertisingManager to accept connections
+  void StartConnectableAdvertising();
+
+  // Wait until every queued task on the stack and client threads has run
+  bool WaitForIdle(std::chrono::milliseconds timeout);
+
+ private:
+  TestModuleRegistry registry_;
+  InProcessHciHal* hal_;
+  os::Thread client_thread_;
+  os::Handler* client_handler_;
+};
+
+}  // namespace stack_benchmark
+}  // namespace bluetooth
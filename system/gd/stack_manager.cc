@@ -22,9 +22,11 @@
 #include <queue>
 
 #include "common/bind.h"
+#include "common/trace_point.h"
 #include "module.h"
 #include "os/handler.h"
 #include "os/log.h"
+#include "os/system_properties.h"
 #include "os/thread.h"
 #include "os/wakelock_manager.h"
 
@@ -34,7 +36,16 @@ using ::bluetooth::os::WakelockManager;
 
 namespace bluetooth {
 
+namespace {
+// Set to "true" to mirror trace point samples to ftrace for Perfetto captures
+constexpr char kTraceMarkerProperty[] = "persist.bluetooth.gd.trace_marker";
+}  // namespace
+
 void StackManager::StartUp(ModuleList* modules, Thread* stack_thread) {
+  if (os::GetSystemProperty(kTraceMarkerProperty).value_or("") == "true") {
+    common::TracePoint::EnableTraceMarker(true);
+  }
+
   management_thread_ = new Thread("management_thread", Thread::Priority::NORMAL);
   handler_ = new Handler(management_thread_);
 
@@ -200,6 +200,8 @@ class Device {
   GENERATE_PROPERTY_GETTER_SETTER_REMOVER(PinLength, int, "PinLength");
   // unix timestamp in seconds from epoch
   GENERATE_PROPERTY_GETTER_SETTER_REMOVER(CreationUnixTimestamp, int, "DevClass");
+  // unix timestamp in seconds from epoch of when Name was last read from the device
+  GENERATE_PROPERTY_GETTER_SETTER_REMOVER(NameUnixTimestamp, int64_t, "NameTimestamp");
   GENERATE_PROPERTY_GETTER_SETTER_REMOVER(IsAuthenticated, int, "IsAuthenticated");
   GENERATE_PROPERTY_GETTER_SETTER_REMOVER(RequiresMitmProtection, int, "RequiresMitmProtection");
   GENERATE_PROPERTY_GETTER_SETTER_REMOVER(IsEncryptionRequired, int, "IsEncryptionRequired");
@@ -21,6 +21,8 @@
 #include <base/callback.h>
 #include <base/location.h>
 
+#include <vector>
+
 #include "osi/include/future.h"
 #include "osi/include/osi.h"  // INVALID_FD
 #include "stack/include/bt_hdr.h"
@@ -70,6 +72,10 @@ typedef struct hci_t {
 
   // Send some data downward through the HCI layer
   void (*transmit_downward)(uint16_t type, void* data);
+
+  // Send several packets of the same type downward through the HCI layer,
+  // with a single hop to the HCI thread
+  void (*transmit_downward_batch)(uint16_t type, std::vector<BT_HDR*> packets);
 } hci_t;
 
 const hci_t* hci_layer_get_interface();
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <set>
+#include <utility>
 
 #include <base/sys_byteorder.h>
 
@@ -302,11 +303,13 @@ struct MediaListItem {
     MediaElementItem song_;
   };
 
-  MediaListItem(MediaPlayerItem item) : type_(PLAYER), player_(item) {}
+  MediaListItem(MediaPlayerItem item)
+      : type_(PLAYER), player_(std::move(item)) {}
 
-  MediaListItem(FolderItem item) : type_(FOLDER), folder_(item) {}
+  MediaListItem(FolderItem item) : type_(FOLDER), folder_(std::move(item)) {}
 
-  MediaListItem(MediaElementItem item) : type_(SONG), song_(item) {}
+  MediaListItem(MediaElementItem item)
+      : type_(SONG), song_(std::move(item)) {}
 
   MediaListItem(const MediaListItem& item) {
     type_ = item.type_;
@@ -305,6 +305,12 @@
 #define BTM_SEC_MAX_DEVICE_RECORDS 100
 #endif
 
+/* The number of random resolvable addresses remembered together with the
+ * security record their IRK resolved to. */
+#ifndef BTM_BLE_RESOLVED_RPA_CACHE_SIZE
+#define BTM_BLE_RESOLVED_RPA_CACHE_SIZE 256
+#endif
+
 /* The number of security records for services. */
 #ifndef BTM_SEC_MAX_SERVICE_RECORDS
 #define BTM_SEC_MAX_SERVICE_RECORDS 32
@@ -109,3 +109,27 @@ void bte_main_hci_send(BT_HDR* p_msg, uint16_t event) {
     osi_free(p_msg);
   }
 }
+
+/******************************************************************************
+ *
+ * Function         bte_main_hci_send_batch
+ *
+ * Description      BTE MAIN API - Sends a batch of HCI messages of the same
+ *                  type, handing them to the HCI transport all at once.
+ *
+ * Returns          None
+ *
+ *****************************************************************************/
+void bte_main_hci_send_batch(std::vector<BT_HDR*> p_msgs, uint16_t event) {
+  uint16_t sub_event = event & BT_SUB_EVT_MASK; /* local controller ID */
+
+  for (BT_HDR* p_msg : p_msgs) p_msg->event = event;
+
+  if ((sub_event == LOCAL_BR_EDR_CONTROLLER_ID) ||
+      (sub_event == LOCAL_BLE_CONTROLLER_ID)) {
+    hci->transmit_downward_batch(event, std::move(p_msgs));
+  } else {
+    APPL_TRACE_ERROR("Invalid Controller ID. Discarding messages.");
+    for (BT_HDR* p_msg : p_msgs) osi_free(p_msg);
+  }
+}
@@ -28,6 +28,7 @@
 #include <memory>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "btif/include/btif_hh.h"
 #include "device/include/controller.h"
@@ -800,8 +801,10 @@ class LeShimAclConnection
 };
 
 struct shim::legacy::Acl::impl {
-  impl(uint8_t max_acceptlist_size, uint8_t max_address_resolution_size)
-      : shadow_acceptlist_(ShadowAcceptlist(max_acceptlist_size)),
+  impl(os::Handler* handler, uint8_t max_acceptlist_size,
+       uint8_t max_address_resolution_size)
+      : handler_(handler),
+        shadow_acceptlist_(ShadowAcceptlist(max_acceptlist_size)),
         shadow_address_resolution_list_(
             ShadowAddressResolutionList(max_address_resolution_size)) {}
 
@@ -816,9 +819,42 @@ struct shim::legacy::Acl::impl {
   FixedQueue<std::unique_ptr<ConnectionDescriptor>> connection_history_ =
       FixedQueue<std::unique_ptr<ConnectionDescriptor>>(kConnectionHistorySize);
 
+  os::Handler* handler_;
   ShadowAcceptlist shadow_acceptlist_;
   ShadowAddressResolutionList shadow_address_resolution_list_;
 
+  // Background connections and resolving list entries added back to back,
+  // e.g. while loading bonded devices, are written to the controller in one
+  // batch once the calls already queued on the handler have run.
+  std::vector<hci::AddressWithType> pending_background_connections_;
+  std::vector<hci::LeAddressManager::ResolvingListEntry>
+      pending_resolving_list_entries_;
+  bool address_lists_flush_scheduled_{false};
+
+  void schedule_address_lists_flush() {
+    if (address_lists_flush_scheduled_) return;
+    address_lists_flush_scheduled_ = true;
+    handler_->CallOn(this, &impl::flush_address_lists);
+  }
+
+  // Also called before any removal, so that it is not overtaken by an
+  // earlier pending addition
+  void flush_address_lists() {
+    address_lists_flush_scheduled_ = false;
+    if (pending_background_connections_.empty() &&
+        pending_resolving_list_entries_.empty()) {
+      return;
+    }
+    LOG_DEBUG("Flushing %zu background connections and %zu resolving entries",
+              pending_background_connections_.size(),
+              pending_resolving_list_entries_.size());
+    GetAclManager()->AddDevicesToBackgroundAndResolvingLists(
+        std::move(pending_background_connections_),
+        std::move(pending_resolving_list_entries_));
+    pending_background_connections_.clear();
+    pending_resolving_list_entries_.clear();
+  }
+
   bool IsClassicAcl(HciHandle handle) {
     return handle_to_classic_connection_map_.find(handle) !=
            handle_to_classic_connection_map_.end();
@@ -971,7 +1007,13 @@ struct shim::legacy::Acl::impl {
     }
     shadow_acceptlist_.Add(address_with_type);
     promise.set_value(true);
-    GetAclManager()->CreateLeConnection(address_with_type, is_direct);
+    if (is_direct) {
+      flush_address_lists();
+      GetAclManager()->CreateLeConnection(address_with_type, is_direct);
+    } else {
+      pending_background_connections_.push_back(address_with_type);
+      schedule_address_lists_flush();
+    }
     LOG_DEBUG("Allow Le connection from remote:%s",
               PRIVATE_ADDRESS(address_with_type));
     BTM_LogHistory(kBtmLogTag, ToLegacyAddressWithType(address_with_type),
@@ -980,6 +1022,7 @@ struct shim::legacy::Acl::impl {
 
   void ignore_le_connection_from(
       const hci::AddressWithType& address_with_type) {
+    flush_address_lists();
     shadow_acceptlist_.Remove(address_with_type);
     GetAclManager()->CancelLeConnectAndRemoveFromBackgroundList(
         address_with_type);
@@ -992,6 +1035,7 @@ struct shim::legacy::Acl::impl {
   void clear_acceptlist() {
     auto shadow_acceptlist = shadow_acceptlist_.GetCopy();
     size_t count = shadow_acceptlist.size();
+    flush_address_lists();
     GetAclManager()->ClearFilterAcceptList();
     shadow_acceptlist_.Clear();
     LOG_DEBUG("Cleared entire Le address acceptlist count:%zu", count);
@@ -1007,12 +1051,15 @@ struct shim::legacy::Acl::impl {
     }
     // TODO This should really be added upon successful completion
     shadow_address_resolution_list_.Add(address_with_type);
-    GetAclManager()->AddDeviceToResolvingList(address_with_type, peer_irk,
-                                              local_irk);
+    pending_resolving_list_entries_.push_back(
+        {address_with_type.ToPeerAddressType(), address_with_type.GetAddress(),
+         peer_irk, local_irk});
+    schedule_address_lists_flush();
   }
 
   void RemoveFromAddressResolution(
       const hci::AddressWithType& address_with_type) {
+    flush_address_lists();
     // TODO This should really be removed upon successful removal
     if (!shadow_address_resolution_list_.Remove(address_with_type)) {
       LOG_WARN("Unable to remove from Le Address Resolution list device:%s",
@@ -1022,6 +1069,7 @@ struct shim::legacy::Acl::impl {
   }
 
   void ClearResolvingList() {
+    flush_address_lists();
     GetAclManager()->ClearResolvingList();
     // TODO This should really be cleared after successful clear status
     shadow_address_resolution_list_.Clear();
@@ -1181,11 +1229,11 @@ void DumpsysHid(int fd) {
   for (unsigned i = 0; i < BTIF_HH_MAX_HID; i++) {
     const btif_hh_device_t* p_dev = &btif_hh_cb.devices[i];
     if (p_dev->bd_addr != RawAddress::kEmpty) {
-      LOG_DUMPSYS(fd, "  %u: addr:%s fd:%d state:%s ready:%s thread_id:%d", i,
+      LOG_DUMPSYS(fd, "  %u: addr:%s fd:%d state:%s ready:%s polling:%s", i,
                   PRIVATE_ADDRESS(p_dev->bd_addr), p_dev->fd,
                   bthh_connection_state_text(p_dev->dev_status).c_str(),
                   (p_dev->ready_for_data) ? ("T") : ("F"),
-                  static_cast<int>(p_dev->hh_poll_thread_id));
+                  (p_dev->hh_keep_polling) ? ("T") : ("F"));
     }
   }
   for (unsigned i = 0; i < BTIF_HH_MAX_ADDED_DEV; i++) {
@@ -1251,7 +1299,7 @@ shim::legacy::Acl::Acl(os::Handler* handler,
     : handler_(handler), acl_interface_(acl_interface) {
   ASSERT(handler_ != nullptr);
   ValidateAclInterface(acl_interface_);
-  pimpl_ = std::make_unique<Acl::impl>(max_acceptlist_size,
+  pimpl_ = std::make_unique<Acl::impl>(handler_, max_acceptlist_size,
                                        max_address_resolution_size);
   GetAclManager()->RegisterCallbacks(this, handler_);
   GetAclManager()->RegisterLeCallbacks(this, handler_);
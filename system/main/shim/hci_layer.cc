@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <vector>
 
 #include "callbacks/callbacks.h"
 #include "gd/common/init_flags.h"
@@ -290,11 +291,31 @@ static std::unique_ptr<bluetooth::packet::RawBuilder> MakeUniquePacket(
   return payload;
 }
 
+// Payload of an outgoing packet serialized straight out of the legacy stack
+// buffer, which it owns from then on.
+class BtHdrPayloadBuilder : public bluetooth::packet::BasePacketBuilder {
+ public:
+  BtHdrPayloadBuilder(BT_HDR* packet, const uint8_t* payload, size_t length)
+      : packet_(packet), payload_(payload), length_(length) {}
+  ~BtHdrPayloadBuilder() override { osi_free(packet_); }
+
+  size_t size() const override { return length_; }
+
+  void Serialize(bluetooth::packet::BitInserter& it) const override {
+    for (size_t i = 0; i < length_; i++) it.insert_byte(payload_[i]);
+  }
+
+ private:
+  BT_HDR* packet_;
+  const uint8_t* payload_;
+  size_t length_;
+};
+
 static BT_HDR* WrapPacketAndCopy(
     uint16_t event,
     bluetooth::hci::PacketView<bluetooth::hci::kLittleEndian>* data) {
   size_t packet_size = data->size() + kBtHdrSize;
-  BT_HDR* packet = reinterpret_cast<BT_HDR*>(osi_malloc(packet_size));
+  BT_HDR* packet = reinterpret_cast<BT_HDR*>(osi_buffer_malloc(packet_size));
   packet->offset = 0;
   packet->len = data->size();
   packet->layer_specific = 0;
@@ -426,7 +447,10 @@ static void transmit_sco_fragment(const uint8_t* stream, size_t length) {
                             bluetooth::shim::GetGdShimHandler());
 }
 
-static void transmit_iso_fragment(const uint8_t* stream, size_t length) {
+// With |owned_packet| set, the payload is not copied and |owned_packet| is
+// freed once sent.
+static void transmit_iso_fragment(const uint8_t* stream, size_t length,
+                                  BT_HDR* owned_packet = nullptr) {
   uint16_t handle_with_flags;
   STREAM_TO_UINT16(handle_with_flags, stream);
   auto pb_flag = static_cast<bluetooth::hci::IsoPacketBoundaryFlag>(
@@ -439,7 +463,13 @@ static void transmit_iso_fragment(const uint8_t* stream, size_t length) {
   // skip data total length
   stream += 2;
   length -= 2;
-  auto payload = MakeUniquePacket(stream, length);
+  std::unique_ptr<bluetooth::packet::BasePacketBuilder> payload;
+  if (owned_packet != nullptr) {
+    payload =
+        std::make_unique<BtHdrPayloadBuilder>(owned_packet, stream, length);
+  } else {
+    payload = MakeUniquePacket(stream, length);
+  }
   auto iso_packet = bluetooth::hci::IsoBuilder::Create(handle, pb_flag, ts_flag,
                                                        std::move(payload));
 
@@ -572,7 +602,7 @@ using bluetooth::shim::rust::u8SliceOnceCallback;
 static BT_HDR* WrapRustPacketAndCopy(uint16_t event,
                                      ::rust::Slice<const uint8_t>* data) {
   size_t packet_size = data->length() + kBtHdrSize;
-  BT_HDR* packet = reinterpret_cast<BT_HDR*>(osi_malloc(packet_size));
+  BT_HDR* packet = reinterpret_cast<BT_HDR*>(osi_buffer_malloc(packet_size));
   packet->offset = 0;
   packet->len = data->length();
   packet->layer_specific = 0;
@@ -771,6 +801,11 @@ static void transmit_fragment(BT_HDR* packet, bool send_transmit_finished) {
     size_t length = packet->len;
     if (bluetooth::common::init_flags::gd_rust_is_enabled()) {
       rust::transmit_iso_fragment(stream, length);
+    } else if (free_after_transmit) {
+      // The last fragment goes out of the packet itself, saving a copy of
+      // each outgoing SDU
+      cpp::transmit_iso_fragment(stream, length, packet);
+      return;
     } else {
       cpp::transmit_iso_fragment(stream, length);
     }
@@ -811,10 +846,27 @@ static void transmit_downward(uint16_t type, void* raw_data) {
   }
 }
 
+static void fragment_and_dispatch_batch(std::vector<BT_HDR*> packets) {
+  for (BT_HDR* packet : packets) {
+    packet_fragmenter->fragment_and_dispatch(packet);
+  }
+}
+
+static void transmit_downward_batch(uint16_t type,
+                                    std::vector<BT_HDR*> packets) {
+  if (bluetooth::common::init_flags::gd_rust_is_enabled()) {
+    fragment_and_dispatch_batch(std::move(packets));
+  } else {
+    bluetooth::shim::GetGdShimHandler()->Call(fragment_and_dispatch_batch,
+                                              std::move(packets));
+  }
+}
+
 static hci_t interface = {.set_data_cb = set_data_cb,
                           .transmit_command = transmit_command,
                           .transmit_command_futured = transmit_command_futured,
-                          .transmit_downward = transmit_downward};
+                          .transmit_downward = transmit_downward,
+                          .transmit_downward_batch = transmit_downward_batch};
 
 const hci_t* bluetooth::shim::hci_layer_get_interface() {
   packet_fragmenter = packet_fragmenter_get_interface();
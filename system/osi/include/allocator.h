@@ -41,6 +41,13 @@ void* osi_malloc(size_t size);
 void* osi_calloc(size_t size);
 void osi_free(void* ptr);
 
+// Same as |osi_malloc| and |osi_calloc|, for short lived packet buffers
+// (BT_HDR and friends) allocated and freed at a high rate. The memory comes
+// from the size-class pool in osi/include/buffer_pool.h when possible and is
+// released with |osi_free| like any other allocation.
+void* osi_buffer_malloc(size_t size);
+void* osi_buffer_calloc(size_t size);
+
 // Free a buffer that was previously allocated with function |osi_malloc|
 // or |osi_calloc| and reset the pointer to that buffer to NULL.
 // |p_ptr| is a pointer to the buffer pointer to be reset.
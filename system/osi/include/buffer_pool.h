@@ -0,0 +1,70 @@
+/******************************************************************************
+ *
+ *  Copyright 2022 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Size-class pool backing |osi_buffer_malloc| and |osi_buffer_calloc|.
+//
+// Every class owns a fixed number of buffers carved out of a single reserved
+// mapping, so |osi_free| can tell pooled buffers apart with a range check.
+// Freed buffers go to a per-thread cache first; a cache growing past its high
+// watermark hands buffers back to the shared lock-free free list of the class
+// until it is down to its low watermark, and an empty cache refills up to the
+// low watermark from that list.
+//
+// The configuration is read once from system properties, on first use:
+//   bluetooth.osi.buffer_pool.enabled            (default true)
+//   bluetooth.osi.buffer_pool.buffers_per_class  (default 512)
+//   bluetooth.osi.buffer_pool.cache_high         (default 32)
+//   bluetooth.osi.buffer_pool.cache_low          (default 8)
+
+typedef struct {
+  size_t buffer_size;
+  size_t capacity;
+  // Buffers of the class that have been used at least once
+  size_t touched;
+  uint64_t alloc_count;
+  uint64_t free_count;
+  // Requests that fell back to malloc because the class was exhausted
+  uint64_t fallback_count;
+} buffer_pool_stats_t;
+
+// Returns a buffer of at least |size| bytes, or NULL if the pool is disabled,
+// |size| is larger than the largest class or the class is exhausted. The
+// caller is expected to fall back to malloc in that case.
+void* buffer_pool_alloc(size_t size);
+
+// Returns true if |ptr| was returned by |buffer_pool_alloc|.
+bool buffer_pool_owns(const void* ptr);
+
+// Returns |ptr| to the pool. |ptr| must be owned by the pool.
+void buffer_pool_free(void* ptr);
+
+// Number of size classes, in increasing buffer size.
+size_t buffer_pool_class_count(void);
+
+// Fills |stats| for the class at |class_index|. Returns false if the index
+// is out of range or the pool is disabled.
+bool buffer_pool_get_stats(size_t class_index, buffer_pool_stats_t* stats);
+
+// Dump the per-class statistics to the |fd| file descriptor.
+void buffer_pool_debug_dump(int fd);
@@ -22,6 +22,7 @@
 #include "check.h"
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/allocator.h"
+#include "osi/include/buffer_pool.h"
 
 static const allocator_id_t alloc_allocator_id = 42;
 
@@ -72,8 +73,35 @@ void* osi_calloc(size_t size) {
   return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
 }
 
+void* osi_buffer_malloc(size_t size) {
+  CHECK(static_cast<ssize_t>(size) >= 0);
+  size_t real_size = allocation_tracker_resize_for_canary(size);
+  void* ptr = buffer_pool_alloc(real_size);
+  if (ptr == NULL) ptr = malloc(real_size);
+  CHECK(ptr);
+  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+}
+
+void* osi_buffer_calloc(size_t size) {
+  CHECK(static_cast<ssize_t>(size) >= 0);
+  size_t real_size = allocation_tracker_resize_for_canary(size);
+  void* ptr = buffer_pool_alloc(real_size);
+  if (ptr != NULL) {
+    memset(ptr, 0, real_size);
+  } else {
+    ptr = calloc(1, real_size);
+  }
+  CHECK(ptr);
+  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+}
+
 void osi_free(void* ptr) {
-  free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
+  void* real_ptr = allocation_tracker_notify_free(alloc_allocator_id, ptr);
+  if (buffer_pool_owns(real_ptr)) {
+    buffer_pool_free(real_ptr);
+  } else {
+    free(real_ptr);
+  }
 }
 
 void osi_free_and_reset(void** p_ptr) {
@@ -0,0 +1,321 @@
+/******************************************************************************
+ *
+ *  Copyright 2022 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_buffer_pool"
+
+#include "osi/include/buffer_pool.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "check.h"
+#include "osi/include/log.h"
+#include "osi/include/properties.h"
+
+namespace {
+
+// Multiples of 64 so every buffer starts on a cache line. 4160 fits a
+// BT_DEFAULT_BUFFER_SIZE packet plus the allocation tracker canaries.
+constexpr std::array<size_t, 7> kBufferSizes = {128,  256,  512, 1024,
+                                                2048, 4160, 8192};
+constexpr size_t kClassCount = kBufferSizes.size();
+
+constexpr uint32_t kNoBuffer = UINT32_MAX;
+constexpr uint64_t kIndexMask = UINT32_MAX;
+constexpr int kGenerationShift = 32;
+
+constexpr int32_t kDefaultBuffersPerClass = 512;
+constexpr int32_t kMaxBuffersPerClass = 4096;
+constexpr int32_t kDefaultCacheHigh = 32;
+constexpr int32_t kDefaultCacheLow = 8;
+
+struct size_class_t {
+  size_t buffer_size = 0;
+  uint8_t* base = nullptr;
+  uint32_t capacity = 0;
+
+  // Free list head: index of the first free buffer in the lower 32 bits and
+  // a generation bumped on every update in the upper 32 bits, so a pop racing
+  // with a pop and push of the same buffer fails its compare-exchange.
+  std::atomic<uint64_t> head{kNoBuffer};
+  std::unique_ptr<std::atomic<uint32_t>[]> next;
+
+  // Buffers at and above this index have never been handed out
+  std::atomic<uint32_t> touched{0};
+
+  std::atomic<uint64_t> alloc_count{0};
+  std::atomic<uint64_t> free_count{0};
+  std::atomic<uint64_t> fallback_count{0};
+};
+
+struct pool_t {
+  std::array<size_class_t, kClassCount> classes;
+  uint8_t* begin = nullptr;
+  uint8_t* end = nullptr;
+  size_t cache_high = 0;
+  size_t cache_low = 0;
+};
+
+// Never freed: thread caches may still flush into it while the process exits
+std::atomic<pool_t*> pool{nullptr};
+std::once_flag pool_init_flag;
+
+void pool_init() {
+  if (!osi_property_get_bool("bluetooth.osi.buffer_pool.enabled", true)) {
+    LOG_INFO("buffer pool disabled");
+    return;
+  }
+
+  int32_t buffers_per_class = osi_property_get_int32(
+      "bluetooth.osi.buffer_pool.buffers_per_class", kDefaultBuffersPerClass);
+  if (buffers_per_class <= 0 || buffers_per_class > kMaxBuffersPerClass) {
+    LOG_WARN("invalid buffers per class %d, using %d", buffers_per_class,
+             kDefaultBuffersPerClass);
+    buffers_per_class = kDefaultBuffersPerClass;
+  }
+  int32_t cache_high = osi_property_get_int32(
+      "bluetooth.osi.buffer_pool.cache_high", kDefaultCacheHigh);
+  int32_t cache_low = osi_property_get_int32(
+      "bluetooth.osi.buffer_pool.cache_low", kDefaultCacheLow);
+  if (cache_high < 1) cache_high = 1;
+  if (cache_low < 1) cache_low = 1;
+  if (cache_low > cache_high) cache_low = cache_high;
+
+  size_t total_size = 0;
+  for (size_t buffer_size : kBufferSizes) {
+    total_size += buffer_size * buffers_per_class;
+  }
+
+  // Pages are only backed once a buffer in them is first used
+  void* region =
+      mmap(nullptr, total_size, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (region == MAP_FAILED) {
+    LOG_ERROR("unable to reserve %zu bytes for the buffer pool", total_size);
+    return;
+  }
+
+  pool_t* new_pool = new pool_t;
+  new_pool->begin = static_cast<uint8_t*>(region);
+  new_pool->end = new_pool->begin + total_size;
+  new_pool->cache_high = cache_high;
+  new_pool->cache_low = cache_low;
+
+  uint8_t* base = new_pool->begin;
+  for (size_t i = 0; i < kClassCount; i++) {
+    size_class_t& size_class = new_pool->classes[i];
+    size_class.buffer_size = kBufferSizes[i];
+    size_class.base = base;
+    size_class.capacity = buffers_per_class;
+    size_class.next.reset(new std::atomic<uint32_t>[buffers_per_class]);
+    base += size_class.buffer_size * size_class.capacity;
+  }
+
+  pool.store(new_pool, std::memory_order_release);
+}
+
+pool_t* get_pool() {
+  std::call_once(pool_init_flag, pool_init);
+  return pool.load(std::memory_order_acquire);
+}
+
+size_t class_for_size(size_t size) {
+  for (size_t i = 0; i < kClassCount; i++) {
+    if (size <= kBufferSizes[i]) return i;
+  }
+  return kClassCount;
+}
+
+uint32_t pop_free_buffer(size_class_t& size_class) {
+  uint64_t head = size_class.head.load(std::memory_order_acquire);
+  while ((head & kIndexMask) != kNoBuffer) {
+    uint32_t index = head & kIndexMask;
+    uint64_t generation = (head >> kGenerationShift) + 1;
+    uint64_t new_head = (generation << kGenerationShift) |
+                        size_class.next[index].load(std::memory_order_relaxed);
+    if (size_class.head.compare_exchange_weak(head, new_head,
+                                              std::memory_order_acquire)) {
+      return index;
+    }
+  }
+
+  // Nothing was freed back yet, take a buffer that was never used
+  uint32_t touched = size_class.touched.load(std::memory_order_relaxed);
+  while (touched < size_class.capacity) {
+    if (size_class.touched.compare_exchange_weak(touched, touched + 1,
+                                                 std::memory_order_relaxed)) {
+      return touched;
+    }
+  }
+  return kNoBuffer;
+}
+
+void push_free_buffer(size_class_t& size_class, uint32_t index) {
+  uint64_t head = size_class.head.load(std::memory_order_relaxed);
+  uint64_t new_head;
+  do {
+    size_class.next[index].store(head & kIndexMask, std::memory_order_relaxed);
+    uint64_t generation = (head >> kGenerationShift) + 1;
+    new_head = (generation << kGenerationShift) | index;
+  } while (!size_class.head.compare_exchange_weak(
+      head, new_head, std::memory_order_release, std::memory_order_relaxed));
+}
+
+class ThreadCache {
+ public:
+  ~ThreadCache();
+
+  std::array<std::vector<uint32_t>, kClassCount> buffers;
+};
+
+thread_local ThreadCache thread_cache;
+// Set once |thread_cache| is destroyed, for frees happening later in the
+// teardown of the thread
+thread_local bool thread_cache_destroyed = false;
+
+ThreadCache::~ThreadCache() {
+  thread_cache_destroyed = true;
+  pool_t* current_pool = pool.load(std::memory_order_acquire);
+  if (current_pool == nullptr) return;
+  for (size_t i = 0; i < kClassCount; i++) {
+    for (uint32_t index : buffers[i]) {
+      push_free_buffer(current_pool->classes[i], index);
+    }
+  }
+}
+
+}  // namespace
+
+void* buffer_pool_alloc(size_t size) {
+  pool_t* current_pool = get_pool();
+  if (current_pool == nullptr) return nullptr;
+
+  size_t class_index = class_for_size(size);
+  if (class_index == kClassCount) return nullptr;
+  size_class_t& size_class = current_pool->classes[class_index];
+
+  uint32_t index = kNoBuffer;
+  if (thread_cache_destroyed) {
+    index = pop_free_buffer(size_class);
+  } else {
+    std::vector<uint32_t>& cache = thread_cache.buffers[class_index];
+    if (cache.empty()) {
+      cache.reserve(current_pool->cache_high + 1);
+      while (cache.size() < current_pool->cache_low) {
+        uint32_t refill = pop_free_buffer(size_class);
+        if (refill == kNoBuffer) break;
+        cache.push_back(refill);
+      }
+    }
+    if (!cache.empty()) {
+      index = cache.back();
+      cache.pop_back();
+    }
+  }
+
+  if (index == kNoBuffer) {
+    size_class.fallback_count.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  size_class.alloc_count.fetch_add(1, std::memory_order_relaxed);
+  return size_class.base + size_t(index) * size_class.buffer_size;
+}
+
+bool buffer_pool_owns(const void* ptr) {
+  pool_t* current_pool = pool.load(std::memory_order_acquire);
+  if (current_pool == nullptr) return false;
+  const uint8_t* p = static_cast<const uint8_t*>(ptr);
+  return p >= current_pool->begin && p < current_pool->end;
+}
+
+void buffer_pool_free(void* ptr) {
+  pool_t* current_pool = pool.load(std::memory_order_acquire);
+  CHECK(current_pool != nullptr);
+
+  uint8_t* p = static_cast<uint8_t*>(ptr);
+  size_t class_index = kClassCount - 1;
+  while (p < current_pool->classes[class_index].base) class_index--;
+  size_class_t& size_class = current_pool->classes[class_index];
+
+  size_t offset = p - size_class.base;
+  CHECK(offset % size_class.buffer_size == 0);
+  uint32_t index = offset / size_class.buffer_size;
+  size_class.free_count.fetch_add(1, std::memory_order_relaxed);
+
+  if (thread_cache_destroyed) {
+    push_free_buffer(size_class, index);
+    return;
+  }
+
+  std::vector<uint32_t>& cache = thread_cache.buffers[class_index];
+  cache.push_back(index);
+  if (cache.size() > current_pool->cache_high) {
+    while (cache.size() > current_pool->cache_low) {
+      push_free_buffer(size_class, cache.back());
+      cache.pop_back();
+    }
+  }
+}
+
+size_t buffer_pool_class_count(void) { return kClassCount; }
+
+bool buffer_pool_get_stats(size_t class_index, buffer_pool_stats_t* stats) {
+  CHECK(stats != nullptr);
+  pool_t* current_pool = get_pool();
+  if (current_pool == nullptr || class_index >= kClassCount) return false;
+
+  const size_class_t& size_class = current_pool->classes[class_index];
+  stats->buffer_size = size_class.buffer_size;
+  stats->capacity = size_class.capacity;
+  stats->touched = size_class.touched.load(std::memory_order_relaxed);
+  stats->alloc_count = size_class.alloc_count.load(std::memory_order_relaxed);
+  stats->free_count = size_class.free_count.load(std::memory_order_relaxed);
+  stats->fallback_count =
+      size_class.fallback_count.load(std::memory_order_relaxed);
+  return true;
+}
+
+void buffer_pool_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth Buffer Pool Statistics:\n");
+
+  pool_t* current_pool = pool.load(std::memory_order_acquire);
+  if (current_pool == nullptr) {
+    dprintf(fd, "  Not in use\n");
+    return;
+  }
+
+  dprintf(fd, "  Thread cache low/high watermark : %zu / %zu\n",
+          current_pool->cache_low, current_pool->cache_high);
+  for (size_t i = 0; i < kClassCount; i++) {
+    buffer_pool_stats_t stats;
+    buffer_pool_get_stats(i, &stats);
+    dprintf(fd,
+            "  %4zu octets: touched/capacity %zu / %zu, alloc/free/used "
+            "%" PRIu64 " / %" PRIu64 " / %" PRIu64 ", fallbacks %" PRIu64 "\n",
+            stats.buffer_size, stats.touched, stats.capacity,
+            stats.alloc_count, stats.free_count,
+            stats.alloc_count - stats.free_count, stats.fallback_count);
+  }
+}
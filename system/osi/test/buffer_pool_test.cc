@@ -0,0 +1,132 @@
+/******************************************************************************
+ *
+ *  Copyright 2022 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/allocator.h"
+#include "osi/include/buffer_pool.h"
+
+class BufferPoolTest : public AllocationTestHarness {};
+
+TEST_F(BufferPoolTest, test_size_classes) {
+  ASSERT_GT(buffer_pool_class_count(), 0u);
+  size_t previous_size = 0;
+  for (size_t i = 0; i < buffer_pool_class_count(); i++) {
+    buffer_pool_stats_t stats;
+    ASSERT_TRUE(buffer_pool_get_stats(i, &stats));
+    EXPECT_GT(stats.buffer_size, previous_size);
+    EXPECT_GT(stats.capacity, 0u);
+    previous_size = stats.buffer_size;
+
+    void* ptr = buffer_pool_alloc(stats.buffer_size);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_TRUE(buffer_pool_owns(ptr));
+    memset(ptr, 0xaa, stats.buffer_size);
+    buffer_pool_free(ptr);
+  }
+
+  buffer_pool_stats_t stats;
+  EXPECT_FALSE(buffer_pool_get_stats(buffer_pool_class_count(), &stats));
+  EXPECT_EQ(buffer_pool_alloc(previous_size + 1), nullptr);
+}
+
+TEST_F(BufferPoolTest, test_osi_buffer_malloc) {
+  buffer_pool_stats_t before;
+  ASSERT_TRUE(buffer_pool_get_stats(0, &before));
+
+  void* ptr = osi_buffer_malloc(16);
+  EXPECT_TRUE(buffer_pool_owns(ptr));
+  memset(ptr, 0x55, 16);
+  osi_free(ptr);
+
+  // Same thread, same class: the buffer comes back from the thread cache
+  uint8_t* zeroed = static_cast<uint8_t*>(osi_buffer_calloc(16));
+  EXPECT_EQ(zeroed, ptr);
+  for (size_t i = 0; i < 16; i++) EXPECT_EQ(zeroed[i], 0);
+  osi_free(zeroed);
+
+  buffer_pool_stats_t after;
+  ASSERT_TRUE(buffer_pool_get_stats(0, &after));
+  EXPECT_EQ(after.alloc_count - before.alloc_count, 2u);
+  EXPECT_EQ(after.free_count - before.free_count, 2u);
+
+  // Larger than any class: plain malloc, still released by osi_free
+  void* large = osi_buffer_malloc(64 * 1024);
+  EXPECT_FALSE(buffer_pool_owns(large));
+  osi_free(large);
+}
+
+TEST_F(BufferPoolTest, test_exhaustion_falls_back) {
+  buffer_pool_stats_t before;
+  ASSERT_TRUE(buffer_pool_get_stats(0, &before));
+
+  std::vector<void*> buffers;
+  std::set<void*> unique;
+  for (size_t i = 0; i <= before.capacity; i++) {
+    void* ptr = osi_buffer_malloc(1);
+    buffers.push_back(ptr);
+    unique.insert(ptr);
+  }
+  EXPECT_EQ(unique.size(), buffers.size());
+  EXPECT_FALSE(buffer_pool_owns(buffers.back()));
+
+  buffer_pool_stats_t after;
+  ASSERT_TRUE(buffer_pool_get_stats(0, &after));
+  EXPECT_EQ(after.touched, after.capacity);
+  EXPECT_GT(after.fallback_count, before.fallback_count);
+
+  for (void* ptr : buffers) osi_free(ptr);
+}
+
+TEST_F(BufferPoolTest, test_free_on_other_thread) {
+  constexpr size_t kBufferCount = 200;
+  buffer_pool_stats_t before;
+  ASSERT_TRUE(buffer_pool_get_stats(1, &before));
+
+  std::vector<void*> buffers;
+  for (size_t i = 0; i < kBufferCount; i++) {
+    buffers.push_back(osi_buffer_malloc(200));
+  }
+
+  // Frees overflow the cache of the other thread back to the shared list,
+  // and the rest is returned when that thread exits
+  std::thread([&buffers]() {
+    for (void* ptr : buffers) osi_free(ptr);
+  }).join();
+
+  buffer_pool_stats_t after;
+  ASSERT_TRUE(buffer_pool_get_stats(1, &after));
+  EXPECT_EQ(after.free_count - before.free_count, kBufferCount);
+
+  // All those buffers can be handed out again without growing the pool
+  buffers.clear();
+  for (size_t i = 0; i < kBufferCount; i++) {
+    buffers.push_back(osi_buffer_malloc(200));
+  }
+  buffer_pool_stats_t reused;
+  ASSERT_TRUE(buffer_pool_get_stats(1, &reused));
+  EXPECT_EQ(reused.touched, after.touched);
+  for (void* ptr : buffers) osi_free(ptr);
+}
@@ -61,9 +61,7 @@ size_t GetFolderItemsResponseBuilder::size() const {
 
   len += 2;  // UID Counter
   len += 2;  // Number of Items;
-  for (const auto& item : items_) {
-    len += item.size();
-  }
+  len += items_size_;
 
   return len;
 }
@@ -96,27 +94,33 @@ bool GetFolderItemsResponseBuilder::Serialize(
 bool GetFolderItemsResponseBuilder::AddMediaPlayer(MediaPlayerItem item) {
   CHECK(scope_ == Scope::MEDIA_PLAYER_LIST);
 
-  if (size() + item.size() > mtu_) return false;
+  size_t item_size = item.size();
+  if (size() + item_size > mtu_) return false;
 
-  items_.push_back(MediaListItem(item));
+  items_.emplace_back(std::move(item));
+  items_size_ += item_size;
   return true;
 }
 
 bool GetFolderItemsResponseBuilder::AddSong(MediaElementItem item) {
   CHECK(scope_ == Scope::VFS || scope_ == Scope::NOW_PLAYING);
 
-  if (size() + item.size() > mtu_) return false;
+  size_t item_size = item.size();
+  if (size() + item_size > mtu_) return false;
 
-  items_.push_back(MediaListItem(item));
+  items_.emplace_back(std::move(item));
+  items_size_ += item_size;
   return true;
 }
 
 bool GetFolderItemsResponseBuilder::AddFolder(FolderItem item) {
   CHECK(scope_ == Scope::VFS);
 
-  if (size() + item.size() > mtu_) return false;
+  size_t item_size = item.size();
+  if (size() + item_size > mtu_) return false;
 
-  items_.push_back(MediaListItem(item));
+  items_.emplace_back(std::move(item));
+  items_size_ += item_size;
   return true;
 }
 
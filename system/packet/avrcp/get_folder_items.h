@@ -43,6 +43,8 @@ class GetFolderItemsResponseBuilder : public BrowsePacketBuilder {
  protected:
   Scope scope_;
   std::vector<MediaListItem> items_;
+  // Sum of items_[i].size(), so that checking the MTU on every Add is cheap
+  size_t items_size_ = 0;
   Status status_;
   uint16_t uid_counter_;
   size_t mtu_;
@@ -473,6 +473,7 @@ void Device::TrackChangedNotificationResponse(uint8_t label, bool interim,
   // Anytime we use the now playing list, update our map so that its always
   // current
   now_playing_ids_.clear();
+  now_playing_ids_.reserve(song_list.size());
   uint64_t uid = 0;
   for (const SongInfo& song : song_list) {
     now_playing_ids_.insert(song.media_id);
@@ -1207,6 +1208,7 @@ void Device::GetVFSListResponse(uint8_t label,
 
   // TODO (apanicke): Add test that checks if vfs_ids_ is the correct size after
   // an operation.
+  vfs_ids_.reserve(items.size());
   for (const auto& item : items) {
     if (item.type == ListItem::FOLDER) {
       vfs_ids_.insert(item.folder.media_id);
@@ -1220,16 +1222,19 @@ void Device::GetVFSListResponse(uint8_t label,
   // happens. These items do not need to correspond with the now playing list as
   // the UID's only need to be unique in the context of the current scope and
   // the current folder
+  //
+  // Only the requested range is converted, and |items| is owned here, so
+  // each item is moved into the response rather than copied.
   for (auto i = pkt->GetStartItem(); i <= pkt->GetEndItem() && i < items.size();
        i++) {
     if (items[i].type == ListItem::FOLDER) {
-      auto folder = items[i].folder;
+      auto& folder = items[i].folder;
       // right now we always use folders of mixed type
       FolderItem folder_item(vfs_ids_.get_uid(folder.media_id), 0x00,
                              folder.is_playable, folder.name);
-      if (!builder->AddFolder(folder_item)) break;
+      if (!builder->AddFolder(std::move(folder_item))) break;
     } else if (items[i].type == ListItem::SONG) {
-      auto song = items[i].song;
+      auto& song = items[i].song;
 
       // Filter out DEFAULT_COVER_ART handle if this device has no client
       if (!HasBipClient()) {
@@ -1252,7 +1257,7 @@ void Device::GetVFSListResponse(uint8_t label,
 
       // If we fail to add a song, don't accidentally add one later that might
       // fit.
-      if (!builder->AddSong(song_item)) break;
+      if (!builder->AddSong(std::move(song_item))) break;
     }
   }
 
@@ -1267,13 +1272,14 @@ void Device::GetNowPlayingListResponse(
       Status::NO_ERROR, 0x0000, browse_mtu_);
 
   now_playing_ids_.clear();
+  now_playing_ids_.reserve(song_list.size());
   for (const SongInfo& song : song_list) {
     now_playing_ids_.insert(song.media_id);
   }
 
   for (size_t i = pkt->GetStartItem();
        i <= pkt->GetEndItem() && i < song_list.size(); i++) {
-    auto song = song_list[i];
+    auto& song = song_list[i];
 
     // Filter out DEFAULT_COVER_ART handle if this device has no client
     if (!HasBipClient()) {
@@ -1294,7 +1300,7 @@ void Device::GetNowPlayingListResponse(
 
     // If we fail to add a song, don't accidentally add one later that might
     // fit.
-    if (!builder->AddSong(item)) break;
+    if (!builder->AddSong(std::move(item))) break;
   }
 
   send_message(label, true, std::move(builder));
@@ -1432,6 +1438,7 @@ void Device::HandleNowPlayingNotificationResponse(
   }
 
   now_playing_ids_.clear();
+  now_playing_ids_.reserve(song_list.size());
   for (const SongInfo& song : song_list) {
     now_playing_ids_.insert(song.media_id);
   }
@@ -16,7 +16,11 @@
 
 #pragma once
 
-#include <map>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
 namespace bluetooth {
 namespace avrcp {
@@ -24,39 +28,47 @@ namespace avrcp {
 // A helper class to convert Media ID's (represented as strings) that are
 // received from the AVRCP Media Interface layer into UID's to be used
 // with connected devices.
+//
+// UID's are handed out sequentially, so each media ID is stored once and the
+// UID is its position in that store. The hash index keys on views into the
+// store; std::deque never moves its elements on push_back, so the views stay
+// valid until clear().
 class MediaIdMap {
  public:
   void clear() {
     media_id_to_uid_.clear();
-    uid_to_media_id_.clear();
+    media_ids_.clear();
   }
 
-  std::string get_media_id(uint64_t uid) {
-    const auto& uid_it = uid_to_media_id_.find(uid);
-    if (uid_it == uid_to_media_id_.end()) return "";
-    return uid_it->second;
+  // Avoids rehashing while a large folder or now playing list is inserted
+  void reserve(size_t count) { media_id_to_uid_.reserve(count); }
+
+  size_t size() const { return media_ids_.size(); }
+
+  std::string get_media_id(uint64_t uid) const {
+    if (uid == 0 || uid > media_ids_.size()) return "";
+    return media_ids_[uid - 1];
   }
 
-  uint64_t get_uid(std::string media_id) {
+  uint64_t get_uid(std::string_view media_id) const {
     const auto& media_id_it = media_id_to_uid_.find(media_id);
     if (media_id_it == media_id_to_uid_.end()) return 0;
     return media_id_it->second;
   }
 
-  uint64_t insert(std::string media_id) {
-    if (media_id_to_uid_.find(media_id) != media_id_to_uid_.end()) {
-      return media_id_to_uid_[media_id];
-    }
+  uint64_t insert(std::string_view media_id) {
+    const auto& media_id_it = media_id_to_uid_.find(media_id);
+    if (media_id_it != media_id_to_uid_.end()) return media_id_it->second;
 
-    uint64_t uid = media_id_to_uid_.size() + 1;
-    media_id_to_uid_.insert(std::pair<std::string, uint64_t>(media_id, uid));
-    uid_to_media_id_.insert(std::pair<uint64_t, std::string>(uid, media_id));
+    media_ids_.emplace_back(media_id);
+    uint64_t uid = media_ids_.size();
+    media_id_to_uid_.emplace(media_ids_.back(), uid);
     return uid;
   }
 
  private:
-  std::map<std::string, uint64_t> media_id_to_uid_;
-  std::map<uint64_t, std::string> uid_to_media_id_;
+  std::deque<std::string> media_ids_;
+  std::unordered_map<std::string_view, uint64_t> media_id_to_uid_;
 };
 
 }  // namespace avrcp
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "media_id_map.h"
+
+namespace bluetooth {
+namespace avrcp {
+
+TEST(AvrcpMediaIdMapTest, uidsAreSequentialAndStable) {
+  MediaIdMap map;
+
+  EXPECT_EQ(map.insert("media_a"), 1u);
+  EXPECT_EQ(map.insert("media_b"), 2u);
+  EXPECT_EQ(map.insert("media_a"), 1u);
+  EXPECT_EQ(map.size(), 2u);
+
+  EXPECT_EQ(map.get_uid("media_b"), 2u);
+  EXPECT_EQ(map.get_media_id(1), "media_a");
+  EXPECT_EQ(map.get_media_id(2), "media_b");
+}
+
+TEST(AvrcpMediaIdMapTest, unknownLookups) {
+  MediaIdMap map;
+  map.insert("media_a");
+
+  EXPECT_EQ(map.get_uid("media_c"), 0u);
+  EXPECT_EQ(map.get_media_id(0), "");
+  EXPECT_EQ(map.get_media_id(2), "");
+}
+
+TEST(AvrcpMediaIdMapTest, clearRestartsUids) {
+  MediaIdMap map;
+  map.insert("media_a");
+  map.insert("media_b");
+  map.clear();
+
+  EXPECT_EQ(map.size(), 0u);
+  EXPECT_EQ(map.get_uid("media_a"), 0u);
+  EXPECT_EQ(map.insert("media_b"), 1u);
+}
+
+TEST(AvrcpMediaIdMapTest, largeListKeepsLookupsValid) {
+  // Enough entries to force the index to rehash and the store to grow
+  // many times; every lookup must still resolve to the right entry.
+  constexpr uint64_t kNumItems = 50000;
+  MediaIdMap map;
+  map.reserve(kNumItems / 2);
+  for (uint64_t i = 0; i < kNumItems; i++) {
+    ASSERT_EQ(map.insert("media_" + std::to_string(i)), i + 1);
+  }
+
+  for (uint64_t i = 0; i < kNumItems; i++) {
+    std::string media_id = "media_" + std::to_string(i);
+    ASSERT_EQ(map.get_uid(media_id), i + 1);
+    ASSERT_EQ(map.get_media_id(i + 1), media_id);
+  }
+}
+
+}  // namespace avrcp
+}  // namespace bluetooth
@@ -24,7 +24,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <vector>
+
 #include "a2dp_aac.h"
+#include "a2dp_pcm_conditioner.h"
 #include "common/time_util.h"
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
@@ -93,6 +96,9 @@ typedef struct {
 
 static tA2DP_AAC_ENCODER_CB a2dp_aac_encoder_cb;
 
+// Converts the feeding PCM when its format differs from the AAC input
+static A2dpPcmConditioner a2dp_aac_pcm_conditioner;
+
 static uint32_t a2dp_aac_encoder_interval_ms = A2DP_AAC_ENCODER_INTERVAL_MS;
 
 static void a2dp_aac_encoder_update(A2dpCodecConfig* a2dp_codec_config,
@@ -119,13 +125,14 @@ void A2DP_UnloadEncoderAac(void) {
   memset(&a2dp_aac_encoder_cb, 0, sizeof(a2dp_aac_encoder_cb));
 }
 
-void a2dp_aac_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+bool a2dp_aac_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
                            A2dpCodecConfig* a2dp_codec_config,
                            a2dp_source_read_callback_t read_callback,
                            a2dp_source_enqueue_callback_t enqueue_callback) {
   if (a2dp_aac_encoder_cb.has_aac_handle)
     aacEncClose(&a2dp_aac_encoder_cb.aac_handle);
   memset(&a2dp_aac_encoder_cb, 0, sizeof(a2dp_aac_encoder_cb));
+  a2dp_aac_pcm_conditioner = A2dpPcmConditioner();
 
   a2dp_aac_encoder_cb.stats.session_start_us =
       bluetooth::common::time_get_os_boottime_us();
@@ -147,6 +154,7 @@ void a2dp_aac_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
   bool config_updated = false;
   a2dp_aac_encoder_update(a2dp_codec_config, &restart_input, &restart_output,
                           &config_updated);
+  return a2dp_aac_pcm_conditioner.IsConfigured();
 }
 
 // Update the A2DP AAC encoder.
@@ -426,6 +434,14 @@ static void a2dp_aac_encoder_update(A2dpCodecConfig* a2dp_codec_config,
       p_encoder_params->input_channels_n,
       p_encoder_params->max_encoded_buffer_bytes);
 
+  if (!a2dp_aac_pcm_conditioner.Init(
+          p_feeding_params->sample_rate, p_feeding_params->bits_per_sample,
+          p_feeding_params->channel_count, p_encoder_params->sample_rate,
+          p_encoder_params->input_channels_n,
+          p_feeding_params->bits_per_sample)) {
+    LOG_ERROR("%s: Cannot convert the PCM to the AAC encoder input", __func__);
+  }
+
   // After encoder params ready, reset the feeding state and its interval.
   a2dp_aac_feeding_reset();
 }
@@ -468,10 +484,12 @@ void a2dp_aac_feeding_reset(void) {
   LOG_INFO("%s: PCM bytes %u per tick %u ms", __func__,
            a2dp_aac_encoder_cb.aac_feeding_state.bytes_per_tick,
            a2dp_aac_encoder_interval_ms);
+  a2dp_aac_pcm_conditioner.Reset();
 }
 
 void a2dp_aac_feeding_flush(void) {
   a2dp_aac_encoder_cb.aac_feeding_state.counter = 0.0f;
+  a2dp_aac_pcm_conditioner.Reset();
 }
 
 uint64_t a2dp_aac_get_encoder_interval_ms(void) {
@@ -540,9 +558,9 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
       &a2dp_aac_encoder_cb.aac_encoder_params;
   tA2DP_FEEDING_PARAMS* p_feeding_params = &a2dp_aac_encoder_cb.feeding_params;
   uint8_t remain_nb_frame = nb_frame;
-  uint8_t read_buffer[BT_DEFAULT_BUFFER_SIZE];
+  alignas(int16_t) uint8_t read_buffer[BT_DEFAULT_BUFFER_SIZE];
   int pcm_bytes_per_frame = p_encoder_params->frame_length *
-                            p_feeding_params->channel_count *
+                            p_encoder_params->input_channels_n *
                             p_feeding_params->bits_per_sample / 8;
   CHECK(pcm_bytes_per_frame <= static_cast<int>(sizeof(read_buffer)));
 
@@ -575,7 +593,7 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
 
   AACENC_InArgs aac_in_args;
   aac_in_args.numInSamples =
-      p_encoder_params->frame_length * p_feeding_params->channel_count;
+      p_encoder_params->frame_length * p_encoder_params->input_channels_n;
   aac_in_args.numAncBytes = 0;
 
   AACENC_OutArgs aac_out_args = {
@@ -586,7 +604,7 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
   int written = 0;
 
   while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+    BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(BT_DEFAULT_BUFFER_SIZE);
     p_buf->offset = A2DP_AAC_OFFSET;
     p_buf->len = 0;
     p_buf->layer_specific = 0;
@@ -662,16 +680,20 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
 }
 
 static bool a2dp_aac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read) {
-  uint32_t read_size = a2dp_aac_encoder_cb.aac_encoder_params.frame_length *
-                       a2dp_aac_encoder_cb.feeding_params.channel_count *
-                       a2dp_aac_encoder_cb.feeding_params.bits_per_sample / 8;
+  uint32_t frame_length = a2dp_aac_encoder_cb.aac_encoder_params.frame_length;
+  uint32_t read_size = a2dp_aac_pcm_conditioner.SourceBytesNeeded(frame_length);
+  static std::vector<uint8_t> source_buffer;
+  uint8_t* source = read_buffer;
+  if (!a2dp_aac_pcm_conditioner.IsPassthrough()) {
+    if (source_buffer.size() < read_size) source_buffer.resize(read_size);
+    source = source_buffer.data();
+  }
 
   a2dp_aac_encoder_cb.stats.media_read_total_expected_reads_count++;
   a2dp_aac_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
 
   /* Read Data from UIPC channel */
-  uint32_t nb_byte_read =
-      a2dp_aac_encoder_cb.read_callback(read_buffer, read_size);
+  uint32_t nb_byte_read = a2dp_aac_encoder_cb.read_callback(source, read_size);
   a2dp_aac_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
   *bytes_read = nb_byte_read;
 
@@ -679,11 +701,15 @@ static bool a2dp_aac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read) {
     if (nb_byte_read == 0) return false;
 
     /* Fill the unfilled part of the read buffer with silence (0) */
-    memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
+    memset(source + nb_byte_read, 0, read_size - nb_byte_read);
     nb_byte_read = read_size;
   }
   a2dp_aac_encoder_cb.stats.media_read_total_actual_reads_count++;
 
+  if (source != read_buffer) {
+    a2dp_aac_pcm_conditioner.Process(
+        source, reinterpret_cast<int16_t*>(read_buffer), frame_length);
+  }
   return true;
 }
 
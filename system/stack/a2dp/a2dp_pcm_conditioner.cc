@@ -0,0 +1,300 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_pcm_conditioner"
+
+#include "a2dp_pcm_conditioner.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "osi/include/log.h"
+
+namespace {
+
+// Filter taps per phase, for each factor by which the sample rate is reduced
+constexpr size_t kTapsPerPhase = 48;
+constexpr size_t kMaxTaps = 192;
+// Phases above this need a coefficient table too large to be worth it
+constexpr uint32_t kMaxPhases = 1024;
+// Cutoff of the anti-aliasing filter, relative to the lower Nyquist frequency
+constexpr double kCutoff = 0.92;
+constexpr size_t kSimdWidth = 8;
+
+int16_t Saturate(int32_t sample) {
+  return static_cast<int16_t>(
+      std::min<int32_t>(std::max<int32_t>(sample, INT16_MIN), INT16_MAX));
+}
+
+// |num_samples| must be a multiple of kSimdWidth
+int32_t DotProduct(const int16_t* a, const int16_t* b, size_t num_samples) {
+  size_t i = 0;
+  int32_t sum = 0;
+#if defined(__ARM_NEON)
+  int32x4_t acc = vdupq_n_s32(0);
+  for (; i + 8 <= num_samples; i += 8) {
+    int16x8_t va = vld1q_s16(a + i);
+    int16x8_t vb = vld1q_s16(b + i);
+    acc = vmlal_s16(acc, vget_low_s16(va), vget_low_s16(vb));
+    acc = vmlal_s16(acc, vget_high_s16(va), vget_high_s16(vb));
+  }
+  int32x2_t pair = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+  sum = vget_lane_s32(vpadd_s32(pair, pair), 0);
+#elif defined(__SSE2__)
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 8 <= num_samples; i += 8) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(va, vb));
+  }
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  sum = _mm_cvtsi128_si32(acc);
+#endif
+  for (; i < num_samples; i++) {
+    sum += static_cast<int32_t>(a[i]) * b[i];
+  }
+  return sum;
+}
+
+// Reads one little endian sample and converts it to 16 bit, rounding
+int16_t ReadSample(const uint8_t* p, uint8_t bits_per_sample) {
+  switch (bits_per_sample) {
+    case 8:
+      return static_cast<int16_t>((p[0] - 128) * 256);
+    case 24: {
+      int32_t sample = static_cast<int32_t>(
+          (static_cast<uint32_t>(p[2]) << 24) |
+          (static_cast<uint32_t>(p[1]) << 16) | (p[0] << 8));
+      return Saturate((static_cast<int64_t>(sample) + (1 << 15)) >> 16);
+    }
+    case 32: {
+      int32_t sample = static_cast<int32_t>(
+          (static_cast<uint32_t>(p[3]) << 24) |
+          (static_cast<uint32_t>(p[2]) << 16) |
+          (static_cast<uint32_t>(p[1]) << 8) | p[0]);
+      return Saturate((static_cast<int64_t>(sample) + (1 << 15)) >> 16);
+    }
+    default:
+      return static_cast<int16_t>(p[0] | (p[1] << 8));
+  }
+}
+
+}  // namespace
+
+bool A2dpPcmConditioner::Init(uint32_t src_sample_rate,
+                              uint8_t src_bits_per_sample,
+                              uint8_t src_channel_count,
+                              uint32_t dst_sample_rate,
+                              uint8_t dst_channel_count,
+                              uint8_t dst_bits_per_sample) {
+  configured_ = false;
+  passthrough_ = true;
+  if (src_sample_rate == 0 || dst_sample_rate == 0 ||
+      (src_bits_per_sample != 8 && src_bits_per_sample != 16 &&
+       src_bits_per_sample != 24 && src_bits_per_sample != 32) ||
+      src_channel_count < 1 || src_channel_count > 2 ||
+      dst_channel_count < 1 || dst_channel_count > 2) {
+    LOG_ERROR("%s: unsupported conversion from %u Hz %u bit %u channels",
+              __func__, src_sample_rate, src_bits_per_sample,
+              src_channel_count);
+    return false;
+  }
+
+  uint32_t divisor = std::gcd(src_sample_rate, dst_sample_rate);
+  uint32_t up = dst_sample_rate / divisor;
+  uint32_t down = src_sample_rate / divisor;
+  if (up > kMaxPhases) {
+    LOG_ERROR("%s: unsupported sample rate conversion from %u Hz to %u Hz",
+              __func__, src_sample_rate, dst_sample_rate);
+    return false;
+  }
+
+  bool passthrough = up == down && src_bits_per_sample == dst_bits_per_sample &&
+                     src_channel_count == dst_channel_count;
+  if (!passthrough && dst_bits_per_sample != 16) {
+    LOG_ERROR("%s: unsupported conversion to %u bit", __func__,
+              dst_bits_per_sample);
+    return false;
+  }
+
+  src_bits_per_sample_ = src_bits_per_sample;
+  src_channel_count_ = src_channel_count;
+  dst_channel_count_ = dst_channel_count;
+  up_ = up;
+  down_ = down;
+  passthrough_ = passthrough;
+  configured_ = true;
+
+  taps_ = 0;
+  coefficients_.clear();
+  if (up_ != down_) {
+    // Longer filters for a steeper cutoff when decimating
+    size_t taps = kTapsPerPhase * ((down_ + up_ - 1) / up_);
+    taps_ = std::min(kMaxTaps,
+                     (taps + kSimdWidth - 1) / kSimdWidth * kSimdWidth);
+    DesignFilter();
+  }
+  Reset();
+
+  LOG_INFO("%s: %u Hz %u bit %u channels to %u Hz %u channels, %s", __func__,
+           src_sample_rate, src_bits_per_sample, src_channel_count,
+           dst_sample_rate, dst_channel_count,
+           passthrough_ ? "passthrough"
+                        : (up_ == down_ ? "no resampling" : "resampling"));
+  return true;
+}
+
+void A2dpPcmConditioner::Reset() {
+  position_ = 0;
+  for (auto& samples : samples_) {
+    samples.assign(taps_, 0);
+  }
+}
+
+// Windowed sinc low pass filter at |up_| times the source rate, split into
+// |up_| phases of |taps_| coefficients each.
+void A2dpPcmConditioner::DesignFilter() {
+  size_t length = taps_ * up_;
+  double cutoff = kCutoff / (2.0 * std::max(up_, down_));
+  double center = (length - 1) / 2.0;
+  std::vector<double> filter(length);
+  for (size_t n = 0; n < length; n++) {
+    double t = 2.0 * M_PI * cutoff * (n - center);
+    double sinc = t == 0 ? 1.0 : std::sin(t) / t;
+    double x = 2.0 * M_PI * n / (length - 1);
+    double blackman = 0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2 * x);
+    filter[n] = sinc * blackman;
+  }
+
+  coefficients_.resize(length);
+  for (uint32_t phase = 0; phase < up_; phase++) {
+    // Unity gain at DC for every phase, so a constant input stays constant
+    double gain = 0;
+    for (size_t i = 0; i < taps_; i++) {
+      gain += filter[phase + i * up_];
+    }
+    for (size_t i = 0; i < taps_; i++) {
+      double coefficient = filter[phase + i * up_] / gain * 32768.0;
+      coefficients_[phase * taps_ + (taps_ - 1 - i)] = static_cast<int16_t>(
+          std::clamp(std::lround(coefficient), long{INT16_MIN},
+                     long{INT16_MAX}));
+    }
+  }
+}
+
+size_t A2dpPcmConditioner::SourceFramesNeeded(size_t num_frames) const {
+  if (up_ == down_ || num_frames == 0) {
+    return num_frames;
+  }
+  // Up to and including the source frame of the last output frame
+  int64_t last_position =
+      position_ + static_cast<int64_t>(num_frames - 1) * down_;
+  return (last_position + up_) / up_;
+}
+
+size_t A2dpPcmConditioner::SourceBytesNeeded(size_t num_frames) const {
+  return SourceFramesNeeded(num_frames) * src_channel_count_ *
+         (src_bits_per_sample_ / 8);
+}
+
+// Appends |num_frames| source frames to |samples_|, converted to 16 bit and
+// mapped to the output channels
+void A2dpPcmConditioner::Deinterleave(const uint8_t* src, size_t num_frames) {
+  size_t bytes_per_sample = src_bits_per_sample_ / 8;
+  size_t bytes_per_frame = bytes_per_sample * src_channel_count_;
+  for (uint8_t channel = 0; channel < dst_channel_count_; channel++) {
+    samples_[channel].resize(taps_ + num_frames);
+  }
+  int16_t* left = samples_[0].data() + taps_;
+
+  if (src_channel_count_ == 1) {
+    for (size_t i = 0; i < num_frames; i++) {
+      left[i] = ReadSample(src + i * bytes_per_frame, src_bits_per_sample_);
+    }
+    if (dst_channel_count_ == 2) {
+      memcpy(samples_[1].data() + taps_, left, num_frames * sizeof(int16_t));
+    }
+  } else if (dst_channel_count_ == 2) {
+    int16_t* right = samples_[1].data() + taps_;
+    for (size_t i = 0; i < num_frames; i++) {
+      const uint8_t* frame = src + i * bytes_per_frame;
+      left[i] = ReadSample(frame, src_bits_per_sample_);
+      right[i] = ReadSample(frame + bytes_per_sample, src_bits_per_sample_);
+    }
+  } else {
+    for (size_t i = 0; i < num_frames; i++) {
+      const uint8_t* frame = src + i * bytes_per_frame;
+      int32_t sum = ReadSample(frame, src_bits_per_sample_) +
+                    ReadSample(frame + bytes_per_sample, src_bits_per_sample_);
+      left[i] = static_cast<int16_t>(sum >> 1);
+    }
+  }
+}
+
+void A2dpPcmConditioner::Process(const uint8_t* src, int16_t* dst,
+                                 size_t num_frames) {
+  if (passthrough_) {
+    memcpy(dst, src, SourceBytesNeeded(num_frames));
+    return;
+  }
+
+  size_t num_src_frames = SourceFramesNeeded(num_frames);
+  Deinterleave(src, num_src_frames);
+
+  if (up_ == down_) {
+    for (uint8_t channel = 0; channel < dst_channel_count_; channel++) {
+      const int16_t* samples = samples_[channel].data();
+      for (size_t i = 0; i < num_frames; i++) {
+        dst[i * dst_channel_count_ + channel] = samples[i];
+      }
+    }
+    return;
+  }
+
+  int64_t position = position_;
+  for (size_t i = 0; i < num_frames; i++, position += down_) {
+    // |position| is never below -|up_|, see position_
+    int64_t frame = (position + up_) / up_ - 1;
+    size_t phase = position - frame * up_;
+    const int16_t* coefficients = coefficients_.data() + phase * taps_;
+    // The |taps_| samples up to and including |frame|, which is at
+    // |taps_| + |frame| after the history
+    size_t first = frame + 1;
+    for (uint8_t channel = 0; channel < dst_channel_count_; channel++) {
+      int32_t sum =
+          DotProduct(coefficients, samples_[channel].data() + first, taps_);
+      dst[i * dst_channel_count_ + channel] =
+          Saturate((sum + (1 << 14)) >> 15);
+    }
+  }
+  position_ = position - static_cast<int64_t>(num_src_frames) * up_;
+
+  // Keep the last |taps_| samples as the history of the next call
+  for (uint8_t channel = 0; channel < dst_channel_count_; channel++) {
+    int16_t* samples = samples_[channel].data();
+    memmove(samples, samples + num_src_frames, taps_ * sizeof(int16_t));
+  }
+}
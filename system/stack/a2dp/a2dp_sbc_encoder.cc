@@ -25,8 +25,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <vector>
+
+#include "a2dp_pcm_conditioner.h"
 #include "a2dp_sbc.h"
-#include "a2dp_sbc_up_sample.h"
 #include "common/time_util.h"
 #include "embdrv/sbc/encoder/include/sbc_encoder.h"
 #include "osi/include/allocator.h"
@@ -69,7 +71,6 @@
 
 typedef struct {
   uint32_t aa_frame_counter;
-  int32_t aa_feed_counter;
   int32_t aa_feed_residue;
   float counter;
   uint32_t bytes_per_tick; /* pcm bytes read each media task tick */
@@ -108,6 +109,9 @@ typedef struct {
 
 static tA2DP_SBC_ENCODER_CB a2dp_sbc_encoder_cb;
 
+// Converts the feeding PCM when its format differs from the SBC input
+static A2dpPcmConditioner a2dp_sbc_pcm_conditioner;
+
 static void a2dp_sbc_encoder_update(A2dpCodecConfig* a2dp_codec_config,
                                     bool* p_restart_input,
                                     bool* p_restart_output,
@@ -132,11 +136,12 @@ void A2DP_UnloadEncoderSbc(void) {
   // Nothing to do - the library is statically linked
 }
 
-void a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+bool a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
                            A2dpCodecConfig* a2dp_codec_config,
                            a2dp_source_read_callback_t read_callback,
                            a2dp_source_enqueue_callback_t enqueue_callback) {
   memset(&a2dp_sbc_encoder_cb, 0, sizeof(a2dp_sbc_encoder_cb));
+  a2dp_sbc_pcm_conditioner = A2dpPcmConditioner();
 
   a2dp_sbc_encoder_cb.stats.session_start_us =
       bluetooth::common::time_get_os_boottime_us();
@@ -153,6 +158,7 @@ void a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
   bool config_updated = false;
   a2dp_sbc_encoder_update(a2dp_codec_config, &restart_input, &restart_output,
                           &config_updated);
+  return a2dp_sbc_pcm_conditioner.IsConfigured();
 }
 
 // Update the A2DP SBC encoder.
@@ -234,6 +240,13 @@ static void a2dp_sbc_encoder_update(A2dpCodecConfig* a2dp_codec_config,
   else
     s16SamplingFreq = 48000;
 
+  if (!a2dp_sbc_pcm_conditioner.Init(
+          p_feeding_params->sample_rate, p_feeding_params->bits_per_sample,
+          p_feeding_params->channel_count, s16SamplingFreq,
+          p_encoder_params->s16NumOfChannels)) {
+    LOG_ERROR("%s: Cannot convert the PCM to the SBC encoder input", __func__);
+  }
+
   // Set the initial target bit rate
   const tA2DP_ENCODER_INIT_PEER_PARAMS& peer_params =
       a2dp_sbc_encoder_cb.peer_params;
@@ -357,11 +370,13 @@ void a2dp_sbc_feeding_reset(void) {
 
   LOG_INFO("%s: PCM bytes per tick %u", __func__,
            a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick);
+  a2dp_sbc_pcm_conditioner.Reset();
 }
 
 void a2dp_sbc_feeding_flush(void) {
   a2dp_sbc_encoder_cb.feeding_state.counter = 0.0f;
   a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
+  a2dp_sbc_pcm_conditioner.Reset();
 }
 
 uint64_t a2dp_sbc_get_encoder_interval_ms(void) {
@@ -497,7 +512,7 @@ static void a2dp_sbc_encode_frames(uint8_t nb_frame) {
   uint8_t last_frame_len = 0;
 
   while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(A2DP_SBC_BUFFER_SIZE);
+    BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(A2DP_SBC_BUFFER_SIZE);
     uint32_t bytes_read = 0;
 
     p_buf->offset = A2DP_SBC_OFFSET;
@@ -566,42 +581,14 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
   uint16_t blocm_x_subband =
       p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
   uint32_t read_size;
-  uint32_t sbc_sampling = 48000;
-  uint32_t src_samples;
   uint16_t bytes_needed = blocm_x_subband * p_encoder_params->s16NumOfChannels *
                           a2dp_sbc_encoder_cb.feeding_params.bits_per_sample /
                           8;
-  static uint16_t up_sampled_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
-                                    SBC_MAX_NUM_OF_CHANNELS *
-                                    SBC_MAX_NUM_OF_SUBBANDS * 2];
-  static uint16_t read_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
-                              SBC_MAX_NUM_OF_CHANNELS *
-                              SBC_MAX_NUM_OF_SUBBANDS];
-  uint32_t src_size_used;
-  uint32_t dst_size_used;
-  bool fract_needed;
-  int32_t fract_max;
-  int32_t fract_threshold;
+  static std::vector<uint8_t> read_buffer;
   uint32_t nb_byte_read;
 
-  /* Get the SBC sampling rate */
-  switch (p_encoder_params->s16SamplingFreq) {
-    case SBC_sf48000:
-      sbc_sampling = 48000;
-      break;
-    case SBC_sf44100:
-      sbc_sampling = 44100;
-      break;
-    case SBC_sf32000:
-      sbc_sampling = 32000;
-      break;
-    case SBC_sf16000:
-      sbc_sampling = 16000;
-      break;
-  }
-
   a2dp_sbc_encoder_cb.stats.media_read_total_expected_reads_count++;
-  if (sbc_sampling == a2dp_sbc_encoder_cb.feeding_params.sample_rate) {
+  if (a2dp_sbc_pcm_conditioner.IsPassthrough()) {
     read_size =
         bytes_needed - a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue;
     a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
@@ -622,100 +609,28 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
     return true;
   }
 
-  /*
-   * Some Feeding PCM frequencies require to split the number of sample
-   * to read.
-   * E.g 128 / 6 = 21.3333 => read 22 and 21 and 21 => max = 2; threshold = 0
-   */
-  fract_needed = false; /* Default */
-  switch (a2dp_sbc_encoder_cb.feeding_params.sample_rate) {
-    case 32000:
-    case 8000:
-      fract_needed = true;
-      fract_max = 2;       /* 0, 1 and 2 */
-      fract_threshold = 0; /* Add one for the first */
-      break;
-    case 16000:
-      fract_needed = true;
-      fract_max = 2;       /* 0, 1 and 2 */
-      fract_threshold = 1; /* Add one for the first two frames*/
-      break;
-  }
-
-  /* Compute number of sample to read from source */
-  src_samples = blocm_x_subband;
-  src_samples *= a2dp_sbc_encoder_cb.feeding_params.sample_rate;
-  src_samples /= sbc_sampling;
-
-  /* The previous division may have a remainder not null */
-  if (fract_needed) {
-    if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter <= fract_threshold) {
-      src_samples++; /* for every read before threshold add one sample */
-    }
-
-    /* do nothing if counter >= threshold */
-    a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter++; /* one more read */
-    if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter > fract_max) {
-      a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter = 0;
-    }
-  }
-
-  /* Compute number of bytes to read from source */
-  read_size = src_samples;
-  read_size *= a2dp_sbc_encoder_cb.feeding_params.channel_count;
-  read_size *= (a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8);
+  /* Read the source PCM for exactly one SBC frame */
+  read_size = a2dp_sbc_pcm_conditioner.SourceBytesNeeded(blocm_x_subband);
+  if (read_buffer.size() < read_size) read_buffer.resize(read_size);
   a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
 
-  /* Read Data from UIPC channel */
   nb_byte_read =
-      a2dp_sbc_encoder_cb.read_callback((uint8_t*)read_buffer, read_size);
+      a2dp_sbc_encoder_cb.read_callback(read_buffer.data(), read_size);
   a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
+  *bytes_read = nb_byte_read;
 
   if (nb_byte_read < read_size) {
     if (nb_byte_read == 0) return false;
 
     /* Fill the unfilled part of the read buffer with silence (0) */
-    memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
-    nb_byte_read = read_size;
+    memset(read_buffer.data() + nb_byte_read, 0, read_size - nb_byte_read);
   }
   a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
 
-  /* Initialize PCM up-sampling engine */
-  a2dp_sbc_init_up_sample(a2dp_sbc_encoder_cb.feeding_params.sample_rate,
-                          sbc_sampling,
-                          a2dp_sbc_encoder_cb.feeding_params.bits_per_sample,
-                          a2dp_sbc_encoder_cb.feeding_params.channel_count);
-
-  /*
-   * Re-sample the read buffer.
-   * The output PCM buffer will be stereo, 16 bit per sample.
-   */
-  dst_size_used = a2dp_sbc_up_sample(
-      (uint8_t*)read_buffer,
-      (uint8_t*)up_sampled_buffer +
-          a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
-      nb_byte_read, sizeof(up_sampled_buffer) -
-                        a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
-      &src_size_used);
-
-  /* update the residue */
-  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue += dst_size_used;
-
-  /* only copy the pcm sample when we have up-sampled enough PCM */
-  if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue < bytes_needed)
-    return false;
-
-  /* Copy the output pcm samples in SBC encoding buffer */
-  memcpy((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer, (uint8_t*)up_sampled_buffer,
-         bytes_needed);
-  /* update the residue */
-  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue -= bytes_needed;
-
-  if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue != 0) {
-    memcpy((uint8_t*)up_sampled_buffer,
-           (uint8_t*)up_sampled_buffer + bytes_needed,
-           a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue);
-  }
+  /* Convert straight into the SBC encoding buffer */
+  a2dp_sbc_pcm_conditioner.Process(read_buffer.data(),
+                                   a2dp_sbc_encoder_cb.pcmBuffer,
+                                   blocm_x_subband);
   return true;
 }
 
@@ -23,6 +23,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <vector>
+
+#include "a2dp_pcm_conditioner.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_aptx.h"
 #include "common/time_util.h"
@@ -98,6 +101,9 @@ typedef struct {
 
 static tA2DP_APTX_ENCODER_CB a2dp_aptx_encoder_cb;
 
+// Converts the feeding PCM when its format differs from the aptX input
+static A2dpPcmConditioner a2dp_aptx_pcm_conditioner;
+
 static void a2dp_vendor_aptx_encoder_update(A2dpCodecConfig* a2dp_codec_config,
                                             bool* p_restart_input,
                                             bool* p_restart_output,
@@ -155,12 +161,13 @@ void A2DP_VendorUnloadEncoderAptx(void) {
   }
 }
 
-void a2dp_vendor_aptx_encoder_init(
+bool a2dp_vendor_aptx_encoder_init(
     const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
     A2dpCodecConfig* a2dp_codec_config,
     a2dp_source_read_callback_t read_callback,
     a2dp_source_enqueue_callback_t enqueue_callback) {
   memset(&a2dp_aptx_encoder_cb, 0, sizeof(a2dp_aptx_encoder_cb));
+  a2dp_aptx_pcm_conditioner = A2dpPcmConditioner();
 
   a2dp_aptx_encoder_cb.stats.session_start_us =
       bluetooth::common::time_get_os_boottime_us();
@@ -192,6 +199,7 @@ void a2dp_vendor_aptx_encoder_init(
   bool config_updated = false;
   a2dp_vendor_aptx_encoder_update(a2dp_codec_config, &restart_input,
                                   &restart_output, &config_updated);
+  return a2dp_aptx_pcm_conditioner.IsConfigured();
 }
 
 // Update the A2DP aptX encoder.
@@ -225,6 +233,14 @@ static void a2dp_vendor_aptx_encoder_update(A2dpCodecConfig* a2dp_codec_config,
   LOG_INFO("%s: sample_rate=%u bits_per_sample=%u channel_count=%u", __func__,
            p_feeding_params->sample_rate, p_feeding_params->bits_per_sample,
            p_feeding_params->channel_count);
+
+  // The aptX encoder takes 16 bit stereo
+  if (!a2dp_aptx_pcm_conditioner.Init(
+          p_feeding_params->sample_rate, p_feeding_params->bits_per_sample,
+          p_feeding_params->channel_count, p_feeding_params->sample_rate, 2)) {
+    LOG_ERROR("%s: Cannot convert the PCM to the aptX encoder input",
+              __func__);
+  }
   a2dp_vendor_aptx_feeding_reset();
 }
 
@@ -324,10 +340,12 @@ static void aptx_update_framing_params(tAPTX_FRAMING_PARAMS* framing_params) {
 
 void a2dp_vendor_aptx_feeding_reset(void) {
   aptx_init_framing_params(&a2dp_aptx_encoder_cb.framing_params);
+  a2dp_aptx_pcm_conditioner.Reset();
 }
 
 void a2dp_vendor_aptx_feeding_flush(void) {
   aptx_init_framing_params(&a2dp_aptx_encoder_cb.framing_params);
+  a2dp_aptx_pcm_conditioner.Reset();
 }
 
 uint64_t a2dp_vendor_aptx_get_encoder_interval_ms(void) {
@@ -342,7 +360,7 @@ void a2dp_vendor_aptx_send_frames(uint64_t timestamp_us) {
   tAPTX_FRAMING_PARAMS* framing_params = &a2dp_aptx_encoder_cb.framing_params;
 
   // Prepare the packet to send
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(BT_DEFAULT_BUFFER_SIZE);
   p_buf->offset = A2DP_APTX_OFFSET;
   p_buf->len = 0;
   p_buf->layer_specific = 0;
@@ -356,8 +374,19 @@ void a2dp_vendor_aptx_send_frames(uint64_t timestamp_us) {
   // Read the PCM data and encode it
   //
   uint16_t read_buffer16[A2DP_APTX_MAX_PCM_BYTES_PER_READ / sizeof(uint16_t)];
+  size_t num_frames = framing_params->pcm_reads *
+                      framing_params->pcm_bytes_per_read /
+                      (2 * sizeof(uint16_t));
   uint32_t expected_read_bytes =
-      framing_params->pcm_reads * framing_params->pcm_bytes_per_read;
+      a2dp_aptx_pcm_conditioner.SourceBytesNeeded(num_frames);
+  static std::vector<uint8_t> source_buffer;
+  uint8_t* source = (uint8_t*)read_buffer16;
+  if (!a2dp_aptx_pcm_conditioner.IsPassthrough()) {
+    if (source_buffer.size() < expected_read_bytes) {
+      source_buffer.resize(expected_read_bytes);
+    }
+    source = source_buffer.data();
+  }
   size_t encoded_ptr_index = 0;
   size_t pcm_bytes_encoded = 0;
   uint32_t bytes_read = 0;
@@ -368,8 +397,8 @@ void a2dp_vendor_aptx_send_frames(uint64_t timestamp_us) {
       expected_read_bytes;
 
   LOG_VERBOSE("%s: PCM read of size %u", __func__, expected_read_bytes);
-  bytes_read = a2dp_aptx_encoder_cb.read_callback((uint8_t*)read_buffer16,
-                                                  expected_read_bytes);
+  bytes_read =
+      a2dp_aptx_encoder_cb.read_callback(source, expected_read_bytes);
   a2dp_aptx_encoder_cb.stats.media_read_total_actual_read_bytes += bytes_read;
   if (bytes_read < expected_read_bytes) {
     LOG_WARN("%s: underflow at PCM reading: read %u bytes instead of %u",
@@ -379,6 +408,10 @@ void a2dp_vendor_aptx_send_frames(uint64_t timestamp_us) {
     return;
   }
   a2dp_aptx_encoder_cb.stats.media_read_total_actual_reads_count++;
+  if (source != (uint8_t*)read_buffer16) {
+    a2dp_aptx_pcm_conditioner.Process(source, (int16_t*)read_buffer16,
+                                      num_frames);
+  }
 
   for (uint32_t reads = 0, offset = 0; reads < framing_params->pcm_reads;
        reads++, offset +=
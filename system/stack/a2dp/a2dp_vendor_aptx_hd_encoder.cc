@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "a2dp_pcm_conditioner.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_aptx_hd.h"
 #include "common/time_util.h"
@@ -98,6 +99,10 @@ typedef struct {
 
 static tA2DP_APTX_HD_ENCODER_CB a2dp_aptx_hd_encoder_cb;
 
+// Checks that the feeding PCM is in the aptX-HD input format. Conversions
+// only produce 16 bit PCM, so the conditioner is always a passthrough here.
+static A2dpPcmConditioner a2dp_aptx_hd_pcm_conditioner;
+
 static void a2dp_vendor_aptx_hd_encoder_update(
     A2dpCodecConfig* a2dp_codec_config, bool* p_restart_input,
     bool* p_restart_output, bool* p_config_updated);
@@ -156,12 +161,13 @@ void A2DP_VendorUnloadEncoderAptxHd(void) {
   }
 }
 
-void a2dp_vendor_aptx_hd_encoder_init(
+bool a2dp_vendor_aptx_hd_encoder_init(
     const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
     A2dpCodecConfig* a2dp_codec_config,
     a2dp_source_read_callback_t read_callback,
     a2dp_source_enqueue_callback_t enqueue_callback) {
   memset(&a2dp_aptx_hd_encoder_cb, 0, sizeof(a2dp_aptx_hd_encoder_cb));
+  a2dp_aptx_hd_pcm_conditioner = A2dpPcmConditioner();
 
   a2dp_aptx_hd_encoder_cb.stats.session_start_us =
       bluetooth::common::time_get_os_boottime_us();
@@ -193,6 +199,7 @@ void a2dp_vendor_aptx_hd_encoder_init(
   bool config_updated = false;
   a2dp_vendor_aptx_hd_encoder_update(a2dp_codec_config, &restart_input,
                                      &restart_output, &config_updated);
+  return a2dp_aptx_hd_pcm_conditioner.IsConfigured();
 }
 
 // Update the A2DP aptX-HD encoder.
@@ -226,6 +233,15 @@ static void a2dp_vendor_aptx_hd_encoder_update(
   LOG_INFO("%s: sample_rate=%u bits_per_sample=%u channel_count=%u", __func__,
            p_feeding_params->sample_rate, p_feeding_params->bits_per_sample,
            p_feeding_params->channel_count);
+
+  // The aptX-HD encoder takes 24 bit packed stereo
+  if (!a2dp_aptx_hd_pcm_conditioner.Init(
+          p_feeding_params->sample_rate, p_feeding_params->bits_per_sample,
+          p_feeding_params->channel_count, p_feeding_params->sample_rate, 2,
+          24)) {
+    LOG_ERROR("%s: Cannot convert the PCM to the aptX-HD encoder input",
+              __func__);
+  }
   a2dp_vendor_aptx_hd_feeding_reset();
 }
 
@@ -327,7 +343,7 @@ void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
       &a2dp_aptx_hd_encoder_cb.framing_params;
 
   // Prepare the packet to send
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(BT_DEFAULT_BUFFER_SIZE);
   p_buf->offset = A2DP_APTX_HD_OFFSET;
   p_buf->len = 0;
   p_buf->layer_specific = 0;
@@ -342,8 +358,10 @@ void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
   //
   uint32_t
       read_buffer32[A2DP_APTX_HD_MAX_PCM_BYTES_PER_READ / sizeof(uint32_t)];
+  size_t num_frames = framing_params->pcm_reads *
+                      framing_params->pcm_bytes_per_read / (2 * 3);
   uint32_t expected_read_bytes =
-      framing_params->pcm_reads * framing_params->pcm_bytes_per_read;
+      a2dp_aptx_hd_pcm_conditioner.SourceBytesNeeded(num_frames);
   size_t encoded_ptr_index = 0;
   size_t pcm_bytes_encoded = 0;
   uint32_t bytes_read = 0;
@@ -28,6 +28,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <vector>
+
+#include "a2dp_pcm_conditioner.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_ldac.h"
 #include "common/time_util.h"
@@ -110,6 +113,9 @@ static bool ldac_abr_loaded = true;  // the library is statically linked
 
 static tA2DP_LDAC_ENCODER_CB a2dp_ldac_encoder_cb;
 
+// Converts the feeding PCM when its format differs from the LDAC input
+static A2dpPcmConditioner a2dp_ldac_pcm_conditioner;
+
 static void a2dp_vendor_ldac_encoder_update(A2dpCodecConfig* a2dp_codec_config,
                                             bool* p_restart_input,
                                             bool* p_restart_output,
@@ -133,12 +139,13 @@ void A2DP_VendorUnloadEncoderLdac(void) {
   a2dp_vendor_ldac_encoder_cleanup();
 }
 
-void a2dp_vendor_ldac_encoder_init(
+bool a2dp_vendor_ldac_encoder_init(
     const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
     A2dpCodecConfig* a2dp_codec_config,
     a2dp_source_read_callback_t read_callback,
     a2dp_source_enqueue_callback_t enqueue_callback) {
   a2dp_vendor_ldac_encoder_cleanup();
+  a2dp_ldac_pcm_conditioner = A2dpPcmConditioner();
 
   a2dp_ldac_encoder_cb.stats.session_start_us =
       bluetooth::common::time_get_os_boottime_us();
@@ -164,6 +171,7 @@ void a2dp_vendor_ldac_encoder_init(
   bool config_updated = false;
   a2dp_vendor_ldac_encoder_update(a2dp_codec_config, &restart_input,
                                   &restart_output, &config_updated);
+  return a2dp_ldac_pcm_conditioner.IsConfigured();
 }
 
 // Update the A2DP LDAC encoder.
@@ -297,6 +305,15 @@ static void a2dp_vendor_ldac_encoder_update(A2dpCodecConfig* a2dp_codec_config,
   else if (p_encoder_params->pcm_wlength == 4)
     p_encoder_params->pcm_fmt = LDACBT_SMPL_FMT_S32;
 
+  if (!a2dp_ldac_pcm_conditioner.Init(
+          p_feeding_params->sample_rate, p_feeding_params->bits_per_sample,
+          p_feeding_params->channel_count, p_encoder_params->sample_rate,
+          p_feeding_params->channel_count,
+          p_encoder_params->pcm_wlength * 8)) {
+    LOG_ERROR("%s: Cannot convert the PCM to the LDAC encoder input",
+              __func__);
+  }
+
   const tA2DP_ENCODER_INIT_PEER_PARAMS& peer_params =
       a2dp_ldac_encoder_cb.peer_params;
   a2dp_ldac_encoder_cb.TxAaMtuSize = adjust_effective_mtu(peer_params);
@@ -350,10 +367,12 @@ void a2dp_vendor_ldac_feeding_reset(void) {
 
   LOG_INFO("%s: PCM bytes per tick %u", __func__,
            a2dp_ldac_encoder_cb.ldac_feeding_state.bytes_per_tick);
+  a2dp_ldac_pcm_conditioner.Reset();
 }
 
 void a2dp_vendor_ldac_feeding_flush(void) {
   a2dp_ldac_encoder_cb.ldac_feeding_state.counter = 0.0f;
+  a2dp_ldac_pcm_conditioner.Reset();
 }
 
 uint64_t a2dp_vendor_ldac_get_encoder_interval_ms(void) {
@@ -437,7 +456,8 @@ static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
       &a2dp_ldac_encoder_cb.ldac_encoder_params;
   uint8_t remain_nb_frame = nb_frame;
   uint16_t ldac_frame_size;
-  uint8_t read_buffer[LDACBT_MAX_LSU * 4 /* byte/sample */ * 2 /* ch */];
+  alignas(int16_t) uint8_t
+      read_buffer[LDACBT_MAX_LSU * 4 /* byte/sample */ * 2 /* ch */];
 
   switch (p_encoder_params->sample_rate) {
     case 176400:
@@ -462,7 +482,7 @@ static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
 
   uint32_t bytes_read = 0;
   while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+    BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(BT_DEFAULT_BUFFER_SIZE);
     p_buf->offset = A2DP_LDAC_OFFSET;
     p_buf->len = 0;
     p_buf->layer_specific = 0;
@@ -541,27 +561,35 @@ static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
 }
 
 static bool a2dp_ldac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read) {
-  uint32_t read_size = LDACBT_ENC_LSU *
-                       a2dp_ldac_encoder_cb.feeding_params.channel_count *
-                       a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8;
+  uint32_t read_size =
+      a2dp_ldac_pcm_conditioner.SourceBytesNeeded(LDACBT_ENC_LSU);
+  static std::vector<uint8_t> source_buffer;
+  uint8_t* source = read_buffer;
+  if (!a2dp_ldac_pcm_conditioner.IsPassthrough()) {
+    if (source_buffer.size() < read_size) source_buffer.resize(read_size);
+    source = source_buffer.data();
+  }
 
   a2dp_ldac_encoder_cb.stats.media_read_total_expected_reads_count++;
   a2dp_ldac_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
 
   /* Read Data from UIPC channel */
-  uint32_t nb_byte_read =
-      a2dp_ldac_encoder_cb.read_callback(read_buffer, read_size);
+  uint32_t nb_byte_read = a2dp_ldac_encoder_cb.read_callback(source, read_size);
   a2dp_ldac_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
 
   if (nb_byte_read < read_size) {
     if (nb_byte_read == 0) return false;
 
     /* Fill the unfilled part of the read buffer with silence (0) */
-    memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
+    memset(source + nb_byte_read, 0, read_size - nb_byte_read);
     nb_byte_read = read_size;
   }
   a2dp_ldac_encoder_cb.stats.media_read_total_actual_reads_count++;
 
+  if (source != read_buffer) {
+    a2dp_ldac_pcm_conditioner.Process(
+        source, reinterpret_cast<int16_t*>(read_buffer), LDACBT_ENC_LSU);
+  }
   *bytes_read = nb_byte_read;
   return true;
 }
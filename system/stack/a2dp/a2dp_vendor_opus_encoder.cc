@@ -28,6 +28,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <vector>
+
+#include "a2dp_pcm_conditioner.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_opus.h"
 #include "common/time_util.h"
@@ -89,6 +92,9 @@ typedef struct {
 
 static tA2DP_OPUS_ENCODER_CB a2dp_opus_encoder_cb;
 
+// Converts the feeding PCM when its format differs from the Opus input
+static A2dpPcmConditioner a2dp_opus_pcm_conditioner;
+
 static bool a2dp_vendor_opus_encoder_update(uint16_t peer_mtu,
                                             A2dpCodecConfig* a2dp_codec_config,
                                             bool* p_restart_input,
@@ -121,7 +127,7 @@ void a2dp_vendor_opus_encoder_cleanup(void) {
   return;
 }
 
-void a2dp_vendor_opus_encoder_init(
+bool a2dp_vendor_opus_encoder_init(
     const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
     A2dpCodecConfig* a2dp_codec_config,
     a2dp_source_read_callback_t read_callback,
@@ -129,6 +135,7 @@ void a2dp_vendor_opus_encoder_init(
   uint32_t error_val;
 
   a2dp_vendor_opus_encoder_cleanup();
+  a2dp_opus_pcm_conditioner = A2dpPcmConditioner();
 
   a2dp_opus_encoder_cb.read_callback = read_callback;
   a2dp_opus_encoder_cb.enqueue_callback = enqueue_callback;
@@ -147,7 +154,7 @@ void a2dp_vendor_opus_encoder_init(
       static_cast<OpusEncoder*>(osi_malloc(size));
   if (a2dp_opus_encoder_cb.opus_handle == nullptr) {
     LOG_ERROR("failed to allocate opus encoder handle");
-    return;
+    return false;
   }
 
   error_val = opus_encoder_init(
@@ -161,7 +168,7 @@ void a2dp_vendor_opus_encoder_init(
         size, A2DP_OPUS_CODEC_DEFAULT_SAMPLERATE, A2DP_OPUS_CODEC_OUTPUT_CHS,
         error_val);
     osi_free(a2dp_opus_encoder_cb.opus_handle);
-    return;
+    return false;
   } else {
     a2dp_opus_encoder_cb.has_opus_handle = true;
   }
@@ -170,7 +177,7 @@ void a2dp_vendor_opus_encoder_init(
                                   a2dp_codec_config, &restart_input,
                                   &restart_output, &config_updated);
 
-  return;
+  return a2dp_opus_pcm_conditioner.IsConfigured();
 }
 
 bool A2dpCodecConfigOpusSource::updateEncoderUserConfig(
@@ -231,6 +238,15 @@ static bool a2dp_vendor_opus_encoder_update(uint16_t peer_mtu,
   LOG_INFO("sample_rate=%u bits_per_sample=%u channel_count=%u",
            p_feeding_params->sample_rate, p_feeding_params->bits_per_sample,
            p_feeding_params->channel_count);
+
+  // The Opus encoder takes 16 bit PCM in the format it was initialized with
+  if (!a2dp_opus_pcm_conditioner.Init(
+          p_feeding_params->sample_rate, p_feeding_params->bits_per_sample,
+          p_feeding_params->channel_count, A2DP_OPUS_CODEC_DEFAULT_SAMPLERATE,
+          A2DP_OPUS_CODEC_OUTPUT_CHS)) {
+    LOG_ERROR("Cannot convert the PCM to the Opus encoder input");
+    return false;
+  }
   a2dp_vendor_opus_feeding_reset();
 
   // The codec parameters
@@ -302,12 +318,14 @@ void a2dp_vendor_opus_feeding_reset(void) {
        a2dp_opus_encoder_cb.feeding_params.channel_count *
        a2dp_vendor_opus_get_encoder_interval_ms()) /
       1000;
+  a2dp_opus_pcm_conditioner.Reset();
 
   return;
 }
 
 void a2dp_vendor_opus_feeding_flush(void) {
   a2dp_opus_encoder_cb.opus_feeding_state.counter = 0.0f;
+  a2dp_opus_pcm_conditioner.Reset();
 
   return;
 }
@@ -374,16 +392,14 @@ static void a2dp_opus_encode_frames(uint8_t nb_frame) {
   unsigned char* packet;
   uint8_t remain_nb_frame = nb_frame;
   uint16_t opus_frame_size = p_encoder_params->framesize;
-  uint8_t read_buffer[p_encoder_params->framesize *
-                      p_encoder_params->pcm_wlength *
-                      p_encoder_params->channel_mode];
+  opus_int16 read_buffer[opus_frame_size * A2DP_OPUS_CODEC_OUTPUT_CHS];
 
   int32_t out_frames = 0;
   int32_t written = 0;
 
   uint32_t bytes_read = 0;
   while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+    BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(BT_DEFAULT_BUFFER_SIZE);
     p_buf->offset = A2DP_OPUS_OFFSET;
     p_buf->len = 0;
     p_buf->layer_specific = 0;
@@ -394,7 +410,7 @@ static void a2dp_opus_encode_frames(uint8_t nb_frame) {
       // Read the PCM data and encode it
       //
       uint32_t temp_bytes_read = 0;
-      if (a2dp_opus_read_feeding(read_buffer, &temp_bytes_read)) {
+      if (a2dp_opus_read_feeding((uint8_t*)read_buffer, &temp_bytes_read)) {
         bytes_read += temp_bytes_read;
         packet = (unsigned char*)(p_buf + 1) + p_buf->offset + p_buf->len;
 
@@ -406,9 +422,9 @@ static void a2dp_opus_encode_frames(uint8_t nb_frame) {
         }
 
         written =
-            opus_encode(a2dp_opus_encoder_cb.opus_handle,
-                        (const opus_int16*)&read_buffer[0], opus_frame_size,
-                        packet, (BT_DEFAULT_BUFFER_SIZE - p_buf->offset));
+            opus_encode(a2dp_opus_encoder_cb.opus_handle, read_buffer,
+                        opus_frame_size, packet,
+                        (BT_DEFAULT_BUFFER_SIZE - p_buf->offset));
 
         if (written <= 0) {
           LOG_ERROR("OPUS encoding error");
@@ -456,27 +472,35 @@ static void a2dp_opus_encode_frames(uint8_t nb_frame) {
 }
 
 static bool a2dp_opus_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read) {
-  uint32_t read_size = a2dp_opus_encoder_cb.opus_encoder_params.framesize *
-                       a2dp_opus_encoder_cb.feeding_params.channel_count *
-                       a2dp_opus_encoder_cb.feeding_params.bits_per_sample / 8;
+  uint16_t framesize = a2dp_opus_encoder_cb.opus_encoder_params.framesize;
+  uint32_t read_size = a2dp_opus_pcm_conditioner.SourceBytesNeeded(framesize);
+  static std::vector<uint8_t> source_buffer;
+  uint8_t* source = read_buffer;
+  if (!a2dp_opus_pcm_conditioner.IsPassthrough()) {
+    if (source_buffer.size() < read_size) source_buffer.resize(read_size);
+    source = source_buffer.data();
+  }
 
   a2dp_opus_encoder_cb.stats.media_read_total_expected_reads_count++;
   a2dp_opus_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
 
   /* Read Data from UIPC channel */
-  uint32_t nb_byte_read =
-      a2dp_opus_encoder_cb.read_callback(read_buffer, read_size);
+  uint32_t nb_byte_read = a2dp_opus_encoder_cb.read_callback(source, read_size);
   a2dp_opus_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
 
   if (nb_byte_read < read_size) {
     if (nb_byte_read == 0) return false;
 
     /* Fill the unfilled part of the read buffer with silence (0) */
-    memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
+    memset(source + nb_byte_read, 0, read_size - nb_byte_read);
     nb_byte_read = read_size;
   }
   a2dp_opus_encoder_cb.stats.media_read_total_actual_reads_count++;
 
+  if (source != read_buffer) {
+    a2dp_opus_pcm_conditioner.Process(
+        source, reinterpret_cast<int16_t*>(read_buffer), framesize);
+  }
   *bytes_read = nb_byte_read;
   return true;
 }
@@ -1104,7 +1104,7 @@ bool avdt_msg_send(AvdtpCcb* p_ccb, BT_HDR* p_msg) {
              2;
 
       /* get a new buffer for fragment we are sending */
-      p_buf = (BT_HDR*)osi_malloc(AVDT_CMD_BUF_SIZE);
+      p_buf = (BT_HDR*)osi_buffer_malloc(AVDT_CMD_BUF_SIZE);
 
       /* copy portion of data from current message to new buffer */
       p_buf->offset = L2CAP_MIN_OFFSET + hdr_len;
@@ -1121,7 +1121,7 @@ bool avdt_msg_send(AvdtpCcb* p_ccb, BT_HDR* p_msg) {
       hdr_len = AVDT_LEN_TYPE_CONT;
 
       /* get a new buffer for fragment we are sending */
-      p_buf = (BT_HDR*)osi_malloc(AVDT_CMD_BUF_SIZE);
+      p_buf = (BT_HDR*)osi_buffer_malloc(AVDT_CMD_BUF_SIZE);
 
       /* copy portion of data from current message to new buffer */
       p_buf->offset = L2CAP_MIN_OFFSET + hdr_len;
@@ -1257,7 +1257,7 @@ BT_HDR* avdt_msg_asmbl(AvdtpCcb* p_ccb, BT_HDR* p_buf) {
       p_ret = NULL;
       return p_ret;
     }
-    p_ccb->p_rx_msg = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+    p_ccb->p_rx_msg = (BT_HDR*)osi_buffer_malloc(BT_DEFAULT_BUFFER_SIZE);
     if (sizeof(BT_HDR) + p_buf->offset + p_buf->len > BT_DEFAULT_BUFFER_SIZE) {
       android_errorWriteLog(0x534e4554, "232023771");
       return NULL;
@@ -1348,7 +1348,7 @@ void avdt_msg_send_cmd(AvdtpCcb* p_ccb, void* p_scb, uint8_t sig_id,
                        tAVDT_MSG* p_params) {
   uint8_t* p;
   uint8_t* p_start;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(AVDT_CMD_BUF_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(AVDT_CMD_BUF_SIZE);
 
   /* set up buf pointer and offset */
   p_buf->offset = AVDT_MSG_OFFSET;
@@ -1404,7 +1404,7 @@ void avdt_msg_send_cmd(AvdtpCcb* p_ccb, void* p_scb, uint8_t sig_id,
 void avdt_msg_send_rsp(AvdtpCcb* p_ccb, uint8_t sig_id, tAVDT_MSG* p_params) {
   uint8_t* p;
   uint8_t* p_start;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(AVDT_CMD_BUF_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(AVDT_CMD_BUF_SIZE);
 
   /* set up buf pointer and offset */
   p_buf->offset = AVDT_MSG_OFFSET;
@@ -1444,7 +1444,7 @@ void avdt_msg_send_rsp(AvdtpCcb* p_ccb, uint8_t sig_id, tAVDT_MSG* p_params) {
 void avdt_msg_send_rej(AvdtpCcb* p_ccb, uint8_t sig_id, tAVDT_MSG* p_params) {
   uint8_t* p;
   uint8_t* p_start;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(AVDT_CMD_BUF_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(AVDT_CMD_BUF_SIZE);
 
   /* set up buf pointer and offset */
   p_buf->offset = AVDT_MSG_OFFSET;
@@ -1495,7 +1495,7 @@ void avdt_msg_send_rej(AvdtpCcb* p_ccb, uint8_t sig_id, tAVDT_MSG* p_params) {
 void avdt_msg_send_grej(AvdtpCcb* p_ccb, uint8_t sig_id, tAVDT_MSG* p_params) {
   uint8_t* p;
   uint8_t* p_start;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(AVDT_CMD_BUF_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(AVDT_CMD_BUF_SIZE);
 
   /* set up buf pointer and offset */
   p_buf->offset = AVDT_MSG_OFFSET;
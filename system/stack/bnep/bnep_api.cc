@@ -327,7 +327,8 @@ tBNEP_RESULT BNEP_Disconnect(uint16_t handle) {
  *                  BNEP_MTU_EXCEDED        - If the data length is greater than
  *                                            the MTU
  *                  BNEP_IGNORE_CMD         - If the packet is filtered out
- *                  BNEP_Q_SIZE_EXCEEDED    - If the Tx Q is full
+ *                  BNEP_Q_SIZE_EXCEEDED    - If the Tx Q is full, p_buf is
+ *                                            then left to the caller
  *                  BNEP_SUCCESS            - If written successfully
  *
  ******************************************************************************/
@@ -343,6 +344,12 @@ tBNEP_RESULT BNEP_WriteBuf(uint16_t handle, const RawAddress& p_dest_addr,
   }
 
   p_bcb = &(bnep_cb.bcb[handle - 1]);
+  /* Check transmit queue first, so that the buffer is still untouched when it
+   * is left to the caller */
+  if (fixed_queue_length(p_bcb->xmit_q) >= BNEP_MAX_XMITQ_DEPTH) {
+    return (BNEP_Q_SIZE_EXCEEDED);
+  }
+
   /* Check MTU size */
   if (p_buf->len > BNEP_MTU_SIZE) {
     BNEP_TRACE_ERROR("%s length %d exceeded MTU %d", __func__, p_buf->len,
@@ -399,12 +406,6 @@ tBNEP_RESULT BNEP_WriteBuf(uint16_t handle, const RawAddress& p_dest_addr,
     }
   }
 
-  /* Check transmit queue */
-  if (fixed_queue_length(p_bcb->xmit_q) >= BNEP_MAX_XMITQ_DEPTH) {
-    osi_free(p_buf);
-    return (BNEP_Q_SIZE_EXCEEDED);
-  }
-
   /* Build the BNEP header */
   bnepu_build_bnep_hdr(p_bcb, p_buf, protocol, p_src_addr, &p_dest_addr,
                        fw_ext_present);
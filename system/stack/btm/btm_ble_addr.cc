@@ -183,10 +183,30 @@ static bool btm_ble_match_random_bda(void* data, void* context) {
  */
 tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
   if (btm_cb.sec_dev_rec == nullptr) return nullptr;
+
+  auto& cache = btm_cb.resolved_rpa_cache;
+  auto it = cache.find(random_bda);
+  if (it != cache.end()) {
+    // No record matched, and no IRK has been saved since
+    if (it->second == nullptr) return nullptr;
+    // One IRK to check instead of all of them
+    if (!btm_ble_match_random_bda(it->second, (void*)&random_bda)) {
+      return it->second;
+    }
+    cache.erase(it);
+  }
+
   list_node_t* n = list_foreach(btm_cb.sec_dev_rec, btm_ble_match_random_bda,
                                 (void*)&random_bda);
-  return (n == nullptr) ? (nullptr)
-                        : (static_cast<tBTM_SEC_DEV_REC*>(list_node(n)));
+  tBTM_SEC_DEV_REC* p_dev_rec =
+      (n == nullptr) ? (nullptr)
+                     : (static_cast<tBTM_SEC_DEV_REC*>(list_node(n)));
+
+  /* Peers rotate their address every 15 minutes or so, rather than aging
+   * entries out simply start over once the cache is full */
+  if (cache.size() >= BTM_BLE_RESOLVED_RPA_CACHE_SIZE) cache.clear();
+  cache[random_bda] = p_dev_rec;
+  return p_dev_rec;
 }
 
 /*******************************************************************************
@@ -39,10 +39,14 @@
 #include "osi/include/compat.h"
 #include "stack/include/acl_api.h"
 #include "stack/include/bt_octets.h"
+#include "stack/include/hcidefs.h"
 #include "types/raw_address.h"
 
 extern tBTM_CB btm_cb;
 
+extern bool btm_ble_init_pseudo_addr(tBTM_SEC_DEV_REC* p_dev_rec,
+                                     const RawAddress& new_pseudo_addr);
+
 /*******************************************************************************
  *
  * Function         BTM_SecAddDevice
@@ -130,9 +134,26 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
   return true;
 }
 
+/* Drop every lookup hint pointing at |p_dev_rec| before it is freed */
+static void btm_dev_forget_rec(const tBTM_SEC_DEV_REC* p_dev_rec) {
+  auto forget = [p_dev_rec](auto& index) {
+    for (auto it = index.begin(); it != index.end();) {
+      if (it->second == p_dev_rec) {
+        it = index.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  };
+  forget(btm_cb.sec_dev_rec_by_addr);
+  forget(btm_cb.sec_dev_rec_by_handle);
+  forget(btm_cb.resolved_rpa_cache);
+}
+
 void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec) {
   p_dev_rec->link_key.fill(0);
   memset(&p_dev_rec->ble.keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
+  btm_dev_forget_rec(p_dev_rec);
   list_remove(btm_cb.sec_dev_rec, p_dev_rec);
 }
 
@@ -313,12 +334,15 @@ bool btm_dev_support_role_switch(const RawAddress& bd_addr) {
   return false;
 }
 
+static bool is_handle_of(const tBTM_SEC_DEV_REC* p_dev_rec, uint16_t handle) {
+  return p_dev_rec->hci_handle == handle || p_dev_rec->ble_hci_handle == handle;
+}
+
 bool is_handle_equal(void* data, void* context) {
   tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
   uint16_t* handle = static_cast<uint16_t*>(context);
 
-  if (p_dev_rec->hci_handle == *handle || p_dev_rec->ble_hci_handle == *handle)
-    return false;
+  if (is_handle_of(p_dev_rec, *handle)) return false;
 
   return true;
 }
@@ -334,19 +358,35 @@ bool is_handle_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) {
+  auto& index = btm_cb.sec_dev_rec_by_handle;
+  auto it = index.find(handle);
+  if (it != index.end()) {
+    if (is_handle_of(it->second, handle)) return it->second;
+    // The record has moved on to another link since
+    index.erase(it);
+  }
+
   list_node_t* n = list_foreach(btm_cb.sec_dev_rec, is_handle_equal, &handle);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n == nullptr) return NULL;
+
+  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  // Every record without a link shares the invalid handle, keep it unindexed
+  if (handle != HCI_INVALID_HANDLE) index[handle] = p_dev_rec;
+  return p_dev_rec;
+}
 
-  return NULL;
+static bool is_address_of(const tBTM_SEC_DEV_REC* p_dev_rec,
+                          const RawAddress& bd_addr) {
+  return p_dev_rec->bd_addr == bd_addr ||
+         // If a LE random address is looking for device record
+         p_dev_rec->ble.pseudo_addr == bd_addr;
 }
 
 bool is_address_equal(void* data, void* context) {
   tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
   const RawAddress* bd_addr = ((RawAddress*)context);
 
-  if (p_dev_rec->bd_addr == *bd_addr) return false;
-  // If a LE random address is looking for device record
-  if (p_dev_rec->ble.pseudo_addr == *bd_addr) return false;
+  if (is_address_of(p_dev_rec, *bd_addr)) return false;
 
   if (btm_ble_addr_resolvable(*bd_addr, p_dev_rec)) return false;
   return true;
@@ -365,11 +405,32 @@ bool is_address_equal(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
   if (btm_cb.sec_dev_rec == nullptr) return nullptr;
 
-  list_node_t* n =
-      list_foreach(btm_cb.sec_dev_rec, is_address_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  auto& index = btm_cb.sec_dev_rec_by_addr;
+  auto it = index.find(bd_addr);
+  if (it != index.end()) {
+    if (is_address_of(it->second, bd_addr)) return it->second;
+    index.erase(it);
+  }
+
+  /* Plain address compares first, so that IRKs are only tried once no record
+   * carries the address itself */
+  list_node_t* end = list_end(btm_cb.sec_dev_rec);
+  for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
+       node = list_next(node)) {
+    tBTM_SEC_DEV_REC* p_dev_rec =
+        static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+    if (is_address_of(p_dev_rec, bd_addr)) {
+      // Records without a pseudo address all share the empty one
+      if (!bd_addr.IsEmpty()) index[bd_addr] = p_dev_rec;
+      return p_dev_rec;
+    }
+  }
+
+  if (!BTM_BLE_IS_RESOLVE_BDA(bd_addr)) return NULL;
 
-  return NULL;
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_ble_resolve_random_addr(bd_addr);
+  if (p_dev_rec != nullptr) btm_ble_init_pseudo_addr(p_dev_rec, bd_addr);
+  return p_dev_rec;
 }
 
 /*******************************************************************************
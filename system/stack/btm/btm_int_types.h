@@ -21,6 +21,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 #include "gd/common/circular_buffer.h"
 #include "osi/include/allocator.h"
@@ -279,6 +280,14 @@ typedef struct tBTM_CB {
   uint8_t disc_reason{0};           /* for legacy devices */
   tBTM_SEC_SERV_REC sec_serv_rec[BTM_SEC_MAX_SERVICE_RECORDS];
   list_t* sec_dev_rec{nullptr}; /* list of tBTM_SEC_DEV_REC */
+  /* Lookup hints into sec_dev_rec. Record fields are written directly all
+   * over the stack, so entries are checked against the record on every hit
+   * and repaired from the list on a miss, see btm_dev.cc */
+  std::unordered_map<RawAddress, tBTM_SEC_DEV_REC*> sec_dev_rec_by_addr;
+  std::unordered_map<uint16_t, tBTM_SEC_DEV_REC*> sec_dev_rec_by_handle;
+  /* Random resolvable addresses already run against every known IRK, mapped
+   * to the matching record or nullptr, see btm_ble_addr.cc */
+  std::unordered_map<RawAddress, tBTM_SEC_DEV_REC*> resolved_rpa_cache;
   tBTM_SEC_SERV_REC* p_out_serv{nullptr};
   tBTM_MKEY_CALLBACK* mkey_cback{nullptr};
 
@@ -368,6 +377,9 @@ typedef struct tBTM_CB {
     fixed_queue_free(sec_pending_q, nullptr);
     sec_pending_q = nullptr;
 
+    sec_dev_rec_by_addr.clear();
+    sec_dev_rec_by_handle.clear();
+    resolved_rpa_cache.clear();
     list_free(sec_dev_rec);
     sec_dev_rec = nullptr;
 
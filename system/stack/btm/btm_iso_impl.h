@@ -20,6 +20,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <vector>
 
 #include "base/bind.h"
 #include "base/callback.h"
@@ -64,6 +65,11 @@ struct iso_base {
   std::atomic_uint8_t state_flags;
   uint32_t sdu_itv;
   std::atomic_uint16_t used_credits;
+  /* Changes whenever the used credits are reclaimed at once, so that the
+   * credits of SDUs acquired before are not returned a second time. Written
+   * on the main thread, read on the audio thread.
+   */
+  std::atomic_uint32_t credit_epoch;
 
   struct credits_stats {
     size_t credits_underflow_bytes = 0;
@@ -144,6 +150,7 @@ struct iso_impl {
         cis->sdu_itv = sdu_itv_mtos;
         cis->sync_info = {.first_sync_ts = 0, .seq_nb = 0};
         cis->used_credits = 0;
+        cis->credit_epoch = next_credit_epoch_++;
         cis->state_flags = kStateFlagsNone;
         conn_hdl_to_cis_map_[conn_handle] = std::move(cis);
       }
@@ -409,7 +416,7 @@ struct iso_impl {
 
     /* Add 2 for handle, 2 for length */
     uint16_t iso_full_len = iso_data_load_len + 4;
-    BT_HDR* packet = (BT_HDR*)osi_malloc(iso_full_len + sizeof(BT_HDR));
+    BT_HDR* packet = (BT_HDR*)osi_buffer_malloc(iso_full_len + sizeof(BT_HDR));
     packet->len = iso_full_len;
     packet->offset = 0;
     packet->event = MSG_STACK_TO_HC_HCI_ISO;
@@ -432,31 +439,28 @@ struct iso_impl {
     bte_main_hci_send(packet, MSG_STACK_TO_HC_HCI_ISO | 0x0001);
   }
 
-  void send_iso_data(uint16_t iso_handle, const uint8_t* data,
-                     uint16_t data_len) {
-    iso_base* iso = GetIsoIfKnown(iso_handle);
-    LOG_ASSERT(iso != nullptr)
-        << "No such iso connection handle: " << loghex(iso_handle);
-
+  bool is_ready_to_send(iso_base* iso, uint16_t iso_handle) {
     if (!(iso->state_flags & kStateFlagIsBroadcast)) {
       if (!(iso->state_flags & kStateFlagIsConnected)) {
         LOG(WARNING) << __func__ << "Cis handle: " << loghex(iso_handle)
                      << " not established";
-        return;
+        return false;
       }
     }
 
     if (!(iso->state_flags & kStateFlagHasDataPathSet)) {
       LOG_WARN("Data path not set for handle: 0x%04x", iso_handle);
-      return;
+      return false;
     }
 
-    /* Calculate sequence number for the ISO data packet.
-     * It should be incremented by 1 every SDU Interval.
-     */
-    uint32_t ts = bluetooth::common::time_get_os_boottime_us();
-    iso->sync_info.seq_nb = (ts - iso->sync_info.first_sync_ts) / iso->sdu_itv;
+    return true;
+  }
 
+  /* Charges one controller buffer to the ISO connection. The buffers are
+   * shared by all the ISO connections, but each one is accounted for the
+   * buffers it holds, so they can be reclaimed when it goes away.
+   */
+  bool take_credit(iso_base* iso, uint16_t iso_handle, uint16_t data_len) {
     if (iso_credits_ == 0 || data_len > iso_buffer_size_) {
       iso->cr_stats.credits_underflow_bytes += data_len;
       iso->cr_stats.credits_underflow_count++;
@@ -467,11 +471,49 @@ struct iso_impl {
                    << static_cast<int>(data_len)
                    << ", iso credits: " << static_cast<int>(iso_credits_)
                    << ", iso handle: " << loghex(iso_handle);
-      return;
+      return false;
     }
 
     iso_credits_--;
     iso->used_credits++;
+    return true;
+  }
+
+  void return_credits(iso_base* iso, uint16_t credits) {
+    iso->used_credits -= credits;
+    iso_credits_ += credits;
+  }
+
+  /* Returns all the credits held by the ISO connection, e.g. when the
+   * controller drops what was queued on it.
+   */
+  void reclaim_credits(iso_base* iso) {
+    return_credits(iso, iso->used_credits);
+    iso->credit_epoch = next_credit_epoch_++;
+  }
+
+  uint16_t get_sdu_handle(const BT_HDR* sdu) {
+    const uint8_t* p = sdu->data + sdu->offset;
+    uint16_t iso_handle;
+    STREAM_TO_UINT16(iso_handle, p);
+    return iso_handle;
+  }
+
+  void send_iso_data(uint16_t iso_handle, const uint8_t* data,
+                     uint16_t data_len) {
+    iso_base* iso = GetIsoIfKnown(iso_handle);
+    LOG_ASSERT(iso != nullptr)
+        << "No such iso connection handle: " << loghex(iso_handle);
+
+    if (!is_ready_to_send(iso, iso_handle)) return;
+
+    /* Calculate sequence number for the ISO data packet.
+     * It should be incremented by 1 every SDU Interval.
+     */
+    uint32_t ts = bluetooth::common::time_get_os_boottime_us();
+    iso->sync_info.seq_nb = (ts - iso->sync_info.first_sync_ts) / iso->sdu_itv;
+
+    if (!take_credit(iso, iso_handle, data_len)) return;
 
     BT_HDR* packet =
         prepare_ts_hci_packet(iso_handle, ts, iso->sync_info.seq_nb, data_len);
@@ -479,6 +521,71 @@ struct iso_impl {
     send_iso_data_hci_packet(packet);
   }
 
+  BT_HDR* acquire_iso_sdu(uint16_t iso_handle, uint16_t data_len) {
+    iso_base* iso = GetIsoIfKnown(iso_handle);
+    LOG_ASSERT(iso != nullptr)
+        << "No such iso connection handle: " << loghex(iso_handle);
+
+    if (!is_ready_to_send(iso, iso_handle)) return nullptr;
+    if (!take_credit(iso, iso_handle, data_len)) return nullptr;
+
+    /* Timestamp and sequence number are written once the SDU is sent */
+    BT_HDR* sdu = prepare_ts_hci_packet(iso_handle, 0, 0, data_len);
+    acquired_sdus_[sdu] = iso->credit_epoch;
+    return sdu;
+  }
+
+  /* Returns whether the credit of |sdu| is still charged to |iso| */
+  bool holds_sdu_credit(iso_base* iso, const BT_HDR* sdu) {
+    auto sdu_it = acquired_sdus_.find(sdu);
+    return iso != nullptr && sdu_it != acquired_sdus_.end() &&
+           sdu_it->second == iso->credit_epoch;
+  }
+
+  void release_iso_sdu(BT_HDR* sdu) {
+    /* Credits taken before the connection went away or was torn down were
+     * reclaimed along with it.
+     */
+    iso_base* iso = GetIsoIfKnown(get_sdu_handle(sdu));
+    if (holds_sdu_credit(iso, sdu)) return_credits(iso, 1);
+    acquired_sdus_.erase(sdu);
+    osi_free(sdu);
+  }
+
+  void send_iso_sdus(std::vector<BT_HDR*> sdus) {
+    if (sdus.empty()) return;
+
+    /* All the SDUs of one ISO interval get the same timestamp */
+    uint32_t ts = bluetooth::common::time_get_os_boottime_us();
+
+    auto sdu_it = sdus.begin();
+    while (sdu_it != sdus.end()) {
+      uint16_t iso_handle = get_sdu_handle(*sdu_it);
+      iso_base* iso = GetIsoIfKnown(iso_handle);
+      if (iso == nullptr || !holds_sdu_credit(iso, *sdu_it) ||
+          !is_ready_to_send(iso, iso_handle)) {
+        LOG_WARN("Dropping SDU of released or torn down handle: 0x%04x",
+                 iso_handle);
+        release_iso_sdu(*sdu_it);
+        sdu_it = sdus.erase(sdu_it);
+        continue;
+      }
+      acquired_sdus_.erase(*sdu_it);
+
+      iso->sync_info.seq_nb =
+          (ts - iso->sync_info.first_sync_ts) / iso->sdu_itv;
+
+      /* Skip the handle and the data load length */
+      uint8_t* p = (*sdu_it)->data + (*sdu_it)->offset + 4;
+      UINT32_TO_STREAM(p, ts);
+      UINT16_TO_STREAM(p, iso->sync_info.seq_nb);
+      ++sdu_it;
+    }
+    if (sdus.empty()) return;
+
+    bte_main_hci_send_batch(std::move(sdus), MSG_STACK_TO_HC_HCI_ISO | 0x0001);
+  }
+
   void process_cis_est_pkt(uint8_t len, uint8_t* data) {
     cis_establish_cmpl_evt evt;
 
@@ -535,8 +642,7 @@ struct iso_impl {
       cis->state_flags &= ~kStateFlagIsConnected;
 
       /* return used credits */
-      iso_credits_ += cis->used_credits;
-      cis->used_credits = 0;
+      reclaim_credits(cis);
 
       /* Data path is considered still valid, but can be reconfigured only once
        * CIS is reestablished.
@@ -559,15 +665,13 @@ struct iso_impl {
 
       auto iter = conn_hdl_to_cis_map_.find(handle);
       if (iter != conn_hdl_to_cis_map_.end()) {
-        iter->second->used_credits -= num_sent;
-        iso_credits_ += num_sent;
+        return_credits(iter->second.get(), num_sent);
         continue;
       }
 
       iter = conn_hdl_to_bis_map_.find(handle);
       if (iter != conn_hdl_to_bis_map_.end()) {
-        iter->second->used_credits -= num_sent;
-        iso_credits_ += num_sent;
+        return_credits(iter->second.get(), num_sent);
         continue;
       }
     }
@@ -576,15 +680,13 @@ struct iso_impl {
   void handle_gd_num_completed_pkts(uint16_t handle, uint16_t credits) {
     auto iter = conn_hdl_to_cis_map_.find(handle);
     if (iter != conn_hdl_to_cis_map_.end()) {
-      iter->second->used_credits -= credits;
-      iso_credits_ += credits;
+      return_credits(iter->second.get(), credits);
       return;
     }
 
     iter = conn_hdl_to_bis_map_.find(handle);
     if (iter != conn_hdl_to_bis_map_.end()) {
-      iter->second->used_credits -= credits;
-      iso_credits_ += credits;
+      return_credits(iter->second.get(), credits);
     }
   }
 
@@ -626,6 +728,7 @@ struct iso_impl {
         bis->sdu_itv = last_big_create_req_sdu_itv_;
         bis->sync_info = {.first_sync_ts = ts, .seq_nb = 0};
         bis->used_credits = 0;
+        bis->credit_epoch = next_credit_epoch_++;
         bis->state_flags = kStateFlagIsBroadcast;
         conn_hdl_to_bis_map_[conn_handle] = std::move(bis);
       }
@@ -647,6 +750,8 @@ struct iso_impl {
     auto bis_it = conn_hdl_to_bis_map_.cbegin();
     while (bis_it != conn_hdl_to_bis_map_.cend()) {
       if (bis_it->second->big_handle == evt.big_id) {
+        /* The controller drops whatever is still queued on the BISes */
+        reclaim_credits(bis_it->second.get());
         bis_it = conn_hdl_to_bis_map_.erase(bis_it);
         is_known_handle = true;
       } else {
@@ -873,6 +978,11 @@ struct iso_impl {
 
   std::atomic_uint16_t iso_credits_;
   uint16_t iso_buffer_size_;
+  std::atomic_uint32_t next_credit_epoch_{0};
+  /* The SDUs handed out and not yet sent or released, with the credit epoch
+   * of their connection when they were acquired.
+   */
+  std::map<const BT_HDR*, uint32_t> acquired_sdus_;
   uint32_t last_big_create_req_sdu_itv_;
 
   CigCallbacks* cig_callbacks_ = nullptr;
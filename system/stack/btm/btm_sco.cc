@@ -228,7 +228,7 @@ void btm_send_sco_packet(std::vector<uint8_t> data) {
 BT_HDR* btm_sco_make_packet(std::vector<uint8_t> data, uint16_t sco_handle) {
   ASSERT_LOG(data.size() <= BTM_SCO_DATA_SIZE_MAX, "Invalid SCO data size: %zu",
              data.size());
-  BT_HDR* p_buf = (BT_HDR*)osi_calloc(BT_SMALL_BUFFER_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_buffer_calloc(BT_SMALL_BUFFER_SIZE);
   p_buf->event = BT_EVT_TO_LM_HCI_SCO;
   // SCO header size is 3 per Core 5.2 Vol 4 Part E 5.4.3 figure 5.3
   p_buf->len = data.size() + 3;
@@ -54,7 +54,8 @@ using bluetooth::Uuid;
 static BT_HDR* attp_build_mtu_cmd(uint8_t op_code, uint16_t rx_mtu) {
   uint8_t* p;
   BT_HDR* p_buf =
-      (BT_HDR*)osi_malloc(sizeof(BT_HDR) + GATT_HDR_SIZE + L2CAP_MIN_OFFSET);
+      (BT_HDR*)osi_buffer_malloc(sizeof(BT_HDR) + GATT_HDR_SIZE +
+                                 L2CAP_MIN_OFFSET);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   UINT8_TO_STREAM(p, op_code);
@@ -75,7 +76,7 @@ static BT_HDR* attp_build_mtu_cmd(uint8_t op_code, uint16_t rx_mtu) {
  *
  ******************************************************************************/
 static BT_HDR* attp_build_exec_write_cmd(uint8_t op_code, uint8_t flag) {
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(GATT_DATA_BUF_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(GATT_DATA_BUF_SIZE);
   uint8_t* p;
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
@@ -106,7 +107,8 @@ static BT_HDR* attp_build_exec_write_cmd(uint8_t op_code, uint8_t flag) {
 static BT_HDR* attp_build_err_cmd(uint8_t cmd_code, uint16_t err_handle,
                                   uint8_t reason) {
   uint8_t* p;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + 5);
+  BT_HDR* p_buf =
+      (BT_HDR*)osi_buffer_malloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + 5);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   UINT8_TO_STREAM(p, GATT_RSP_ERROR);
@@ -136,7 +138,8 @@ static BT_HDR* attp_build_browse_cmd(uint8_t op_code, uint16_t s_hdl,
   const size_t payload_size =
       (GATT_OP_CODE_SIZE) + (GATT_START_END_HANDLE_SIZE) + (Uuid::kNumBytes128);
   BT_HDR* p_buf =
-      (BT_HDR*)osi_malloc(sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET);
+      (BT_HDR*)osi_buffer_malloc(sizeof(BT_HDR) + payload_size +
+                                 L2CAP_MIN_OFFSET);
 
   uint8_t* p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   /* Describe the built message location and size */
@@ -165,7 +168,8 @@ static BT_HDR* attp_build_read_by_type_value_cmd(
   uint8_t* p;
   uint16_t len = p_value_type->value_len;
   BT_HDR* p_buf =
-      (BT_HDR*)osi_malloc(sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET);
+      (BT_HDR*)osi_buffer_malloc(sizeof(BT_HDR) + payload_size +
+                                 L2CAP_MIN_OFFSET);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   p_buf->offset = L2CAP_MIN_OFFSET;
@@ -199,8 +203,8 @@ static BT_HDR* attp_build_read_multi_cmd(uint8_t op_code, uint16_t payload_size,
                                          uint16_t num_handle,
                                          uint16_t* p_handle) {
   uint8_t *p, i = 0;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + num_handle * 2 + 1 +
-                                      L2CAP_MIN_OFFSET);
+  BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(sizeof(BT_HDR) + num_handle * 2 +
+                                             1 + L2CAP_MIN_OFFSET);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   p_buf->offset = L2CAP_MIN_OFFSET;
@@ -227,7 +231,8 @@ static BT_HDR* attp_build_read_multi_cmd(uint8_t op_code, uint16_t payload_size,
 static BT_HDR* attp_build_handle_cmd(uint8_t op_code, uint16_t handle,
                                      uint16_t offset) {
   uint8_t* p;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + 5 + L2CAP_MIN_OFFSET);
+  BT_HDR* p_buf =
+      (BT_HDR*)osi_buffer_malloc(sizeof(BT_HDR) + 5 + L2CAP_MIN_OFFSET);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   p_buf->offset = L2CAP_MIN_OFFSET;
@@ -257,7 +262,8 @@ static BT_HDR* attp_build_handle_cmd(uint8_t op_code, uint16_t handle,
  ******************************************************************************/
 static BT_HDR* attp_build_opcode_cmd(uint8_t op_code) {
   uint8_t* p;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + 1 + L2CAP_MIN_OFFSET);
+  BT_HDR* p_buf =
+      (BT_HDR*)osi_buffer_malloc(sizeof(BT_HDR) + 1 + L2CAP_MIN_OFFSET);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   p_buf->offset = L2CAP_MIN_OFFSET;
@@ -282,7 +288,8 @@ static BT_HDR* attp_build_value_cmd(uint16_t payload_size, uint8_t op_code,
                                     uint16_t len, uint8_t* p_data) {
   uint8_t *p, *pp, pair_len, *p_pair_len;
   BT_HDR* p_buf =
-      (BT_HDR*)osi_malloc(sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET);
+      (BT_HDR*)osi_buffer_malloc(sizeof(BT_HDR) + payload_size +
+                                 L2CAP_MIN_OFFSET);
 
   p = pp = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   UINT8_TO_STREAM(p, op_code);
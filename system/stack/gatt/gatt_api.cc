@@ -133,7 +133,9 @@ static void gatt_update_last_srv_info() {
 
 /** Update database hash and client status */
 static void gatt_update_for_database_change() {
-  gatt_cb.database_hash = gatts_calculate_database_hash(gatt_cb.srv_list_info);
+  // Computed on the next read, so that a burst of service changes costs a
+  // single hash
+  gatt_cb.database_hash_stale = true;
 
   uint8_t i = 0;
   for (i = 0; i < GATT_MAX_PHY_CHANNEL; i++) {
@@ -494,7 +496,8 @@ static tGATT_STATUS GATTS_HandleMultileValueNotification(
   /* TODO Handle too big packet size here. Not needed now for testing. */
   /* Just build the message. */
   BT_HDR* p_buf =
-      (BT_HDR*)osi_malloc(sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET);
+      (BT_HDR*)osi_buffer_malloc(sizeof(BT_HDR) + payload_size +
+                                 L2CAP_MIN_OFFSET);
 
   uint8_t* p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   UINT8_TO_STREAM(p, GATT_HANDLE_MULTI_VALUE_NOTIF);
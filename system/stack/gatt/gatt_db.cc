@@ -57,6 +57,7 @@ static tGATT_STATUS gatts_send_app_read_request(
 void gatts_init_service_db(tGATT_SVC_DB& db, const Uuid& service_uuid,
                            bool is_pri, uint16_t s_hdl, uint16_t num_handle) {
   db.attr_list.reserve(num_handle);
+  db.hash_block.clear();
 
   VLOG(1) << StringPrintf("%s: s_hdl= %d num_handle= %d", __func__, s_hdl,
                           num_handle);
@@ -687,6 +688,7 @@ static tGATT_ATTR& allocate_attr_in_db(tGATT_SVC_DB& db, const Uuid& uuid,
                << ", next_handle = " << +db.next_handle;
   }
 
+  db.hash_block.clear();
   db.attr_list.emplace_back();
   tGATT_ATTR& attr = db.attr_list.back();
   attr.handle = db.next_handle++;
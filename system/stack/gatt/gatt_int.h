@@ -184,6 +184,9 @@ typedef struct {
   std::vector<tGATT_ATTR> attr_list; /* pointer to the attributes */
   uint16_t end_handle;       /* Last handle number           */
   uint16_t next_handle;      /* Next usable handle value     */
+  /* This service's part of the database hash input, byte reversed. Built on
+   * first use, emptied whenever an attribute is added */
+  std::vector<uint8_t> hash_block;
 } tGATT_SVC_DB;
 
 /* Data Structure used for GATT server */
@@ -440,7 +443,10 @@ typedef struct {
   uint8_t gatt_cl_supported_feat_mask;
 
   uint16_t handle_of_database_hash;
+  /* Only valid when database_hash_stale is false, read it through
+   * gatts_get_database_hash() */
   Octet16 database_hash;
+  bool database_hash_stale;
 
   tGATT_APPL_INFO cb_info;
 
@@ -680,5 +686,6 @@ extern bluetooth::Uuid* gatts_get_service_uuid(tGATT_SVC_DB* p_db);
 /* gatt_sr_hash.cc */
 extern Octet16 gatts_calculate_database_hash(
     std::list<tGATT_SRV_LIST_ELEM>* lst_ptr);
+extern const Octet16& gatts_get_database_hash();
 
 #endif
@@ -496,7 +496,9 @@ typedef struct {
   // The current A2DP codec config is in |a2dp_codec_config|.
   // |read_callback| is the callback for reading the input audio data.
   // |enqueue_callback| is the callback for enqueueing the encoded audio data.
-  void (*encoder_init)(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+  // Returns true on success, otherwise false and the encoder cannot be used,
+  // e.g. when the audio source PCM cannot be converted to its input format.
+  bool (*encoder_init)(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
                        A2dpCodecConfig* a2dp_codec_config,
                        a2dp_source_read_callback_t read_callback,
                        a2dp_source_enqueue_callback_t enqueue_callback);
@@ -522,6 +524,10 @@ typedef struct {
 
   // Set transmit queue length for the A2DP encoder.
   void (*set_transmit_queue_length)(size_t transmit_queue_length);
+
+  // Whether |send_frames| sizes its output from the time elapsed since its
+  // previous call, so that it can be called at a varying interval.
+  bool supports_variable_interval;
 } tA2DP_ENCODER_INTERFACE;
 
 // Prototype for a callback to receive decoded audio data from a
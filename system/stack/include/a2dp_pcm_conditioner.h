@@ -0,0 +1,96 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// PCM conditioning for the A2DP encoders: converts the PCM read from the
+// audio source to 16 bit interleaved samples at the sample rate and channel
+// count of the encoder.
+//
+
+#ifndef A2DP_PCM_CONDITIONER_H
+#define A2DP_PCM_CONDITIONER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+class A2dpPcmConditioner {
+ public:
+  // Configures the conversion from |src_bits_per_sample| (8, 16, 24 or 32
+  // bit) PCM with |src_channel_count| channels at |src_sample_rate| to
+  // |dst_bits_per_sample| PCM with |dst_channel_count| channels at
+  // |dst_sample_rate|. Mono and stereo are supported. Sample rates are
+  // converted with a polyphase filter. Conversions only produce 16 bit PCM,
+  // a wider |dst_bits_per_sample| is only supported when the formats match.
+  // Returns false if the conversion is not supported, the conditioner is then
+  // not configured.
+  bool Init(uint32_t src_sample_rate, uint8_t src_bits_per_sample,
+            uint8_t src_channel_count, uint32_t dst_sample_rate,
+            uint8_t dst_channel_count, uint8_t dst_bits_per_sample = 16);
+
+  // Whether the last Init() succeeded.
+  bool IsConfigured() const { return configured_; }
+
+  // Drops the filter history, e.g. when the audio source is flushed.
+  void Reset();
+
+  // Whether the source PCM is already in the output format and can be read
+  // directly into the encoder input.
+  bool IsPassthrough() const { return passthrough_; }
+
+  // Returns the size in bytes of the source PCM needed for the next
+  // |num_frames| output frames.
+  size_t SourceBytesNeeded(size_t num_frames) const;
+
+  // Writes |num_frames| interleaved output frames to |dst| from |src|, which
+  // holds SourceBytesNeeded(|num_frames|) bytes of source PCM. Must not be
+  // called if the conditioner is not configured.
+  void Process(const uint8_t* src, int16_t* dst, size_t num_frames);
+
+ private:
+  size_t SourceFramesNeeded(size_t num_frames) const;
+  void Deinterleave(const uint8_t* src, size_t num_frames);
+  void DesignFilter();
+
+  bool configured_ = false;
+  bool passthrough_ = true;
+  uint8_t src_bits_per_sample_ = 16;
+  uint8_t src_channel_count_ = 2;
+  uint8_t dst_channel_count_ = 2;
+
+  // Resampling by |up_| / |down_|, both 1 when the sample rates match. The
+  // output frame n is taken at phase (n * down_) % up_ between source frames
+  // (n * down_) / up_ and the next one.
+  uint32_t up_ = 1;
+  uint32_t down_ = 1;
+  // Position of the next output frame in 1 / |up_| source frames, relative to
+  // the first source frame of the next call. Negative while the next output
+  // frame still falls between the last two frames already consumed.
+  int64_t position_ = 0;
+
+  // The filter coefficients of every phase, in Q15 and in reverse order so
+  // that each output sample is a dot product with the history. |taps_| is a
+  // multiple of the SIMD width.
+  size_t taps_ = 0;
+  std::vector<int16_t> coefficients_;
+
+  // The last |taps_| source samples of every output channel, followed by the
+  // samples of the current call.
+  std::vector<int16_t> samples_[2];
+};
+
+#endif  // A2DP_PCM_CONDITIONER_H
@@ -39,7 +39,8 @@ void A2DP_VendorUnloadEncoderAptx(void);
 // The current A2DP codec config is in |a2dp_codec_config|.
 // |read_callback| is the callback for reading the input audio data.
 // |enqueue_callback| is the callback for enqueueing the encoded audio data.
-void a2dp_vendor_aptx_encoder_init(
+// Returns true on success, otherwise false.
+bool a2dp_vendor_aptx_encoder_init(
     const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
     A2dpCodecConfig* a2dp_codec_config,
     a2dp_source_read_callback_t read_callback,
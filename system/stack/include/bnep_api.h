@@ -286,7 +286,8 @@ extern tBNEP_RESULT BNEP_Disconnect(uint16_t handle);
  *                  BNEP_MTU_EXCEDED        - If the data length is greater
  *                                            than MTU
  *                  BNEP_IGNORE_CMD         - If the packet is filtered out
- *                  BNEP_Q_SIZE_EXCEEDED    - If the Tx Q is full
+ *                  BNEP_Q_SIZE_EXCEEDED    - If the Tx Q is full, p_buf is
+ *                                            then left to the caller
  *                  BNEP_SUCCESS            - If written successfully
  *
  ******************************************************************************/
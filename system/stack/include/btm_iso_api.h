@@ -165,6 +165,44 @@ class IsoManager {
   virtual void SendIsoData(uint16_t conn_handle, const uint8_t* data,
                            uint16_t data_len);
 
+  /**
+   * Allocates an outgoing SDU with the HCI ISO header already in place, for
+   * the payload to be written directly at GetIsoSduPayload(), and charges one
+   * controller buffer credit to the connection.
+   *
+   * <p> The SDU shall be handed back with either SendIsoSdus() or
+   * ReleaseIsoSdu().
+   *
+   * @param conn_handle handle of BIS or CIS connection
+   * @param data_len SDU payload length
+   * @return the SDU, or nullptr if the connection can not send or has no
+   * credits left
+   */
+  virtual BT_HDR* AcquireIsoSdu(uint16_t conn_handle, uint16_t data_len);
+
+  /**
+   * Sends SDUs filled in after AcquireIsoSdu(), typically one per channel of
+   * the same ISO interval, to the controller all at once. The SDUs get the
+   * same timestamp.
+   *
+   * @param sdus SDUs to send. The ownership of the SDUs is transferred.
+   */
+  virtual void SendIsoSdus(std::vector<BT_HDR*> sdus);
+
+  /**
+   * Drops an SDU from AcquireIsoSdu() and returns its credit.
+   *
+   * @param sdu SDU to release. The ownership of sdu is transferred.
+   */
+  virtual void ReleaseIsoSdu(BT_HDR* sdu);
+
+  /**
+   * Returns where the payload of an SDU from AcquireIsoSdu() starts.
+   */
+  static uint8_t* GetIsoSduPayload(BT_HDR* sdu) {
+    return sdu->data + sdu->offset + iso_manager::kIsoSduHeaderLen;
+  }
+
   /**
    * Creates the Broadcast Isochronous Group
    *
@@ -47,6 +47,9 @@ constexpr uint8_t kIsoDataPathDirectionOut = 0x01;
 constexpr uint8_t kRemoveIsoDataPathDirectionInput = 0x01;
 constexpr uint8_t kRemoveIsoDataPathDirectionOutput = 0x02;
 
+/* Handle, data load length, timestamp, sequence number and SDU length */
+constexpr uint8_t kIsoSduHeaderLen = 12;
+
 constexpr uint8_t kIsoDataPathHci = 0x00;
 constexpr uint8_t kIsoDataPathPlatformDefault = 0x01;
 constexpr uint8_t kIsoDataPathDisabled = 0xFF;
@@ -22,6 +22,7 @@
 #include <base/callback_forward.h>
 
 #include <cstdint>
+#include <vector>
 
 #include "bt_target.h"
 #include "device/include/esco_parameters.h"
@@ -31,6 +32,7 @@
 #include "types/raw_address.h"
 
 void bte_main_hci_send(BT_HDR* p_msg, uint16_t event);
+void bte_main_hci_send_batch(std::vector<BT_HDR*> p_msgs, uint16_t event);
 
 /* Message by message.... */
 
@@ -344,8 +344,8 @@ extern tPAN_RESULT PAN_Disconnect(uint16_t handle);
  *                  on GN or NAP side and the packet is multicast or broadcast
  *                  it will be sent on all the links. Otherwise the correct link
  *                  is found based on the destination address and forwarded on
- *                  it. If the return value is not PAN_SUCCESS the application
- *                  should take care of releasing the message buffer
+ *                  it. The data is copied, so the application always keeps
+ *                  |p_data|, and the data is dropped if it cannot be sent
  *
  * Parameters:      dst      - MAC or BD Addr of the destination device
  *                  src      - MAC or BD Addr of the source who sent this packet
@@ -355,6 +355,7 @@ extern tPAN_RESULT PAN_Disconnect(uint16_t handle);
  *                  ext      - to indicate that extension headers present
  *
  * Returns          PAN_SUCCESS       - if the data is sent successfully
+ *                  PAN_Q_SIZE_EXCEEDED - if the connection queue is full
  *                  PAN_FAILURE       - if the connection is not found or
  *                                           there is an error in sending data
  *
@@ -371,8 +372,9 @@ extern tPAN_RESULT PAN_Write(uint16_t handle, const RawAddress& dst,
  *                  on GN or NAP side and the packet is multicast or broadcast
  *                  it will be sent on all the links. Otherwise the correct link
  *                  is found based on the destination address and forwarded on
- *                  it. If the return value is not PAN_SUCCESS the application
- *                  should take care of releasing the message buffer
+ *                  it. The message buffer is consumed, except when
+ *                  PAN_Q_SIZE_EXCEEDED is returned: the application then
+ *                  keeps it, e.g. to send it again later
  *
  * Parameters:      dst      - MAC or BD Addr of the destination device
  *                  src      - MAC or BD Addr of the source who sent this packet
@@ -381,6 +383,7 @@ extern tPAN_RESULT PAN_Write(uint16_t handle, const RawAddress& dst,
  *                  ext      - to indicate that extension headers present
  *
  * Returns          PAN_SUCCESS       - if the data is sent successfully
+ *                  PAN_Q_SIZE_EXCEEDED - if the connection queue is full
  *                  PAN_FAILURE       - if the connection is not found or
  *                                           there is an error in sending data
  *
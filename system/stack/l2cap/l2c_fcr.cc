@@ -242,7 +242,7 @@ BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
    * the FCS (Frame Check Sequence) at the end of the buffer.
    */
   uint16_t buf_size = no_of_bytes + sizeof(BT_HDR) + new_offset + L2CAP_FCS_LEN;
-  BT_HDR* p_buf2 = (BT_HDR*)osi_malloc(buf_size);
+  BT_HDR* p_buf2 = (BT_HDR*)osi_buffer_malloc(buf_size);
 
   p_buf2->offset = new_offset;
   p_buf2->len = no_of_bytes;
@@ -402,7 +402,7 @@ void l2c_fcr_send_S_frame(tL2C_CCB* p_ccb, uint16_t function_code,
   ctrl_word |= (p_ccb->fcrb.next_seq_expected << L2CAP_FCR_REQ_SEQ_BITS_SHIFT);
   ctrl_word |= pf_bit;
 
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(L2CAP_CMD_BUF_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_buffer_malloc(L2CAP_CMD_BUF_SIZE);
   p_buf->offset = HCI_DATA_PREAMBLE_SIZE;
   p_buf->len = L2CAP_PKT_OVERHEAD + L2CAP_FCR_OVERHEAD;
 
@@ -722,7 +722,7 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
       return;
     }
 
-    p_data = (BT_HDR*)osi_malloc(BT_HDR_SIZE + sdu_length);
+    p_data = (BT_HDR*)osi_buffer_malloc(BT_HDR_SIZE + sdu_length);
     if (p_data == NULL) {
       osi_free(p_buf);
       return;
@@ -1202,7 +1202,7 @@ static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
                             p_fcrb->rx_sdu_len, p_ccb->max_rx_mtu);
         packet_ok = false;
       } else {
-        p_fcrb->p_rx_sdu = (BT_HDR*)osi_malloc(
+        p_fcrb->p_rx_sdu = (BT_HDR*)osi_buffer_malloc(
             BT_HDR_SIZE + OBX_BUF_MIN_OFFSET + p_fcrb->rx_sdu_len);
         p_fcrb->p_rx_sdu->offset = OBX_BUF_MIN_OFFSET;
         p_fcrb->p_rx_sdu->len = 0;
@@ -401,7 +401,8 @@ tPAN_RESULT PAN_Disconnect(uint16_t handle) {
  *                  on GN or NAP side and the packet is multicast or broadcast
  *                  it will be sent on all the links. Otherwise the correct link
  *                  is found based on the destination address and forwarded on
- *                  it.
+ *                  it. The data is copied, so the application always keeps
+ *                  |p_data|, and the data is dropped if it cannot be sent.
  *
  * Parameters:      handle   - handle for the connection
  *                  dst      - MAC or BD Addr of the destination device
@@ -412,6 +413,7 @@ tPAN_RESULT PAN_Disconnect(uint16_t handle) {
  *                  ext      - to indicate that extension headers present
  *
  * Returns          PAN_SUCCESS       - if the data is sent successfully
+ *                  PAN_Q_SIZE_EXCEEDED - if the connection queue is full
  *                  PAN_FAILURE       - if the connection is not found or
  *                                           there is an error in sending data
  *
@@ -443,7 +445,10 @@ tPAN_RESULT PAN_Write(uint16_t handle, const RawAddress& dst,
   memcpy((uint8_t*)buffer + sizeof(BT_HDR) + buffer->offset, p_data,
          buffer->len);
 
-  return PAN_WriteBuf(handle, dst, src, protocol, buffer, ext);
+  tPAN_RESULT result = PAN_WriteBuf(handle, dst, src, protocol, buffer, ext);
+  /* The buffer is handed back on a full queue, but the caller never sees it */
+  if (result == PAN_Q_SIZE_EXCEEDED) osi_free(buffer);
+  return result;
 }
 
 /*******************************************************************************
@@ -454,8 +459,9 @@ tPAN_RESULT PAN_Write(uint16_t handle, const RawAddress& dst,
  *                  on GN or NAP side and the packet is multicast or broadcast
  *                  it will be sent on all the links. Otherwise the correct link
  *                  is found based on the destination address and forwarded on
- *                  it. If the return value is not PAN_SUCCESS, the application
- *                  should take care of releasing the message buffer.
+ *                  it. The message buffer is consumed, except when
+ *                  PAN_Q_SIZE_EXCEEDED is returned: the application then
+ *                  keeps it, e.g. to send it again later.
  *
  * Parameters:      handle   - handle for the connection
  *                  dst      - MAC or BD Addr of the destination device
@@ -465,6 +471,7 @@ tPAN_RESULT PAN_Write(uint16_t handle, const RawAddress& dst,
  *                  ext      - to indicate that extension headers present
  *
  * Returns          PAN_SUCCESS       - if the data is sent successfully
+ *                  PAN_Q_SIZE_EXCEEDED - if the connection queue is full
  *                  PAN_FAILURE       - if the connection is not found or
  *                                           there is an error in sending data
  *
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "a2dp_pcm_conditioner.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// One SBC frame of 16 blocks of 8 subbands, the unit the SBC encoder reads
+constexpr size_t kFrameSize = 128;
+
+// Converts one second of output per iteration, from
+// state.range(0) Hz state.range(1) bit stereo to state.range(2) Hz stereo
+void BM_ConvertOneSecond(State& state) {
+  auto src_sample_rate = static_cast<uint32_t>(state.range(0));
+  auto src_bits_per_sample = static_cast<uint8_t>(state.range(1));
+  auto dst_sample_rate = static_cast<uint32_t>(state.range(2));
+
+  A2dpPcmConditioner conditioner;
+  if (!conditioner.Init(src_sample_rate, src_bits_per_sample, 2,
+                        dst_sample_rate, 2)) {
+    state.SkipWithError("Unsupported conversion");
+    return;
+  }
+
+  // Enough source for any frame, the content does not change the cost
+  std::vector<uint8_t> src(kFrameSize * 8 * src_bits_per_sample);
+  std::mt19937 gen(0xa2d9);
+  for (auto& byte : src) byte = gen();
+  std::vector<int16_t> dst(kFrameSize * 2);
+
+  size_t num_frames = dst_sample_rate / kFrameSize;
+  for (auto _ : state) {
+    for (size_t i = 0; i < num_frames; i++) {
+      conditioner.Process(src.data(), dst.data(), kFrameSize);
+    }
+    benchmark::DoNotOptimize(dst.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * num_frames * kFrameSize);
+}
+
+BENCHMARK(BM_ConvertOneSecond)
+    ->Args({48000, 16, 48000})
+    ->Args({48000, 24, 48000})
+    ->Args({44100, 16, 48000})
+    ->Args({48000, 16, 44100})
+    ->Args({16000, 16, 48000})
+    ->Args({48000, 32, 16000});
+
+}  // namespace
+
+BENCHMARK_MAIN();
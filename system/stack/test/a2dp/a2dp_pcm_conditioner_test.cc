@@ -0,0 +1,181 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "a2dp_pcm_conditioner.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// One SBC frame of 16 blocks of 8 subbands
+constexpr size_t kFrameSize = 128;
+
+std::vector<uint8_t> Tone(uint32_t sample_rate, double frequency,
+                          size_t num_frames, uint8_t channel_count) {
+  std::vector<uint8_t> pcm;
+  for (size_t i = 0; i < num_frames; i++) {
+    auto sample = static_cast<int16_t>(
+        16000 * std::sin(2 * M_PI * frequency * i / sample_rate));
+    for (uint8_t channel = 0; channel < channel_count; channel++) {
+      pcm.push_back(sample & 0xff);
+      pcm.push_back((sample >> 8) & 0xff);
+    }
+  }
+  return pcm;
+}
+
+// Converts |src| frame by frame, as the SBC encoder reads it, and returns the
+// output of channel 0
+std::vector<int16_t> Convert(A2dpPcmConditioner& conditioner,
+                             const std::vector<uint8_t>& src,
+                             uint8_t dst_channel_count) {
+  std::vector<int16_t> output;
+  std::vector<int16_t> frame(kFrameSize * dst_channel_count);
+  size_t offset = 0;
+  while (offset + conditioner.SourceBytesNeeded(kFrameSize) <= src.size()) {
+    size_t num_bytes = conditioner.SourceBytesNeeded(kFrameSize);
+    conditioner.Process(src.data() + offset, frame.data(), kFrameSize);
+    offset += num_bytes;
+    for (size_t i = 0; i < kFrameSize; i++) {
+      output.push_back(frame[i * dst_channel_count]);
+    }
+  }
+  return output;
+}
+
+double Rms(const std::vector<int16_t>& samples, size_t skip) {
+  double sum = 0;
+  for (size_t i = skip; i < samples.size(); i++) {
+    sum += static_cast<double>(samples[i]) * samples[i];
+  }
+  return std::sqrt(sum / (samples.size() - skip));
+}
+
+TEST(A2dpPcmConditionerTest, passthrough) {
+  A2dpPcmConditioner conditioner;
+  ASSERT_FALSE(conditioner.IsConfigured());
+  ASSERT_TRUE(conditioner.Init(44100, 16, 2, 44100, 2));
+  ASSERT_TRUE(conditioner.IsConfigured());
+  ASSERT_TRUE(conditioner.IsPassthrough());
+  ASSERT_EQ(conditioner.SourceBytesNeeded(kFrameSize), kFrameSize * 4);
+
+  ASSERT_TRUE(conditioner.Init(96000, 24, 2, 96000, 2, 24));
+  ASSERT_TRUE(conditioner.IsPassthrough());
+  ASSERT_EQ(conditioner.SourceBytesNeeded(kFrameSize), kFrameSize * 6);
+
+  ASSERT_TRUE(conditioner.Init(44100, 24, 2, 44100, 2));
+  ASSERT_FALSE(conditioner.IsPassthrough());
+  ASSERT_TRUE(conditioner.Init(44100, 16, 1, 44100, 2));
+  ASSERT_FALSE(conditioner.IsPassthrough());
+
+  ASSERT_FALSE(conditioner.Init(44100, 12, 2, 44100, 2));
+  ASSERT_FALSE(conditioner.IsConfigured());
+  ASSERT_FALSE(conditioner.Init(44100, 16, 6, 44100, 2));
+  ASSERT_FALSE(conditioner.IsConfigured());
+  // Only 16 bit PCM is produced by a conversion
+  ASSERT_FALSE(conditioner.Init(44100, 24, 2, 48000, 2, 24));
+  ASSERT_FALSE(conditioner.IsConfigured());
+}
+
+TEST(A2dpPcmConditionerTest, bit_depth_and_channels) {
+  A2dpPcmConditioner conditioner;
+  int16_t output[4];
+
+  ASSERT_TRUE(conditioner.Init(48000, 8, 1, 48000, 2));
+  std::vector<uint8_t> pcm8 = {0x00, 0xff};
+  conditioner.Process(pcm8.data(), output, 2);
+  ASSERT_EQ(output[0], -32768);
+  ASSERT_EQ(output[1], -32768);
+  ASSERT_EQ(output[2], 127 * 256);
+
+  ASSERT_TRUE(conditioner.Init(48000, 24, 2, 48000, 2));
+  std::vector<uint8_t> pcm24 = {0x80, 0x34, 0x12, 0x00, 0x00, 0x80,
+                                0xff, 0xff, 0x7f, 0x00, 0x01, 0x00};
+  ASSERT_EQ(conditioner.SourceBytesNeeded(2), pcm24.size());
+  conditioner.Process(pcm24.data(), output, 2);
+  ASSERT_EQ(output[0], 0x1235);
+  ASSERT_EQ(output[1], -32768);
+  // Rounding saturates instead of wrapping
+  ASSERT_EQ(output[2], 32767);
+  ASSERT_EQ(output[3], 1);
+
+  ASSERT_TRUE(conditioner.Init(48000, 32, 2, 48000, 1));
+  std::vector<uint8_t> pcm32 = {0x00, 0x00, 0x00, 0x40,
+                                0x00, 0x00, 0x00, 0x20};
+  conditioner.Process(pcm32.data(), output, 1);
+  ASSERT_EQ(output[0], (0x4000 + 0x2000) / 2);
+}
+
+TEST(A2dpPcmConditionerTest, resampled_frame_sizes) {
+  A2dpPcmConditioner conditioner;
+  ASSERT_TRUE(conditioner.Init(44100, 16, 2, 48000, 2));
+  size_t num_bytes = 0;
+  std::vector<uint8_t> src(kFrameSize * 4);
+  std::vector<int16_t> dst(kFrameSize * 2);
+  for (int i = 0; i < 375; i++) {
+    size_t needed = conditioner.SourceBytesNeeded(kFrameSize);
+    ASSERT_LE(needed, src.size());
+    conditioner.Process(src.data(), dst.data(), kFrameSize);
+    num_bytes += needed;
+  }
+  // One second of output takes one second of input, give or take a frame
+  ASSERT_NEAR(num_bytes / 4.0, 44100, 1);
+}
+
+TEST(A2dpPcmConditionerTest, constant_input_stays_constant) {
+  A2dpPcmConditioner conditioner;
+  ASSERT_TRUE(conditioner.Init(16000, 16, 1, 48000, 2));
+  std::vector<uint8_t> src;
+  for (size_t i = 0; i < 16000; i++) {
+    src.push_back(0x10);
+    src.push_back(0x27);  // 10000
+  }
+  std::vector<int16_t> output = Convert(conditioner, src, 2);
+  ASSERT_GT(output.size(), 40000u);
+  for (size_t i = 256; i < output.size(); i++) {
+    ASSERT_NEAR(output[i], 10000, 2) << "at " << i;
+  }
+}
+
+TEST(A2dpPcmConditionerTest, passband_tone_is_kept) {
+  for (auto rates : {std::pair<uint32_t, uint32_t>{44100, 48000},
+                     {48000, 44100},
+                     {32000, 48000},
+                     {48000, 16000}}) {
+    A2dpPcmConditioner conditioner;
+    ASSERT_TRUE(conditioner.Init(rates.first, 16, 2, rates.second, 2));
+    std::vector<uint8_t> src = Tone(rates.first, 1000, rates.first, 2);
+    std::vector<int16_t> output = Convert(conditioner, src, 2);
+    // The RMS of a full scale sine is its amplitude over sqrt(2)
+    ASSERT_NEAR(Rms(output, 512), 16000 / std::sqrt(2), 16000 * 0.02)
+        << rates.first << " to " << rates.second;
+  }
+}
+
+TEST(A2dpPcmConditionerTest, tone_above_output_nyquist_is_removed) {
+  A2dpPcmConditioner conditioner;
+  ASSERT_TRUE(conditioner.Init(48000, 16, 2, 16000, 2));
+  std::vector<uint8_t> src = Tone(48000, 12000, 48000, 2);
+  std::vector<int16_t> output = Convert(conditioner, src, 2);
+  // At least 40 dB down
+  ASSERT_LT(Rms(output, 512), 16000 / std::sqrt(2) / 100);
+}
+
+}  // namespace
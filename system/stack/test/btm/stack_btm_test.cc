@@ -394,3 +394,45 @@ TEST_F(StackBtmWithInitFreeTest, BTM_SetEncryption) {
 
   wipe_secrets_and_remove(device_record);
 }
+
+TEST_F(StackBtmWithInitFreeTest, btm_find_dev_follows_record_changes) {
+  const RawAddress bd_addr1 = RawAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x01});
+  const RawAddress bd_addr2 = RawAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x02});
+  const RawAddress bd_addr3 = RawAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x03});
+
+  tBTM_SEC_DEV_REC* device_record1 = btm_sec_allocate_dev_rec();
+  device_record1->bd_addr = bd_addr1;
+  device_record1->hci_handle = 0x0001;
+  device_record1->ble_hci_handle = HCI_INVALID_HANDLE;
+  tBTM_SEC_DEV_REC* device_record2 = btm_sec_allocate_dev_rec();
+  device_record2->bd_addr = bd_addr2;
+  device_record2->hci_handle = HCI_INVALID_HANDLE;
+  device_record2->ble_hci_handle = 0x0002;
+
+  // Repeated lookups, served from the index after the first one
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(device_record1, btm_find_dev(bd_addr1));
+    ASSERT_EQ(device_record2, btm_find_dev(bd_addr2));
+    ASSERT_EQ(nullptr, btm_find_dev(bd_addr3));
+    ASSERT_EQ(device_record1, btm_find_dev_by_handle(0x0001));
+    ASSERT_EQ(device_record2, btm_find_dev_by_handle(0x0002));
+    ASSERT_EQ(nullptr, btm_find_dev_by_handle(0x0003));
+  }
+
+  // Fields written directly must not leave a stale answer behind
+  device_record2->ble_hci_handle = 0x0003;
+  ASSERT_EQ(nullptr, btm_find_dev_by_handle(0x0002));
+  ASSERT_EQ(device_record2, btm_find_dev_by_handle(0x0003));
+  device_record1->bd_addr = bd_addr3;
+  ASSERT_EQ(nullptr, btm_find_dev(bd_addr1));
+  ASSERT_EQ(device_record1, btm_find_dev(bd_addr3));
+  device_record1->ble.pseudo_addr = bd_addr1;
+  ASSERT_EQ(device_record1, btm_find_dev(bd_addr1));
+
+  wipe_secrets_and_remove(device_record2);
+  ASSERT_EQ(nullptr, btm_find_dev(bd_addr2));
+  ASSERT_EQ(nullptr, btm_find_dev_by_handle(0x0003));
+  ASSERT_EQ(device_record1, btm_find_dev(bd_addr3));
+
+  wipe_secrets_and_remove(device_record1);
+}
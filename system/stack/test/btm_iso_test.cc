@@ -46,12 +46,15 @@ namespace bte {
 class BteInterface {
  public:
   virtual void HciSend(BT_HDR* p_msg, uint16_t event) = 0;
+  virtual void HciSendBatch(std::vector<BT_HDR*>& p_msgs, uint16_t event) = 0;
   virtual ~BteInterface() = default;
 };
 
 class MockBteInterface : public BteInterface {
  public:
   MOCK_METHOD((void), HciSend, (BT_HDR * p_msg, uint16_t event), (override));
+  MOCK_METHOD((void), HciSendBatch,
+              (std::vector<BT_HDR*> & p_msgs, uint16_t event), (override));
 };
 
 static MockBteInterface* bte_interface = nullptr;
@@ -65,6 +68,11 @@ void bte_main_hci_send(BT_HDR* p_msg, uint16_t event) {
   osi_free(p_msg);
 }
 
+void bte_main_hci_send_batch(std::vector<BT_HDR*> p_msgs, uint16_t event) {
+  bte::bte_interface->HciSendBatch(p_msgs, event);
+  for (BT_HDR* p_msg : p_msgs) osi_free(p_msg);
+}
+
 namespace {
 class MockCigCallbacks : public bluetooth::hci::iso_manager::CigCallbacks {
  public:
@@ -2119,6 +2127,185 @@ TEST_F(IsoManagerTest, SendIsoDataCreditsReturnedByDisconnection) {
   }
 }
 
+TEST_F(IsoManagerTest, AcquiredIsoSdusAfterDisconnection) {
+  uint8_t num_buffers = controller_interface_.GetIsoBufferCount();
+
+  IsoManager::GetInstance()->CreateCig(
+      volatile_test_cig_create_cmpl_evt_.cig_id, kDefaultCigParams);
+
+  bluetooth::hci::iso_manager::cis_establish_params params;
+  for (auto& handle : volatile_test_cig_create_cmpl_evt_.conn_handles) {
+    params.conn_pairs.push_back({handle, 1});
+  }
+  IsoManager::GetInstance()->EstablishCis(params);
+
+  for (auto& handle : volatile_test_cig_create_cmpl_evt_.conn_handles) {
+    IsoManager::GetInstance()->SetupIsoDataPath(handle,
+                                                kDefaultIsoDataPathParams);
+  }
+
+  /* Take all the credits on the first CIS */
+  uint16_t handle = volatile_test_cig_create_cmpl_evt_.conn_handles[0];
+  std::vector<BT_HDR*> sdus;
+  for (uint8_t i = 0; i < num_buffers; i++) {
+    BT_HDR* sdu = IsoManager::GetInstance()->AcquireIsoSdu(handle, 108);
+    ASSERT_NE(sdu, nullptr);
+    sdus.push_back(sdu);
+  }
+
+  /* The disconnection reclaims the credits of the SDUs still held */
+  IsoManager::GetInstance()->HandleDisconnect(handle, 16);
+
+  /* Neither sending nor releasing them returns the credits a second time */
+  EXPECT_CALL(bte_interface_, HciSendBatch).Times(0);
+  IsoManager::GetInstance()->ReleaseIsoSdu(sdus.back());
+  sdus.pop_back();
+  IsoManager::GetInstance()->SendIsoSdus(std::move(sdus));
+
+  uint16_t other_handle = volatile_test_cig_create_cmpl_evt_.conn_handles[1];
+  std::vector<BT_HDR*> other_sdus;
+  for (uint8_t i = 0; i < num_buffers; i++) {
+    BT_HDR* sdu = IsoManager::GetInstance()->AcquireIsoSdu(other_handle, 108);
+    ASSERT_NE(sdu, nullptr);
+    other_sdus.push_back(sdu);
+  }
+  ASSERT_EQ(IsoManager::GetInstance()->AcquireIsoSdu(other_handle, 108),
+            nullptr);
+  for (auto sdu : other_sdus) IsoManager::GetInstance()->ReleaseIsoSdu(sdu);
+}
+
+TEST_F(IsoManagerTest, SendIsoSdusBigValid) {
+  constexpr uint16_t data_len = 108;
+  IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
+                                       kDefaultBigParams);
+
+  std::vector<BT_HDR*> sdus;
+  for (auto& handle : volatile_test_big_params_evt_.conn_handles) {
+    IsoManager::GetInstance()->SetupIsoDataPath(handle,
+                                                kDefaultIsoDataPathParams);
+    BT_HDR* sdu = IsoManager::GetInstance()->AcquireIsoSdu(handle, data_len);
+    ASSERT_NE(sdu, nullptr);
+    memset(IsoManager::GetIsoSduPayload(sdu), handle & 0xFF, data_len);
+    sdus.push_back(sdu);
+  }
+
+  /* Every channel of the interval goes down in a single batch */
+  EXPECT_CALL(bte_interface_, HciSend).Times(0);
+  EXPECT_CALL(bte_interface_, HciSendBatch)
+      .WillOnce([this, data_len](std::vector<BT_HDR*>& p_msgs,
+                                 uint16_t event) {
+        ASSERT_TRUE((event & MSG_STACK_TO_HC_HCI_ISO) != 0);
+        ASSERT_EQ(p_msgs.size(),
+                  volatile_test_big_params_evt_.conn_handles.size());
+
+        uint32_t batch_ts = 0;
+        for (size_t i = 0; i < p_msgs.size(); i++) {
+          BT_HDR* p_msg = p_msgs[i];
+          uint8_t* p = p_msg->data + p_msg->offset;
+          ASSERT_TRUE(p_msg->layer_specific & BT_ISO_HDR_CONTAINS_TS);
+          ASSERT_EQ(p_msg->len, data_len + 12);
+
+          uint16_t msg_handle;
+          STREAM_TO_UINT16(msg_handle, p);
+          ASSERT_EQ(msg_handle, volatile_test_big_params_evt_.conn_handles[i]);
+
+          uint16_t iso_load_len;
+          STREAM_TO_UINT16(iso_load_len, p);
+          ASSERT_EQ(iso_load_len, data_len + 8);
+
+          uint32_t ts;
+          STREAM_TO_UINT32(ts, p);
+          if (i == 0) batch_ts = ts;
+          ASSERT_EQ(ts, batch_ts);
+          STREAM_SKIP_UINT16(p);  // skip seq_nb
+
+          uint16_t msg_data_len;
+          STREAM_TO_UINT16(msg_data_len, p);
+          ASSERT_EQ(msg_data_len, data_len);
+
+          for (uint16_t j = 0; j < data_len; j++) {
+            ASSERT_EQ(p[j], msg_handle & 0xFF);
+          }
+        }
+      });
+  IsoManager::GetInstance()->SendIsoSdus(std::move(sdus));
+}
+
+TEST_F(IsoManagerTest, AcquireIsoSduNoCredits) {
+  uint8_t num_buffers = controller_interface_.GetIsoBufferCount();
+
+  IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
+                                       kDefaultBigParams);
+  uint16_t handle = volatile_test_big_params_evt_.conn_handles[0];
+  IsoManager::GetInstance()->SetupIsoDataPath(handle,
+                                              kDefaultIsoDataPathParams);
+
+  /* No SDU is handed out once all the credits are charged to the BIS */
+  std::vector<BT_HDR*> sdus;
+  for (uint8_t i = 0; i < num_buffers; i++) {
+    BT_HDR* sdu = IsoManager::GetInstance()->AcquireIsoSdu(handle, 108);
+    ASSERT_NE(sdu, nullptr);
+    sdus.push_back(sdu);
+  }
+  ASSERT_EQ(IsoManager::GetInstance()->AcquireIsoSdu(handle, 108), nullptr);
+
+  /* A released SDU returns its credit */
+  IsoManager::GetInstance()->ReleaseIsoSdu(sdus.back());
+  sdus.pop_back();
+  BT_HDR* sdu = IsoManager::GetInstance()->AcquireIsoSdu(handle, 108);
+  ASSERT_NE(sdu, nullptr);
+  sdus.push_back(sdu);
+
+  EXPECT_CALL(bte_interface_, HciSendBatch).Times(1);
+  IsoManager::GetInstance()->SendIsoSdus(std::move(sdus));
+  ASSERT_EQ(IsoManager::GetInstance()->AcquireIsoSdu(handle, 108), nullptr);
+
+  /* The credits come back with the completed packets of the BIS */
+  uint8_t mock_rsp[5];
+  uint8_t* p = mock_rsp;
+  UINT8_TO_STREAM(p, 1);
+  UINT16_TO_STREAM(p, handle);
+  UINT16_TO_STREAM(p, 1);
+  IsoManager::GetInstance()->HandleNumComplDataPkts(mock_rsp, sizeof(mock_rsp));
+
+  sdu = IsoManager::GetInstance()->AcquireIsoSdu(handle, 108);
+  ASSERT_NE(sdu, nullptr);
+  IsoManager::GetInstance()->ReleaseIsoSdu(sdu);
+}
+
+TEST_F(IsoManagerTest, SendIsoDataCreditsReturnedByBigTermination) {
+  uint8_t num_buffers = controller_interface_.GetIsoBufferCount();
+  std::vector<uint8_t> data_vec(108, 0);
+
+  IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
+                                       kDefaultBigParams);
+  IsoManager::GetInstance()->SetupIsoDataPath(
+      volatile_test_big_params_evt_.conn_handles[0], kDefaultIsoDataPathParams);
+
+  EXPECT_CALL(bte_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
+  for (uint8_t i = 0; i < num_buffers; i++) {
+    IsoManager::GetInstance()->SendIsoData(
+        volatile_test_big_params_evt_.conn_handles[0], data_vec.data(),
+        data_vec.size());
+  }
+
+  /* Terminating the BIG returns the credits held by its BISes */
+  IsoManager::GetInstance()->TerminateBig(volatile_test_big_params_evt_.big_id,
+                                          0x16);
+
+  IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
+                                       kDefaultBigParams);
+  IsoManager::GetInstance()->SetupIsoDataPath(
+      volatile_test_big_params_evt_.conn_handles[0], kDefaultIsoDataPathParams);
+
+  EXPECT_CALL(bte_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
+  for (uint8_t i = 0; i < num_buffers; i++) {
+    IsoManager::GetInstance()->SendIsoData(
+        volatile_test_big_params_evt_.conn_handles[0], data_vec.data(),
+        data_vec.size());
+  }
+}
+
 TEST_F(IsoManagerDeathTest, SendIsoDataWithNoDataPath) {
   std::vector<uint8_t> data_vec(108, 0);
 
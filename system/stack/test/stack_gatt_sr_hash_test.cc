@@ -87,3 +87,45 @@ TEST(GattDatabaseTest, matchExampleInBtSpecV52) {
 
   ASSERT_EQ(result_hash, expected_hash);
 }
+
+TEST(GattDatabaseTest, serviceHashBlockRebuiltOnlyForChangedService) {
+  tGATT_SVC_DB local_db[2];
+  tGATT_SVC_DB fresh_db[2];
+  std::list<tGATT_SRV_LIST_ELEM> srv_list_info;
+  std::list<tGATT_SRV_LIST_ELEM> fresh_srv_list_info;
+
+  add_item_to_list(srv_list_info, &local_db[0], true);
+  gatts_init_service_db(local_db[0], Uuid::From16Bit(0x1800), true, 0x0001, 5);
+  gatts_add_characteristic(local_db[0], GATT_PERM_READ, GATT_CHAR_PROP_BIT_READ,
+    Uuid::From16Bit(0x2A00));
+  add_item_to_list(srv_list_info, &local_db[1], true);
+  gatts_init_service_db(local_db[1], Uuid::From16Bit(0x1801), true, 0x0006, 4);
+  gatts_add_characteristic(local_db[1], 0, GATT_CHAR_PROP_BIT_INDICATE,
+    Uuid::From16Bit(0x2A05));
+
+  gatts_calculate_database_hash(&srv_list_info);
+  ASSERT_FALSE(local_db[0].hash_block.empty());
+  ASSERT_FALSE(local_db[1].hash_block.empty());
+  std::vector<uint8_t> unchanged_block = local_db[1].hash_block;
+
+  gatts_add_characteristic(local_db[0], GATT_PERM_READ, GATT_CHAR_PROP_BIT_READ,
+    Uuid::From16Bit(0x2A01));
+  ASSERT_TRUE(local_db[0].hash_block.empty());
+  ASSERT_EQ(local_db[1].hash_block, unchanged_block);
+
+  add_item_to_list(fresh_srv_list_info, &fresh_db[0], true);
+  gatts_init_service_db(fresh_db[0], Uuid::From16Bit(0x1800), true, 0x0001, 5);
+  gatts_add_characteristic(fresh_db[0], GATT_PERM_READ, GATT_CHAR_PROP_BIT_READ,
+    Uuid::From16Bit(0x2A00));
+  gatts_add_characteristic(fresh_db[0], GATT_PERM_READ, GATT_CHAR_PROP_BIT_READ,
+    Uuid::From16Bit(0x2A01));
+  add_item_to_list(fresh_srv_list_info, &fresh_db[1], true);
+  gatts_init_service_db(fresh_db[1], Uuid::From16Bit(0x1801), true, 0x0006, 4);
+  gatts_add_characteristic(fresh_db[1], 0, GATT_CHAR_PROP_BIT_INDICATE,
+    Uuid::From16Bit(0x2A05));
+
+  ASSERT_EQ(gatts_calculate_database_hash(&srv_list_info),
+            gatts_calculate_database_hash(&fresh_srv_list_info));
+  ASSERT_EQ(local_db[0].hash_block, fresh_db[0].hash_block);
+  ASSERT_EQ(local_db[1].hash_block, fresh_db[1].hash_block);
+}
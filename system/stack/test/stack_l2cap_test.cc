@@ -65,3 +65,32 @@ TEST_F(StackL2capTest, l2cble_process_data_length_change_event) {
   l2cble_process_data_length_change_event(0x1234, 0x001b, 0x001b);
   ASSERT_EQ(0x001b, l2cb.lcb_pool[0].tx_data_len);
 }
+
+TEST_F(StackL2capTest, l2cu_find_lcb_after_link_reuse) {
+  const RawAddress bd_addr = RawAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x66});
+
+  l2cb.lcb_pool[0].in_use = true;
+  l2cb.lcb_pool[0].transport = BT_TRANSPORT_LE;
+  l2cb.lcb_pool[0].remote_bd_addr = bd_addr;
+  l2cu_set_lcb_handle(l2cb.lcb_pool[0], 0x0040);
+
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(&l2cb.lcb_pool[0], l2cu_find_lcb_by_handle(0x0040));
+    ASSERT_EQ(&l2cb.lcb_pool[0],
+              l2cu_find_lcb_by_bd_addr(bd_addr, BT_TRANSPORT_LE));
+    ASSERT_EQ(nullptr, l2cu_find_lcb_by_bd_addr(bd_addr, BT_TRANSPORT_BR_EDR));
+  }
+
+  // The same peer comes back on another LCB with another handle
+  l2cb.lcb_pool[0].in_use = false;
+  ASSERT_EQ(nullptr, l2cu_find_lcb_by_handle(0x0040));
+  l2cb.lcb_pool[1].in_use = true;
+  l2cb.lcb_pool[1].transport = BT_TRANSPORT_LE;
+  l2cb.lcb_pool[1].remote_bd_addr = bd_addr;
+  l2cu_set_lcb_handle(l2cb.lcb_pool[1], 0x0041);
+
+  ASSERT_EQ(nullptr, l2cu_find_lcb_by_handle(0x0040));
+  ASSERT_EQ(&l2cb.lcb_pool[1], l2cu_find_lcb_by_handle(0x0041));
+  ASSERT_EQ(&l2cb.lcb_pool[1],
+            l2cu_find_lcb_by_bd_addr(bd_addr, BT_TRANSPORT_LE));
+}
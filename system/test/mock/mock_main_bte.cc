@@ -16,7 +16,7 @@
 
 /*
  * Generated mock file from original source file
- *   Functions generated:3
+ *   Functions generated:4
  *
  *  mockcify.pl ver 0.2
  */
@@ -25,6 +25,7 @@
 #include <functional>
 #include <map>
 #include <string>
+#include <vector>
 
 extern std::map<std::string, int> mock_function_count_map;
 
@@ -46,6 +47,7 @@ namespace main_bte {
 // Function state capture and return values, if needed
 struct bte_main_init bte_main_init;
 struct bte_main_hci_send bte_main_hci_send;
+struct bte_main_hci_send_batch bte_main_hci_send_batch;
 
 }  // namespace main_bte
 }  // namespace mock
@@ -60,5 +62,9 @@ void bte_main_hci_send(BT_HDR* p_msg, uint16_t event) {
   mock_function_count_map[__func__]++;
   test::mock::main_bte::bte_main_hci_send(p_msg, event);
 }
+void bte_main_hci_send_batch(std::vector<BT_HDR*> p_msgs, uint16_t event) {
+  mock_function_count_map[__func__]++;
+  test::mock::main_bte::bte_main_hci_send_batch(std::move(p_msgs), event);
+}
 
 // END mockcify generation
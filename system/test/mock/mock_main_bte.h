@@ -16,7 +16,7 @@
 
 /*
  * Generated mock file from original source file
- *   Functions generated:3
+ *   Functions generated:4
  *
  *  mockcify.pl ver 0.2
  */
@@ -25,6 +25,7 @@
 #include <functional>
 #include <map>
 #include <string>
+#include <vector>
 
 extern std::map<std::string, int> mock_function_count_map;
 
@@ -74,6 +75,17 @@ struct bte_main_hci_send {
   void operator()(BT_HDR* p_msg, uint16_t event) { body(p_msg, event); };
 };
 extern struct bte_main_hci_send bte_main_hci_send;
+// Name: bte_main_hci_send_batch
+// Params: std::vector<BT_HDR*> p_msgs, uint16_t event
+// Returns: void
+struct bte_main_hci_send_batch {
+  std::function<void(std::vector<BT_HDR*> p_msgs, uint16_t event)> body{
+      [](std::vector<BT_HDR*> p_msgs, uint16_t event) {}};
+  void operator()(std::vector<BT_HDR*> p_msgs, uint16_t event) {
+    body(std::move(p_msgs), event);
+  };
+};
+extern struct bte_main_hci_send_batch bte_main_hci_send_batch;
 
 }  // namespace main_bte
 }  // namespace mock
@@ -16,7 +16,7 @@
 
 /*
  * Generated mock file from original source file
- *   Functions generated:6
+ *   Functions generated:8
  *
  *  mockcify.pl ver 0.3.0
  */
@@ -38,6 +38,8 @@ namespace mock {
 namespace osi_allocator {
 
 // Function state capture and return values, if needed
+struct osi_buffer_calloc osi_buffer_calloc;
+struct osi_buffer_malloc osi_buffer_malloc;
 struct osi_calloc osi_calloc;
 struct osi_free osi_free;
 struct osi_free_and_reset osi_free_and_reset;
@@ -50,6 +52,14 @@ struct osi_strndup osi_strndup;
 }  // namespace test
 
 // Mocked functions, if any
+void* osi_buffer_calloc(size_t size) {
+  mock_function_count_map[__func__]++;
+  return test::mock::osi_allocator::osi_buffer_calloc(size);
+}
+void* osi_buffer_malloc(size_t size) {
+  mock_function_count_map[__func__]++;
+  return test::mock::osi_allocator::osi_buffer_malloc(size);
+}
 void* osi_calloc(size_t size) {
   mock_function_count_map[__func__]++;
   return test::mock::osi_allocator::osi_calloc(size);
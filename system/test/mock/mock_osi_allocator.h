@@ -16,7 +16,7 @@
 
 /*
  * Generated mock file from original source file
- *   Functions generated:6
+ *   Functions generated:8
  *
  *  mockcify.pl ver 0.3.0
  */
@@ -49,6 +49,28 @@ namespace mock {
 namespace osi_allocator {
 
 // Shared state between mocked functions and tests
+// Name: osi_buffer_calloc
+// Params: size_t size
+// Return: void*
+struct osi_buffer_calloc {
+  void* return_value{};
+  std::function<void*(size_t size)> body{
+      [this](size_t size) { return return_value; }};
+  void* operator()(size_t size) { return body(size); };
+};
+extern struct osi_buffer_calloc osi_buffer_calloc;
+
+// Name: osi_buffer_malloc
+// Params: size_t size
+// Return: void*
+struct osi_buffer_malloc {
+  void* return_value{};
+  std::function<void*(size_t size)> body{
+      [this](size_t size) { return return_value; }};
+  void* operator()(size_t size) { return body(size); };
+};
+extern struct osi_buffer_malloc osi_buffer_malloc;
+
 // Name: osi_calloc
 // Params: size_t size
 // Return: void*
@@ -309,6 +309,14 @@ void* osi_malloc(size_t size) {
   mock_function_count_map[__func__]++;
   return nullptr;
 }
+void* osi_buffer_calloc(size_t size) {
+  mock_function_count_map[__func__]++;
+  return nullptr;
+}
+void* osi_buffer_malloc(size_t size) {
+  mock_function_count_map[__func__]++;
+  return nullptr;
+}
 
 bool fixed_queue_is_empty(fixed_queue_t* queue) {
   mock_function_count_map[__func__]++;